@@ -4,6 +4,8 @@
 #include <vector>
 #include <cstdint>
 #include <cstring>
+#include <memory>
+#include <string>
 
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_vulkan.h>
@@ -19,6 +21,8 @@ int windowWidth = 1280;
 int windowHeight = 720;
 const uint32_t cubeCount = 12;
 const uint32_t shadowMapRes = 2048;
+const float mainPassBudgetMillis = 4.0f;   // dynamic resolution holds the main pass under this
+const bool blitNearest = false;            // upscale filter: nearest or bilinear
 
 struct SDLWindow {
     SDL_Window *window;
@@ -76,9 +80,19 @@ Image createImageFromTGAFile(Commands & commands, const char * filename) {
     return image;
 }
 
+// Prefers vulkan.vktex (vkobjects-cook vulkan.tga vulkan.vktex), which uploads precomputed
+// mips in one copy, over decoding the TGA and generating mips on the GPU.
+Image loadTexture(Commands & commands) {
+    std::ifstream cooked("vulkan.vktex", std::ios::binary);
+    if (!cooked) return createImageFromTGAFile(commands, "vulkan.tga");
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(cooked)), std::istreambuf_iterator<char>());
+    return loadCookedTexture(commands, bytes);
+}
+
 // Push constants — must match all shaders
 struct PushConstants : PushConstantBase<PushConstants> {
-    float viewProjection[16]; // mat4
+    uint32_t drawDataRID;     // DrawDataRing buffer
+    uint32_t globalsSlot;     // FrameGlobals index in it
     uint32_t vertexBufferRID;
     uint32_t textureRID;
     uint32_t shadowMapRID;
@@ -88,6 +102,25 @@ struct PushConstants : PushConstantBase<PushConstants> {
     uint32_t useRT;     // 1 = ray-query shadows, 0 = shadow-map shadows (flips every 1s)
 };
 
+// Per-frame globals, read by cube.mesh from the DrawDataRing
+struct FrameGlobals {
+    float viewProjection[16]; // mat4
+};
+
+// Blit push constants — must match fullscreen.mesh and blit.frag
+struct BlitPush : PushConstantBase<BlitPush> {
+    uint32_t textureRID;
+    uint32_t pad;
+    float uvScale[2];
+};
+
+// Offscreen color target; its sampler sets the blit's upscale filter.
+ImageBuilder offscreenColorBuilder(uint32_t width, uint32_t height) {
+    ImageBuilder builder = ImageBuilder().colorTarget(width, height);
+    if (blitNearest) builder.nearest();
+    return builder;
+}
+
 // Light data stored in a storage buffer (accessed by RID)
 struct LightData {
     float lightViewProjection[16]; // mat4
@@ -106,11 +139,33 @@ mat16f buildLightVP(vec3f lightDir) {
 }
 
 int main(int argc, char *argv[]) {
-    (void)argc;
-    (void)argv;
     SDLWindow window("VulkanApp - Shadow Maps", windowWidth, windowHeight);
 
-    VulkanContext context(window, VulkanContextOptions().validation().meshShaders().rayTracing());
+    // `--capture <pattern>` saves every frame, e.g. --capture "frame_%05u.qoi" (.tga otherwise).
+    // `--render-thread` records and submits each frame on a dedicated thread while the next
+    // frame is simulated. `--present-thread` moves vkQueuePresentKHR off the submitting thread.
+    // `--host-allocations` counts the driver's host allocations and prints them at exit.
+    std::string capturePattern;
+    bool renderThread = false;
+    bool presentThread = false;
+    bool hostAllocations = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--capture" && i + 1 < argc) capturePattern = argv[++i];
+        else if (arg == "--render-thread") renderThread = true;
+        else if (arg == "--present-thread") presentThread = true;
+        else if (arg == "--host-allocations") hostAllocations = true;
+    }
+
+    VulkanContext context(window, VulkanContextOptions().validation().meshShaders().rayTracing()
+                                           .presentThread(presentThread).trackHostAllocations(hostAllocations));
+
+    std::unique_ptr<FrameCapture> capture;
+    if (!capturePattern.empty()) {
+        bool qoi = capturePattern.size() > 4 && capturePattern.compare(capturePattern.size() - 4, 4, ".qoi") == 0;
+        capture = std::make_unique<FrameCapture>(capturePattern, qoi ? CaptureFormat::Qoi : CaptureFormat::Tga);
+    }
+    uint32_t frameCount = 0;
 
     // Shaders
     ShaderModule cubeMeshModule(ShaderBuilder().mesh().fromFile("demo/shaders/cube.mesh.spv"));
@@ -122,7 +177,7 @@ int main(int argc, char *argv[]) {
 
     // One-shot setup
     auto setupCmd = Commands::oneShot();
-    Image textureImage = createImageFromTGAFile(setupCmd, "vulkan.tga");
+    Image textureImage = loadTexture(setupCmd);
 
     // Per-swapchain render targets
     std::vector<Image> depthImages;
@@ -131,18 +186,24 @@ int main(int argc, char *argv[]) {
     for (size_t i = 0; i < context.swapchainImageCount; ++i) {
         depthImages.emplace_back(ImageBuilder().depth(), setupCmd);
         shadowMaps.emplace_back(ImageBuilder().depthSampled(shadowMapRes, shadowMapRes), setupCmd);
-        offscreenColors.emplace_back(ImageBuilder().colorTarget(windowWidth, windowHeight), setupCmd);
+        ImageBuilder colorBuilder = offscreenColorBuilder(windowWidth, windowHeight);
+        offscreenColors.emplace_back(colorBuilder, setupCmd);
     }
     setupCmd.submitAndWait();
 
+    // Main-pass resolution scaling inside the window-sized targets above
+    DynamicResolution dynres({(uint32_t)windowWidth, (uint32_t)windowHeight}, mainPassBudgetMillis);
+
     // Resize callback — recreate depth images and offscreen colors; shadow maps are fixed resolution
     context.onSwapchainResize([&](Commands & cmd, VkExtent2D extent) {
         depthImages.clear();
         offscreenColors.clear();
         for (size_t i = 0; i < context.swapchainImageCount; ++i) {
             depthImages.emplace_back(ImageBuilder().depth(), cmd);
-            offscreenColors.emplace_back(ImageBuilder().colorTarget(extent.width, extent.height), cmd);
+            ImageBuilder colorBuilder = offscreenColorBuilder(extent.width, extent.height);
+            offscreenColors.emplace_back(colorBuilder, cmd);
         }
+        dynres.resize(extent);
     });
 
     // Cube vertex layout the compute pass writes and the BLAS reads (position at offset 0).
@@ -185,7 +246,9 @@ int main(int argc, char *argv[]) {
         .depthOnly()
         .build();
 
-    Pipeline computePipeline = createComputePipeline(cubeCompModule);
+    Pipeline computePipeline = createComputePipeline(cubeCompModule, SpecConstants()
+        .localSize(cubeCompModule.reflection, g_context().subgroupLocalSize(cubeCount))
+        .set(1, cubeCount));
 
     Pipeline blitPipeline = GraphicsPipelineBuilder()
         .meshShader(fullscreenMeshModule)
@@ -199,43 +262,45 @@ int main(int argc, char *argv[]) {
         .lookAt(0.0f, 0.0f, 0.0f)
         .setDistance(0.0f);
 
+    DrawDataRing drawData(16 * 1024);
+    TlasInstances sceneInstances;   // reused so a steady-state frame does not allocate
     PushConstants push = {};
     float totalTime = 0.0f;
 
-    Timer timer;
-    bool done = false;
-    while (!done) {
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_EVENT_QUIT) {
-                done = true;
-            }
-        }
+    // What the simulation hands the render side each frame (FramePacket::state).
+    struct SimState {
+        float viewProjection[16];
+        float totalTime;
+    };
 
+    // Records and submits one frame from the simulation state in `packet`. Runs on the render
+    // thread with --render-thread, inline otherwise.
+    auto renderFrame = [&](FramePacket & packet) {
+        const SimState & sim = packet.state<SimState>();
         Frame frame;
         uint32_t idx = frame.swapchainImageIndex();
 
-        // Accumulate rotation angle for cubes
-        float seconds = (float)timer.elapsed() / 1000.0f;
-        totalTime += seconds;
-
         // Update push constants
-        mat16f vp = camera.getViewProjection();
-        memcpy(push.viewProjection, &vp, sizeof(mat16f));
+        FrameGlobals globals;
+        memcpy(globals.viewProjection, sim.viewProjection, sizeof(globals.viewProjection));
+        drawData.beginFrame();
+        push.drawDataRID = drawData.rid();
+        push.globalsSlot = drawData.write(globals);
+        drawData.flush();
         push.vertexBufferRID = vertexBuffer.rid();
         push.textureRID = textureImage.rid();
         push.shadowMapRID = shadowMaps[idx].rid();
         push.lightBufferRID = lightBuffer.rid();
-        push.rotationAngle = totalTime * (float)M_PI / 6.0f;
+        push.rotationAngle = sim.totalTime * (float)M_PI / 6.0f;
         push.tlasRID = sceneTlas[idx].rid();
-        push.useRT = (((uint32_t)totalTime) % 2u == 0u) ? 1u : 0u;   // flip ray-query vs shadow-map every 1s
+        push.useRT = (((uint32_t)sim.totalTime) % 2u == 0u) ? 1u : 0u;   // flip ray-query vs shadow-map every 1s
 
         auto cmd = frame.beginCommands();
 
         // 1. Compute pass: generate cube geometry
         cmd.bindCompute(computePipeline);
         cmd.pushConstants(push);
-        cmd.dispatch(cubeCount, 1, 1);
+        cmd.dispatchThreads(cubeCount);
 
         // Barrier: compute writes → mesh shader reads AND acceleration-structure build reads
         cmd.bufferBarrier(vertexBuffer, Stage::Compute, Access::ShaderWrite,
@@ -246,7 +311,7 @@ int main(int argc, char *argv[]) {
         cmd.buildBlas(sceneBlas[idx], false);
         VkBuffer blasBacking = sceneBlas[idx].backing();
         cmd.blasToTlasBarrier(std::span<const VkBuffer>(&blasBacking, 1));
-        TlasInstances sceneInstances;
+        sceneInstances.clear();
         sceneInstances.add(sceneBlas[idx], 0);
         cmd.buildTlas(sceneTlas[idx], sceneInstances);
         cmd.tlasToShaderReadBarrier(sceneTlas[idx].backing());
@@ -265,13 +330,15 @@ int main(int argc, char *argv[]) {
             .aspectMask(VK_IMAGE_ASPECT_DEPTH_BIT)
             .record();
 
-        // 3. Main pass: render scene to offscreen color target (not swapchain)
-        VkExtent2D offscreenExtent = {(uint32_t)context.windowWidth, (uint32_t)context.windowHeight};
-        cmd.beginRendering(offscreenColors[idx].imageView, depthImages[idx].imageView, offscreenExtent);
+        // 3. Main pass: render scene to offscreen color target (not swapchain), into the
+        //    top-left sub-rect the dynamic resolution controller picked for this frame
+        dynres.begin(cmd);
+        cmd.beginRendering(offscreenColors[idx].imageView, depthImages[idx].imageView, dynres.extent());
         cmd.bindGraphics(graphicsPipeline);
         cmd.pushConstants(push);
         cmd.drawMeshTasks(cubeCount, 1, 1);
         cmd.endRendering();
+        dynres.end(cmd);
 
         // Barrier: offscreen color → shader readable for blit
         Barrier(cmd).image(offscreenColors[idx], 1)
@@ -286,11 +353,15 @@ int main(int argc, char *argv[]) {
             .aspectMask(VK_IMAGE_ASPECT_DEPTH_BIT)
             .record();
 
-        // 4. Blit pass: sample offscreen texture, draw to swapchain (no depth needed)
+        // 4. Blit pass: upscale the rendered sub-rect to the swapchain (no depth needed)
         cmd.beginRendering();
         cmd.bindGraphics(blitPipeline);
-        uint32_t blitRID = offscreenColors[idx].rid();
-        cmd.pushConstants(&blitRID, sizeof(blitRID));
+        BlitPush blit = {};
+        blit.textureRID = offscreenColors[idx].rid();
+        auto uvScale = dynres.uvScale();
+        blit.uvScale[0] = uvScale[0];
+        blit.uvScale[1] = uvScale[1];
+        cmd.pushConstants(blit);
         cmd.drawMeshTasks(1, 1, 1);
         cmd.endRendering();
 
@@ -300,10 +371,49 @@ int main(int argc, char *argv[]) {
             .to(Stage::ColorOutput, Access::ColorAttachmentWrite, Layout::ColorAttachment)
             .record();
 
+        if (capture) capture->captureSwapchain(cmd);
         frame.submit(cmd);
-    }
+        ++frameCount;
+    };
+
+    RenderThreadOptions renderOptions;
+    if (!renderThread) renderOptions.sameThread();
+    RenderThread renderer(renderFrame, renderOptions);
+
+    Timer timer;
+    bool done = false;
+    while (!done) {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_EVENT_QUIT) {
+                done = true;
+            }
+        }
+
+        // Accumulate rotation angle for cubes
+        float seconds = (float)timer.elapsed() / 1000.0f;
+        totalTime += seconds;
 
-    if (VK_SUCCESS != vkQueueWaitIdle(context.graphicsQueue)) {
-        throw std::runtime_error("failed to wait for the graphics queue to be idle");
+        FramePacket & packet = renderer.beginPacket();
+        SimState & sim = packet.state<SimState>();
+        mat16f vp = camera.getViewProjection();
+        memcpy(sim.viewProjection, &vp, sizeof(mat16f));
+        sim.totalTime = totalTime;
+        renderer.submitPacket();
+    }
+    renderer.flush();
+
+    context.waitIdle();
+    PresentStats presentStats = context.presentStats();
+    if (presentStats.presents > 0) {
+        std::cout << "present: " << presentStats.presentMillis / presentStats.presents << " ms in vkQueuePresentKHR, "
+                  << presentStats.callerMillis / presentStats.presents << " ms on the frame thread (per frame, "
+                  << (presentThread ? "present thread" : "inline") << ")\n";
+    }
+    if (hostAllocations) context.hostAllocations().print(std::cout);
+    if (capture) {
+        capture->flush();
+        std::cout << frameCount << " frames in " << totalTime << " s (" << frameCount / totalTime << " fps), "
+                  << capture->written() << " captured, " << capture->dropped() << " dropped\n";
     }
 }
@@ -8,8 +8,12 @@ layout(set=0, binding=1) uniform sampler2D samplers[];
 
 layout(push_constant) uniform PushConstants {
     uint textureRID;
+    vec2 uvScale;   // rendered sub-rect / texture size (dynamic resolution)
 };
 
 void main() {
-    outColor = texture(samplers[nonuniformEXT(textureRID)], inUV);
+    // Clamp half a texel inside the sub-rect so linear filtering never reads stale texels past it.
+    vec2 texel = 1.0 / vec2(textureSize(samplers[nonuniformEXT(textureRID)], 0));
+    vec2 uv = min(inUV * uvScale, uvScale - 0.5 * texel);
+    outColor = texture(samplers[nonuniformEXT(textureRID)], uv);
 }
@@ -13,7 +13,8 @@ layout(set=0, binding=1) uniform sampler2DShadow shadowSamplers[];
 layout(set=0, binding=3) uniform accelerationStructureEXT tlasTable[];
 
 layout(push_constant) uniform PushConstants {
-    mat4 viewProjection;
+    uint drawDataRID;     // DrawDataRing buffer
+    uint globalsSlot;     // FrameGlobals index in it
     uint vertexBufferRID;
     uint textureRID;
     uint shadowMapRID;
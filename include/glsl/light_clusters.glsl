@@ -0,0 +1,103 @@
+// Clustered light lookup for LightClusterer (vkobjects.h). Include right after #version and
+// the #extension lines; compile with -I <vkobjects>/include/glsl.
+//
+//   uint cluster = lightClusterIndex(clusterRID, gl_FragCoord.xy, -viewPosition.z);
+//   uint count = lightClusterCount(clusterRID, cluster);
+//   for (uint i = 0u; i < count; ++i) {
+//       ClusterLight light = clusterLight(clusterRID, lightClusterLight(clusterRID, cluster, i));
+//       ...
+//   }
+//
+// clusterRID is LightClusterer::rid(): a header, then the light list as three vec4 arrays
+// (position + range, color + intensity, spot direction + cosine of the cone half-angle).
+// The header names the cluster buffer: one light count per cluster, then a fixed-size light
+// index list per cluster. The word offsets below must match src/lightcluster.cpp.
+
+#ifndef LIGHT_CLUSTERS_GLSL
+#define LIGHT_CLUSTERS_GLSL
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+const uint LC_GRID_X = 0u;
+const uint LC_GRID_Y = 1u;
+const uint LC_GRID_Z = 2u;
+const uint LC_MAX_PER_CLUSTER = 3u;
+const uint LC_LIGHT_COUNT = 4u;
+const uint LC_LIGHT_CAPACITY = 5u;
+const uint LC_CLUSTERS_RID = 6u;
+const uint LC_Z_NEAR = 8u;
+const uint LC_Z_FAR = 9u;
+const uint LC_SLICE_SCALE = 10u;
+const uint LC_SLICE_BIAS = 11u;
+const uint LC_VIEWPORT_WIDTH = 12u;
+const uint LC_VIEWPORT_HEIGHT = 13u;
+const uint LC_TAN_HALF_FOV_X = 14u;
+const uint LC_TAN_HALF_FOV_Y = 15u;
+const uint LC_VIEW = 16u;            // world -> view, column-major mat4
+const uint LC_HEADER_WORDS = 32u;
+
+layout(set = 0, binding = 0) readonly buffer LightClusterWords { uint words[]; } lightClusterBuffers[];
+
+struct ClusterLight {
+    vec3 position;     // world space
+    float range;
+    vec3 color;
+    float intensity;
+    vec3 direction;    // spot axis, world space
+    float spotCos;     // cosine of the cone half-angle; -1 for point lights
+};
+
+uint lightClusterWord(uint rid, uint index) {
+    return lightClusterBuffers[nonuniformEXT(rid)].words[index];
+}
+
+float lightClusterFloat(uint rid, uint index) {
+    return uintBitsToFloat(lightClusterWord(rid, index));
+}
+
+vec4 lightClusterVec4(uint rid, uint index) {
+    return vec4(lightClusterFloat(rid, index), lightClusterFloat(rid, index + 1u),
+                lightClusterFloat(rid, index + 2u), lightClusterFloat(rid, index + 3u));
+}
+
+// Cluster of a fragment. viewDepth is the positive distance along the view axis (-z in view
+// space). Depth slices are exponential: slice k starts at zNear * (zFar / zNear)^(k / gridZ).
+uint lightClusterIndex(uint rid, vec2 fragCoord, float viewDepth) {
+    uvec3 grid = uvec3(lightClusterWord(rid, LC_GRID_X), lightClusterWord(rid, LC_GRID_Y),
+                       lightClusterWord(rid, LC_GRID_Z));
+    vec2 viewport = vec2(lightClusterFloat(rid, LC_VIEWPORT_WIDTH), lightClusterFloat(rid, LC_VIEWPORT_HEIGHT));
+    uvec2 tile = min(uvec2(max(fragCoord / viewport * vec2(grid.xy), vec2(0.0))), grid.xy - 1u);
+    float slice = log(max(viewDepth, 1e-6)) * lightClusterFloat(rid, LC_SLICE_SCALE) +
+                  lightClusterFloat(rid, LC_SLICE_BIAS);
+    uint z = uint(clamp(slice, 0.0, float(grid.z - 1u)));
+    return (z * grid.y + tile.y) * grid.x + tile.x;
+}
+
+uint lightClusterCount(uint rid, uint cluster) {
+    return lightClusterWord(lightClusterWord(rid, LC_CLUSTERS_RID), cluster);
+}
+
+// Index (into the light list) of the i-th light affecting `cluster`, i < lightClusterCount().
+uint lightClusterLight(uint rid, uint cluster, uint i) {
+    uint clusters = lightClusterWord(rid, LC_GRID_X) * lightClusterWord(rid, LC_GRID_Y) *
+                    lightClusterWord(rid, LC_GRID_Z);
+    uint base = clusters + cluster * lightClusterWord(rid, LC_MAX_PER_CLUSTER);
+    return lightClusterWord(lightClusterWord(rid, LC_CLUSTERS_RID), base + i);
+}
+
+ClusterLight clusterLight(uint rid, uint lightIndex) {
+    uint capacity = lightClusterWord(rid, LC_LIGHT_CAPACITY);
+    vec4 positionRange = lightClusterVec4(rid, LC_HEADER_WORDS + 4u * lightIndex);
+    vec4 colorIntensity = lightClusterVec4(rid, LC_HEADER_WORDS + 4u * (capacity + lightIndex));
+    vec4 directionCos = lightClusterVec4(rid, LC_HEADER_WORDS + 4u * (2u * capacity + lightIndex));
+    ClusterLight light;
+    light.position = positionRange.xyz;
+    light.range = positionRange.w;
+    light.color = colorIntensity.xyz;
+    light.intensity = colorIntensity.w;
+    light.direction = directionCos.xyz;
+    light.spotCos = directionCos.w;
+    return light;
+}
+
+#endif
@@ -0,0 +1,31 @@
+// Tile lookup for ShadowAtlas (vkobjects.h). Include right after #version and the #extension
+// lines; compile with -I <vkobjects>/include/glsl.
+//
+//   vec3 local = lightSpace.xyz / lightSpace.w * vec3(0.5, 0.5, 1.0) + vec3(0.5, 0.5, 0.0);
+//   if (shadowAtlasTileValid(tilesRID, tile)) {
+//       float lit = texture(shadowSamplers[nonuniformEXT(atlasRID)], shadowAtlasCoord(tilesRID, tile, local));
+//   }
+//
+// `local` is the coordinate the light's own projection gives for a full-size shadow map: xy
+// in [0, 1], z the depth to compare. Each tile stores two vec4s: the transform into the atlas
+// (scale.xy, offset.xy) and the tile's texel-center bounds (min.xy, max.xy), which keep
+// filtering from reading a neighbouring tile. The layout must match src/shadowatlas.cpp.
+
+#ifndef SHADOW_ATLAS_GLSL
+#define SHADOW_ATLAS_GLSL
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) readonly buffer ShadowAtlasTiles { vec4 data[]; } shadowAtlasTiles[];
+
+bool shadowAtlasTileValid(uint tilesRID, uint tile) {
+    return shadowAtlasTiles[nonuniformEXT(tilesRID)].data[2u * tile].x > 0.0;
+}
+
+vec3 shadowAtlasCoord(uint tilesRID, uint tile, vec3 local) {
+    vec4 transform = shadowAtlasTiles[nonuniformEXT(tilesRID)].data[2u * tile];
+    vec4 bounds = shadowAtlasTiles[nonuniformEXT(tilesRID)].data[2u * tile + 1u];
+    return vec3(clamp(local.xy * transform.xy + transform.zw, bounds.xy, bounds.zw), local.z);
+}
+
+#endif
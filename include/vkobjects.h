@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <set>
+#include <map>
 #include <iostream>
 #include <stdexcept>
 #include <iostream>
@@ -13,13 +14,24 @@
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_core.h>
 #include <cstdint>
+#include <cstring>
 #include <array>
 #include <type_traits>
 #include <utility>
 #include <span>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <cassert>
+#include <mutex>
+#include <unordered_map>
+#include <optional>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <exception>
+#include <cstring>
 
 // --- Synchronization2 enum wrappers ---
 
@@ -103,9 +115,96 @@ struct PushConstantBase {
 // --- VMA forward declaration ---
 struct VmaAllocation_T;
 typedef VmaAllocation_T* VmaAllocation;
+struct VmaAllocator_T;
+typedef VmaAllocator_T* VmaAllocator;
 
 // --- Resource destruction ---
 
+// Result of one DestroyGeneration::destroy pass: handles freed, handles still queued
+// (carried over by the budget), and wall time spent.
+struct DestroyStats {
+    uint32_t destroyed = 0;
+    uint32_t pending = 0;
+    double millis = 0.0;
+};
+
+// Cumulative present timing (VulkanContext::presentStats). presentMillis is time inside
+// vkQueuePresentKHR on whichever thread made the call; callerMillis is what the frame thread
+// spent on presenting: the call itself when inline, otherwise handing the present off plus
+// any wait for the present thread before the next acquire.
+struct PresentStats {
+    uint64_t presents = 0;
+    double presentMillis = 0.0;
+    double callerMillis = 0.0;
+};
+
+// Host memory requested through the library's VkAllocationCallbacks
+// (VulkanContextOptions::trackHostAllocations), cumulative since the context was created.
+// liveBytes is what is held right now; internal* mirrors the driver's
+// pfnInternalAllocation/pfnInternalFree notifications (memory it allocated itself, e.g. for
+// executable code), which the callbacks do not serve.
+struct HostAllocationStats {
+    uint64_t allocations = 0;
+    uint64_t reallocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;          // total requested by allocations and reallocations
+    int64_t liveBytes = 0;
+    int64_t peakLiveBytes = 0;   // per scope and object type; summed when aggregated
+    uint64_t internalAllocations = 0;
+    int64_t internalLiveBytes = 0;
+
+    HostAllocationStats & operator+=(const HostAllocationStats & other);
+};
+
+// VulkanContext::hostAllocations(). byScope is indexed by VkSystemAllocationScope. byObjectType
+// lists each object type that saw host allocations, summed over scopes, in creation order of
+// the first such object; VK_OBJECT_TYPE_DEVICE_MEMORY stands for everything VMA creates
+// (device memory, buffers, images and VMA's own bookkeeping).
+struct HostAllocationReport {
+    std::array<HostAllocationStats, 5> byScope;
+    std::vector<std::pair<VkObjectType, HostAllocationStats>> byObjectType;
+    // Command-scope allocations served from the per-thread pool rather than malloc
+    // (VulkanContextOptions::poolCommandAllocations).
+    uint64_t pooledAllocations = 0;
+
+    static const char * scopeName(VkSystemAllocationScope scope);
+    static const char * objectTypeName(VkObjectType type);
+    // One line per scope, then one per object type.
+    void print(std::ostream & out) const;
+};
+
+// Bump allocator for CPU-side arrays that only live while commands are recorded. Vulkan copies
+// barrier, attachment and build-range arrays when the vkCmd* call returns, so Commands takes
+// them from here instead of the heap. The context keeps one per frame-in-flight slot, reset by
+// Frame() once that slot's fence has signaled, plus one for Commands recorded outside a Frame,
+// reset by submitAndWait(). Blocks are kept across reset(), so once the first frames have
+// sized it, allocate() never reaches operator new.
+class FrameArena {
+    struct Block {
+        std::unique_ptr<uint8_t[]> bytes;
+        size_t size;
+    };
+    std::vector<Block> blocks;
+    size_t blockBytes;
+    size_t block = 0;   // index of the block being bumped
+    size_t used = 0;    // bytes taken from blocks[block]
+    size_t total = 0;   // bytes handed out since reset(), including alignment padding
+
+public:
+    explicit FrameArena(size_t blockBytes = 64 * 1024) : blockBytes(blockBytes) {}
+
+    void * allocate(size_t size, size_t alignment);
+    template<typename T>
+    T * allocate(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "FrameArena never runs destructors");
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+    // Invalidates everything allocated so far; keeps the blocks.
+    void reset();
+    size_t bytesUsed() const { return total; }
+    size_t bytesReserved() const;
+};
+
 struct DestroyGeneration {
     std::vector<std::pair<VkBuffer, VmaAllocation>> bufferAllocations;
     std::vector<std::pair<VkImage, VmaAllocation>> imageAllocations;
@@ -117,8 +216,17 @@ struct DestroyGeneration {
     std::vector<uint32_t> samplerRIDs;
     std::vector<uint32_t> storageImageRIDs;
     std::vector<uint32_t> tlasRIDs;
+    std::vector<uint32_t> uniformBufferRIDs;
     std::vector<VkPipeline> pipelines;
     void destroy();
+    // Frees handles, oldest first, until maxItems have been destroyed or maxMillis has elapsed
+    // (0 = no limit); the rest stay queued. At least one handle is freed per call, so a spent
+    // budget still makes progress. RIDs are always released. Dependents go first (views before images,
+    // acceleration structures before their backing buffers), so a partial pass is always safe.
+    DestroyStats destroy(uint32_t maxItems, double maxMillis);
+    // Moves every queued handle of `other` into this generation.
+    void append(DestroyGeneration & other);
+    size_t pending() const;
     ~DestroyGeneration();
 };
 
@@ -126,6 +234,17 @@ struct DestroyGeneration {
 
 enum class ValidationSeverity { Info, Warning, Error };
 
+// Load-time SPIR-V processing (SpirvOptimizer).
+enum class SpirvOptimization {
+    None,          // modules are created from the SPIR-V as given
+    Strip,         // built in: debug names, line info, NonSemantic instructions, unreachable functions
+    Size,          // SPIRV-Tools size recipe, then Strip; Strip alone without SPIRV-Tools
+    Performance,   // SPIRV-Tools performance recipe, then Strip; Strip alone without SPIRV-Tools
+};
+
+// VulkanContextOptions::jobWorkerCount before jobWorkers() is called.
+constexpr uint32_t kAutoJobWorkers = ~0u;
+
 struct VulkanContextOptions {
     bool enableMultisampling;
     uint32_t multisampleCount;
@@ -137,12 +256,27 @@ struct VulkanContextOptions {
     bool enableGpuAssistedValidation;
     bool enableImmediateDestroy;
     bool enableRayTracing;
+    bool enableUniformBuffers;
+    uint32_t destroyBudgetItems;
+    double destroyBudgetMillis;
     std::string pipelineCacheDir;
+    std::vector<std::string> prefetchPaths;
+    uint32_t jobWorkerCount;   // kAutoJobWorkers: sized when the context is created
+    bool enablePresentThread;
+    bool enableHostAllocationTracking;
+    bool enableCommandScopePool;
+    VkExtent2D offscreenExtent;
+    std::string glslCacheDir;
+    SpirvOptimization shaderOptimization;
+    std::string shaderOptimizationCacheDir;
     std::function<void(ValidationSeverity, const char*)> validationCallback;
     VulkanContextOptions();
     VulkanContextOptions & multisample(uint32_t count);
     VulkanContextOptions & meshShaders();
     VulkanContextOptions & rayTracing();
+    // Adds bindless binding 4 (UNIFORM_BUFFER) for buffers built with BufferBuilder::uniform().
+    // Requires descriptorBindingUniformBufferUpdateAfterBind.
+    VulkanContextOptions & uniformBuffers();
     VulkanContextOptions & validation();
     VulkanContextOptions & sampleRateShading(float rate);
     VulkanContextOptions & throwOnValidationError();
@@ -150,6 +284,37 @@ struct VulkanContextOptions {
     VulkanContextOptions & gpuAssistedValidation(bool enable = true);
     VulkanContextOptions & immediateDestroy(bool v = true);
     VulkanContextOptions & pipelineCache(const std::string & dir);
+    // Cap deferred destruction per frame; anything past the budget carries over to the next
+    // frame. 0 disables a limit. Default: unlimited (everything is freed as soon as it is safe).
+    VulkanContextOptions & destroyBudget(uint32_t maxItems, double maxMillis = 0.0);
+    // Files (typically .spv) read on worker threads while the context starts up.
+    // ShaderBuilder::fromFile with the same path joins the read instead of hitting the disk.
+    VulkanContextOptions & prefetchFiles(std::vector<std::string> paths);
+    // Worker threads of the context's JobSystem (VulkanContext::jobs()), not counting the
+    // thread that creates the context. Default: hardware concurrency - 1, less the workers of
+    // contexts already alive, so concurrent contexts together do not oversubscribe the CPU.
+    VulkanContextOptions & jobWorkers(uint32_t count);
+    // Frame::submit queues vkQueuePresentKHR to a dedicated thread instead of calling it
+    // inline, so a present that blocks (FIFO, compositors) overlaps the next frame's CPU work.
+    VulkanContextOptions & presentThread(bool enable = true);
+    // Passes VkAllocationCallbacks to every vkCreate*/vkDestroy* the library makes, and to VMA,
+    // counting host allocations per VkSystemAllocationScope and object type
+    // (VulkanContext::hostAllocations()). Off by default: the callbacks cost an indirect call
+    // and a few atomics per driver allocation.
+    VulkanContextOptions & trackHostAllocations(bool enable = true);
+    // With tracking, serves VK_SYSTEM_ALLOCATION_SCOPE_COMMAND allocations, which the driver
+    // frees before the vk* call that made them returns, from per-thread size-class free lists
+    // instead of malloc. Implies trackHostAllocations().
+    VulkanContextOptions & poolCommandAllocations(bool enable = true);
+    // Size reported as the window size by a context created without a window (offscreen), for
+    // beginRendering() and ImageBuilder::depth(). Default 1x1.
+    VulkanContextOptions & offscreenSize(uint32_t width, uint32_t height);
+    // Directory for SPIR-V compiled at runtime by VulkanContext::glsl() (ShaderBuilder::fromGlsl).
+    // Empty (the default) compiles every time. defaultPipelineCacheDir() is a good choice.
+    VulkanContextOptions & glslCache(const std::string & dir);
+    // Every ShaderModule the context creates goes through SpirvOptimizer at `level` first;
+    // results are cached on disk under `cacheDir` (empty: no cache). Default: None.
+    VulkanContextOptions & optimizeShaders(SpirvOptimization level, const std::string & cacheDir = {});
 };
 
 struct BindlessTable {
@@ -157,6 +322,9 @@ struct BindlessTable {
     static constexpr uint32_t MAX_SAMPLERS = 16384;
     static constexpr uint32_t MAX_STORAGE_IMAGES = 4096;
     static constexpr uint32_t MAX_TLAS = 8;
+    // Upper bound; the actual count is clamped to the device's update-after-bind UBO limits.
+    static constexpr uint32_t MAX_UNIFORM_BUFFERS = 1024;
+    static constexpr uint32_t UNIFORM_BUFFER_BINDING = 4;
 
     VkDescriptorSetLayout layout = VK_NULL_HANDLE;
     VkDescriptorPool pool = VK_NULL_HANDLE;
@@ -167,31 +335,43 @@ struct BindlessTable {
     std::vector<uint32_t> freeSamplerIndices;
     std::vector<uint32_t> freeStorageImageIndices;
     std::vector<uint32_t> freeTlasIndices;
+    std::vector<uint32_t> freeUniformBufferIndices;
     uint32_t nextStorageBufferIndex = 0;
     uint32_t nextSamplerIndex = 0;
     uint32_t nextStorageImageIndex = 0;
     uint32_t nextTlasIndex = 0;
+    uint32_t nextUniformBufferIndex = 0;
     bool tlasEnabled = false;
+    uint32_t uniformBufferCount = 0;   // 0 = no uniform buffer binding
 
-    void init(VkDevice device, uint32_t maxPushConstantSize = 128, bool enableTlas = false);
+    void init(VkDevice device, uint32_t maxPushConstantSize = 128, bool enableTlas = false, uint32_t uniformBuffers = 0);
     void destroy(VkDevice device);
 
     uint32_t registerStorageBuffer(VkDevice device, VkBuffer buffer, VkDeviceSize size);
     uint32_t registerSampler(VkDevice device, VkImageView imageView, VkSampler sampler);
     uint32_t registerStorageImage(VkDevice device, VkImageView imageView);
     uint32_t registerTlas(VkDevice device, VkAccelerationStructureKHR tlas);
+    uint32_t registerUniformBuffer(VkDevice device, VkBuffer buffer, VkDeviceSize size);
     void releaseStorageBuffer(uint32_t index);
     void releaseSampler(uint32_t index);
     void releaseStorageImage(uint32_t index);
     void releaseTlas(uint32_t index);
+    void releaseUniformBuffer(uint32_t index);
 };
 
 struct Commands;
 struct ShaderModule;
 class Pipeline;
+struct SpecConstants;
+class JobSystem;
+class PresentThread;
+class HostAllocator;
+class GlslCompiler;
+class SpirvOptimizer;
 
 class VulkanContext {
     friend struct Frame;
+    friend class PresentThread;
     friend struct Commands;
     friend struct Buffer;
     friend struct Image;
@@ -199,15 +379,21 @@ class VulkanContext {
     friend class Blas;
     friend class Tlas;
     friend struct ShaderModule;
+    friend struct ShaderBuilder;
     friend struct DestroyGeneration;
     friend struct GraphicsPipelineBuilder;
     friend class Pipeline;
     friend class TimestampQuery;
+    friend class IblBaker;
+    friend class GpuPrimitives;
     friend Pipeline createComputePipeline(ShaderModule &, const char *);
+    friend Pipeline createComputePipeline(ShaderModule &, const SpecConstants &, const char *);
     friend void createSwapChain(VulkanContext &, VkSurfaceKHR, VkPhysicalDevice, VkDevice, VkSwapchainKHR &);
     friend VkFence createFence();
     friend VkSemaphore createSemaphore();
     friend void makeChainImageViews(VkDevice, VkFormat, std::vector<VkImage> &, std::vector<VkImageView> &);
+    friend struct VulkanContextSingleton;
+    friend class ContextScope;
 
     SDL_Window * window;
     VkInstance instance;
@@ -215,8 +401,8 @@ class VulkanContext {
     VkPhysicalDevice physicalDevice;
     unsigned int graphicsQueueIndex;
     VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
-    VkSurfaceKHR presentationSurface;
-    VkQueue presentationQueue;
+    VkSurfaceKHR presentationSurface = VK_NULL_HANDLE;
+    VkQueue presentationQueue = VK_NULL_HANDLE;
     VkSwapchainKHR swapchain;
     VkFormat colorFormat;
     VkCommandPool commandPool;
@@ -224,7 +410,30 @@ class VulkanContext {
     VulkanContextOptions options;
     VkPhysicalDeviceLimits limits;
     VkPhysicalDeviceMeshShaderPropertiesEXT meshShaderProperties;
+    VkPhysicalDeviceSubgroupProperties subgroup = {};
+    VkPhysicalDeviceSubgroupSizeControlProperties subgroupSizeControl = {};
     uint32_t minAccelerationStructureScratchOffsetAlignment = 1;
+    VkImageUsageFlags swapchainUsage = 0;
+    VkExtent2D swapchainImageExtent = {0, 0};
+    uint64_t framesBegun = 0;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    // The live Frame on this context, or nullptr (Frame::current()).
+    Frame * currentFrame = nullptr;
+
+    // Device-level entry points from vkGetDeviceProcAddr; they belong to this device.
+    PFN_vkCmdDrawMeshTasksEXT vkCmdDrawMeshTasks = nullptr;
+    PFN_vkCmdDrawMeshTasksIndirectEXT vkCmdDrawMeshTasksIndirect = nullptr;
+    PFN_vkCmdBeginRendering vkBeginRendering = nullptr;
+    PFN_vkCmdEndRendering vkEndRendering = nullptr;
+    PFN_vkGetAccelerationStructureBuildSizesKHR rtGetAccelerationStructureBuildSizes = nullptr;
+    PFN_vkCreateAccelerationStructureKHR rtCreateAccelerationStructure = nullptr;
+    PFN_vkDestroyAccelerationStructureKHR rtDestroyAccelerationStructure = nullptr;
+    PFN_vkCmdBuildAccelerationStructuresKHR rtCmdBuildAccelerationStructures = nullptr;
+    PFN_vkGetAccelerationStructureDeviceAddressKHR rtGetAccelerationStructureDeviceAddress = nullptr;
+    PFN_vkCmdCopyAccelerationStructureToMemoryKHR rtCmdCopyAccelerationStructureToMemory = nullptr;
+    PFN_vkCmdCopyMemoryToAccelerationStructureKHR rtCmdCopyMemoryToAccelerationStructure = nullptr;
+    PFN_vkCmdWriteAccelerationStructuresPropertiesKHR rtCmdWriteAccelerationStructuresProperties = nullptr;
+    PFN_vkGetDeviceAccelerationStructureCompatibilityKHR rtGetDeviceAccelerationStructureCompatibility = nullptr;
 
     BindlessTable bindlessTable;
     std::function<void(Commands &, VkExtent2D)> resizeCallback;
@@ -244,17 +453,63 @@ class VulkanContext {
     std::set<VkPipeline> pipelines;
     VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 
+    // Guards destroyGenerations, frameInFlightIndex and pipelines: Buffer, Image and Pipeline
+    // may be created and destroyed on any thread, while the frame thread drains the queues.
+    std::mutex destroyMutex;
     std::vector<DestroyGeneration> destroyGenerations;
+    // Handles whose fence has signaled but which exceeded the per-frame destroy budget.
+    DestroyGeneration destroyBacklog;
+    DestroyStats lastDestroyStats;
 
     std::vector<std::function<void()>> preDestroyCallbacks;
 
+    // prefetchPaths reads queued on jobSystem, by path. Declared before jobSystem, so the
+    // workers have finished with it by the time it is destroyed.
+    struct PrefetchedFiles;
+    std::unique_ptr<PrefetchedFiles> prefetched;
+    // Joins a prefetched read of `path`; false if it was not prefetched or the read failed.
+    bool takePrefetchedFile(const std::string & path, std::vector<uint8_t> & out);
+    // Destroys every generation now. An offscreen context never runs Frame, so submitAndWait
+    // calls this once no submit is left in flight on it.
+    void drainDestroys();
+
+    // VulkanContextOptions::trackHostAllocations; null when off. Outlives the destructor
+    // body, so it is still there for vkDestroyInstance.
+    std::unique_ptr<HostAllocator> hostAllocator;
+    std::unique_ptr<JobSystem> jobSystem;
+    std::unique_ptr<GlslCompiler> glslCompiler;
+    std::unique_ptr<SpirvOptimizer> spirvOptimizer;
+
+    // Transient recording memory: one arena per frame-in-flight slot, and one for Commands
+    // recorded outside a Frame (setup, oneShot).
+    std::vector<FrameArena> frameArenas;
+    FrameArena setupArena;
+
+    // Guards host access to the graphics/present queue while a present thread exists.
+    std::mutex queueMutex;
+    // submitAndWait calls outside a Frame that have submitted and not yet returned.
+    std::atomic<uint32_t> setupSubmitsInFlight{0};
+    std::unique_ptr<PresentThread> presenter;
+    std::atomic<uint64_t> presentCount{0};
+    std::atomic<int64_t> presentNanos{0};
+    std::atomic<int64_t> presentCallerNanos{0};
+
 public:
     size_t windowWidth;
     size_t windowHeight;
     size_t swapchainImageCount;
     VkQueue graphicsQueue;
 
+    // Contexts are independent: each has its own instance, device, allocator, bindless table
+    // and job system, and any number may exist at once. The first one created is the process
+    // default, and destroying it makes the oldest surviving context the default; each thread
+    // also uses the first context created on it (see g_context). With a null window the
+    // context is offscreen: no surface or swapchain, so no Frame, but everything else works;
+    // its deferred destroys run when a submitAndWait returns with no other one in flight.
+    // Destroy a context on the thread that created it.
     VulkanContext(SDL_Window * window, VulkanContextOptions options);
+    // Offscreen context.
+    explicit VulkanContext(VulkanContextOptions options);
     ~VulkanContext();
     VulkanContext & operator=(const VulkanContext & other) = delete;
     VulkanContext(const VulkanContext & other) = delete;
@@ -263,6 +518,16 @@ public:
     void onSwapchainResize(std::function<void(Commands &, VkExtent2D)> callback);
     void waitIdle();
     void flushDestroys();
+    // Stats of the deferred-destruction pass run by the most recent Frame().
+    const DestroyStats & destroyStats() const { return lastDestroyStats; }
+    PresentStats presentStats() const;
+    // Host allocation counts by scope and object type; all zero unless
+    // VulkanContextOptions::trackHostAllocations() is set.
+    HostAllocationReport hostAllocations() const;
+    // The callbacks the library passes when creating and destroying objects of `type`, or
+    // nullptr when tracking is off. Pass them for objects you create on deviceHandle() to have
+    // those counted too (the same pointer at create and destroy).
+    const VkAllocationCallbacks * allocationCallbacks(VkObjectType type) const;
 
     // Register a callback to run at the very start of ~VulkanContext, before the device,
     // allocator, and pipelines are torn down. Use for releasing long-lived caches that own
@@ -270,27 +535,90 @@ public:
     // freed before vmaDestroyAllocator. Callbacks run in registration order.
     void onPreDestroy(std::function<void()> callback);
 
+    // Shared CPU job system; library code that parallelizes submits here rather than
+    // starting its own threads. The creating thread is its owner (see JobSystem).
+    JobSystem & jobs() { return *jobSystem; }
+    // Runtime GLSL compiler with the context's SPIR-V cache (VulkanContextOptions::glslCache).
+    GlslCompiler & glsl() { return *glslCompiler; }
+    // Load-time SPIR-V optimizer ShaderModule uses (VulkanContextOptions::optimizeShaders).
+    SpirvOptimizer & shaderOptimizer() { return *spirvOptimizer; }
+
     VkDevice deviceHandle() const { return device; }
     VkPhysicalDevice physicalDeviceHandle() const { return physicalDevice; }
+    VmaAllocator allocatorHandle() const { return allocator; }
+    bool offscreen() const { return window == nullptr; }
+
+    // Default subgroup size and the stages and GL_KHR_shader_subgroup_* operations that support it.
+    const VkPhysicalDeviceSubgroupProperties & subgroupProperties() const { return subgroup; }
+    // Range of subgroup sizes the device may use for a dispatch (varies on some GPUs).
+    const VkPhysicalDeviceSubgroupSizeControlProperties & subgroupSizeControlProperties() const { return subgroupSizeControl; }
+    // A workgroup width for local_size_x_id: `threads` rounded up to a multiple of the largest
+    // subgroup size the device may use, so no subgroup runs partly empty, within the device's
+    // workgroup limits. Pass it to SpecConstants::localSize.
+    uint32_t subgroupLocalSize(uint32_t threads = 64) const;
 
     VkDescriptorSetLayout bindlessSetLayout() const { return bindlessTable.layout; }
     VkDescriptorSet bindlessDescriptorSet() const { return bindlessTable.set; }
     uint32_t accelerationStructureScratchAlignment() const { return minAccelerationStructureScratchOffsetAlignment; }
     bool rayTracingEnabled() const { return options.enableRayTracing; }
+    bool uniformBuffersEnabled() const { return bindlessTable.uniformBufferCount > 0; }
+    VkFormat swapchainFormat() const { return colorFormat; }
+    // Size the swapchain images were created with (the surface's currentExtent when it has one),
+    // which can differ from windowWidth/windowHeight on high-DPI displays.
+    VkExtent2D swapchainExtent() const { return swapchainImageExtent; }
+    // Swapchain images can be copied from (FrameCapture); true on practically every surface.
+    bool swapchainCapturable() const { return (swapchainUsage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0; }
 };
 
+// The context library calls resolve to: the calling thread's context (bound by a ContextScope,
+// or the first context created on the thread), otherwise the process default (the oldest
+// living context). Threads the library starts (job workers, RenderThread) take the context
+// of the thread that created them. Buffer, Image, Pipeline and Commands remember the context
+// they were created on and use it for the rest of their life, wherever they are destroyed.
 struct VulkanContextSingleton {
-    VulkanContext * contextInstance;
+    std::atomic<VulkanContext *> contextInstance{nullptr};
+    static thread_local VulkanContext * threadContext;
+    std::mutex liveMutex;
+    std::vector<VulkanContext *> live;   // creation order; guarded by liveMutex
+    uint32_t liveJobWorkers = 0;         // JobSystem workers of the live contexts; liveMutex
+    // The calling thread's context, or nullptr when there is none.
+    VulkanContext * current() const;
+    // current(); throws when no context is alive.
     VulkanContext& operator()();
 };
 
 extern VulkanContextSingleton g_context;
 
+// Binds `context` to the calling thread for the scope's lifetime, so g_context() and objects
+// created on this thread use it. Scopes nest; the previous binding comes back on exit.
+//
+//   VulkanContext baker(VulkanContextOptions().offscreenSize(1024, 1024));   // on any thread
+//   ContextScope scope(baker);
+//   Buffer probes(BufferBuilder(bytes).storage());   // lives on `baker`
+class ContextScope {
+    VulkanContext * previous;
+
+public:
+    explicit ContextScope(VulkanContext & context);
+    ~ContextScope();
+    ContextScope(const ContextScope &) = delete;
+    ContextScope & operator=(const ContextScope &) = delete;
+};
+
 // --- Shaders ---
 
+// A preprocessor definition for runtime GLSL compilation: `#define name value`.
+struct ShaderDefine {
+    std::string name;
+    std::string value;   // empty: defined with no value
+};
+
 struct ShaderBuilder {
     VkShaderStageFlagBits stage;
     std::vector<uint8_t> code;
+    // Borrowed SPIR-V from fromBuffer(span), used instead of `code` when set. Must stay valid
+    // until the ShaderModule is constructed.
+    std::span<const uint8_t> view;
     std::string fileName;
     ShaderBuilder();
     ShaderBuilder& fragment();
@@ -298,16 +626,31 @@ struct ShaderBuilder {
     ShaderBuilder& mesh();
     ShaderBuilder& fromFile(const char * fileName);
     ShaderBuilder& fromBuffer(const uint8_t * data, size_t size);
+    // Zero-copy: references `bytes` (e.g. an AssetArchive blob) instead of copying them.
+    ShaderBuilder& fromBuffer(std::span<const uint8_t> bytes);
+    // Compiles GLSL for the stage already selected, through g_context().glsl() (and its SPIR-V
+    // cache), or an uncached compiler when there is no context. Throws with the compiler's
+    // messages on an error, or when the library was built without libshaderc.
+    ShaderBuilder& fromGlsl(std::string_view source, const std::vector<ShaderDefine> & defines = {});
+    // fromGlsl() with the contents of `fileName`; relative #includes resolve next to it.
+    ShaderBuilder& fromGlslFile(const char * fileName, const std::vector<ShaderDefine> & defines = {});
+    // The SPIR-V this builder will create a module from.
+    std::span<const uint8_t> bytes() const;
 };
 
 struct ShaderReflection {
     uint32_t pushConstantSize = 0;
     std::array<uint32_t, 3> localSize = {0, 0, 0};
+    // constant_id of each local_size_*_id dimension, ~0u where the size is fixed. localSize then
+    // holds the default the pipeline gets without a SpecConstants value.
+    std::array<uint32_t, 3> localSizeSpecIds = {~0u, ~0u, ~0u};
     uint32_t maxVertices = 0;
     uint32_t maxPrimitives = 0;
     std::set<uint32_t> inputLocations;
     std::set<uint32_t> outputLocations;
     std::set<std::pair<uint32_t, uint32_t>> descriptorBindings;
+    // Descriptor type declared at each (set, binding), where the SPIR-V type identifies one.
+    std::map<std::pair<uint32_t, uint32_t>, VkDescriptorType> descriptorTypes;
     VkShaderStageFlagBits executionModel = VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM;
 };
 
@@ -320,6 +663,99 @@ struct ShaderModule {
     operator VkShaderModule() const;
 };
 
+// --- Runtime GLSL ---
+
+struct GlslSource {
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    std::string source;
+    std::string name = "shader.glsl";   // for messages; relative #includes resolve next to it
+    std::vector<ShaderDefine> defines;
+};
+
+// GLSL to SPIR-V at runtime with libshaderc (Vulkan SDK), so shader permutations no longer have
+// to be listed in CMake. Output matches the build's glslc flags (--target-env=vulkan1.2). With
+// a cache directory, SPIR-V is stored under a hash of the preprocessed source, stage, defines
+// and compiler version: editing an #included file or a define changes the key, and a warm
+// cache costs a preprocess and a file read per shader instead of a compile. Entries are
+// replaced atomically like the pipeline cache; corrupt ones are recompiled. compile() may be
+// called from several threads; set include directories before that.
+//
+//   GlslCompiler & glsl = g_context().glsl();
+//   std::vector<GlslSource> sources = { ... one per permutation ... };
+//   auto spirv = glsl.compileAll(sources, g_context().jobs());
+//   ShaderModule module(ShaderBuilder().compute().fromBuffer(spirv[0].data(), spirv[0].size()));
+class GlslCompiler {
+    struct Shaderc;
+    std::unique_ptr<Shaderc> shaderc;
+    std::string dir_;
+    bool verbose_;
+    std::vector<std::string> includeDirs_;
+    std::atomic<uint32_t> hits_{0}, misses_{0};
+
+public:
+    explicit GlslCompiler(std::string cacheDir = {}, bool verbose = false);
+    ~GlslCompiler();
+    GlslCompiler(const GlslCompiler &) = delete;
+    GlslCompiler & operator=(const GlslCompiler &) = delete;
+
+    // False when the library was built without libshaderc; compile() then throws.
+    static bool available();
+    // Searched for #include <...>, and for "..." after the including file's directory.
+    GlslCompiler & includeDirectory(std::string dir);
+
+    // SPIR-V words as bytes, from the cache when there is a valid entry.
+    std::vector<uint8_t> compile(const GlslSource & source);
+    // compile() for every source, spread over `jobs`; results in the same order. Rethrows
+    // the first compile error.
+    std::vector<std::vector<uint8_t>> compileAll(std::span<const GlslSource> sources, JobSystem & jobs);
+
+    // Cache key of `source`: preprocesses it, so #included files are read.
+    uint64_t cacheKey(const GlslSource & source);
+    // Cache file for `key`; empty without a cache directory.
+    std::string path(uint64_t key) const;
+    uint32_t hits() const { return hits_.load(); }
+    uint32_t misses() const { return misses_.load(); }
+};
+
+// --- SPIR-V optimization ---
+
+// Built-in strip pass: removes OpSource*, OpString, OpName/OpMemberName, OpLine/OpNoLine,
+// OpModuleProcessed, NonSemantic extended instruction sets and their instructions, and
+// functions no entry point can reach, with the decorations of every id they defined. Returns
+// the input unchanged if it does not parse.
+std::vector<uint8_t> stripSpirv(std::span<const uint8_t> spirv);
+
+// Shrinks SPIR-V before vkCreateShaderModule: glslc output carries debug names and is not
+// optimized. ShaderModule runs it when VulkanContextOptions::optimizeShaders is set, after
+// reflection, so reflection still sees every declared binding. Results are cached on disk
+// under a hash of the input, the level and the SPIRV-Tools version; an optimizer failure
+// falls back to the stripped input. optimize() may be called from several threads.
+class SpirvOptimizer {
+    SpirvOptimization level_;
+    std::string dir_;
+    bool verbose_;
+    std::atomic<uint32_t> hits_{0}, misses_{0};
+
+public:
+    explicit SpirvOptimizer(SpirvOptimization level = SpirvOptimization::Strip, std::string cacheDir = {},
+                            bool verbose = false);
+    SpirvOptimizer(const SpirvOptimizer &) = delete;
+    SpirvOptimizer & operator=(const SpirvOptimizer &) = delete;
+
+    // False when the library was built without SPIRV-Tools: Size and Performance only strip.
+    static bool toolsAvailable();
+    SpirvOptimization level() const { return level_; }
+
+    // The processed module; `spirv` itself for SpirvOptimization::None.
+    std::vector<uint8_t> optimize(std::span<const uint8_t> spirv);
+
+    uint64_t cacheKey(std::span<const uint8_t> spirv) const;
+    // Cache file for `key`; empty without a cache directory.
+    std::string path(uint64_t key) const;
+    uint32_t hits() const { return hits_.load(); }
+    uint32_t misses() const { return misses_.load(); }
+};
+
 // --- Buffers ---
 
 struct BufferBuilder {
@@ -327,9 +763,13 @@ struct BufferBuilder {
     VkMemoryPropertyFlags properties;
     size_t byteCount;
     bool isReadback = false;
+    bool isPersistentlyMapped = false;
+    bool isUniform = false;
 
     BufferBuilder(size_t byteCount);
     BufferBuilder & index();
+    // Host-visible, coherent, UNIFORM_BUFFER usage. Still a storage buffer at rid(); with
+    // VulkanContextOptions::uniformBuffers() it also gets a uniformRid().
     BufferBuilder & uniform();
     BufferBuilder & storage();
     BufferBuilder & indirect();
@@ -339,6 +779,8 @@ struct BufferBuilder {
     BufferBuilder & transferSource();
     BufferBuilder & transferDestination();
     BufferBuilder & readback();
+    // Host-visible and mapped for the buffer's whole lifetime (Buffer::mappedData()).
+    BufferBuilder & persistentlyMapped();
     BufferBuilder & size(size_t byteCount);
     BufferBuilder & deviceAddress();
     BufferBuilder & accelerationStructureInput();
@@ -346,19 +788,35 @@ struct BufferBuilder {
 };
 
 class Buffer {
+    VulkanContext * context;
     VkBuffer buffer;
     VmaAllocation allocation;
     size_t size;
     uint32_t rid_;
+    uint32_t uniformRid_ = kNullRid;
+    void * mapped_ = nullptr;
 
 public:
     uint32_t rid() const;
+    // Slot in bindless binding 4 for BufferBuilder::uniform() buffers when the context enables
+    // uniformBuffers(); kNullRid otherwise. Covers the first maxUniformBufferRange bytes.
+    uint32_t uniformRid() const { return uniformRid_; }
     size_t byteSize() const;
     bool isHostVisible() const;
+    // Persistent mapping from BufferBuilder::persistentlyMapped(); nullptr otherwise.
+    void * mappedData() const { return mapped_; }
+    // Makes host writes to [offset, offset + size) visible to the device; no-op on coherent memory.
+    void flush(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    // Makes device writes to [offset, offset + size) visible to host reads; no-op on coherent memory.
+    void invalidate(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
     void upload(void * bytes, size_t size);
     void upload(void * bytes, size_t size, VkDeviceSize offset);
     void download(void * bytes, size_t size);
     VkDeviceAddress deviceAddress() const;
+    // Hands the buffer and its RIDs to the current frame's destroy generation, even with
+    // immediateDestroy, and leaves this Buffer empty. For a buffer that commands recorded but
+    // not yet submitted still reference.
+    void retire();
     Buffer(BufferBuilder & builder);
     Buffer(Buffer && other);
     ~Buffer();
@@ -373,6 +831,7 @@ public:
 // (R32G32B32 positions, 12-byte stride, non-indexed); the setters override only what differs.
 class BlasGeometry {
     friend class Blas;
+    friend struct BlasBuilder;
     friend struct Commands;
     VkAccelerationStructureGeometryKHR geom_{};
     uint32_t primitiveCount_ = 0;
@@ -395,6 +854,10 @@ struct BlasBuilder {
     BlasBuilder& addGeometry(const BlasGeometry&);
     BlasBuilder& refittable();
     BlasBuilder& fastBuild();
+
+    // Key for BlasCache: build flags, each geometry's formats and counts, and the caller's CPU
+    // copy of the vertex/index bytes (the builder itself only holds device addresses).
+    uint64_t contentHash(std::span<const uint8_t> geometryBytes) const;
 };
 
 class Blas {
@@ -410,6 +873,8 @@ class Blas {
     VkBuildAccelerationStructureFlagsKHR flags_ = 0;
 
     void destroyHandle();
+    // deserializedSize != 0 sizes the backing for a deserialized copy and skips build scratch.
+    Blas(BlasBuilder&, VkDeviceSize deserializedSize);
 
 public:
     Blas(BlasBuilder&);
@@ -422,7 +887,92 @@ public:
     VkDeviceAddress address() const;
     Buffer& backing();
     bool updatable() const;
+    // Backing plus build and refit scratch, in bytes.
+    VkDeviceSize memoryBytes() const;
     operator VkAccelerationStructureKHR() const;
+
+    // Device-specific serialized copy of a built BLAS (vkCmdCopyAccelerationStructureToMemoryKHR).
+    // The build must already be submitted; blocks on two one-shot submits.
+    std::vector<uint8_t> serialize();
+    // True when this device can deserialize `data` (vkGetDeviceAccelerationStructureCompatibilityKHR).
+    static bool compatible(std::span<const uint8_t> data);
+    // A built Blas from serialize() output, or nullopt when the data is malformed or from an
+    // incompatible device/driver. `builder` must describe the same geometry; it supplies the
+    // flags and refit inputs. A deserialized Blas can be refit but not rebuilt. Blocks.
+    static std::optional<Blas> deserialize(BlasBuilder& builder, std::span<const uint8_t> data);
+};
+
+// On-disk BLAS cache for static geometry. Entries are serialize() output keyed by
+// BlasBuilder::contentHash() and by a tag of the device's driver and device UUIDs, so GPUs
+// sharing a directory keep separate files and a driver update starts fresh ones. The driver's
+// compatibility check still decides whether a loaded entry is usable. Files are replaced
+// atomically like the pipeline cache. An empty dir disables the cache.
+//
+//   BlasCache cache(defaultPipelineCacheDir("mygame"));
+//   BlasBuilder builder;
+//   builder.addGeometry(BlasGeometry(vertexBuffer).vertexCount(n).triangleCount(n / 3));
+//   Blas blas = cache.getOrBuild(builder, builder.contentHash(meshBytes));
+class BlasCache {
+    std::string dir_;
+    bool verbose_;
+    uint64_t deviceTag_ = 0;
+    uint32_t hits_ = 0, misses_ = 0;
+
+public:
+    // Needs a context unless dir is empty: the device tag is read from the current device.
+    explicit BlasCache(std::string dir, bool verbose = false);
+
+    // Deserialized entry for `key`, or nullopt on a missing, corrupt or incompatible file.
+    std::optional<Blas> load(BlasBuilder& builder, uint64_t key);
+    // Serialize a built Blas to the entry for `key`. Best-effort: never throws.
+    void store(Blas& blas, uint64_t key);
+    // load(), or build with a one-shot submit and store() on a miss.
+    Blas getOrBuild(BlasBuilder& builder, uint64_t key);
+
+    // <dir>/blas_<device tag>_<key>.bin
+    std::string path(uint64_t key) const;
+    uint64_t deviceTag() const { return deviceTag_; }
+    uint32_t hits() const { return hits_; }
+    uint32_t misses() const { return misses_; }
+};
+
+// Shares one Blas between every request with the same geometry key (e.g. repeated props),
+// so identical meshes are built and stored once. Keys come from BlasBuilder::contentHash()
+// or from the caller (an asset ID). Entries are refcounted through shared_ptr: the registry
+// holds only a weak reference, and the Blas is freed (deferred, like any Blas) when the last
+// user drops it. A later request for the same key builds it again.
+//
+//   BlasRegistry registry;
+//   for (auto& prop : props) {
+//       BlasBuilder builder = prop.mesh->blasBuilder();
+//       prop.blas = registry.acquire(cmd, builder, prop.mesh->assetId);   // records a build only once
+//       instances.add(*prop.blas, prop.index);
+//   }
+//   cmd.blasToTlasBarrier(registry.pendingBackings());   // then buildTlas on the same cmd
+class BlasRegistry {
+public:
+    struct Stats {
+        uint32_t requests = 0;
+        uint32_t builds = 0;             // requests minus builds were served by an existing Blas
+        VkDeviceSize bytesAllocated = 0; // memoryBytes() of every Blas built
+        VkDeviceSize bytesSaved = 0;     // memoryBytes() that shared requests would have allocated
+    };
+
+    // Shared Blas for `key`, recording its build on `cmd` if no live one exists.
+    std::shared_ptr<Blas> acquire(Commands& cmd, BlasBuilder& builder, uint64_t key);
+    // Keyed by builder.contentHash(geometryBytes).
+    std::shared_ptr<Blas> acquire(Commands& cmd, BlasBuilder& builder, std::span<const uint8_t> geometryBytes);
+
+    // Backings of the Blases built since the last call, for Commands::blasToTlasBarrier.
+    std::vector<VkBuffer> pendingBackings();
+    // Distinct live Blases; drops entries whose last user has gone.
+    size_t liveCount();
+    const Stats& stats() const { return stats_; }
+
+private:
+    std::unordered_map<uint64_t, std::weak_ptr<Blas>> entries_;
+    std::vector<VkBuffer> pending_;
+    Stats stats_;
 };
 
 struct TlasInstances {
@@ -503,6 +1053,8 @@ void setBufferWriteHook(BufferWriteHook hook);
 
 // --- Images ---
 
+struct CookedTexture;
+
 struct ImageBuilder {
     bool buildMipmaps;
     void * bytes;
@@ -516,15 +1068,24 @@ struct ImageBuilder {
     bool isCube = false;
     bool isSampledStorage = false;
     uint32_t mipLevelsOverride = 0;
+    uint32_t layerCount = 1;
+    // Explicit staging regions (fromCookedTexture); replaces the single mip-0 copy when set.
+    std::vector<VkBufferImageCopy> copyRegions;
     VkSampleCountFlagBits sampleBits;
     VkImageUsageFlags usage;
     ImageBuilder();
     ImageBuilder & createMipmaps(bool buildMipmaps);
     ImageBuilder & depth();
     ImageBuilder & depthSampled(uint32_t width, uint32_t height);
+    // Layered depthSampled: one 2D-array view over all layers, usable as a multiview
+    // depth attachment and sampled as sampler2DArrayShadow (e.g. shadow cascades).
+    ImageBuilder & depthSampledArray(uint32_t width, uint32_t height, uint32_t layers);
     ImageBuilder & colorTarget(uint32_t width, uint32_t height);
     ImageBuilder & colorTarget(uint32_t width, uint32_t height, VkFormat format);
     ImageBuilder & fromStagingBuffer(Buffer & stagingBuffer, int width, int height, VkFormat format);
+    // Every mip of a cooked texture in one vkCmdCopyBufferToImage; `stagingBuffer` holds the
+    // whole cooked file. No mipmaps are generated.
+    ImageBuilder & fromCookedTexture(Buffer & stagingBuffer, const CookedTexture & texture);
     ImageBuilder & color();
     ImageBuilder & multisample();
     ImageBuilder & storage();
@@ -539,6 +1100,7 @@ struct ImageBuilder {
 };
 
 class Image {
+    VulkanContext * context;
     VkImage image;
     VmaAllocation allocation;
     VkSampler sampler;
@@ -546,6 +1108,8 @@ class Image {
     bool isStorageImage;
     bool isCube_ = false;
     uint32_t mipLevels_ = 1;
+    uint32_t layers_ = 1;
+    VkExtent2D extent_ = {0, 0};
     VkFormat format_ = VK_FORMAT_UNDEFINED;
 
 public:
@@ -554,6 +1118,9 @@ public:
     uint32_t rid() const;
     bool isCube() const;
     uint32_t mipLevelCount() const;
+    uint32_t layerCount() const;
+    VkExtent2D extent() const;
+    VkFormat format() const { return format_; }
     Image(Image && other);
     Image(ImageBuilder & builder, Commands & commands);
     operator VkImage() const;
@@ -566,7 +1133,14 @@ public:
     // storage usage.
     struct StorageView { uint32_t rid; VkImageView view; };
     StorageView createStorageView(uint32_t face, uint32_t mip);
+    // Storage view over every layer (all six faces of a cube) of one mip, as a
+    // 2D array: one view and one descriptor per mip, one dispatch with z = layers.
+    StorageView createStorageArrayView(uint32_t mip);
+    // On the calling thread's context; views must come from an image of that context.
     static void destroyStorageView(StorageView view);
+    // Like destroyStorageView, but deferred like the image itself (immediate with
+    // VulkanContextOptions::immediateDestroy), for a view recorded into unfinished work.
+    static void retireStorageView(StorageView view);
 };
 
 // --- Barrier ---
@@ -608,24 +1182,34 @@ class Frame {
     VkFence submittedBuffersFinishedFence;
     uint32_t imageIndex;
     bool submitted;
+    uint64_t serial_;
 
-    static Frame * currentGuard;
     friend class VulkanContext;
 
+    static void recreateSwapchain(VulkanContext & context);
+
 public:
     Frame();
     ~Frame();
 
     uint32_t swapchainImageIndex() const;
     VkImageView swapchainImageView() const;
+    VkImage swapchainImage() const;
     Commands beginCommands();
+    // Submits and presents. With VulkanContextOptions::presentThread() the present is queued
+    // and this returns right after the submit; the next Frame() waits for it to be issued.
     void submit(Commands & cmd);
 
     // Frame-in-flight slot this frame occupies (0 .. swapchainImageCount-1). The coordinate
     // any per-frame-mutable resource ring must index by.
     size_t inFlight() const { return inFlightIndex; }
-    // The live frame, or nullptr outside a Frame's scope (e.g. setup, oneShot work).
-    static Frame * current() { return currentGuard; }
+    // The live frame of the calling thread's context, or nullptr outside a Frame's scope (e.g.
+    // setup, oneShot work). With a RenderThread, frames live on the render thread and this is
+    // only meaningful there.
+    static Frame * current();
+    // 1 for the first Frame of the context, increasing by one per Frame. Work submitted by the
+    // frame with serial s is complete once the frame with serial s + swapchainImageCount exists.
+    uint64_t serial() const { return serial_; }
 };
 
 template<class T>
@@ -655,15 +1239,19 @@ public:
 };
 
 class Commands {
+    VulkanContext * context;
     VkCommandBuffer commandBuffer;
     bool ended;
     bool ownsBuffer;
     Frame * frame;
+    std::array<uint32_t, 3> computeLocalSize = {0, 0, 0};   // of the bound compute Pipeline
 
-    Commands(VkCommandBuffer cmd, bool owns = false);
+    Commands(VulkanContext & context, VkCommandBuffer cmd, bool owns = false);
     friend class Frame;
     friend struct Image;
 
+    FrameArena & scratchArena();
+
 public:
     Commands(Commands && other);
     Commands(const Commands &) = delete;
@@ -673,8 +1261,14 @@ public:
     static Commands oneShot();
 
     void bindCompute(VkPipeline pipeline);
+    // Also remembers the pipeline's local size for dispatchThreads.
+    void bindCompute(const Pipeline & pipeline);
     void bindGraphics(VkPipeline pipeline);
     void dispatch(uint32_t x, uint32_t y, uint32_t z);
+    // Dispatches enough workgroups of the bound compute Pipeline's local size to cover x*y*z
+    // invocations; the last group in each dimension may be partial, so the shader bounds-checks.
+    // Throws when the pipeline was bound as a plain VkPipeline or the group count is too large.
+    void dispatchThreads(uint32_t x, uint32_t y = 1, uint32_t z = 1);
     void dispatchIndirect(VkBuffer buffer, VkDeviceSize offset = 0);
     void drawMeshTasks(uint32_t x, uint32_t y, uint32_t z);
     void drawMeshTasksIndirect(VkBuffer buffer, uint32_t drawCount, VkDeviceSize offset = 0, uint32_t stride = 12);
@@ -689,7 +1283,9 @@ public:
     void resumeRendering();
     void beginRenderingOffscreen(VkImageView colorImage, VkExtent2D extent);
     void beginRendering(VkImageView depthImage);
-    void beginRendering(VkImageView depthImage, VkExtent2D extent);
+    // Depth-only pass. A nonzero viewMask renders once per set bit into the matching layer of a
+    // layered depth view (VK_KHR_multiview); the pipeline must be built with the same viewMask().
+    void beginRendering(VkImageView depthImage, VkExtent2D extent, uint32_t viewMask = 0);
     void beginRendering(VkImageView colorImage, VkImageView depthImage, VkExtent2D extent);
     void beginRendering(std::span<const VkImageView> colorImages, VkImageView depthImage, VkExtent2D extent);
     void endRendering();
@@ -713,6 +1309,12 @@ public:
     void submitAndWait();
     void end();
 
+    // `count` uninitialized Ts from the recording's FrameArena: the frame slot's arena for a
+    // Frame's commands, the setup arena otherwise. For arrays handed to vkCmd* calls; they stay
+    // valid until that arena resets.
+    template<typename T>
+    T * scratch(size_t count) { return scratchArena().allocate<T>(count); }
+
     operator VkCommandBuffer();
 };
 
@@ -720,14 +1322,22 @@ public:
 
 class Pipeline {
     VkPipeline pipeline;
+    VulkanContext * context;
+    std::array<uint32_t, 3> localSize_ = {0, 0, 0};
+    friend Pipeline createComputePipeline(ShaderModule &, const SpecConstants &, const char *);
 public:
-    Pipeline() : pipeline(VK_NULL_HANDLE) {}
-    explicit Pipeline(VkPipeline pipeline) : pipeline(pipeline) {}
-    Pipeline(Pipeline && other) : pipeline(other.pipeline) { other.pipeline = VK_NULL_HANDLE; }
+    Pipeline() : pipeline(VK_NULL_HANDLE), context(nullptr) {}
+    // Owned by the calling thread's context.
+    explicit Pipeline(VkPipeline pipeline) : pipeline(pipeline), context(g_context.current()) {}
+    Pipeline(Pipeline && other) : pipeline(other.pipeline), context(other.context), localSize_(other.localSize_) {
+        other.pipeline = VK_NULL_HANDLE;
+    }
     Pipeline & operator=(Pipeline && other) {
         if (this != &other) {
-            if (pipeline != VK_NULL_HANDLE) destroyPipeline(pipeline);
+            if (pipeline != VK_NULL_HANDLE) destroyPipeline(*context, pipeline);
             pipeline = other.pipeline;
+            context = other.context;
+            localSize_ = other.localSize_;
             other.pipeline = VK_NULL_HANDLE;
         }
         return *this;
@@ -736,9 +1346,11 @@ public:
     Pipeline & operator=(const Pipeline &) = delete;
     ~Pipeline();
     operator VkPipeline() const { return pipeline; }
+    // Workgroup size of a compute pipeline after specialization; zeros for graphics pipelines.
+    const std::array<uint32_t, 3> & localSize() const { return localSize_; }
 
 private:
-    static void destroyPipeline(VkPipeline pipeline);
+    static void destroyPipeline(VulkanContext & context, VkPipeline pipeline);
 };
 
 struct GraphicsPipelineBuilder {
@@ -749,6 +1361,7 @@ struct GraphicsPipelineBuilder {
     bool noColorAttachments = false;
     bool enableAlphaBlend;
     bool disableDepthTest;
+    uint32_t multiviewMask = 0;
     VkFormat depthOnlyFormat;
     std::vector<VkFormat> colorAttachmentFormats;
     GraphicsPipelineBuilder();
@@ -760,11 +1373,31 @@ struct GraphicsPipelineBuilder {
     GraphicsPipelineBuilder & alphaBlend();
     GraphicsPipelineBuilder & noDepth();
     GraphicsPipelineBuilder & noColor();
+    // Multiview mask; must match the viewMask passed to beginRendering. Shaders read gl_ViewIndex.
+    GraphicsPipelineBuilder & viewMask(uint32_t mask);
     Pipeline build();
 };
 
 Pipeline createComputePipeline(ShaderModule & computeShaderModule, const char * entryPoint = "main");
 
+// Specialization constants for pipeline creation: 32-bit values keyed by constant_id.
+// Typical use is a workgroup size declared with local_size_x_id.
+//
+//   Pipeline p = createComputePipeline(module, SpecConstants().set(0, 256u));
+//   Pipeline q = createComputePipeline(module, SpecConstants().localSize(module.reflection, g_context().subgroupLocalSize()));
+struct SpecConstants {
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint32_t> data;
+    SpecConstants & set(uint32_t constantId, uint32_t value);
+    SpecConstants & set(uint32_t constantId, int32_t value);
+    SpecConstants & set(uint32_t constantId, float value);
+    // Sets the local_size_*_id constants `reflection` declares. Throws when a dimension that
+    // differs from the shader's fixed size has no constant_id.
+    SpecConstants & localSize(const ShaderReflection & reflection, uint32_t x, uint32_t y = 1, uint32_t z = 1);
+};
+
+Pipeline createComputePipeline(ShaderModule & computeShaderModule, const SpecConstants & constants, const char * entryPoint = "main");
+
 // --- Pipeline cache ---
 
 // Derive a per-user, machine-local cache directory for `appName` and create it.
@@ -810,7 +1443,8 @@ public:
 // Labeled per-segment GPU timing over TimestampQuery. begin() marks the start;
 // each mark() closes one labeled segment. After the GPU work completes (e.g.
 // submitAndWait), resolve() returns labeled millisecond durations. Keeps query
-// pools and tick conversion out of call sites.
+// pools and tick conversion out of call sites. Labels are stored as pointers, so pass
+// literals (or strings that outlive resolve()); nothing is allocated after construction.
 //
 //   GpuTimer timer(passCount);
 //   timer.begin(cmd);
@@ -820,7 +1454,9 @@ public:
 //   for (auto & [label, ms] : timer.resolve()) ...
 class GpuTimer {
     TimestampQuery query;
-    std::vector<std::string> labels;
+    std::vector<const char *> labels;
+    std::vector<uint64_t> ticks;
+    std::vector<std::pair<const char *, double>> results;
     uint32_t frame;
     uint32_t next;
 
@@ -829,6 +1465,888 @@ public:
     explicit GpuTimer(uint32_t maxSegments, uint32_t frameCount = 1);
     void begin(Commands & cmd, uint32_t frameIndex = 0);
     void mark(Commands & cmd, const char * label);
-    // Labeled durations in milliseconds; empty if results are not yet ready.
-    std::vector<std::pair<std::string, double>> resolve();
+    // Labeled durations in milliseconds; empty if results are not yet ready. Valid until the
+    // next resolve().
+    const std::vector<std::pair<const char *, double>> & resolve();
+};
+
+// --- Dynamic resolution ---
+
+// Holds a GPU time budget for one pass by scaling its render extent inside render targets
+// preallocated at maxExtent. begin()/end() bracket the measured pass with timestamps, one
+// query pair per frame-in-flight slot; begin() first folds in the timing that slot recorded
+// last time round (complete, since Frame waited on its fence) and picks this frame's
+// extent(). Render with beginRendering(..., extent()) — renderArea, viewport and scissor
+// become the top-left sub-rect, so nothing is reallocated — then sample the sub-rect with
+// uvScale() when upscaling. Scale drops quickly under a spike and recovers gradually.
+//
+//   DynamicResolution dynres({w, h}, 8.0f);
+//   dynres.begin(cmd);
+//   cmd.beginRendering(color.imageView, depth.imageView, dynres.extent());
+//   /* main pass */
+//   cmd.endRendering();
+//   dynres.end(cmd);
+//   /* blit: uv *= dynres.uvScale() */
+class DynamicResolution {
+    // One slot per frame in flight, sized from the swapchain by the constructor and resize().
+    std::unique_ptr<TimestampQuery> query;
+    std::vector<bool> written;
+    std::vector<float> slotScale;   // scale each slot's pending measurement was rendered at
+    VkExtent2D maxExtent_;
+    VkExtent2D extent_;
+    float budgetMillis_;
+    float minScale_, maxScale_;
+    float scale_;
+    double gpuMillis_ = 0.0;
+    uint32_t slot = 0;
+
+    void fitSlots();
+
+public:
+    // Scales are per axis, relative to maxExtent. Frame-in-flight count is the swapchain's.
+    DynamicResolution(VkExtent2D maxExtent, float budgetMillis, float minScale = 0.5f, float maxScale = 1.0f);
+    DynamicResolution(const DynamicResolution &) = delete;
+    DynamicResolution & operator=(const DynamicResolution &) = delete;
+
+    // Call inside a Frame, before and after the measured pass.
+    void begin(Commands & cmd);
+    void end(Commands & cmd);
+
+    // New max-size targets (e.g. from onSwapchainResize). Keeps the current scale. If the
+    // swapchain's image count changed, the per-slot queries are recreated and pending
+    // measurements dropped, so call it with the device idle, as the resize callback is.
+    void resize(VkExtent2D maxExtent);
+    void budget(float millis) { budgetMillis_ = millis; }
+
+    VkExtent2D extent() const { return extent_; }
+    VkExtent2D maxExtent() const { return maxExtent_; }
+    float scale() const { return scale_; }
+    // Smoothed GPU milliseconds of the measured pass; 0 until the first result lands.
+    double gpuMillis() const { return gpuMillis_; }
+    // extent() / maxExtent(): multiply full-target UVs by this to sample the rendered sub-rect.
+    std::array<float, 2> uvScale() const;
+};
+
+// --- Image-based lighting ---
+
+// Bakes split-sum IBL inputs from an environment cube with built-in compute shaders:
+//   prefiltered()  — cube; mip m is GGX-prefiltered for roughness m / (mipCount - 1)
+//   irradianceSH() — 9 vec4 L2 spherical-harmonic irradiance coefficients (rgb; w unused)
+//   brdfLut()      — lutSize² split-sum LUT, (scale, bias) in rg, x = NdotV, y = roughness
+// One 2D-array storage view per prefiltered mip is created up front and reused by every
+// bake(); each mip is a single dispatch with z = 6. The BRDF LUT is environment-independent
+// and is baked once. All outputs are left in Layout::ShaderReadOnly.
+//
+//   IblBaker ibl(setupCmd);
+//   ibl.bake(cmd, skybox);              // skybox: cube, ShaderReadOnly
+//   cmd.submitAndWait();
+//   for (auto & [label, ms] : ibl.timings()) ...
+class IblBaker {
+    std::unique_ptr<ShaderModule> prefilterShader, irradianceShader, brdfLutShader;
+    Pipeline prefilterPipeline, irradiancePipeline, brdfLutPipeline;
+    std::unique_ptr<Image> prefiltered_, brdfLut_;
+    std::unique_ptr<Buffer> irradianceSH_;
+    std::vector<Image::StorageView> mipViews;
+    Image::StorageView brdfLutView;
+    GpuTimer timer;
+    bool baked = false;
+
+public:
+    explicit IblBaker(Commands & cmd, uint32_t edge = 256, uint32_t mipCount = 6, uint32_t lutSize = 256);
+    ~IblBaker();
+    IblBaker(const IblBaker &) = delete;
+    IblBaker & operator=(const IblBaker &) = delete;
+
+    // Records a (re-)bake from `environment`, a cube image in Layout::ShaderReadOnly.
+    void bake(Commands & cmd, const Image & environment);
+    // Labeled GPU milliseconds of the last bake; empty until the GPU has finished it. The BRDF
+    // LUT depends on nothing but its size, so only the first bake computes it (and reports an
+    // "ibl brdf lut" segment).
+    const std::vector<std::pair<const char *, double>> & timings();
+
+    Image & prefiltered() { return *prefiltered_; }
+    Image & brdfLut() { return *brdfLut_; }
+    Buffer & irradianceSH() { return *irradianceSH_; }
+};
+
+// --- GPU compute primitives ---
+
+enum class ReduceOp : uint32_t { Add, Min, Max };
+
+// Data-parallel building blocks over uint32 storage buffers, as built-in compute pipelines:
+// exclusive/inclusive scan, stream compaction, segmented reduction and stable LSD radix sort of
+// 32- or 64-bit keys with optional uint32 values. Kernels use subgroup arithmetic when the
+// device supports it in compute (else shared memory); the workgroup size is a specialization
+// constant. Scratch buffers grow on demand and are reused by later calls; a scratch buffer
+// that grows is retired through the frame's destroy generation even with immediateDestroy, so
+// earlier calls recorded on the same Commands keep a live buffer.
+//
+// Each call records its own internal barriers. Inputs must already be visible to compute
+// shader reads; outputs are left as compute shader writes, so barrier before consuming them.
+//
+//   GpuPrimitives prims;
+//   prims.exclusiveScan(cmd, counts, offsets, n);
+//   prims.radixSort(cmd, keys, &values, n);
+class GpuPrimitives {
+    struct Kernel {
+        std::unique_ptr<ShaderModule> shader;
+        Pipeline pipeline;
+    };
+    uint32_t workgroupSize_;
+    bool subgroups_;
+    Kernel scanKernel, scanAddKernel, compactKernel, reduceKernel, radixCountKernel, radixScatterKernel;
+    std::vector<std::unique_ptr<Buffer>> scanPartials;   // one per scan level
+    std::unique_ptr<Buffer> compactIndices, radixHistogram, radixKeys, radixValues;
+
+    Kernel makeKernel(const uint32_t * words, size_t byteCount, const char * name);
+    static Buffer & scratch(std::unique_ptr<Buffer> & slot, size_t byteCount);
+    void dispatchGroups(Commands & cmd, uint32_t groups);
+    void scan(Commands & cmd, Buffer & input, Buffer & output, uint32_t count, bool inclusive, bool predicate, uint32_t level);
+
+public:
+    // workgroupSize: power of two in [32, 512]. useSubgroups = false forces the shared-memory path.
+    explicit GpuPrimitives(uint32_t workgroupSize = 256, bool useSubgroups = true);
+    GpuPrimitives(const GpuPrimitives &) = delete;
+    GpuPrimitives & operator=(const GpuPrimitives &) = delete;
+
+    uint32_t workgroupSize() const { return workgroupSize_; }
+    bool usesSubgroups() const { return subgroups_; }
+
+    // output[i] = sum of input[0 .. i) (exclusive) or [0 .. i] (inclusive). input may equal output.
+    void exclusiveScan(Commands & cmd, Buffer & input, Buffer & output, uint32_t count);
+    void inclusiveScan(Commands & cmd, Buffer & input, Buffer & output, uint32_t count);
+    // Copies values[i] with flags[i] != 0 to the front of output, in order; countOut[0] = kept.
+    // count == 0 records nothing.
+    void compact(Commands & cmd, Buffer & values, Buffer & flags, Buffer & output, Buffer & countOut, uint32_t count);
+    // output[s] = op over values[offsets[s] .. offsets[s + 1]); offsets holds segmentCount + 1 entries.
+    // valueCount is the number of values the offsets index (offsets[segmentCount] at most); values
+    // must hold that many, and offsets beyond it are clamped on the device.
+    void segmentedReduce(Commands & cmd, Buffer & values, Buffer & offsets, Buffer & output,
+                         uint32_t segmentCount, uint32_t valueCount, ReduceOp op = ReduceOp::Add);
+    // Stable ascending sort in place. keyBits 64 reads keys as (low, high) uint32 word pairs.
+    // values (nullable) holds one uint32 per key and is permuted alongside.
+    void radixSort(Commands & cmd, Buffer & keys, Buffer * values, uint32_t count, uint32_t keyBits = 32);
+};
+
+// --- Draw lists ---
+
+// Counters from one DrawList::replay: what was recorded versus elided.
+struct DrawReplayStats {
+    uint32_t draws = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t pushConstantUploads = 0;
+};
+
+// Collects mesh-task draw packets, sorts them by a packed 64-bit key and replays them into
+// Commands with redundant pipeline binds and identical push-constant uploads elided. Push
+// constants survive pipeline changes because every pipeline shares the bindless layout.
+//
+// Key layout, most significant first (see DrawList::key):
+//   pass (4 bits) | pipeline (12-bit handle hash) | material RID (24) | depth (24)
+// Equal keys keep submission order (bucket order, then order within a bucket).
+//
+// Each thread fills its own bucket; buckets are cache-line aligned and unsynchronized, so
+// bucket(i) must only be written by one thread at a time and never during sort/replay.
+//
+//   DrawList list(threadCount);
+//   list.bucket(t).draw(DrawList::key(0, pipeline, materialRID, depth), pipeline, push, groups);
+//   list.replay(cmd);   // sorts first
+//   list.clear();
+class DrawList {
+    struct Packet {
+        uint64_t key;
+        VkPipeline pipeline;
+        uint32_t pushOffset;
+        uint32_t pushSize;
+        uint32_t groups[3];
+        VkBuffer indirectBuffer;
+        VkDeviceSize indirectOffset;
+        uint32_t drawCount;
+        uint32_t stride;
+    };
+    struct SortEntry {
+        uint64_t key;
+        uint32_t bucket;
+        uint32_t packet;
+    };
+
+public:
+    class alignas(64) Bucket {
+        friend class DrawList;
+        std::vector<Packet> packets;
+        std::vector<uint8_t> payload;
+        bool dirty = false;   // packets added since the last sort
+        Packet & add(uint64_t key, VkPipeline pipeline, const void * push, uint32_t pushSize);
+
+    public:
+        void draw(uint64_t key, VkPipeline pipeline, const void * push, uint32_t pushSize,
+                  uint32_t x, uint32_t y = 1, uint32_t z = 1);
+        void drawIndirect(uint64_t key, VkPipeline pipeline, const void * push, uint32_t pushSize,
+                          VkBuffer buffer, uint32_t drawCount, VkDeviceSize offset = 0, uint32_t stride = 12);
+        template<typename T>
+        void draw(uint64_t key, VkPipeline pipeline, const T & push, uint32_t x, uint32_t y = 1, uint32_t z = 1) {
+            static_assert(sizeof(T) <= 128, "Push constants exceed 128-byte Vulkan guaranteed minimum");
+            draw(key, pipeline, &push, sizeof(T), x, y, z);
+        }
+        template<typename T>
+        void drawIndirect(uint64_t key, VkPipeline pipeline, const T & push,
+                          VkBuffer buffer, uint32_t drawCount, VkDeviceSize offset = 0, uint32_t stride = 12) {
+            static_assert(sizeof(T) <= 128, "Push constants exceed 128-byte Vulkan guaranteed minimum");
+            drawIndirect(key, pipeline, &push, sizeof(T), buffer, drawCount, offset, stride);
+        }
+    };
+
+    explicit DrawList(uint32_t bucketCount = 1);
+
+    Bucket & bucket(uint32_t index) { return buckets.at(index); }
+    uint32_t bucketCount() const { return (uint32_t)buckets.size(); }
+    size_t size() const;
+
+    // Stable LSD radix sort of all buckets by key (8-bit digits; passes whose digit is the same
+    // for every packet are skipped). Called by replay() when packets were added or cleared since.
+    void sort();
+    DrawReplayStats replay(Commands & cmd);
+    // Replays into anything with Commands' bindGraphics, pushConstants(data, size),
+    // drawMeshTasks and drawMeshTasksIndirect; replay(Commands &) is this with Commands.
+    template<typename Recorder>
+    DrawReplayStats replay(Recorder & out);
+    // Drops all packets; bucket storage is kept for the next frame.
+    void clear();
+
+    // depth in [0, 1] (view depth normalized by the caller); backToFront flips it for blending.
+    static uint64_t key(uint32_t pass, VkPipeline pipeline, uint32_t materialRID, float depth, bool backToFront = false);
+
+private:
+    std::vector<Bucket> buckets;
+    std::vector<SortEntry> order, scratch;
+    bool dirty = false;   // cleared since the last sort
+};
+
+template<typename Recorder>
+DrawReplayStats DrawList::replay(Recorder & out) {
+    bool stale = dirty;
+    for (const Bucket & bucket : buckets) stale |= bucket.dirty;
+    if (stale) sort();
+
+    DrawReplayStats stats;
+    VkPipeline bound = VK_NULL_HANDLE;
+    const uint8_t * lastPush = nullptr;
+    uint32_t lastPushSize = 0;
+    for (const SortEntry & entry : order) {
+        const Bucket & bucket = buckets[entry.bucket];
+        const Packet & packet = bucket.packets[entry.packet];
+        if (packet.pipeline != bound) {
+            out.bindGraphics(packet.pipeline);
+            bound = packet.pipeline;
+            stats.pipelineBinds++;
+        }
+        const uint8_t * push = bucket.payload.data() + packet.pushOffset;
+        if (packet.pushSize > 0 &&
+            (packet.pushSize != lastPushSize || std::memcmp(push, lastPush, packet.pushSize) != 0)) {
+            out.pushConstants(push, packet.pushSize);
+            lastPush = push;
+            lastPushSize = packet.pushSize;
+            stats.pushConstantUploads++;
+        }
+        if (packet.indirectBuffer != VK_NULL_HANDLE) {
+            out.drawMeshTasksIndirect(packet.indirectBuffer, packet.drawCount, packet.indirectOffset, packet.stride);
+        } else {
+            out.drawMeshTasks(packet.groups[0], packet.groups[1], packet.groups[2]);
+        }
+        stats.draws++;
+    }
+    return stats;
+}
+
+// --- Per-draw data ring ---
+
+// Frame-ringed, persistently mapped storage for per-draw structs and per-frame globals, so
+// push constants carry slot indices instead of payloads. One buffer holds a region per frame
+// in flight and keeps a single RID for its lifetime. beginFrame() rewinds to the region of
+// Frame::current(), which the GPU has finished with.
+//
+// write<T>() returns an index into an array of T: the slot starts at a multiple of sizeof(T)
+// from the start of the buffer, so a shader declaring `buffer { T items[]; }` at binding 0
+// reads items[slot]. T must have the same size in C++ and under std430.
+//
+//   DrawDataRing ring(64 * 1024);
+//   ring.beginFrame();
+//   push.drawDataRID = ring.rid();
+//   push.globalsSlot = ring.write(frameGlobals);
+//   for (auto & obj : objects) { push.objectSlot = ring.write(obj.data); /* draw */ }
+//   ring.flush();   // before submit
+class DrawDataRing {
+    std::unique_ptr<Buffer> buffer;
+    uint8_t * mapped = nullptr;
+    size_t frameBytes;
+    uint32_t frameCount;
+    uint32_t frame = 0;
+    size_t cursor = 0;       // bytes used in the current frame's region
+
+public:
+    // bytesPerFrame: capacity of each frame's region. Frame count is the swapchain's.
+    explicit DrawDataRing(size_t bytesPerFrame);
+    DrawDataRing(const DrawDataRing &) = delete;
+    DrawDataRing & operator=(const DrawDataRing &) = delete;
+
+    void beginFrame();
+    // Copies size bytes to an offset that is a multiple of stride; returns offset / stride.
+    uint32_t write(const void * data, size_t size, size_t stride);
+    template<typename T>
+    uint32_t write(const T & value) {
+        static_assert(std::is_trivially_copyable_v<T>, "DrawDataRing stores trivially copyable structs");
+        return write(&value, sizeof(T), sizeof(T));
+    }
+    // Makes this frame's writes visible to the device (no-op on coherent memory).
+    void flush();
+
+    uint32_t rid() const { return buffer->rid(); }
+    size_t bytesUsed() const { return cursor; }
+    size_t bytesPerFrame() const { return frameBytes; }
+};
+
+
+// --- Clustered lights ---
+
+// One light for LightClusterer. A spot light sets spotCos to the cosine of its cone
+// half-angle; point lights leave it at -1.
+struct ClusterLight {
+    float position[3] = {0.0f, 0.0f, 0.0f};    // world space
+    float range = 1.0f;                         // no contribution beyond this distance
+    float color[3] = {1.0f, 1.0f, 1.0f};
+    float intensity = 1.0f;
+    float direction[3] = {0.0f, 0.0f, -1.0f};  // spot axis, world space
+    float spotCos = -1.0f;
+};
+
+// Camera for LightClusterer::cull: a symmetric perspective looking down -Z in view space,
+// whose projection puts view-space +Y at the top of the framebuffer.
+struct ClusterView {
+    float view[16];          // world -> view, column-major
+    float tanHalfFovX;
+    float tanHalfFovY;
+    float zNear;
+    float zFar;
+};
+
+// Bins lights into a gridX × gridY × gridZ froxel grid on the GPU. Tiles split the viewport
+// evenly; depth slices are exponential between zNear and zFar, so near slices stay thin.
+// setLights() stages a compact SoA light list; cull() uploads it into this frame's light
+// buffer (one per frame in flight) with a header describing the grid, and records the culling
+// pass. Each cluster gets a count and a fixed list of up to maxLightsPerCluster light indices;
+// extra lights are dropped.
+//
+// Fragment shaders need only rid(): include/glsl/light_clusters.glsl walks the header.
+//
+//   LightClusterer clusterer(1024);
+//   clusterer.setLights(lights);                  // whenever the lights change
+//   clusterer.cull(cmd, clusterView, extent);     // each frame, before the lit pass
+//   push.clusterRID = clusterer.rid();
+class LightClusterer {
+    std::unique_ptr<ShaderModule> shader;
+    Pipeline pipeline;
+    std::vector<std::unique_ptr<Buffer>> lightBuffers;   // per frame in flight: header + SoA lights
+    std::vector<uint64_t> uploadedVersion;
+    std::unique_ptr<Buffer> clusters;                    // counts, then per-cluster index lists
+    std::vector<uint32_t> staged;                         // SoA words awaiting upload
+    uint64_t version = 1;
+    uint32_t maxLights_;
+    uint32_t gridX, gridY, gridZ;
+    uint32_t maxPerCluster;
+    uint32_t lightCount_ = 0;
+    uint32_t slot = 0;
+
+public:
+    explicit LightClusterer(uint32_t maxLights, uint32_t gridX = 16, uint32_t gridY = 9, uint32_t gridZ = 24,
+                            uint32_t maxLightsPerCluster = 128);
+    LightClusterer(const LightClusterer &) = delete;
+    LightClusterer & operator=(const LightClusterer &) = delete;
+
+    // Replaces the light list (at most maxLights); it is uploaded by the following cull() calls.
+    void setLights(std::span<const ClusterLight> lights);
+    // Records the culling pass. Results are visible to fragment and compute shader reads.
+    void cull(Commands & cmd, const ClusterView & view, VkExtent2D viewport);
+
+    // Light buffer used by the last cull(); the only RID the lookup include needs.
+    uint32_t rid() const { return lightBuffers[slot]->rid(); }
+    Buffer & clusterBuffer() { return *clusters; }
+    uint32_t clusterCount() const { return gridX * gridY * gridZ; }
+    uint32_t lightCount() const { return lightCount_; }
+    uint32_t maxLights() const { return maxLights_; }
+};
+
+// --- Shadow atlas ---
+
+// A shadow map's square in the atlas, in texels. size 0 means the light got no tile this frame.
+struct ShadowTile {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t size = 0;
+    bool valid() const { return size != 0; }
+};
+
+// Packs the shadow maps of many lights into one depth-sampled image per frame in flight, so
+// shadows cost one image, one barrier and one RID however many lights cast them. Each frame,
+// allocate() sizes a square power-of-two tile per light from its importance (1 = maxTileSize,
+// each halving of importance one size smaller, never below minTileSize) and packs the tiles.
+// When they do not fit, the least important lights shrink first, then lose their tiles. Tile
+// UV transforms go to a per-frame storage buffer read by include/glsl/shadow_atlas.glsl.
+//
+//   ShadowAtlas atlas(setupCmd, 4096);
+//   auto tiles = atlas.allocate(importances);     // one per light, in input order
+//   atlas.begin(cmd);                             // clears the whole atlas
+//   for (uint32_t i = 0; i < tiles.size(); ++i) {
+//       if (!tiles[i].valid()) continue;
+//       atlas.setTile(cmd, i);                    // viewport + scissor
+//       /* draw light i's casters with its own light projection */
+//   }
+//   atlas.end(cmd);                               // -> sampled as sampler2DShadow at rid()
+//   push.shadowAtlasRID = atlas.rid();
+//   push.shadowTilesRID = atlas.tileBufferRID();
+class ShadowAtlas {
+    std::vector<Image> atlases;                         // per frame in flight
+    std::vector<bool> sampled;                          // atlas left in DepthReadOnly by end()
+    std::vector<std::unique_ptr<Buffer>> tileBuffers;   // per frame in flight: 2 vec4 per tile
+    std::vector<ShadowTile> tiles;
+    uint32_t size_, maxTileSize, minTileSize, maxTiles_;
+    uint32_t slot = 0;
+
+public:
+    // All sizes are powers of two with minTileSize <= maxTileSize <= size.
+    explicit ShadowAtlas(Commands & cmd, uint32_t size = 4096, uint32_t maxTileSize = 1024,
+                         uint32_t minTileSize = 128, uint32_t maxTiles = 256);
+    ShadowAtlas(const ShadowAtlas &) = delete;
+    ShadowAtlas & operator=(const ShadowAtlas &) = delete;
+
+    // Lays out this frame's tiles, one per importance value in [0, 1], and uploads their UV
+    // transforms. Returns tiles in input order.
+    std::span<const ShadowTile> allocate(std::span<const float> importance);
+    // Barrier to depth attachment and beginRendering over the whole atlas (cleared to 1.0).
+    void begin(Commands & cmd);
+    // Viewport and scissor for tile i of the last allocate().
+    void setTile(Commands & cmd, uint32_t tile);
+    // endRendering and barrier to fragment-shader sampling.
+    void end(Commands & cmd);
+
+    // The packing allocate() uses, without a GPU.
+    static std::vector<ShadowTile> layout(std::span<const float> importance, uint32_t atlasSize,
+                                          uint32_t maxTileSize, uint32_t minTileSize);
+
+    uint32_t rid() const { return atlases[slot].rid(); }
+    uint32_t tileBufferRID() const { return tileBuffers[slot]->rid(); }
+    Buffer & tileBuffer() { return *tileBuffers[slot]; }
+    Image & image() { return atlases[slot]; }
+    std::span<const ShadowTile> currentTiles() const { return tiles; }
+    uint32_t size() const { return size_; }
+};
+
+// --- Frame capture ---
+
+enum class CaptureFormat {
+    Tga,   // 24-bit uncompressed, top-left origin
+    Qoi,   // lossless, typically a third of TGA's size and faster to write
+};
+
+// Saves rendered frames to disk without stalling the render thread. capture() records a copy
+// of the swapchain (or an offscreen color image) into a free slot of a persistently mapped
+// readback ring, inside the frame's own command buffer. Once the frame that slot was recorded
+// in is known complete (swapchainImageCount frames later, after Frame() waited its fence), the
+// slot goes to a worker thread that encodes and writes it, then frees the slot. If encoding
+// falls behind and no slot is free, the capture is dropped and counted rather than waited on.
+// 8-bit RGBA/BGRA color formats only.
+//
+//   FrameCapture capture("captures/frame_%05u.qoi", CaptureFormat::Qoi);
+//   ...
+//   Frame frame;
+//   Commands cmd = frame.beginCommands();
+//   /* render */
+//   capture.captureSwapchain(cmd);                 // after the last draw, before submit
+//   frame.submit(cmd);
+//   ...
+//   capture.flush();                               // all captures so far are on disk
+class FrameCapture {
+    enum class SlotState { Free, Recorded, Encoding };
+    struct Slot {
+        std::unique_ptr<Buffer> buffer;
+        SlotState state = SlotState::Free;
+        VkExtent2D extent = {0, 0};
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint64_t frameSerial = 0;   // 0 = recorded outside a Frame
+        uint32_t index = 0;         // capture number, used in the file name
+    };
+
+    std::string pattern;
+    CaptureFormat fileFormat;
+    std::vector<Slot> slots;
+    uint32_t nextIndex = 0;
+    uint32_t dropped_ = 0;
+    uint32_t written_ = 0;
+    uint32_t failed_ = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake, idle;
+    std::deque<uint32_t> queue;     // slots waiting for the worker
+    bool stopping = false;
+    std::thread worker;
+
+    // Queue recorded slots whose frame has completed (all of them when `all`). Slots recorded
+    // outside a Frame are queued only when `outsideFrame`, i.e. their Commands were submitted.
+    void promote(bool all, bool outsideFrame);
+    bool record(Commands & cmd, VkImage image, VkExtent2D extent, VkFormat format,
+                Layout layout, Stage stage, Access access);
+    void run();
+    bool encode(const Slot & slot);
+
+public:
+    // `pathPattern` is a printf pattern taking the capture number (%u). ringSize 0 uses twice
+    // the frames in flight.
+    explicit FrameCapture(std::string pathPattern, CaptureFormat format = CaptureFormat::Tga, uint32_t ringSize = 0);
+    FrameCapture(const FrameCapture &) = delete;
+    FrameCapture & operator=(const FrameCapture &) = delete;
+    // Flushes, then joins the worker.
+    ~FrameCapture();
+
+    // Copies the current Frame's swapchain image. Returns false when the capture was dropped.
+    bool captureSwapchain(Commands & cmd);
+    // Copies mip 0 / layer 0 of `image`, which is in `layout` after `stage`/`access` and is
+    // left that way. Outside a Frame the slot stays busy until submitted() or flush().
+    bool capture(Commands & cmd, Image & image, Layout layout, Stage stage, Access access);
+    // After submitAndWait() of Commands that capture() recorded into outside a Frame: hands
+    // those captures to the worker.
+    void submitted();
+    // Waits for the device and the worker: every capture so far is written (or failed).
+    void flush();
+
+    uint32_t written();
+    uint32_t failed();
+    uint32_t dropped() const { return dropped_; }
+};
+
+
+// --- Asset archive ---
+
+// Read-only pack of many small files (SPIR-V, textures) in one file, memory-mapped on open so
+// a lookup is a binary search and blobs are read straight out of the mapping: no per-file
+// open, no read into a temporary vector. Layout: a 32-byte header, a table of contents sorted
+// by FNV-1a hash of the entry name, the names, then the blobs at 64-byte aligned offsets.
+// Names are paths relative to the packed directory with '/' separators. Spans stay valid for
+// the archive's lifetime. Build archives with pack() or the vkobjects-pack tool.
+//
+//   AssetArchive assets("assets.vkpak");
+//   ShaderModule frag(ShaderBuilder().fragment().fromBuffer(assets.get("shaders/blit.frag.spv")));
+//   Buffer staging = assets.stagingBuffer("textures/bricks.bin");   // one memcpy from the map
+class AssetArchive {
+    struct Entry {
+        uint64_t hash;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+    };
+
+    const uint8_t * base = nullptr;
+    size_t mappedSize = 0;
+    std::vector<Entry> entries;   // sorted by (hash, name)
+    std::string path_;
+
+    std::string_view entryName(const Entry & e) const;
+    void unmap();
+
+public:
+    // Maps and validates `path`; throws on a missing, truncated or malformed archive.
+    explicit AssetArchive(const std::string & path);
+    AssetArchive(AssetArchive && other) noexcept;
+    AssetArchive & operator=(AssetArchive && other) noexcept;
+    AssetArchive(const AssetArchive &) = delete;
+    AssetArchive & operator=(const AssetArchive &) = delete;
+    ~AssetArchive();
+
+    // The blob named `name`, or an empty span when there is none.
+    std::span<const uint8_t> find(std::string_view name) const;
+    // find(), throwing when the entry is missing.
+    std::span<const uint8_t> get(std::string_view name) const;
+    bool contains(std::string_view name) const;
+    // Host-visible transfer source holding the blob, filled with a single copy from the map.
+    Buffer stagingBuffer(std::string_view name) const;
+
+    size_t size() const { return entries.size(); }
+    // Entry names in table order (hash order, not alphabetical).
+    std::string_view name(size_t index) const { return entryName(entries.at(index)); }
+    const std::string & path() const { return path_; }
+
+    // Packs every regular file under `directory` into `archivePath`, replacing it atomically.
+    // Returns the number of entries; throws when a file cannot be read or the write fails.
+    static size_t pack(const std::string & directory, const std::string & archivePath);
+    // The archive image for explicit (name, bytes) entries. Throws on duplicate names.
+    static std::vector<uint8_t> build(const std::vector<std::pair<std::string, std::vector<uint8_t>>> & files);
+};
+
+// --- Cooked textures ---
+
+enum class MipFilter {
+    Box,      // 2x2 average
+    Kaiser,   // Kaiser-windowed sinc, 3-texel radius at the destination level: sharper mips
+};
+
+enum class TextureCompression {
+    None,   // B8G8R8A8
+    BC1,    // 4 bpp, alpha dropped
+    BC3,    // 8 bpp, BC1 color plus an interpolated alpha block
+};
+
+// Offline texture cooking (the vkobjects-cook tool). The full mip chain is filtered in linear
+// space on the CPU, split by rows into JobSystem jobs (SSE2 where available), then optionally
+// BC-compressed. The file is a header, a per-mip table of offsets and sizes, and the mips at
+// 16-byte aligned offsets. Each table entry maps 1:1 onto a VkBufferImageCopy, so the whole
+// file is copied into staging as-is and uploaded with one multi-region copy, with no
+// recordMipmapGeneration on the GPU.
+//
+//   auto file = cookTexture(bgra, w, h, TextureCookOptions().kaiser().bc3());
+//   ...
+//   Image texture = loadCookedTexture(cmd, assets.get("textures/bricks.vktex"));
+struct TextureCookOptions {
+    MipFilter filter = MipFilter::Box;
+    TextureCompression compression = TextureCompression::None;
+    bool srgb = true;
+    uint32_t threads = 0;   // 0 = the context's jobs() (hardware concurrency without a context)
+
+    TextureCookOptions & box() { filter = MipFilter::Box; return *this; }
+    TextureCookOptions & kaiser() { filter = MipFilter::Kaiser; return *this; }
+    TextureCookOptions & bc1() { compression = TextureCompression::BC1; return *this; }
+    TextureCookOptions & bc3() { compression = TextureCompression::BC3; return *this; }
+    // Color data is linear (normal maps, masks): no sRGB decode before filtering, UNORM format.
+    TextureCookOptions & linear() { srgb = false; return *this; }
+    TextureCookOptions & threadCount(uint32_t n) { threads = n; return *this; }
+};
+
+// Cooks tightly packed 8-bit BGRA pixels (top-left origin) into a cooked texture file.
+std::vector<uint8_t> cookTexture(const uint8_t * bgra, uint32_t width, uint32_t height,
+                                 const TextureCookOptions & options = TextureCookOptions());
+
+// Parsed cooked texture header. Region buffer offsets are relative to the start of the file.
+struct CookedTexture {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent = {0, 0};
+    uint32_t mipLevels = 0;
+    size_t byteSize = 0;   // the whole file, i.e. the staging size
+    std::vector<VkBufferImageCopy> regions;
+
+    // Throws on a truncated or malformed file.
+    explicit CookedTexture(std::span<const uint8_t> file);
+};
+
+// One memcpy of `file` into a staging buffer and one vkCmdCopyBufferToImage for every mip.
+// The staging buffer's destruction is deferred like any other, so `cmd` may be submitted later.
+Image loadCookedTexture(Commands & cmd, std::span<const uint8_t> file);
+
+// --- Job system ---
+
+// Tracks a group of jobs: run() increments it, each finished job decrements it, and
+// JobSystem::wait() returns once it reaches zero. The first exception thrown by a job in the
+// group is rethrown from wait().
+class JobCounter {
+    std::atomic<uint32_t> pending{0};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    friend class JobSystem;
+
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter &) = delete;
+    JobCounter & operator=(const JobCounter &) = delete;
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Work-stealing job system: a fixed set of worker threads, each with a Chase-Lev deque. A
+// thread pushes and pops its own deque at the bottom (LIFO, cache-warm); idle threads steal
+// from the top of others'. The thread that constructs the system owns deque 0 and works
+// through jobs while it wait()s instead of blocking, so `workers` = 0 still makes progress.
+// Other threads may submit too; their jobs go through a shared queue. Idle workers spin
+// briefly and then sleep until new work arrives.
+//
+//   JobSystem & jobs = g_context().jobs();
+//   jobs.parallelFor(drawCount, 64, [&](uint32_t begin, uint32_t end) { cull(begin, end); });
+//
+//   JobCounter loads;
+//   for (auto & path : paths) jobs.run(loads, [&, path] { decode(path); });
+//   jobs.wait(loads);
+class JobSystem {
+    struct Job;
+    struct WorkDeque;
+
+    std::vector<std::unique_ptr<WorkDeque>> deques;   // [0] = owner thread, [i] = worker i
+    std::vector<std::thread> threads;
+    std::mutex injectMutex;
+    std::deque<Job *> injected;                      // jobs from threads without a deque
+    std::atomic<uint32_t> injectedCount{0};
+    std::atomic<int64_t> queued{0};
+    std::atomic<uint32_t> sleepers{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::pair<const JobSystem *, uint32_t> previousOwner;
+    VulkanContext * context;   // the creating thread's, bound on the workers
+
+    uint32_t selfIndex() const;
+    void push(Job * job);
+    Job * take(uint32_t self);
+    void execute(Job * job);
+    void workerLoop(uint32_t index);
+
+public:
+    static uint32_t defaultWorkerCount();
+    explicit JobSystem(uint32_t workers = defaultWorkerCount());
+    JobSystem(const JobSystem &) = delete;
+    JobSystem & operator=(const JobSystem &) = delete;
+    // Finishes queued jobs, then joins the workers. Call from the owner thread.
+    ~JobSystem();
+
+    // Queues `job` as part of `counter`. Jobs may run() and wait() on their own counters.
+    void run(JobCounter & counter, std::function<void()> job);
+    // Executes queued jobs on the calling thread until `counter` reaches zero.
+    void wait(JobCounter & counter);
+    // body(begin, end) over [0, count) in chunks of `grain`, the caller taking part. Runs
+    // inline when there is a single chunk or no workers.
+    void parallelFor(uint32_t count, uint32_t grain, const std::function<void(uint32_t begin, uint32_t end)> & body);
+
+    uint32_t workerCount() const { return uint32_t(threads.size()); }
+    // Threads that execute jobs: the workers plus the owner.
+    uint32_t concurrency() const { return workerCount() + 1; }
+};
+
+// --- Render thread ---
+
+// What the game thread hands the render thread for one frame: a DrawList (whose packets
+// already carry their push constants) plus a fixed-size bump arena for everything else:
+// per-frame state such as the camera, per-draw structs the render side will write into a
+// DrawDataRing, and so on. reset() rewinds both without freeing, so once the DrawList buckets
+// have grown to a frame's size, building a packet does no heap allocation. Arena memory is
+// not constructed or destroyed: trivially copyable types only.
+class FramePacket {
+    std::unique_ptr<uint8_t[]> arena;
+    size_t capacity;
+    size_t used = 0;
+    void * state_ = nullptr;
+    size_t stateSize = 0;
+    uint64_t serial_ = 0;
+    friend class RenderThread;
+
+public:
+    DrawList draws;
+
+    FramePacket(size_t arenaBytes, uint32_t drawBuckets);
+    FramePacket(const FramePacket &) = delete;
+    FramePacket & operator=(const FramePacket &) = delete;
+
+    // Throws when the arena is exhausted; the pointer stays valid until the packet is reset.
+    void * allocate(size_t size, size_t alignment);
+    template<typename T>
+    T * allocate(size_t count = 1) {
+        static_assert(std::is_trivially_copyable_v<T>, "FramePacket stores trivially copyable types");
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+    template<typename T>
+    T * push(const T & value) {
+        T * slot = allocate<T>();
+        std::memcpy(static_cast<void *>(slot), &value, sizeof(T));
+        return slot;
+    }
+    // The packet's one per-frame state block, value-initialized in the arena on first use after
+    // reset(); later calls, from either thread, return the same object.
+    template<typename T>
+    T & state() {
+        if (!state_) {
+            state_ = push(T{});
+            stateSize = sizeof(T);
+        } else if (stateSize != sizeof(T)) {
+            throw std::runtime_error("FramePacket::state() used with two different types");
+        }
+        return *static_cast<T *>(state_);
+    }
+    void reset();
+
+    size_t bytesUsed() const { return used; }
+    size_t arenaBytes() const { return capacity; }
+    // 1 for the first packet of a RenderThread, increasing by one per packet.
+    uint64_t serial() const { return serial_; }
+};
+
+struct RenderThreadOptions {
+    size_t arenaBytes = 1 << 20;
+    uint32_t drawBuckets = 1;
+    bool threaded = true;
+
+    RenderThreadOptions & arena(size_t bytes) { arenaBytes = bytes; return *this; }
+    RenderThreadOptions & buckets(uint32_t count) { drawBuckets = count; return *this; }
+    // Runs `render` inside submitPacket() on the calling thread: the serial loop, for A/B runs.
+    RenderThreadOptions & sameThread() { threaded = false; return *this; }
+};
+
+// Pipelines simulation against recording and submission. The game thread fills a FramePacket
+// for frame N+1 while a dedicated thread runs `render` on the packet of frame N, which records
+// and submits that frame with its own Frame, so a frame costs about max(sim, render) instead
+// of their sum. Two packets alternate; beginPacket() waits only while the render thread still
+// holds the packet it is about to reuse.
+//
+// While the render thread runs it is the only thread that may touch Vulkan: Frame, Commands,
+// resource creation and destruction all share unsynchronized context state (command pool,
+// deferred-destroy generations, bindless slots). The game thread does that work inside
+// `render`, or between flush() and the next submitPacket(). Frame::current() is only
+// meaningful on the render thread. An exception thrown by `render` stops the thread and is
+// rethrown from the next beginPacket(), submitPacket() or flush().
+//
+//   RenderThread renderer([&](FramePacket & packet) {
+//       Frame frame;
+//       Commands cmd = frame.beginCommands();
+//       SceneState & scene = packet.state<SceneState>();
+//       /* write scene globals into a DrawDataRing, packet.draws.replay(cmd), ... */
+//       frame.submit(cmd);
+//   });
+//   while (running) {
+//       pollEvents();
+//       FramePacket & packet = renderer.beginPacket();
+//       packet.state<SceneState>().viewProjection = camera.getViewProjection();
+//       for (auto & obj : objects) packet.draws.bucket(0).draw(obj.key, pipeline, obj.push, 1);
+//       renderer.submitPacket();
+//   }
+//   renderer.flush();
+class RenderThread {
+    std::function<void(FramePacket &)> render;
+    bool threaded;
+    std::array<std::unique_ptr<FramePacket>, 2> packets;
+    bool building = false;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake, done;
+    uint64_t submitted = 0;   // packets handed over
+    uint64_t rendered = 0;    // packets `render` has returned from
+    bool stopping = false;
+    std::exception_ptr error;
+    double renderMillis_ = 0.0;
+    double waitMillis_ = 0.0;
+    VulkanContext * context;   // the creating thread's, bound on the render thread
+    std::thread worker;
+
+    void run();
+    void rethrowLocked();
+
+public:
+    explicit RenderThread(std::function<void(FramePacket &)> render, RenderThreadOptions options = RenderThreadOptions());
+    RenderThread(const RenderThread &) = delete;
+    RenderThread & operator=(const RenderThread &) = delete;
+    // Renders whatever was submitted, then joins the thread.
+    ~RenderThread();
+
+    // The packet for the next frame, reset. Blocks while the render thread is still on the
+    // previous use of this packet.
+    FramePacket & beginPacket();
+    // Hands the packet from beginPacket() to the render thread.
+    void submitPacket();
+    // Waits until `render` has returned for every submitted packet.
+    void flush();
+
+    bool isThreaded() const { return threaded; }
+    // Duration of the latest `render` call, and how long the latest beginPacket() blocked.
+    double renderMillis() const;
+    double waitMillis() const;
 };
@@ -1,6 +1,8 @@
 #include "vkinternal.h"
+#include "pipelinecache.h"
 
 #include <algorithm>
+#include <cstring>
 
 namespace {
 
@@ -91,7 +93,27 @@ BlasBuilder& BlasBuilder::fastBuild() {
     return *this;
 }
 
-Blas::Blas(BlasBuilder& builder)
+uint64_t BlasBuilder::contentHash(std::span<const uint8_t> geometryBytes) const {
+    std::vector<uint8_t> key;
+    auto put = [&](uint64_t v) { for (int i = 0; i < 8; ++i) key.push_back(uint8_t(v >> (8 * i))); };
+    put(allowUpdate);
+    put(fastTrace);
+    for (const BlasGeometry& g : geoms) {
+        const auto& tri = g.geom_.geometry.triangles;
+        put(tri.vertexFormat);
+        put(tri.vertexStride);
+        put(tri.maxVertex);
+        put(tri.indexType);
+        put(g.geom_.flags);
+        put(g.primitiveCount_);
+    }
+    put(vkobjects::fnv1a64(geometryBytes.data(), geometryBytes.size()));
+    return vkobjects::fnv1a64(key.data(), key.size());
+}
+
+Blas::Blas(BlasBuilder& builder) : Blas(builder, 0) {}
+
+Blas::Blas(BlasBuilder& builder, VkDeviceSize deserializedSize)
     : geometry_(builder.geoms), updatable_(builder.allowUpdate),
       flags_(buildFlags(builder.fastTrace, builder.allowUpdate)) {
     assert(!geometry_.empty());
@@ -108,25 +130,26 @@ Blas::Blas(BlasBuilder& builder)
 
     VkAccelerationStructureBuildSizesInfoKHR sizes = {};
     sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
-    rtGetAccelerationStructureBuildSizes(g_context().deviceHandle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+    g_context().rtGetAccelerationStructureBuildSizes(g_context().deviceHandle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
                                          &build, counts.data(), &sizes);
-    backing_ = makeBuffer(sizes.accelerationStructureSize, AsBuffer::Storage);
-    scratch_ = makeScratch(std::max<VkDeviceSize>(sizes.buildScratchSize, 4), scratchAddress_);
+    VkDeviceSize asSize = deserializedSize ? deserializedSize : sizes.accelerationStructureSize;
+    backing_ = makeBuffer(asSize, AsBuffer::Storage);
+    if (!deserializedSize) scratch_ = makeScratch(std::max<VkDeviceSize>(sizes.buildScratchSize, 4), scratchAddress_);
     if (updatable_) updateScratch_ = makeScratch(std::max<VkDeviceSize>(sizes.updateScratchSize, 4), updateScratchAddress_);
 
     VkAccelerationStructureCreateInfoKHR create = {};
     create.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
     create.buffer = *backing_;
-    create.size = sizes.accelerationStructureSize;
+    create.size = asSize;
     create.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-    if (rtCreateAccelerationStructure(g_context().deviceHandle(), &create, nullptr, &handle_) != VK_SUCCESS) {
+    if (g_context().rtCreateAccelerationStructure(g_context().deviceHandle(), &create, hostCallbacks(VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR), &handle_) != VK_SUCCESS) {
         throw std::runtime_error("failed to create BLAS");
     }
 
     VkAccelerationStructureDeviceAddressInfoKHR addr = {};
     addr.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
     addr.accelerationStructure = handle_;
-    address_ = rtGetAccelerationStructureDeviceAddress(g_context().deviceHandle(), &addr);
+    address_ = g_context().rtGetAccelerationStructureDeviceAddress(g_context().deviceHandle(), &addr);
 }
 
 Blas::Blas(Blas&& other) noexcept
@@ -164,8 +187,9 @@ void Blas::destroyHandle() {
     if (handle_ == VK_NULL_HANDLE) return;
     VulkanContext& context = g_context();
     if (context.options.enableImmediateDestroy) {
-        rtDestroyAccelerationStructure(context.deviceHandle(), handle_, nullptr);
+        context.rtDestroyAccelerationStructure(context.deviceHandle(), handle_, hostCallbacks(VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR));
     } else {
+        std::lock_guard<std::mutex> lock(context.destroyMutex);
         context.destroyGenerations[context.frameInFlightIndex].accelStructures.push_back(handle_);
     }
     handle_ = VK_NULL_HANDLE;
@@ -174,8 +198,128 @@ void Blas::destroyHandle() {
 VkDeviceAddress Blas::address() const { return address_; }
 Buffer& Blas::backing() { return *backing_; }
 bool Blas::updatable() const { return updatable_; }
+VkDeviceSize Blas::memoryBytes() const {
+    VkDeviceSize bytes = backing_->byteSize();
+    if (scratch_) bytes += scratch_->byteSize();
+    if (updateScratch_) bytes += updateScratch_->byteSize();
+    return bytes;
+}
 Blas::operator VkAccelerationStructureKHR() const { return handle_; }
 
+namespace {
+
+// Header every serialized acceleration structure starts with (Vulkan spec,
+// vkCmdCopyAccelerationStructureToMemoryKHR): driver UUID, compatibility UUID, serialized
+// size, deserialized size, then the count of bottom-level handles that follow (0 for a BLAS).
+constexpr size_t kSerializedSizeOffset = 2 * VK_UUID_SIZE;
+constexpr size_t kDeserializedSizeOffset = kSerializedSizeOffset + 8;
+constexpr size_t kHandleCountOffset = kDeserializedSizeOffset + 8;
+constexpr size_t kSerializedHeaderSize = kHandleCountOffset + 8;
+
+// Serialization copies need 256-byte aligned device addresses.
+constexpr uint32_t kSerializedAlignment = 256;
+
+std::unique_ptr<Buffer> makeSerializationBuffer(size_t bytes, VkDeviceAddress& outAddress, size_t& outOffset) {
+    auto buffer = makeBuffer(bytes + kSerializedAlignment, AsBuffer::Input, true);
+    outAddress = alignUp(buffer->deviceAddress(), kSerializedAlignment);
+    outOffset = size_t(outAddress - buffer->deviceAddress());
+    return buffer;
+}
+
+uint64_t headerField(std::span<const uint8_t> data, size_t offset) {
+    uint64_t v;
+    std::memcpy(&v, data.data() + offset, sizeof(v));
+    return v;
+}
+
+} // namespace
+
+std::vector<uint8_t> Blas::serialize() {
+    if (!built_) throw std::runtime_error("Blas::serialize before buildBlas");
+    VkDevice device = g_context().deviceHandle();
+
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR;
+    poolInfo.queryCount = 1;
+    VkQueryPool pool = VK_NULL_HANDLE;
+    if (vkCreateQueryPool(device, &poolInfo, hostCallbacks(VK_OBJECT_TYPE_QUERY_POOL), &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create AS serialization size query pool");
+    }
+    uint64_t size = 0;
+    {
+        auto cmd = Commands::oneShot();
+        cmd.bufferBarrier(*backing_, Stage::AccelStructureBuild, Access::AccelStructureWrite,
+                          Stage::AccelStructureBuild, Access::AccelStructureRead);
+        vkCmdResetQueryPool(cmd, pool, 0, 1);
+        g_context().rtCmdWriteAccelerationStructuresProperties(cmd, 1, &handle_,
+            VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR, pool, 0);
+        cmd.submitAndWait();
+    }
+    VkResult result = vkGetQueryPoolResults(device, pool, 0, 1, sizeof(size), &size, sizeof(size),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    vkDestroyQueryPool(device, pool, hostCallbacks(VK_OBJECT_TYPE_QUERY_POOL));
+    if (result != VK_SUCCESS || size < kSerializedHeaderSize) {
+        throw std::runtime_error("failed to query BLAS serialization size");
+    }
+
+    VkDeviceAddress stagingAddress = 0;
+    size_t stagingOffset = 0;
+    auto staging = makeSerializationBuffer(size_t(size), stagingAddress, stagingOffset);
+    {
+        auto cmd = Commands::oneShot();
+        cmd.bufferBarrier(*backing_, Stage::AccelStructureBuild, Access::AccelStructureWrite,
+                          Stage::AccelStructureBuild, Access::AccelStructureRead);
+        VkCopyAccelerationStructureToMemoryInfoKHR copy = {};
+        copy.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR;
+        copy.src = handle_;
+        copy.dst.deviceAddress = stagingAddress;
+        copy.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR;
+        g_context().rtCmdCopyAccelerationStructureToMemory(cmd, &copy);
+        cmd.bufferBarrier(*staging, Stage::AccelStructureBuild, Access::TransferWrite, Stage::Host, Access::HostRead);
+        cmd.submitAndWait();
+    }
+    std::vector<uint8_t> data(stagingOffset + size_t(size));
+    staging->download(data.data(), data.size());
+    data.erase(data.begin(), data.begin() + stagingOffset);
+    return data;
+}
+
+bool Blas::compatible(std::span<const uint8_t> data) {
+    if (data.size() < kSerializedHeaderSize) return false;
+    VkAccelerationStructureVersionInfoKHR version = {};
+    version.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_VERSION_INFO_KHR;
+    version.pVersionData = data.data();
+    VkAccelerationStructureCompatibilityKHR compatibility = VK_ACCELERATION_STRUCTURE_COMPATIBILITY_INCOMPATIBLE_KHR;
+    g_context().rtGetDeviceAccelerationStructureCompatibility(g_context().deviceHandle(), &version, &compatibility);
+    return compatibility == VK_ACCELERATION_STRUCTURE_COMPATIBILITY_COMPATIBLE_KHR;
+}
+
+std::optional<Blas> Blas::deserialize(BlasBuilder& builder, std::span<const uint8_t> data) {
+    if (data.size() < kSerializedHeaderSize) return std::nullopt;
+    if (headerField(data, kSerializedSizeOffset) != data.size()) return std::nullopt;
+    if (headerField(data, kHandleCountOffset) != 0) return std::nullopt;   // not a BLAS
+    uint64_t deserializedSize = headerField(data, kDeserializedSizeOffset);
+    if (deserializedSize == 0 || !compatible(data)) return std::nullopt;
+
+    Blas blas(builder, VkDeviceSize(deserializedSize));
+    VkDeviceAddress stagingAddress = 0;
+    size_t stagingOffset = 0;
+    auto staging = makeSerializationBuffer(data.size(), stagingAddress, stagingOffset);
+    staging->upload(const_cast<uint8_t*>(data.data()), data.size(), stagingOffset);
+
+    auto cmd = Commands::oneShot();
+    VkCopyMemoryToAccelerationStructureInfoKHR copy = {};
+    copy.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_ACCELERATION_STRUCTURE_INFO_KHR;
+    copy.src.deviceAddress = stagingAddress;
+    copy.dst = blas.handle_;
+    copy.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_DESERIALIZE_KHR;
+    g_context().rtCmdCopyMemoryToAccelerationStructure(cmd, &copy);
+    cmd.submitAndWait();
+    blas.built_ = true;
+    return blas;
+}
+
 TlasInstances& TlasInstances::add(const Blas& blas, uint32_t customIndex, uint8_t mask) {
     const float identity[12] = {
         1.0f, 0.0f, 0.0f, 0.0f,
@@ -222,7 +366,7 @@ Tlas::Tlas(uint32_t maxInstances) : maxInstances_(maxInstances) {
 
     VkAccelerationStructureBuildSizesInfoKHR sizes = {};
     sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
-    rtGetAccelerationStructureBuildSizes(g_context().deviceHandle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+    g_context().rtGetAccelerationStructureBuildSizes(g_context().deviceHandle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
                                          &build, &maxInstances, &sizes);
     backing_ = makeBuffer(sizes.accelerationStructureSize, AsBuffer::Storage);
     scratch_ = makeScratch(std::max<VkDeviceSize>(sizes.buildScratchSize, 4), scratchAddress_);
@@ -232,7 +376,7 @@ Tlas::Tlas(uint32_t maxInstances) : maxInstances_(maxInstances) {
     create.buffer = *backing_;
     create.size = sizes.accelerationStructureSize;
     create.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-    if (rtCreateAccelerationStructure(g_context().deviceHandle(), &create, nullptr, &handle_) != VK_SUCCESS) {
+    if (g_context().rtCreateAccelerationStructure(g_context().deviceHandle(), &create, hostCallbacks(VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR), &handle_) != VK_SUCCESS) {
         throw std::runtime_error("failed to create TLAS");
     }
     rid_ = g_context().bindlessTable.registerTlas(g_context().deviceHandle(), handle_);
@@ -268,8 +412,9 @@ void Tlas::destroyHandle() {
     VulkanContext& context = g_context();
     if (context.options.enableImmediateDestroy) {
         if (rid_ != kNullRid) context.bindlessTable.releaseTlas(rid_);
-        rtDestroyAccelerationStructure(context.deviceHandle(), handle_, nullptr);
+        context.rtDestroyAccelerationStructure(context.deviceHandle(), handle_, hostCallbacks(VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR));
     } else {
+        std::lock_guard<std::mutex> lock(context.destroyMutex);
         auto& gen = context.destroyGenerations[context.frameInFlightIndex];
         if (rid_ != kNullRid) gen.tlasRIDs.push_back(rid_);
         gen.accelStructures.push_back(handle_);
@@ -288,17 +433,19 @@ void Commands::buildBlas(Blas& blas, bool refit) {
     if (refit) {
         assert(blas.updatable_ && blas.built_);
         if (!blas.updatable_ || !blas.built_) throw std::runtime_error("invalid BLAS refit before build");
+    } else if (!blas.scratch_) {
+        throw std::runtime_error("a deserialized BLAS can be refit but not rebuilt");
     }
-    std::vector<VkAccelerationStructureGeometryKHR> geoms;
-    std::vector<VkAccelerationStructureBuildRangeInfoKHR> ranges;
-    for (const BlasGeometry& g : blas.geometry_) {
-        geoms.push_back(g.geom_);
-        VkAccelerationStructureBuildRangeInfoKHR range = {};
-        range.primitiveCount = g.primitiveCount_;
-        ranges.push_back(range);
+    const size_t count = blas.geometry_.size();
+    auto* geoms = scratch<VkAccelerationStructureGeometryKHR>(count);
+    auto* ranges = scratch<VkAccelerationStructureBuildRangeInfoKHR>(count);
+    for (size_t i = 0; i < count; ++i) {
+        geoms[i] = blas.geometry_[i].geom_;
+        ranges[i] = {};
+        ranges[i].primitiveCount = blas.geometry_[i].primitiveCount_;
     }
-    std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> rangePtrs(ranges.size());
-    for (size_t i = 0; i < ranges.size(); ++i) rangePtrs[i] = &ranges[i];
+    // One build, so ppBuildRangeInfos has one entry: its geometryCount contiguous ranges.
+    const VkAccelerationStructureBuildRangeInfoKHR* rangePtr = ranges;
 
     VkAccelerationStructureBuildGeometryInfoKHR build = {};
     build.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
@@ -308,10 +455,10 @@ void Commands::buildBlas(Blas& blas, bool refit) {
                        : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
     build.srcAccelerationStructure = refit ? blas.handle_ : VK_NULL_HANDLE;
     build.dstAccelerationStructure = blas.handle_;
-    build.geometryCount = static_cast<uint32_t>(geoms.size());
-    build.pGeometries = geoms.data();
+    build.geometryCount = static_cast<uint32_t>(count);
+    build.pGeometries = geoms;
     build.scratchData.deviceAddress = refit ? blas.updateScratchAddress_ : blas.scratchAddress_;
-    rtCmdBuildAccelerationStructures(*this, 1, &build, rangePtrs.data());
+    context->rtCmdBuildAccelerationStructures(*this, 1, &build, &rangePtr);
     if (!refit) blas.built_ = true;
 }
 
@@ -342,5 +489,5 @@ void Commands::buildTlas(Tlas& tlas, const TlasInstances& instances) {
     VkAccelerationStructureBuildRangeInfoKHR range = {};
     range.primitiveCount = static_cast<uint32_t>(instances.raw.size());
     const VkAccelerationStructureBuildRangeInfoKHR* rangePtr = &range;
-    rtCmdBuildAccelerationStructures(*this, 1, &build, &rangePtr);
+    context->rtCmdBuildAccelerationStructures(*this, 1, &build, &rangePtr);
 }
@@ -0,0 +1,259 @@
+#include "vkinternal.h"
+#include "pipelinecache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// --- AssetArchive ---
+//
+// File layout (little-endian):
+//   0   header: magic, version, entry count, names size (u32 each), file size, FNV-1a of
+//       the TOC and names (u64 each)
+//   32  TOC: entry count x { name hash u64, blob offset u64, blob size u64,
+//       name offset u32, name length u32 }, sorted by (hash, name)
+//   ..  names, concatenated without terminators
+//   ..  blobs, each at a 64-byte aligned offset
+// Open validates the header, TOC and names, so every span handed out is in bounds. Blob bytes
+// are not hashed: that would touch every page of the mapping and undo the point of mmap.
+
+namespace {
+
+constexpr uint32_t kArchiveMagic = 0x52414B56u;   // 'VKAR'
+constexpr uint32_t kArchiveVersion = 1u;
+constexpr size_t kHeaderSize = 32;
+constexpr size_t kEntrySize = 32;
+constexpr size_t kBlobAlignment = 64;
+
+uint64_t nameHash(std::string_view name) {
+    return vkobjects::fnv1a64(reinterpret_cast<const uint8_t *>(name.data()), name.size());
+}
+
+// Read-only mapping of a whole file; nullptr when the file is missing or empty.
+const uint8_t * mapFile(const std::string & path, size_t & size) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) { CloseHandle(file); return nullptr; }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) return nullptr;
+    void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);   // the view keeps the mapping alive
+    if (!view) return nullptr;
+    size = size_t(length.QuadPart);
+    return static_cast<const uint8_t *>(view);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); return nullptr; }
+    void * view = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);   // the mapping keeps the file alive
+    if (view == MAP_FAILED) return nullptr;
+    size = size_t(st.st_size);
+    return static_cast<const uint8_t *>(view);
+#endif
+}
+
+void unmapFile(const uint8_t * base, size_t size) {
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(base);
+#else
+    ::munmap(const_cast<uint8_t *>(base), size);
+#endif
+}
+
+} // namespace
+
+AssetArchive::AssetArchive(const std::string & path) : path_(path) {
+    base = mapFile(path, mappedSize);
+    if (!base) throw std::runtime_error("failed to map asset archive " + path);
+
+    auto fail = [&](const char * why) {
+        unmap();
+        throw std::runtime_error("malformed asset archive " + path + ": " + why);
+    };
+    if (mappedSize < kHeaderSize) fail("truncated header");
+    if (vkobjects::get32(base) != kArchiveMagic) fail("bad magic");
+    if (vkobjects::get32(base + 4) != kArchiveVersion) fail("unsupported version");
+    uint64_t count = vkobjects::get32(base + 8);
+    uint64_t namesSize = vkobjects::get32(base + 12);
+    if (vkobjects::get64(base + 16) != mappedSize) fail("file size does not match header");
+
+    // Both terms are bounded by 32-bit counts, so the sum cannot overflow.
+    uint64_t namesOffset = kHeaderSize + count * kEntrySize;
+    uint64_t namesEnd = namesOffset + namesSize;
+    if (namesEnd > mappedSize) fail("table of contents past end of file");
+    if (namesEnd > UINT32_MAX) fail("table of contents too large");
+    if (vkobjects::fnv1a64(base + kHeaderSize, size_t(namesEnd - kHeaderSize)) != vkobjects::get64(base + 24)) {
+        fail("table of contents checksum mismatch");
+    }
+
+    entries.resize(size_t(count));
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const uint8_t * p = base + kHeaderSize + i * kEntrySize;
+        Entry & e = entries[i];
+        e = { vkobjects::get64(p), vkobjects::get64(p + 8), vkobjects::get64(p + 16),
+              vkobjects::get32(p + 24), vkobjects::get32(p + 28) };
+        if (uint64_t(e.nameOffset) + e.nameLength > namesSize) fail("entry name out of range");
+        e.nameOffset += uint32_t(namesOffset);
+        if (e.offset % kBlobAlignment != 0 || e.offset < namesEnd) fail("misplaced blob");
+        if (e.offset > mappedSize || e.size > mappedSize - e.offset) fail("blob past end of file");
+        if (nameHash(entryName(e)) != e.hash) fail("entry hash mismatch");
+        if (i > 0) {
+            const Entry & prev = entries[i - 1];
+            if (prev.hash > e.hash || (prev.hash == e.hash && entryName(prev) >= entryName(e))) {
+                fail("table of contents not sorted");
+            }
+        }
+    }
+}
+
+AssetArchive::AssetArchive(AssetArchive && other) noexcept
+    : base(std::exchange(other.base, nullptr)), mappedSize(std::exchange(other.mappedSize, 0)),
+      entries(std::move(other.entries)), path_(std::move(other.path_)) {}
+
+AssetArchive & AssetArchive::operator=(AssetArchive && other) noexcept {
+    if (this != &other) {
+        unmap();
+        base = std::exchange(other.base, nullptr);
+        mappedSize = std::exchange(other.mappedSize, 0);
+        entries = std::move(other.entries);
+        path_ = std::move(other.path_);
+    }
+    return *this;
+}
+
+AssetArchive::~AssetArchive() { unmap(); }
+
+void AssetArchive::unmap() {
+    if (base) unmapFile(base, mappedSize);
+    base = nullptr;
+    mappedSize = 0;
+    entries.clear();
+}
+
+std::string_view AssetArchive::entryName(const Entry & e) const {
+    return std::string_view(reinterpret_cast<const char *>(base) + e.nameOffset, e.nameLength);
+}
+
+std::span<const uint8_t> AssetArchive::find(std::string_view name) const {
+    uint64_t hash = nameHash(name);
+    auto it = std::lower_bound(entries.begin(), entries.end(), hash,
+                               [](const Entry & e, uint64_t h) { return e.hash < h; });
+    for (; it != entries.end() && it->hash == hash; ++it) {
+        if (entryName(*it) == name) return std::span<const uint8_t>(base + it->offset, size_t(it->size));
+    }
+    return {};
+}
+
+std::span<const uint8_t> AssetArchive::get(std::string_view name) const {
+    std::span<const uint8_t> blob = find(name);
+    // A present but empty blob still points into the mapping; only a miss has no data.
+    if (!blob.data()) throw std::runtime_error("asset archive " + path_ + " has no entry " + std::string(name));
+    return blob;
+}
+
+bool AssetArchive::contains(std::string_view name) const {
+    return find(name).data() != nullptr;
+}
+
+Buffer AssetArchive::stagingBuffer(std::string_view name) const {
+    std::span<const uint8_t> blob = get(name);
+    BufferBuilder builder(blob.empty() ? 1 : blob.size());
+    builder.transferSource().persistentlyMapped();
+    Buffer buffer(builder);
+    if (!blob.empty()) std::memcpy(buffer.mappedData(), blob.data(), blob.size());
+    buffer.flush();
+    return buffer;
+}
+
+std::vector<uint8_t> AssetArchive::build(const std::vector<std::pair<std::string, std::vector<uint8_t>>> & files) {
+    struct Pending { uint64_t hash; size_t index; };
+    std::vector<Pending> order;
+    order.reserve(files.size());
+    for (size_t i = 0; i < files.size(); ++i) order.push_back({ nameHash(files[i].first), i });
+    std::sort(order.begin(), order.end(), [&](const Pending & a, const Pending & b) {
+        if (a.hash != b.hash) return a.hash < b.hash;
+        return files[a.index].first < files[b.index].first;
+    });
+    for (size_t i = 1; i < order.size(); ++i) {
+        if (files[order[i].index].first == files[order[i - 1].index].first) {
+            throw std::runtime_error("duplicate asset archive entry " + files[order[i].index].first);
+        }
+    }
+    if (files.size() > UINT32_MAX) throw std::runtime_error("too many asset archive entries");
+
+    size_t namesOffset = kHeaderSize + files.size() * kEntrySize;
+    size_t namesSize = 0;
+    for (auto & f : files) namesSize += f.first.size();
+    if (namesSize > UINT32_MAX) throw std::runtime_error("asset archive names too long");
+    size_t namesEnd = namesOffset + namesSize;
+
+    size_t fileSize = vkobjects::alignUp(namesEnd, kBlobAlignment);
+    std::vector<size_t> blobOffsets(files.size());
+    for (const Pending & p : order) {   // blobs in TOC order, so neighbours in hash order are adjacent
+        blobOffsets[p.index] = fileSize;
+        fileSize = vkobjects::alignUp(fileSize + files[p.index].second.size(), kBlobAlignment);
+    }
+
+    std::vector<uint8_t> out(fileSize, 0);
+    vkobjects::put32(out.data(), kArchiveMagic);
+    vkobjects::put32(out.data() + 4, kArchiveVersion);
+    vkobjects::put32(out.data() + 8, uint32_t(files.size()));
+    vkobjects::put32(out.data() + 12, uint32_t(namesSize));
+    vkobjects::put64(out.data() + 16, fileSize);
+
+    size_t nameCursor = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        const auto & [name, bytes] = files[order[i].index];
+        uint8_t * p = out.data() + kHeaderSize + i * kEntrySize;
+        vkobjects::put64(p, order[i].hash);
+        vkobjects::put64(p + 8, blobOffsets[order[i].index]);
+        vkobjects::put64(p + 16, bytes.size());
+        vkobjects::put32(p + 24, uint32_t(nameCursor));
+        vkobjects::put32(p + 28, uint32_t(name.size()));
+        std::memcpy(out.data() + namesOffset + nameCursor, name.data(), name.size());
+        nameCursor += name.size();
+        if (!bytes.empty()) std::memcpy(out.data() + blobOffsets[order[i].index], bytes.data(), bytes.size());
+    }
+    vkobjects::put64(out.data() + 24, vkobjects::fnv1a64(out.data() + kHeaderSize, namesEnd - kHeaderSize));
+    return out;
+}
+
+size_t AssetArchive::pack(const std::string & directory, const std::string & archivePath) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path root(directory);
+    if (!fs::is_directory(root, ec)) throw std::runtime_error("not a directory: " + directory);
+    fs::path output = fs::weakly_canonical(fs::path(archivePath), ec);
+
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> files;
+    for (auto it = fs::recursive_directory_iterator(root); it != fs::recursive_directory_iterator(); ++it) {
+        if (!it->is_regular_file()) continue;
+        if (fs::weakly_canonical(it->path(), ec) == output) continue;   // packing into the source dir
+        std::string name = it->path().lexically_relative(root).generic_string();
+        std::ifstream file(it->path(), std::ios::binary);
+        if (!file) throw std::runtime_error("failed to open " + it->path().string());
+        files.emplace_back(std::move(name), std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                                                 std::istreambuf_iterator<char>()));
+    }
+
+    if (!vkobjects::atomicWrite(archivePath, build(files), false)) {
+        throw std::runtime_error("failed to write asset archive " + archivePath);
+    }
+    return files.size();
+}
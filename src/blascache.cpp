@@ -0,0 +1,112 @@
+#include "vkinternal.h"
+#include "pipelinecache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+// --- BlasCache ---
+//
+// File layout: a 32-byte little-endian prefix (magic, version, device tag, blob size, FNV-1a of
+// the blob) followed by the Blas::serialize() bytes. The device tag is also in the file name,
+// so two GPUs sharing a cache directory keep separate entries instead of overwriting each
+// other's; Blas::compatible() still has the final say on load.
+
+namespace {
+
+constexpr uint32_t kBlasCacheMagic = 0x53414B56u;   // 'VKAS'
+constexpr uint32_t kBlasCacheVersion = 2u;
+constexpr size_t kBlasPrefixSize = 32;
+
+// The serialized blob inside a cache file, or an empty span when the prefix does not check out
+// or names another device.
+std::span<const uint8_t> cachedBlob(const std::vector<uint8_t> & file, uint64_t deviceTag) {
+    if (file.size() <= kBlasPrefixSize) return {};
+    const uint8_t * p = file.data();
+    if (vkobjects::get32(p) != kBlasCacheMagic || vkobjects::get32(p + 4) != kBlasCacheVersion) return {};
+    if (vkobjects::get64(p + 8) != deviceTag) return {};
+    uint64_t size = vkobjects::get64(p + 16);
+    if (file.size() - kBlasPrefixSize != size) return {};
+    std::span<const uint8_t> blob(p + kBlasPrefixSize, size_t(size));
+    if (vkobjects::fnv1a64(blob.data(), blob.size()) != vkobjects::get64(p + 24)) return {};
+    return blob;
+}
+
+// FNV-1a of the driver and device UUIDs. Serialized acceleration structures carry the driver
+// UUID and a compatibility UUID the API only exposes inside serialized data; the device UUID
+// stands in for the latter, so any GPU or driver change picks a different tag.
+uint64_t deviceTagOf(VkPhysicalDevice physicalDevice) {
+    VkPhysicalDeviceIDProperties id = {};
+    id.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &id;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+    uint8_t uuids[2 * VK_UUID_SIZE];
+    std::memcpy(uuids, id.driverUUID, VK_UUID_SIZE);
+    std::memcpy(uuids + VK_UUID_SIZE, id.deviceUUID, VK_UUID_SIZE);
+    return vkobjects::fnv1a64(uuids, sizeof(uuids));
+}
+
+} // namespace
+
+BlasCache::BlasCache(std::string dir, bool verbose) : dir_(std::move(dir)), verbose_(verbose) {
+    if (!dir_.empty()) deviceTag_ = deviceTagOf(g_context().physicalDeviceHandle());
+}
+
+std::string BlasCache::path(uint64_t key) const {
+    if (dir_.empty()) return {};
+    char name[64];
+    std::snprintf(name, sizeof(name), "blas_%016llx_%016llx.bin",
+                  (unsigned long long)deviceTag_, (unsigned long long)key);
+    return (std::filesystem::path(dir_) / name).string();
+}
+
+std::optional<Blas> BlasCache::load(BlasBuilder & builder, uint64_t key) {
+    if (dir_.empty()) return std::nullopt;
+    std::string file = path(key);
+    std::vector<uint8_t> bytes = vkobjects::readFile(file);
+    if (bytes.empty()) {
+        if (verbose_) std::cerr << "[blascache] no entry at " << file << "\n";
+        return std::nullopt;
+    }
+    std::span<const uint8_t> blob = cachedBlob(bytes, deviceTag_);
+    std::optional<Blas> blas;
+    if (!blob.empty()) blas = Blas::deserialize(builder, blob);
+    if (!blas && verbose_) std::cerr << "[blascache] discarding corrupt/incompatible " << file << "\n";
+    if (blas && verbose_) std::cerr << "[blascache] loaded " << file << " (" << blob.size() << " B)\n";
+    return blas;
+}
+
+void BlasCache::store(Blas & blas, uint64_t key) {
+    if (dir_.empty()) return;
+    try {
+        std::vector<uint8_t> blob = blas.serialize();
+        std::vector<uint8_t> file(kBlasPrefixSize + blob.size());
+        vkobjects::put32(file.data(), kBlasCacheMagic);
+        vkobjects::put32(file.data() + 4, kBlasCacheVersion);
+        vkobjects::put64(file.data() + 8, deviceTag_);
+        vkobjects::put64(file.data() + 16, blob.size());
+        vkobjects::put64(file.data() + 24, vkobjects::fnv1a64(blob.data(), blob.size()));
+        std::memcpy(file.data() + kBlasPrefixSize, blob.data(), blob.size());
+        bool written = vkobjects::atomicWrite(path(key), file, verbose_);
+        if (verbose_) std::cerr << "[blascache] " << (written ? "wrote " : "write failed: ") << path(key) << "\n";
+    } catch (const std::exception & e) {
+        if (verbose_) std::cerr << "[blascache] store error (" << e.what() << ")\n";
+    }
+}
+
+Blas BlasCache::getOrBuild(BlasBuilder & builder, uint64_t key) {
+    if (std::optional<Blas> cached = load(builder, key)) {
+        ++hits_;
+        return std::move(*cached);
+    }
+    ++misses_;
+    Blas blas(builder);
+    auto cmd = Commands::oneShot();
+    cmd.buildBlas(blas, false);
+    cmd.submitAndWait();
+    store(blas, key);
+    return blas;
+}
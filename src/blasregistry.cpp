@@ -0,0 +1,32 @@
+#include "vkinternal.h"
+
+// --- BlasRegistry ---
+
+std::shared_ptr<Blas> BlasRegistry::acquire(Commands & cmd, BlasBuilder & builder, uint64_t key) {
+    ++stats_.requests;
+    std::weak_ptr<Blas> & entry = entries_[key];
+    if (std::shared_ptr<Blas> shared = entry.lock()) {
+        stats_.bytesSaved += shared->memoryBytes();
+        return shared;
+    }
+    auto blas = std::make_shared<Blas>(builder);
+    cmd.buildBlas(*blas, false);
+    pending_.push_back(blas->backing());
+    ++stats_.builds;
+    stats_.bytesAllocated += blas->memoryBytes();
+    entry = blas;
+    return blas;
+}
+
+std::shared_ptr<Blas> BlasRegistry::acquire(Commands & cmd, BlasBuilder & builder, std::span<const uint8_t> geometryBytes) {
+    return acquire(cmd, builder, builder.contentHash(geometryBytes));
+}
+
+std::vector<VkBuffer> BlasRegistry::pendingBackings() {
+    return std::exchange(pending_, {});
+}
+
+size_t BlasRegistry::liveCount() {
+    std::erase_if(entries_, [](const auto & entry) { return entry.second.expired(); });
+    return entries_.size();
+}
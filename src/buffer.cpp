@@ -1,5 +1,7 @@
 #include "vkinternal.h"
 
+#include <algorithm>
+
 // --- Buffer ---
 
 static BufferWriteHook g_bufferWriteHook;
@@ -8,8 +10,10 @@ void setBufferWriteHook(BufferWriteHook hook) { g_bufferWriteHook = std::move(ho
 BufferBuilder::BufferBuilder(size_t byteCount) : usage(0), properties(0), byteCount(byteCount) {}
 BufferBuilder & BufferBuilder::index() { usage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT; return *this; }
 BufferBuilder & BufferBuilder::uniform() {
-    // In bindless model, uniform buffers are storage buffers with host visibility
+    // Registered at binding 0 like every buffer, and at binding 4 when uniform buffers are enabled
+    usage |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
     properties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    isUniform = true;
     return *this;
 }
 BufferBuilder & BufferBuilder::storage() { usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT; return *this; }
@@ -24,6 +28,11 @@ BufferBuilder & BufferBuilder::readback() {
     isReadback = true;
     return *this;
 }
+BufferBuilder & BufferBuilder::persistentlyMapped() {
+    properties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    isPersistentlyMapped = true;
+    return *this;
+}
 BufferBuilder & BufferBuilder::size(size_t byteCount) { this->byteCount = byteCount; return *this; }
 BufferBuilder & BufferBuilder::deviceAddress() {
     usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
@@ -40,7 +49,7 @@ BufferBuilder & BufferBuilder::accelerationStructureStorage() {
     return *this;
 }
 
-Buffer::Buffer(BufferBuilder & builder) : buffer(VK_NULL_HANDLE), allocation(VK_NULL_HANDLE), size(builder.byteCount), rid_(UINT32_MAX) {
+Buffer::Buffer(BufferBuilder & builder) : context(&g_context()), buffer(VK_NULL_HANDLE), allocation(VK_NULL_HANDLE), size(builder.byteCount), rid_(UINT32_MAX) {
     // All buffers get STORAGE_BUFFER_BIT for bindless registration
     VkBufferUsageFlags usage = builder.usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
 
@@ -68,7 +77,7 @@ Buffer::Buffer(BufferBuilder & builder) : buffer(VK_NULL_HANDLE), allocation(VK_
         // on NVIDIA where BAR memory types are also DEVICE_LOCAL).
         allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
         VkPhysicalDeviceMemoryProperties memProps;
-        vkGetPhysicalDeviceMemoryProperties(g_context().physicalDevice, &memProps);
+        vkGetPhysicalDeviceMemoryProperties(context->physicalDevice, &memProps);
         uint32_t typeBits = 0;
         for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
             uint32_t heapIdx = memProps.memoryTypes[i].heapIndex;
@@ -79,13 +88,27 @@ Buffer::Buffer(BufferBuilder & builder) : buffer(VK_NULL_HANDLE), allocation(VK_
             allocInfo.memoryTypeBits = typeBits;
     }
 
-    if (vmaCreateBuffer(g_allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr) != VK_SUCCESS) {
+    if (builder.isPersistentlyMapped) {
+        allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    }
+
+    VmaAllocationInfo allocationInfo = {};
+    if (vmaCreateBuffer(context->allocator, &bufferInfo, &allocInfo, &buffer, &allocation, &allocationInfo) != VK_SUCCESS) {
         throw std::runtime_error("failed to create buffer");
     }
+    if (builder.isPersistentlyMapped) {
+        mapped_ = allocationInfo.pMappedData;
+    }
 
-    rid_ = g_context().bindlessTable.registerStorageBuffer(g_context().device, buffer, builder.byteCount);
+    rid_ = context->bindlessTable.registerStorageBuffer(context->device, buffer, builder.byteCount);
+    if (builder.isUniform && context->uniformBuffersEnabled()) {
+        VkDeviceSize range = std::min<VkDeviceSize>(builder.byteCount, context->limits.maxUniformBufferRange);
+        uniformRid_ = context->bindlessTable.registerUniformBuffer(context->device, buffer, range);
+    }
 }
-Buffer::Buffer(Buffer && other) : buffer(other.buffer), allocation(other.allocation), size(other.size), rid_(other.rid_) {
+Buffer::Buffer(Buffer && other) : context(other.context), buffer(other.buffer), allocation(other.allocation), size(other.size), rid_(other.rid_), uniformRid_(other.uniformRid_), mapped_(other.mapped_) {
+    other.uniformRid_ = kNullRid;
+    other.mapped_ = nullptr;
     other.buffer = VK_NULL_HANDLE;
     other.allocation = VK_NULL_HANDLE;
     other.size = 0;
@@ -96,52 +119,75 @@ size_t Buffer::byteSize() const { return size; }
 void Buffer::upload(void * bytes, size_t size) {
     if (size > this->size) throw std::runtime_error("buffer size mismatch");
     void* mapped;
-    vmaMapMemory(g_allocator, allocation, &mapped);
+    vmaMapMemory(context->allocator, allocation, &mapped);
     memcpy(mapped, bytes, size);
-    vmaUnmapMemory(g_allocator, allocation);
+    vmaUnmapMemory(context->allocator, allocation);
     if (g_bufferWriteHook) g_bufferWriteHook(rid_);
 }
 void Buffer::upload(void * bytes, size_t size, VkDeviceSize offset) {
     if (size > this->size) throw std::runtime_error("buffer size mismatch");
     void* mapped;
-    vmaMapMemory(g_allocator, allocation, &mapped);
+    vmaMapMemory(context->allocator, allocation, &mapped);
     memcpy(static_cast<char*>(mapped) + offset, bytes, size);
-    vmaUnmapMemory(g_allocator, allocation);
+    vmaUnmapMemory(context->allocator, allocation);
     if (g_bufferWriteHook) g_bufferWriteHook(rid_);
 }
+void Buffer::flush(VkDeviceSize offset, VkDeviceSize size) {
+    vmaFlushAllocation(context->allocator, allocation, offset, size);
+}
+void Buffer::invalidate(VkDeviceSize offset, VkDeviceSize size) {
+    vmaInvalidateAllocation(context->allocator, allocation, offset, size);
+}
 void Buffer::download(void * bytes, size_t size) {
     if (size > this->size) throw std::runtime_error("buffer size mismatch");
     void* mapped;
-    vmaMapMemory(g_allocator, allocation, &mapped);
+    vmaMapMemory(context->allocator, allocation, &mapped);
     memcpy(bytes, mapped, size);
-    vmaUnmapMemory(g_allocator, allocation);
+    vmaUnmapMemory(context->allocator, allocation);
 }
 Buffer::~Buffer() {
     if (buffer == VK_NULL_HANDLE) return;
-    VulkanContext & context = g_context();
-    if (context.options.enableImmediateDestroy) {
+    if (context->options.enableImmediateDestroy) {
         if (rid_ != UINT32_MAX)
-            context.bindlessTable.releaseStorageBuffer(rid_);
-        vmaDestroyBuffer(g_allocator, buffer, allocation);
+            context->bindlessTable.releaseStorageBuffer(rid_);
+        if (uniformRid_ != kNullRid)
+            context->bindlessTable.releaseUniformBuffer(uniformRid_);
+        vmaDestroyBuffer(context->allocator, buffer, allocation);
         return;
     }
-    auto & gen = context.destroyGenerations[context.frameInFlightIndex];
-    if (rid_ != UINT32_MAX) {
-        gen.storageBufferRIDs.push_back(rid_);
+    retire();
+}
+void Buffer::retire() {
+    if (buffer == VK_NULL_HANDLE) return;
+    {
+        std::lock_guard<std::mutex> lock(context->destroyMutex);
+        auto & gen = context->destroyGenerations[context->frameInFlightIndex];
+        if (rid_ != UINT32_MAX) {
+            gen.storageBufferRIDs.push_back(rid_);
+        }
+        if (uniformRid_ != kNullRid) {
+            gen.uniformBufferRIDs.push_back(uniformRid_);
+        }
+        gen.bufferAllocations.push_back({buffer, allocation});
     }
-    gen.bufferAllocations.push_back({buffer, allocation});
+    buffer = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
+    size = 0;
+    rid_ = UINT32_MAX;
+    uniformRid_ = kNullRid;
+    mapped_ = nullptr;
 }
 Buffer::operator VkBuffer() const { return buffer; }Buffer::operator VkBuffer*() const { return (VkBuffer*)&buffer; }
 bool Buffer::isHostVisible() const {
     // Query the ACTUAL allocated memory type (VMA AUTO may differ from the requested properties),
     // so tests can structurally assert a buffer landed in device-local (non-host-mapped) memory.
     VkMemoryPropertyFlags flags = 0;
-    vmaGetAllocationMemoryProperties(g_allocator, allocation, &flags);
+    vmaGetAllocationMemoryProperties(context->allocator, allocation, &flags);
     return (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
 }
 VkDeviceAddress Buffer::deviceAddress() const {
     VkBufferDeviceAddressInfo info = {};
     info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
     info.buffer = buffer;
-    return vkGetBufferDeviceAddress(g_context().device, &info);
+    return vkGetBufferDeviceAddress(context->device, &info);
 }
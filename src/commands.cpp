@@ -6,18 +6,25 @@
 
 // --- Commands ---
 
-static thread_local VkFence submitAndWaitFence = VK_NULL_HANDLE;
-static thread_local VkDevice submitAndWaitFenceDevice = VK_NULL_HANDLE;
+// submitAndWait's fence, per thread and per device: a thread may submit to several contexts.
+struct SubmitFence {
+    VkDevice device;
+    VkFence fence;
+};
+static thread_local std::vector<SubmitFence> submitAndWaitFences;
 
 void destroyThreadLocalSubmitFence(VkDevice device) {
-    if (submitAndWaitFence != VK_NULL_HANDLE && submitAndWaitFenceDevice == device) {
-        vkDestroyFence(device, submitAndWaitFence, nullptr);
-        submitAndWaitFence = VK_NULL_HANDLE;
-        submitAndWaitFenceDevice = VK_NULL_HANDLE;
+    for (auto it = submitAndWaitFences.begin(); it != submitAndWaitFences.end(); ++it) {
+        if (it->device == device) {
+            vkDestroyFence(device, it->fence, hostCallbacks(VK_OBJECT_TYPE_FENCE));
+            submitAndWaitFences.erase(it);
+            return;
+        }
     }
 }
 
-Commands::Commands(VkCommandBuffer cmd, bool owns) : commandBuffer(cmd), ended(false), ownsBuffer(owns), frame(nullptr) {
+Commands::Commands(VulkanContext & context, VkCommandBuffer cmd, bool owns)
+    : context(&context), commandBuffer(cmd), ended(false), ownsBuffer(owns), frame(nullptr) {
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
@@ -26,14 +33,15 @@ Commands::Commands(VkCommandBuffer cmd, bool owns) : commandBuffer(cmd), ended(f
     }
 
     // Bind the global bindless descriptor set
-    VkDescriptorSet bindlessSet = g_context().bindlessTable.set;
-    VkPipelineLayout layout = g_context().bindlessTable.pipelineLayout;
+    VkDescriptorSet bindlessSet = context->bindlessTable.set;
+    VkPipelineLayout layout = context->bindlessTable.pipelineLayout;
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &bindlessSet, 0, nullptr);
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &bindlessSet, 0, nullptr);
 }
 
 Commands::Commands(Commands && other)
-    : commandBuffer(other.commandBuffer), ended(other.ended), ownsBuffer(other.ownsBuffer), frame(other.frame) {
+    : context(other.context), commandBuffer(other.commandBuffer), ended(other.ended), ownsBuffer(other.ownsBuffer),
+      frame(other.frame), computeLocalSize(other.computeLocalSize) {
     other.commandBuffer = VK_NULL_HANDLE;
     other.ended = true;
     other.ownsBuffer = false;
@@ -44,18 +52,24 @@ Commands::~Commands() {
     if (commandBuffer != VK_NULL_HANDLE) {
         if (!ended) vkEndCommandBuffer(commandBuffer);
         if (ownsBuffer) {
-            vkFreeCommandBuffers(g_context().device, g_context().commandPool, 1, &commandBuffer);
+            vkFreeCommandBuffers(context->device, context->commandPool, 1, &commandBuffer);
         }
     }
 }
 
 Commands Commands::oneShot() {
-    VkCommandBuffer cmd = createCommandBuffer(g_context().device, g_context().commandPool);
-    return Commands(cmd, true);
+    VulkanContext & context = g_context();
+    VkCommandBuffer cmd = createCommandBuffer(context.device, context.commandPool);
+    return Commands(context, cmd, true);
 }
 
 void Commands::bindCompute(VkPipeline pipeline) {
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    computeLocalSize = {0, 0, 0};
+}
+void Commands::bindCompute(const Pipeline & pipeline) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    computeLocalSize = pipeline.localSize();
 }
 void Commands::bindGraphics(VkPipeline pipeline) {
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
@@ -63,17 +77,32 @@ void Commands::bindGraphics(VkPipeline pipeline) {
 void Commands::dispatch(uint32_t x, uint32_t y, uint32_t z) {
     vkCmdDispatch(commandBuffer, x, y, z);
 }
+void Commands::dispatchThreads(uint32_t x, uint32_t y, uint32_t z) {
+    if (computeLocalSize[0] == 0) {
+        throw std::runtime_error("dispatchThreads: no local size; bind the compute Pipeline itself, not its VkPipeline");
+    }
+    uint32_t threads[3] = {x, y, z};
+    uint32_t groups[3];
+    for (int i = 0; i < 3; ++i) {
+        groups[i] = threads[i] / computeLocalSize[i] + (threads[i] % computeLocalSize[i] != 0);
+        if (groups[i] > context->limits.maxComputeWorkGroupCount[i]) {
+            throw std::runtime_error("dispatchThreads: " + std::to_string(groups[i]) + " workgroups exceed maxComputeWorkGroupCount[" +
+                                     std::to_string(i) + "]");
+        }
+    }
+    vkCmdDispatch(commandBuffer, groups[0], groups[1], groups[2]);
+}
 void Commands::dispatchIndirect(VkBuffer buffer, VkDeviceSize offset) {
     vkCmdDispatchIndirect(commandBuffer, buffer, offset);
 }
 void Commands::drawMeshTasks(uint32_t x, uint32_t y, uint32_t z) {
-    vkCmdDrawMeshTasks(commandBuffer, x, y, z);
+    context->vkCmdDrawMeshTasks(commandBuffer, x, y, z);
 }
 void Commands::drawMeshTasksIndirect(VkBuffer buffer, uint32_t drawCount, VkDeviceSize offset, uint32_t stride) {
-    vkCmdDrawMeshTasksIndirect(commandBuffer, buffer, offset, drawCount, stride);
+    context->vkCmdDrawMeshTasksIndirect(commandBuffer, buffer, offset, drawCount, stride);
 }
 void Commands::pushConstants(const void * data, uint32_t size) {
-    vkCmdPushConstants(commandBuffer, g_context().bindlessTable.pipelineLayout, VK_SHADER_STAGE_ALL, 0, size, data);
+    vkCmdPushConstants(commandBuffer, context->bindlessTable.pipelineLayout, VK_SHADER_STAGE_ALL, 0, size, data);
 }
 
 void Commands::beginRendering() {
@@ -94,22 +123,22 @@ void Commands::beginRendering(float r, float g, float b, float a) {
 
     VkRenderingInfo renderingInfo = {};
     renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-    renderingInfo.renderArea = { 0, 0, (uint32_t)g_context().windowWidth, (uint32_t)g_context().windowHeight };
+    renderingInfo.renderArea = { 0, 0, (uint32_t)context->windowWidth, (uint32_t)context->windowHeight };
     renderingInfo.layerCount = 1;
     renderingInfo.pColorAttachments = &colorAttachment;
     renderingInfo.colorAttachmentCount = 1;
     renderingInfo.pDepthAttachment = nullptr;
 
     VkViewport vp = {};
-    vp.width = (float)g_context().windowWidth;
-    vp.height = (float)g_context().windowHeight;
+    vp.width = (float)context->windowWidth;
+    vp.height = (float)context->windowHeight;
     vp.minDepth = 0.0f; vp.maxDepth = 1.0f;
     vkCmdSetViewport(commandBuffer, 0, 1, &vp);
     VkRect2D sc = {};
-    sc.extent = { (uint32_t)g_context().windowWidth, (uint32_t)g_context().windowHeight };
+    sc.extent = { (uint32_t)context->windowWidth, (uint32_t)context->windowHeight };
     vkCmdSetScissor(commandBuffer, 0, 1, &sc);
 
-    vkBeginRendering(commandBuffer, &renderingInfo);
+    context->vkBeginRendering(commandBuffer, &renderingInfo);
 }
 
 void Commands::resumeRendering() {
@@ -124,22 +153,22 @@ void Commands::resumeRendering() {
 
     VkRenderingInfo renderingInfo = {};
     renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-    renderingInfo.renderArea = { 0, 0, (uint32_t)g_context().windowWidth, (uint32_t)g_context().windowHeight };
+    renderingInfo.renderArea = { 0, 0, (uint32_t)context->windowWidth, (uint32_t)context->windowHeight };
     renderingInfo.layerCount = 1;
     renderingInfo.pColorAttachments = &colorAttachment;
     renderingInfo.colorAttachmentCount = 1;
     renderingInfo.pDepthAttachment = nullptr;
 
     VkViewport vp = {};
-    vp.width = (float)g_context().windowWidth;
-    vp.height = (float)g_context().windowHeight;
+    vp.width = (float)context->windowWidth;
+    vp.height = (float)context->windowHeight;
     vp.minDepth = 0.0f; vp.maxDepth = 1.0f;
     vkCmdSetViewport(commandBuffer, 0, 1, &vp);
     VkRect2D sc = {};
-    sc.extent = { (uint32_t)g_context().windowWidth, (uint32_t)g_context().windowHeight };
+    sc.extent = { (uint32_t)context->windowWidth, (uint32_t)context->windowHeight };
     vkCmdSetScissor(commandBuffer, 0, 1, &sc);
 
-    vkBeginRendering(commandBuffer, &renderingInfo);
+    context->vkBeginRendering(commandBuffer, &renderingInfo);
 }
 
 void Commands::beginRenderingOffscreen(VkImageView colorImage, VkExtent2D extent) {
@@ -168,7 +197,7 @@ void Commands::beginRenderingOffscreen(VkImageView colorImage, VkExtent2D extent
     sc.extent = extent;
     vkCmdSetScissor(commandBuffer, 0, 1, &sc);
 
-    vkBeginRendering(commandBuffer, &renderingInfo);
+    context->vkBeginRendering(commandBuffer, &renderingInfo);
 }
 
 void Commands::beginRendering(VkImageView depthImage) {
@@ -194,25 +223,25 @@ void Commands::beginRendering(VkImageView depthImage) {
 
     VkRenderingInfo renderingInfo = {};
     renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-    renderingInfo.renderArea = { 0, 0, (uint32_t)g_context().windowWidth, (uint32_t)g_context().windowHeight };
+    renderingInfo.renderArea = { 0, 0, (uint32_t)context->windowWidth, (uint32_t)context->windowHeight };
     renderingInfo.layerCount = 1;
     renderingInfo.pColorAttachments = &colorAttachment;
     renderingInfo.colorAttachmentCount = 1;
     renderingInfo.pDepthAttachment = &depthAttachmentInfo;
 
     VkViewport vp = {};
-    vp.width = (float)g_context().windowWidth;
-    vp.height = (float)g_context().windowHeight;
+    vp.width = (float)context->windowWidth;
+    vp.height = (float)context->windowHeight;
     vp.minDepth = 0.0f; vp.maxDepth = 1.0f;
     vkCmdSetViewport(commandBuffer, 0, 1, &vp);
     VkRect2D sc = {};
-    sc.extent = { (uint32_t)g_context().windowWidth, (uint32_t)g_context().windowHeight };
+    sc.extent = { (uint32_t)context->windowWidth, (uint32_t)context->windowHeight };
     vkCmdSetScissor(commandBuffer, 0, 1, &sc);
 
-    vkBeginRendering(commandBuffer, &renderingInfo);
+    context->vkBeginRendering(commandBuffer, &renderingInfo);
 }
 
-void Commands::beginRendering(VkImageView depthImage, VkExtent2D extent) {
+void Commands::beginRendering(VkImageView depthImage, VkExtent2D extent, uint32_t viewMask) {
     VkRenderingAttachmentInfo depthAttachmentInfo = {};
     depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
     depthAttachmentInfo.imageView = depthImage;
@@ -226,6 +255,7 @@ void Commands::beginRendering(VkImageView depthImage, VkExtent2D extent) {
     renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
     renderingInfo.renderArea = { 0, 0, extent.width, extent.height };
     renderingInfo.layerCount = 1;
+    renderingInfo.viewMask = viewMask;
     renderingInfo.colorAttachmentCount = 0;
     renderingInfo.pColorAttachments = nullptr;
     renderingInfo.pDepthAttachment = &depthAttachmentInfo;
@@ -240,7 +270,7 @@ void Commands::beginRendering(VkImageView depthImage, VkExtent2D extent) {
     sc.extent = extent;
     vkCmdSetScissor(commandBuffer, 0, 1, &sc);
 
-    vkBeginRendering(commandBuffer, &renderingInfo);
+    context->vkBeginRendering(commandBuffer, &renderingInfo);
 }
 
 void Commands::beginRendering(VkImageView colorImage, VkImageView depthImage, VkExtent2D extent) {
@@ -249,9 +279,11 @@ void Commands::beginRendering(VkImageView colorImage, VkImageView depthImage, Vk
 }
 
 void Commands::beginRendering(std::span<const VkImageView> colorImages, VkImageView depthImage, VkExtent2D extent) {
-    std::vector<VkRenderingAttachmentInfo> colorAttachments;
-    for (auto view : colorImages) {
-        VkRenderingAttachmentInfo att = {};
+    VkRenderingAttachmentInfo * colorAttachments = scratch<VkRenderingAttachmentInfo>(colorImages.size());
+    for (size_t i = 0; i < colorImages.size(); ++i) {
+        VkImageView view = colorImages[i];
+        VkRenderingAttachmentInfo & att = colorAttachments[i];
+        att = {};
         att.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
         att.imageView = view;
         att.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -259,7 +291,6 @@ void Commands::beginRendering(std::span<const VkImageView> colorImages, VkImageV
         att.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         VkClearValue clearColor = { .color = { 0.0f, 0.0f, 0.0f, 1.0f } };
         att.clearValue = clearColor;
-        colorAttachments.push_back(att);
     }
 
     VkRenderingAttachmentInfo depthAttachmentInfo = {};
@@ -275,8 +306,8 @@ void Commands::beginRendering(std::span<const VkImageView> colorImages, VkImageV
     renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
     renderingInfo.renderArea = { 0, 0, extent.width, extent.height };
     renderingInfo.layerCount = 1;
-    renderingInfo.colorAttachmentCount = (uint32_t)colorAttachments.size();
-    renderingInfo.pColorAttachments = colorAttachments.data();
+    renderingInfo.colorAttachmentCount = (uint32_t)colorImages.size();
+    renderingInfo.pColorAttachments = colorAttachments;
     renderingInfo.pDepthAttachment = &depthAttachmentInfo;
 
     VkViewport vp = {};
@@ -287,11 +318,11 @@ void Commands::beginRendering(std::span<const VkImageView> colorImages, VkImageV
     sc.extent = extent;
     vkCmdSetScissor(commandBuffer, 0, 1, &sc);
 
-    vkBeginRendering(commandBuffer, &renderingInfo);
+    context->vkBeginRendering(commandBuffer, &renderingInfo);
 }
 
 void Commands::endRendering() {
-    vkEndRendering(commandBuffer);
+    context->vkEndRendering(commandBuffer);
 }
 
 void Commands::setViewport(float x, float y, float width, float height) {
@@ -353,7 +384,7 @@ void Commands::bufferBarrier(VkBuffer buf, Stage srcStage, Access srcAccess,
 
 void Commands::bufferBarriers(std::span<const BufferBarrierDesc> barriers) {
     if (barriers.empty()) return;
-    std::vector<VkBufferMemoryBarrier2> mem(barriers.size());
+    VkBufferMemoryBarrier2 * mem = scratch<VkBufferMemoryBarrier2>(barriers.size());
     for (size_t i = 0; i < barriers.size(); ++i) {
         VkBufferMemoryBarrier2 & b = mem[i];
         b = {};
@@ -370,19 +401,18 @@ void Commands::bufferBarriers(std::span<const BufferBarrierDesc> barriers) {
     }
     VkDependencyInfo depInfo = {};
     depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-    depInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(mem.size());
-    depInfo.pBufferMemoryBarriers = mem.data();
+    depInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+    depInfo.pBufferMemoryBarriers = mem;
     vkCmdPipelineBarrier2(commandBuffer, &depInfo);
 }
 
 void Commands::blasToTlasBarrier(std::span<const VkBuffer> blasBackings) {
-    std::vector<BufferBarrierDesc> barriers;
-    barriers.reserve(blasBackings.size());
-    for (VkBuffer backing : blasBackings) {
-        barriers.push_back({backing, Stage::AccelStructureBuild, Access::AccelStructureWrite,
-                            Stage::AccelStructureBuild, Access::AccelStructureRead});
+    BufferBarrierDesc * barriers = scratch<BufferBarrierDesc>(blasBackings.size());
+    for (size_t i = 0; i < blasBackings.size(); ++i) {
+        barriers[i] = {blasBackings[i], Stage::AccelStructureBuild, Access::AccelStructureWrite,
+                       Stage::AccelStructureBuild, Access::AccelStructureRead};
     }
-    bufferBarriers(barriers);
+    bufferBarriers(std::span<const BufferBarrierDesc>(barriers, blasBackings.size()));
 }
 
 void Commands::tlasToShaderReadBarrier(VkBuffer tlasBacking) {
@@ -420,32 +450,46 @@ void Commands::submitAndWait() {
     // Reuse one fence per thread across submitAndWait calls: this function always waits for
     // completion before returning, so the fence is idle by the next call. vkCreateFence /
     // vkDestroyFence per submit cost ~0.3ms each on this driver — ~7ms over a ~12-submit bind.
-    VkDevice device = g_context().device;
-    if (submitAndWaitFence == VK_NULL_HANDLE || submitAndWaitFenceDevice != device) {
-        if (vkCreateFence(device, &fenceInfo, nullptr, &submitAndWaitFence) != VK_SUCCESS) {
+    VkDevice device = context->device;
+    VkFence fence = VK_NULL_HANDLE;
+    for (SubmitFence & entry : submitAndWaitFences) {
+        if (entry.device == device) fence = entry.fence;
+    }
+    if (fence == VK_NULL_HANDLE) {
+        if (vkCreateFence(device, &fenceInfo, context->allocationCallbacks(VK_OBJECT_TYPE_FENCE), &fence) != VK_SUCCESS) {
             throw std::runtime_error("failed to create fence for submitAndWait");
         }
-        submitAndWaitFenceDevice = device;
+        submitAndWaitFences.push_back({device, fence});
     } else {
-        vkResetFences(device, 1, &submitAndWaitFence);
+        vkResetFences(device, 1, &fence);
     }
-    VkFence fence = submitAndWaitFence;
     auto tFence = now();
 
-    vkQueueSubmit2(g_context().graphicsQueue, 1, &submitInfo, fence);
+    if (!frame) context->setupSubmitsInFlight.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(context->queueMutex);   // a present thread may share the queue
+        vkQueueSubmit2(context->graphicsQueue, 1, &submitInfo, fence);
+    }
     auto tSubmit = now();
     if (std::getenv("HULL_FENCE_SLACK_POLL") != nullptr) {
-        while (vkGetFenceStatus(g_context().device, fence) == VK_NOT_READY) { /* busy spin */ }
+        while (vkGetFenceStatus(context->device, fence) == VK_NOT_READY) { /* busy spin */ }
     } else {
-        vkWaitForFences(g_context().device, 1, &fence, VK_TRUE, UINT64_MAX);
+        vkWaitForFences(context->device, 1, &fence, VK_TRUE, UINT64_MAX);
     }
     auto tWait = now();
     auto tDestroy = now();
 
+    // Everything taken from the setup arena was copied by the vkCmd* call it was made for.
+    if (!frame) context->setupArena.reset();
+
     if (ownsBuffer) {
-        vkFreeCommandBuffers(g_context().device, g_context().commandPool, 1, &commandBuffer);
+        vkFreeCommandBuffers(context->device, context->commandPool, 1, &commandBuffer);
         commandBuffer = VK_NULL_HANDLE;
     }
+    // With nothing else in flight, whatever was destroyed before this point is no longer in use.
+    if (!frame && context->setupSubmitsInFlight.fetch_sub(1) == 1 && context->offscreen()) {
+        context->drainDestroys();
+    }
     auto tFree = now();
     if (diag) {
         std::fprintf(stderr,
@@ -463,3 +507,7 @@ void Commands::end() {
 }
 
 Commands::operator VkCommandBuffer() { return commandBuffer; }
+
+FrameArena & Commands::scratchArena() {
+    return frame ? context->frameArenas[frame->inFlight()] : context->setupArena;
+}
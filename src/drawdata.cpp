@@ -0,0 +1,36 @@
+#include "vkinternal.h"
+
+#include <cstring>
+
+// --- DrawDataRing ---
+
+DrawDataRing::DrawDataRing(size_t bytesPerFrame)
+    : frameBytes(bytesPerFrame), frameCount(g_context().swapchainImageCount) {
+    if (bytesPerFrame == 0) throw std::runtime_error("DrawDataRing needs a nonzero region per frame");
+    BufferBuilder builder(bytesPerFrame * frameCount);
+    builder.storage().persistentlyMapped();
+    buffer = std::make_unique<Buffer>(builder);
+    mapped = static_cast<uint8_t *>(buffer->mappedData());
+    if (!mapped) throw std::runtime_error("DrawDataRing buffer is not host mapped");
+}
+
+void DrawDataRing::beginFrame() {
+    Frame * current = Frame::current();
+    if (!current) throw std::runtime_error("DrawDataRing::beginFrame requires a live Frame");
+    frame = (uint32_t)current->inFlight() % frameCount;
+    cursor = 0;
+}
+
+uint32_t DrawDataRing::write(const void * data, size_t size, size_t stride) {
+    if (stride == 0 || stride % 4 != 0) throw std::runtime_error("DrawDataRing stride must be a nonzero multiple of 4");
+    size_t base = size_t(frame) * frameBytes;
+    size_t offset = (base + cursor + stride - 1) / stride * stride;
+    if (offset + size > base + frameBytes) throw std::runtime_error("DrawDataRing frame region exhausted");
+    memcpy(mapped + offset, data, size);
+    cursor = offset + size - base;
+    return uint32_t(offset / stride);
+}
+
+void DrawDataRing::flush() {
+    if (cursor > 0) buffer->flush(VkDeviceSize(frame) * frameBytes, cursor);
+}
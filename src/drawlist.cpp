@@ -0,0 +1,132 @@
+#include "vkinternal.h"
+
+#include <algorithm>
+
+// --- DrawList ---
+
+namespace {
+
+constexpr uint32_t kPassBits = 4;
+constexpr uint32_t kPipelineBits = 12;
+constexpr uint32_t kMaterialBits = 24;
+constexpr uint32_t kDepthBits = 24;
+static_assert(kPassBits + kPipelineBits + kMaterialBits + kDepthBits == 64, "draw key must fill 64 bits");
+
+// Below this, std::stable_sort beats the fixed cost of eight histograms.
+constexpr size_t kRadixThreshold = 256;
+
+uint64_t mask(uint32_t bits) { return (uint64_t(1) << bits) - 1; }
+
+// Handles are opaque; mix them so that nearby allocations still spread over the 12-bit field.
+// A collision only interleaves two pipelines in the sort; replay compares real handles.
+uint64_t pipelineHash(VkPipeline pipeline) {
+    uint64_t h = (uint64_t)pipeline;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+} // namespace
+
+DrawList::Packet & DrawList::Bucket::add(uint64_t key, VkPipeline pipeline, const void * push, uint32_t pushSize) {
+    if (pushSize > 128) throw std::runtime_error("DrawList push constants exceed 128 bytes");
+    Packet packet = {};
+    packet.key = key;
+    packet.pipeline = pipeline;
+    packet.pushOffset = (uint32_t)payload.size();
+    packet.pushSize = pushSize;
+    payload.insert(payload.end(), (const uint8_t *)push, (const uint8_t *)push + pushSize);
+    packets.push_back(packet);
+    dirty = true;
+    return packets.back();
+}
+
+void DrawList::Bucket::draw(uint64_t key, VkPipeline pipeline, const void * push, uint32_t pushSize,
+                            uint32_t x, uint32_t y, uint32_t z) {
+    Packet & packet = add(key, pipeline, push, pushSize);
+    packet.groups[0] = x;
+    packet.groups[1] = y;
+    packet.groups[2] = z;
+}
+
+void DrawList::Bucket::drawIndirect(uint64_t key, VkPipeline pipeline, const void * push, uint32_t pushSize,
+                                    VkBuffer buffer, uint32_t drawCount, VkDeviceSize offset, uint32_t stride) {
+    Packet & packet = add(key, pipeline, push, pushSize);
+    packet.indirectBuffer = buffer;
+    packet.indirectOffset = offset;
+    packet.drawCount = drawCount;
+    packet.stride = stride;
+}
+
+DrawList::DrawList(uint32_t bucketCount) : buckets(std::max(bucketCount, 1u)) {}
+
+size_t DrawList::size() const {
+    size_t n = 0;
+    for (auto & bucket : buckets) n += bucket.packets.size();
+    return n;
+}
+
+uint64_t DrawList::key(uint32_t pass, VkPipeline pipeline, uint32_t materialRID, float depth, bool backToFront) {
+    float d = std::clamp(depth, 0.0f, 1.0f);
+    uint64_t depthField = uint64_t(d * float(mask(kDepthBits))) & mask(kDepthBits);
+    if (backToFront) depthField = mask(kDepthBits) - depthField;
+    return (uint64_t(pass) & mask(kPassBits)) << (kPipelineBits + kMaterialBits + kDepthBits) |
+           (pipelineHash(pipeline) & mask(kPipelineBits)) << (kMaterialBits + kDepthBits) |
+           (uint64_t(materialRID) & mask(kMaterialBits)) << kDepthBits |
+           depthField;
+}
+
+void DrawList::sort() {
+    order.clear();
+    for (uint32_t b = 0; b < buckets.size(); ++b) {
+        for (uint32_t p = 0; p < buckets[b].packets.size(); ++p) {
+            order.push_back({buckets[b].packets[p].key, b, p});
+        }
+        buckets[b].dirty = false;
+    }
+    dirty = false;
+    size_t n = order.size();
+    if (n < kRadixThreshold) {
+        std::stable_sort(order.begin(), order.end(),
+                         [](const SortEntry & a, const SortEntry & b) { return a.key < b.key; });
+        return;
+    }
+
+    // All eight digit histograms in one streaming pass, then one scatter per digit that varies.
+    uint32_t counts[8][256] = {};
+    for (const SortEntry & e : order) {
+        for (uint32_t digit = 0; digit < 8; ++digit) counts[digit][(e.key >> (digit * 8)) & 0xFF]++;
+    }
+    scratch.resize(n);
+    SortEntry * src = order.data();
+    SortEntry * dst = scratch.data();
+    for (uint32_t digit = 0; digit < 8; ++digit) {
+        uint32_t * count = counts[digit];
+        if (count[(src[0].key >> (digit * 8)) & 0xFF] == n) continue;
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < 256; ++i) {
+            offsets[i] = sum;
+            sum += count[i];
+        }
+        for (size_t i = 0; i < n; ++i) {
+            dst[offsets[(src[i].key >> (digit * 8)) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != order.data()) order.swap(scratch);
+}
+
+DrawReplayStats DrawList::replay(Commands & cmd) {
+    return replay<Commands>(cmd);
+}
+
+void DrawList::clear() {
+    for (auto & bucket : buckets) {
+        bucket.packets.clear();
+        bucket.payload.clear();
+    }
+    order.clear();
+    dirty = true;
+}
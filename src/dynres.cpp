@@ -0,0 +1,87 @@
+#include "vkinternal.h"
+
+#include <algorithm>
+#include <cmath>
+
+// --- DynamicResolution ---
+
+namespace {
+
+// Aim a little under the budget so measurement noise does not push every other frame over.
+constexpr double kHeadroom = 0.9;
+// Largest per-frame scale increase. Decreases apply at once; growth is gradual so a
+// spike that subsides does not bounce the resolution straight back into it.
+constexpr float kRecoverStep = 0.02f;
+// Weight of a new sample in the reported gpuMillis() average.
+constexpr double kSmoothing = 0.1;
+
+uint32_t scaled(uint32_t size, float scale) {
+    return std::clamp((uint32_t)std::lround(size * scale), 1u, size);
+}
+
+} // namespace
+
+DynamicResolution::DynamicResolution(VkExtent2D maxExtent, float budgetMillis, float minScale, float maxScale)
+    : maxExtent_(maxExtent),
+      budgetMillis_(budgetMillis),
+      minScale_(minScale), maxScale_(maxScale),
+      scale_(maxScale) {
+    if (budgetMillis <= 0.0f) throw std::runtime_error("DynamicResolution budget must be positive");
+    if (minScale <= 0.0f || minScale > maxScale || maxScale > 1.0f) {
+        throw std::runtime_error("DynamicResolution scales must satisfy 0 < minScale <= maxScale <= 1");
+    }
+    resize(maxExtent);
+}
+
+void DynamicResolution::begin(Commands & cmd) {
+    Frame * frame = Frame::current();
+    if (!frame) throw std::runtime_error("DynamicResolution::begin requires a live Frame");
+    slot = (uint32_t)frame->inFlight();
+    if (slot >= written.size()) {
+        throw std::runtime_error("DynamicResolution has fewer slots than frames in flight; call resize() after the swapchain changes");
+    }
+
+    uint64_t ticks[2];
+    if (written[slot] && query->read(slot, ticks, 2)) {
+        double ms = double(ticks[1] - ticks[0]) * query->nanosPerTick() * 1e-6;
+        gpuMillis_ = gpuMillis_ == 0.0 ? ms : gpuMillis_ + (ms - gpuMillis_) * kSmoothing;
+
+        // Pass cost tracks pixel count, i.e. scale². The sample is swapchainImageCount frames
+        // old, so project from the scale it was measured at rather than the current one.
+        double target = slotScale[slot] * std::sqrt(budgetMillis_ * kHeadroom / std::max(ms, 1e-3));
+        float next = target < scale_ ? (float)target : std::min((float)target, scale_ + kRecoverStep);
+        scale_ = std::clamp(next, minScale_, maxScale_);
+        extent_ = { scaled(maxExtent_.width, scale_), scaled(maxExtent_.height, scale_) };
+    }
+
+    query->reset(cmd, slot);
+    query->write(cmd, slot, 0);
+    slotScale[slot] = scale_;
+}
+
+void DynamicResolution::end(Commands & cmd) {
+    query->write(cmd, slot, 1);
+    written[slot] = true;
+}
+
+void DynamicResolution::resize(VkExtent2D maxExtent) {
+    if (maxExtent.width == 0 || maxExtent.height == 0) throw std::runtime_error("DynamicResolution extent must be nonzero");
+    fitSlots();
+    maxExtent_ = maxExtent;
+    extent_ = { scaled(maxExtent_.width, scale_), scaled(maxExtent_.height, scale_) };
+}
+
+void DynamicResolution::fitSlots() {
+    size_t count = g_context().swapchainImageCount;
+    if (query && written.size() == count) return;
+    // Nothing is in flight here (construction, or a resize with the device idle), so the old
+    // pools can go at once.
+    query.reset();
+    query = std::make_unique<TimestampQuery>(2, (uint32_t)count);
+    written.assign(count, false);
+    slotScale.assign(count, scale_);
+}
+
+std::array<float, 2> DynamicResolution::uvScale() const {
+    return { float(extent_.width) / float(maxExtent_.width), float(extent_.height) / float(maxExtent_.height) };
+}
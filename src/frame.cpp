@@ -1,28 +1,86 @@
 #include "vkinternal.h"
 
+#include <chrono>
+
 // --- Frame ---
 
-Frame * Frame::currentGuard = nullptr;
+namespace {
+
+VulkanContext & presentableContext() {
+    VulkanContext & context = g_context();
+    if (context.offscreen()) throw std::runtime_error("Frame on an offscreen VulkanContext (no swapchain)");
+    return context;
+}
+
+int64_t nanosSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+// After VK_ERROR_OUT_OF_DATE_KHR / VK_SUBOPTIMAL_KHR from a present.
+void Frame::recreateSwapchain(VulkanContext & context) {
+    vkDeviceWaitIdle(context.device);
+
+    int w, h;
+    SDL_GetWindowSize(context.window, &w, &h);
+    context.windowWidth = w;
+    context.windowHeight = h;
+
+    for (VkImageView view : context.swapchainImageViews) {
+        vkDestroyImageView(context.device, view, context.allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW));
+    }
+    createSwapChain(context, context.presentationSurface, context.physicalDevice, context.device, context.swapchain);
+    getSwapChainImageHandles(context.device, context.swapchain, context.swapchainImages);
+    makeChainImageViews(context.device, context.colorFormat, context.swapchainImages, context.swapchainImageViews);
+
+    // Recreated swapchain images start in Layout::Undefined; the next frame's begin transitions
+    // each from Undefined (a valid first use). Pre-transitioning unacquired presentable images
+    // is unnecessary and a validation error, so it is omitted here.
+    Commands rebuildCmd = Commands::oneShot();
+    if (context.resizeCallback) {
+        VkExtent2D extent = {(uint32_t)w, (uint32_t)h};
+        context.resizeCallback(rebuildCmd, extent);
+    }
+    rebuildCmd.submitAndWait();
+}
 
 Frame::Frame() :
-    context(g_context()),
+    context(presentableContext()),
     inFlightIndex(context.frameInFlightIndex),
     imageAvailableSemaphore(context.imageAvailableSemaphores[inFlightIndex]),
     renderFinishedSemaphore(VK_NULL_HANDLE),
     submittedBuffersFinishedFence(context.submittedBuffersFinishedFences[inFlightIndex]),
     imageIndex(0),
-    submitted(false)
+    submitted(false),
+    serial_(++context.framesBegun)
 {
-    if (Frame::currentGuard != nullptr) {
+    if (context.currentFrame != nullptr) {
         throw std::runtime_error("multiple frames in flight, only one frame is allowed at a time");
     }
-    Frame::currentGuard = this;
+    context.currentFrame = this;
 
     // Wait for oldest frame's work to complete
     vkWaitForFences(context.device, 1, &submittedBuffersFinishedFence, VK_TRUE, UINT64_MAX);
+    context.frameArenas[inFlightIndex].reset();
 
-    // Clean up oldest generation
-    context.destroyGenerations[inFlightIndex].destroy();
+    // Clean up oldest generation. Its handles join the backlog so that whatever exceeds the
+    // per-frame destroy budget carries over instead of spiking this frame.
+    {
+        std::lock_guard<std::mutex> lock(context.destroyMutex);
+        context.destroyBacklog.append(context.destroyGenerations[inFlightIndex]);
+    }
+    context.lastDestroyStats = context.destroyBacklog.destroy(
+        context.options.destroyBudgetItems, context.options.destroyBudgetMillis);
+
+    // The present thread's last present must be issued before the swapchain is touched again.
+    // A stale result is handled here, on the frame thread; the inline path handles it in submit().
+    if (context.presenter) {
+        auto start = std::chrono::steady_clock::now();
+        context.presenter->drain();
+        context.presentCallerNanos += nanosSince(start);
+        if (context.presenter->takeStale()) recreateSwapchain(context);
+    }
 
     // Acquire next image
     if (VK_SUCCESS != vkAcquireNextImageKHR(context.device, context.swapchain, UINT64_MAX,
@@ -33,18 +91,25 @@ Frame::Frame() :
 }
 
 Frame::~Frame() {
-    Frame::currentGuard = nullptr;
+    context.currentFrame = nullptr;
+    std::lock_guard<std::mutex> lock(context.destroyMutex);
     context.frameInFlightIndex = (context.frameInFlightIndex + 1) % context.swapchainImageCount;
 }
 
+Frame * Frame::current() {
+    VulkanContext * context = g_context.current();
+    return context ? context->currentFrame : nullptr;
+}
+
 uint32_t Frame::swapchainImageIndex() const { return imageIndex; }
 VkImageView Frame::swapchainImageView() const { return context.swapchainImageViews[imageIndex]; }
+VkImage Frame::swapchainImage() const { return context.swapchainImages[imageIndex]; }
 
 Commands Frame::beginCommands() {
     VkCommandBuffer cmd = context.frameCommandBuffers[inFlightIndex];
     vkResetCommandBuffer(cmd, 0);
-    Commands cmds(cmd, false);
-    cmds.frame = &(*Frame::currentGuard);
+    Commands cmds(context, cmd, false);
+    cmds.frame = this;
 
     // Set default viewport and scissor (dynamic state)
     cmds.setViewport(0, 0, (float)context.windowWidth, (float)context.windowHeight);
@@ -92,11 +157,21 @@ void Frame::submit(Commands & cmd) {
     submitInfo.signalSemaphoreInfoCount = 1;
     submitInfo.pSignalSemaphoreInfos = &signalSemaphoreInfo;
 
-    if (vkQueueSubmit2(context.graphicsQueue, 1, &submitInfo, submittedBuffersFinishedFence) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit command buffer");
+    {
+        std::lock_guard<std::mutex> lock(context.queueMutex);
+        if (vkQueueSubmit2(context.graphicsQueue, 1, &submitInfo, submittedBuffersFinishedFence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit command buffer");
+        }
     }
 
     // Present
+    auto presentStart = std::chrono::steady_clock::now();
+    if (context.presenter) {
+        context.presenter->push(imageIndex, renderFinishedSemaphore);
+        context.presentCallerNanos += nanosSince(presentStart);
+        submitted = true;
+        return;
+    }
     VkSwapchainKHR swapchains[] = {context.swapchain};
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -107,31 +182,13 @@ void Frame::submit(Commands & cmd) {
     presentInfo.pImageIndices = &imageIndex;
 
     VkResult result = vkQueuePresentKHR(context.presentationQueue, &presentInfo);
+    int64_t presentNanos = nanosSince(presentStart);
+    context.presentNanos += presentNanos;
+    context.presentCallerNanos += presentNanos;
+    context.presentCount++;
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-        vkDeviceWaitIdle(context.device);
-
-        int w, h;
-        SDL_GetWindowSize(context.window, &w, &h);
-        context.windowWidth = w;
-        context.windowHeight = h;
-
-        for (VkImageView view : context.swapchainImageViews) {
-            vkDestroyImageView(context.device, view, nullptr);
-        }
-        createSwapChain(context, context.presentationSurface, context.physicalDevice, context.device, context.swapchain);
-        getSwapChainImageHandles(context.device, context.swapchain, context.swapchainImages);
-        makeChainImageViews(context.device, context.colorFormat, context.swapchainImages, context.swapchainImageViews);
-
-        // Recreated swapchain images start in Layout::Undefined; the next frame's begin transitions
-        // each from Undefined (a valid first use). Pre-transitioning unacquired presentable images
-        // is unnecessary and a validation error, so it is omitted here.
-        Commands rebuildCmd = Commands::oneShot();
-        if (context.resizeCallback) {
-            VkExtent2D extent = {(uint32_t)w, (uint32_t)h};
-            context.resizeCallback(rebuildCmd, extent);
-        }
-        rebuildCmd.submitAndWait();
+        recreateSwapchain(context);
     } else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to present queue");
     }
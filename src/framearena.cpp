@@ -0,0 +1,34 @@
+#include "vkinternal.h"
+
+// --- FrameArena ---
+
+void * FrameArena::allocate(size_t size, size_t alignment) {
+    // Blocks come from operator new[], aligned for any fundamental type; offsets only need
+    // rounding up. A request that does not fit leaves the rest of its block unused until
+    // reset() and moves on to the next kept block, or adds one.
+    while (block < blocks.size()) {
+        size_t offset = (used + alignment - 1) & ~(alignment - 1);
+        if (offset <= blocks[block].size && size <= blocks[block].size - offset) {
+            total += offset - used + size;
+            used = offset + size;
+            return blocks[block].bytes.get() + offset;
+        }
+        ++block;
+        used = 0;
+    }
+    size_t bytes = std::max(blockBytes, size + alignment);
+    blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[bytes]), bytes });
+    return allocate(size, alignment);
+}
+
+void FrameArena::reset() {
+    block = 0;
+    used = 0;
+    total = 0;
+}
+
+size_t FrameArena::bytesReserved() const {
+    size_t bytes = 0;
+    for (const Block & b : blocks) bytes += b.size;
+    return bytes;
+}
@@ -0,0 +1,267 @@
+#include "vkinternal.h"
+
+#include <cstdio>
+#include <fstream>
+
+// --- FrameCapture ---
+
+namespace {
+
+bool bgraFormat(VkFormat format) {
+    return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+bool rgbaFormat(VkFormat format) {
+    return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+bool srgbFormat(VkFormat format) {
+    return format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+void put16(std::vector<uint8_t> & out, size_t at, uint32_t v) {
+    out[at] = uint8_t(v);
+    out[at + 1] = uint8_t(v >> 8);
+}
+
+void putBE32(std::vector<uint8_t> & out, uint32_t v) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(uint8_t(v >> shift));
+}
+
+// 24-bit uncompressed truecolor, top-left origin (descriptor bit 5), stored BGR.
+std::vector<uint8_t> encodeTga(const uint8_t * pixels, uint32_t width, uint32_t height, bool bgra) {
+    std::vector<uint8_t> out(18 + size_t(width) * height * 3);
+    out[2] = 2;
+    put16(out, 12, width);
+    put16(out, 14, height);
+    out[16] = 24;
+    out[17] = 0x20;
+    uint8_t * dst = out.data() + 18;
+    size_t count = size_t(width) * height;
+    for (size_t i = 0; i < count; ++i, pixels += 4, dst += 3) {
+        dst[0] = bgra ? pixels[0] : pixels[2];
+        dst[1] = pixels[1];
+        dst[2] = bgra ? pixels[2] : pixels[0];
+    }
+    return out;
+}
+
+// "Quite OK Image" format (qoiformat.org), 3 channels. Alpha is not meaningful in a
+// presented frame, so it is forced opaque and never costs an op. The index still holds
+// RGBA, as the decoder's does: its zeroed entries must not match opaque black.
+std::vector<uint8_t> encodeQoi(const uint8_t * pixels, uint32_t width, uint32_t height, bool bgra, bool srgb) {
+    struct Rgba {
+        uint8_t r, g, b, a;
+        bool operator==(const Rgba &) const = default;
+    };
+    std::vector<uint8_t> out;
+    out.reserve(14 + size_t(width) * height * 2 + 8);
+    out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+    putBE32(out, width);
+    putBE32(out, height);
+    out.push_back(3);
+    out.push_back(srgb ? 0 : 1);
+
+    Rgba index[64] = {};
+    Rgba prev = { 0, 0, 0, 255 };
+    uint32_t run = 0;
+    size_t count = size_t(width) * height;
+    for (size_t i = 0; i < count; ++i, pixels += 4) {
+        Rgba px = { bgra ? pixels[2] : pixels[0], pixels[1], bgra ? pixels[0] : pixels[2], 255 };
+        if (px == prev) {
+            if (++run == 62) {
+                out.push_back(uint8_t(0xC0 | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            out.push_back(uint8_t(0xC0 | (run - 1)));
+            run = 0;
+        }
+        uint32_t hash = (px.r * 3u + px.g * 5u + px.b * 7u + px.a * 11u) % 64u;
+        Rgba & slot = index[hash];
+        if (slot == px) {
+            out.push_back(uint8_t(hash));
+        } else {
+            slot = px;
+            int8_t dr = int8_t(px.r - prev.r), dg = int8_t(px.g - prev.g), db = int8_t(px.b - prev.b);
+            int drg = dr - dg, dbg = db - dg;
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                out.push_back(uint8_t(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+            } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                out.push_back(uint8_t(0x80 | (dg + 32)));
+                out.push_back(uint8_t(((drg + 8) << 4) | (dbg + 8)));
+            } else {
+                out.insert(out.end(), { 0xFE, px.r, px.g, px.b });
+            }
+        }
+        prev = px;
+    }
+    if (run > 0) out.push_back(uint8_t(0xC0 | (run - 1)));
+    out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+    return out;
+}
+
+} // namespace
+
+FrameCapture::FrameCapture(std::string pathPattern, CaptureFormat format, uint32_t ringSize)
+    : pattern(std::move(pathPattern)), fileFormat(format) {
+    if (ringSize == 0) ringSize = uint32_t(2 * g_context().swapchainImageCount);
+    slots.resize(ringSize);
+    worker = std::thread([this] { run(); });
+}
+
+FrameCapture::~FrameCapture() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void FrameCapture::promote(bool all, bool outsideFrame) {
+    Frame * frame = Frame::current();
+    uint64_t frameCount = g_context().swapchainImageCount;
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uint32_t i = 0; i < slots.size(); ++i) {
+            Slot & slot = slots[i];
+            if (slot.state != SlotState::Recorded) continue;
+            // A capture recorded outside a Frame is only known complete once the caller says it
+            // was submitted: the Commands it went into may still be recording.
+            bool complete = all || (slot.frameSerial == 0 ? outsideFrame
+                                                          : frame && frame->serial() >= slot.frameSerial + frameCount);
+            if (!complete) continue;
+            slot.buffer->invalidate();
+            slot.state = SlotState::Encoding;
+            queue.push_back(i);
+            queued = true;
+        }
+    }
+    if (queued) wake.notify_one();
+}
+
+bool FrameCapture::record(Commands & cmd, VkImage image, VkExtent2D extent, VkFormat format,
+                          Layout layout, Stage stage, Access access) {
+    if (!bgraFormat(format) && !rgbaFormat(format)) {
+        throw std::runtime_error("FrameCapture supports 8-bit RGBA/BGRA color formats only");
+    }
+    promote(false, false);
+
+    Slot * slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Slot & s : slots) {
+            if (s.state == SlotState::Free) { slot = &s; break; }
+        }
+    }
+    if (!slot) {
+        ++dropped_;
+        return false;
+    }
+
+    size_t bytes = size_t(extent.width) * extent.height * 4;
+    if (!slot->buffer || slot->buffer->byteSize() != bytes) {
+        BufferBuilder builder(bytes);
+        builder.readback().persistentlyMapped().transferDestination();
+        slot->buffer = std::make_unique<Buffer>(builder);
+    }
+
+    Barrier(cmd).image(image)
+        .from(stage, access, layout)
+        .to(Stage::Transfer, Access::TransferRead, Layout::TransferSrc)
+        .record();
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { extent.width, extent.height, 1 };
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *slot->buffer, 1, &region);
+    Barrier(cmd).image(image)
+        .from(Stage::Transfer, Access::TransferRead, Layout::TransferSrc)
+        .to(stage, access, layout)
+        .record();
+    cmd.bufferBarrier(*slot->buffer, Stage::Transfer, Access::TransferWrite, Stage::Host, Access::HostRead);
+
+    Frame * frame = Frame::current();
+    std::lock_guard<std::mutex> lock(mutex);
+    slot->extent = extent;
+    slot->format = format;
+    slot->frameSerial = frame ? frame->serial() : 0;
+    slot->index = nextIndex++;
+    slot->state = SlotState::Recorded;
+    return true;
+}
+
+bool FrameCapture::captureSwapchain(Commands & cmd) {
+    Frame * frame = Frame::current();
+    if (!frame) throw std::runtime_error("FrameCapture::captureSwapchain outside a Frame");
+    VulkanContext & context = g_context();
+    if (!context.swapchainCapturable()) throw std::runtime_error("swapchain images do not support transfer source usage");
+    return record(cmd, frame->swapchainImage(), context.swapchainExtent(), context.swapchainFormat(),
+                  Layout::ColorAttachment, Stage::ColorOutput, Access::ColorAttachmentWrite);
+}
+
+bool FrameCapture::capture(Commands & cmd, Image & image, Layout layout, Stage stage, Access access) {
+    return record(cmd, image, image.extent(), image.format(), layout, stage, access);
+}
+
+void FrameCapture::submitted() {
+    promote(false, true);
+}
+
+void FrameCapture::flush() {
+    g_context().waitIdle();
+    promote(true, true);
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] {
+        for (const Slot & slot : slots) {
+            if (slot.state == SlotState::Encoding) return false;
+        }
+        return true;
+    });
+}
+
+uint32_t FrameCapture::written() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return written_;
+}
+
+uint32_t FrameCapture::failed() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failed_;
+}
+
+void FrameCapture::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [&] { return stopping || !queue.empty(); });
+        if (queue.empty()) return;   // stopping, nothing left
+        uint32_t index = queue.front();
+        queue.pop_front();
+        lock.unlock();
+        bool ok = encode(slots[index]);
+        lock.lock();
+        slots[index].state = SlotState::Free;
+        ++(ok ? written_ : failed_);
+        idle.notify_all();
+    }
+}
+
+bool FrameCapture::encode(const Slot & slot) {
+    std::vector<char> path(pattern.size() + 32);
+    std::snprintf(path.data(), path.size(), pattern.c_str(), slot.index);
+
+    const uint8_t * pixels = static_cast<const uint8_t *>(slot.buffer->mappedData());
+    bool bgra = bgraFormat(slot.format);
+    std::vector<uint8_t> file = fileFormat == CaptureFormat::Qoi
+        ? encodeQoi(pixels, slot.extent.width, slot.extent.height, bgra, srgbFormat(slot.format))
+        : encodeTga(pixels, slot.extent.width, slot.extent.height, bgra);
+
+    std::ofstream out(path.data(), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(file.data()), std::streamsize(file.size()));
+    return bool(out);
+}
@@ -0,0 +1,248 @@
+#include "vkinternal.h"
+#include "pipelinecache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#if VKOBJECTS_SHADERC
+#include <shaderc/shaderc.hpp>
+#endif
+
+// --- SPIR-V cache entries ---
+//
+// Shared by GlslCompiler and SpirvOptimizer. File layout: a 32-byte little-endian prefix
+// (magic, version, cache key, SPIR-V size, FNV-1a of the SPIR-V) followed by the SPIR-V. The
+// key is in the prefix as well as the file name, so a renamed or mixed-up file is rebuilt
+// rather than used.
+
+namespace {
+
+constexpr uint32_t kSpirvCacheMagic = 0x56534B56u;   // 'VKSV'
+constexpr uint32_t kSpirvCacheVersion = 1u;
+constexpr size_t kSpirvPrefixSize = 32;
+constexpr uint32_t kSpirvMagic = 0x07230203u;
+
+std::string readText(const std::filesystem::path & path) {
+    std::vector<uint8_t> bytes = vkobjects::readFile(path);
+    return std::string(bytes.begin(), bytes.end());
+}
+
+} // namespace
+
+std::vector<uint8_t> readSpirvCacheEntry(const std::string & path, uint64_t key) {
+    std::vector<uint8_t> file = vkobjects::readFile(path);
+    if (file.size() <= kSpirvPrefixSize) return {};
+    const uint8_t * p = file.data();
+    if (vkobjects::get32(p) != kSpirvCacheMagic || vkobjects::get32(p + 4) != kSpirvCacheVersion || vkobjects::get64(p + 8) != key) return {};
+    uint64_t size = vkobjects::get64(p + 16);
+    if (file.size() - kSpirvPrefixSize != size || size % 4 != 0) return {};
+    const uint8_t * spirv = p + kSpirvPrefixSize;
+    if (vkobjects::fnv1a64(spirv, size_t(size)) != vkobjects::get64(p + 24) || vkobjects::get32(spirv) != kSpirvMagic) return {};
+    return std::vector<uint8_t>(spirv, spirv + size);
+}
+
+bool writeSpirvCacheEntry(const std::string & path, uint64_t key, std::span<const uint8_t> spirv, bool verbose) {
+    try {
+        std::vector<uint8_t> bytes(kSpirvPrefixSize + spirv.size());
+        vkobjects::put32(bytes.data(), kSpirvCacheMagic);
+        vkobjects::put32(bytes.data() + 4, kSpirvCacheVersion);
+        vkobjects::put64(bytes.data() + 8, key);
+        vkobjects::put64(bytes.data() + 16, spirv.size());
+        vkobjects::put64(bytes.data() + 24, vkobjects::fnv1a64(spirv.data(), spirv.size()));
+        std::memcpy(bytes.data() + kSpirvPrefixSize, spirv.data(), spirv.size());
+        return vkobjects::atomicWrite(path, bytes, verbose);
+    } catch (const std::exception & e) {
+        if (verbose) std::cerr << "[spirvcache] store error (" << e.what() << ")\n";
+        return false;
+    }
+}
+
+// --- GlslCompiler ---
+
+#if VKOBJECTS_SHADERC
+
+namespace {
+
+shaderc_shader_kind shaderKind(VkShaderStageFlagBits stage) {
+    switch (stage) {
+        case VK_SHADER_STAGE_VERTEX_BIT:   return shaderc_vertex_shader;
+        case VK_SHADER_STAGE_FRAGMENT_BIT: return shaderc_fragment_shader;
+        case VK_SHADER_STAGE_COMPUTE_BIT:  return shaderc_compute_shader;
+        case VK_SHADER_STAGE_TASK_BIT_EXT: return shaderc_task_shader;
+        case VK_SHADER_STAGE_MESH_BIT_EXT: return shaderc_mesh_shader;
+        default: throw std::runtime_error("GlslCompiler: unsupported shader stage");
+    }
+}
+
+// Resolves "..." next to the including file, then in the include directories; <...> only in
+// the include directories. Each result owns its name and text until ReleaseInclude.
+class Includer : public shaderc::CompileOptions::IncluderInterface {
+    std::vector<std::string> dirs;
+
+    struct Result {
+        shaderc_include_result result;
+        std::string name;
+        std::string text;
+    };
+
+public:
+    explicit Includer(std::vector<std::string> dirs) : dirs(std::move(dirs)) {}
+
+    shaderc_include_result * GetInclude(const char * requested, shaderc_include_type type,
+                                        const char * requesting, size_t) override {
+        auto * out = new Result();
+        std::vector<std::filesystem::path> candidates;
+        if (type == shaderc_include_type_relative) {
+            candidates.push_back(std::filesystem::path(requesting).parent_path() / requested);
+        }
+        for (const std::string & dir : dirs) candidates.push_back(std::filesystem::path(dir) / requested);
+        for (const std::filesystem::path & candidate : candidates) {
+            std::error_code ec;
+            if (!std::filesystem::is_regular_file(candidate, ec)) continue;
+            out->name = candidate.lexically_normal().string();
+            out->text = readText(candidate);
+            break;
+        }
+        // An empty source_name tells shaderc the include failed; `content` is the message.
+        if (out->name.empty()) out->text = std::string("cannot find include file ") + requested;
+        out->result = {out->name.c_str(), out->name.size(), out->text.c_str(), out->text.size(), out};
+        return &out->result;
+    }
+
+    void ReleaseInclude(shaderc_include_result * data) override {
+        delete static_cast<Result *>(data->user_data);
+    }
+};
+
+} // namespace
+
+// shaderc compilers may be used from several threads at once; options are built per call
+// because they own the includer. They are filled in place: moving CompileOptions leaves the
+// includer behind.
+struct GlslCompiler::Shaderc {
+    shaderc::Compiler compiler;
+
+    static void configure(shaderc::CompileOptions & opts, const GlslSource & source, const std::vector<std::string> & includeDirs) {
+        opts.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+        opts.SetSourceLanguage(shaderc_source_language_glsl);
+        for (const ShaderDefine & define : source.defines) opts.AddMacroDefinition(define.name, define.value);
+        opts.SetIncluder(std::make_unique<Includer>(includeDirs));
+    }
+
+    std::string preprocess(const GlslSource & source, const std::vector<std::string> & includeDirs) const {
+        shaderc::CompileOptions opts;
+        configure(opts, source, includeDirs);
+        shaderc::PreprocessedSourceCompilationResult result = compiler.PreprocessGlsl(
+            source.source.data(), source.source.size(), shaderKind(source.stage), source.name.c_str(), opts);
+        if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+            throw std::runtime_error("GLSL preprocessing failed: " + result.GetErrorMessage());
+        }
+        return std::string(result.cbegin(), result.cend());
+    }
+
+    std::vector<uint8_t> compile(const GlslSource & source, const std::vector<std::string> & includeDirs) const {
+        shaderc::CompileOptions opts;
+        configure(opts, source, includeDirs);
+        shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(
+            source.source.data(), source.source.size(), shaderKind(source.stage), source.name.c_str(), opts);
+        if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+            throw std::runtime_error("GLSL compile failed: " + result.GetErrorMessage());
+        }
+        auto begin = reinterpret_cast<const uint8_t *>(result.cbegin());
+        auto end = reinterpret_cast<const uint8_t *>(result.cend());
+        return std::vector<uint8_t>(begin, end);
+    }
+};
+
+bool GlslCompiler::available() { return true; }
+
+#else
+
+struct GlslCompiler::Shaderc {
+    [[noreturn]] static void missing() {
+        throw std::runtime_error("GlslCompiler: vkobjects was built without libshaderc");
+    }
+    std::string preprocess(const GlslSource &, const std::vector<std::string> &) const { missing(); }
+    std::vector<uint8_t> compile(const GlslSource &, const std::vector<std::string> &) const { missing(); }
+};
+
+bool GlslCompiler::available() { return false; }
+
+#endif
+
+GlslCompiler::GlslCompiler(std::string cacheDir, bool verbose)
+    : shaderc(std::make_unique<Shaderc>()), dir_(std::move(cacheDir)), verbose_(verbose) {}
+
+GlslCompiler::~GlslCompiler() = default;
+
+GlslCompiler & GlslCompiler::includeDirectory(std::string dir) {
+    includeDirs_.push_back(std::move(dir));
+    return *this;
+}
+
+uint64_t GlslCompiler::cacheKey(const GlslSource & source) {
+    std::string text = shaderc->preprocess(source, includeDirs_);
+    std::vector<uint8_t> key;
+    auto put = [&](uint64_t v) { for (int i = 0; i < 8; ++i) key.push_back(uint8_t(v >> (8 * i))); };
+    auto putText = [&](const std::string & s) {
+        put(s.size());
+        put(vkobjects::fnv1a64(reinterpret_cast<const uint8_t *>(s.data()), s.size()));
+    };
+    put(kSpirvCacheVersion);
+#if VKOBJECTS_SHADERC
+    // shaderc has no version query of its own: the SPIR-V version it emits plus the SDK
+    // headers it was built against stand in for it.
+    unsigned int spvVersion = 0, spvRevision = 0;
+    shaderc_get_spv_version(&spvVersion, &spvRevision);
+    put(spvVersion);
+    put(spvRevision);
+#endif
+    put(VK_HEADER_VERSION_COMPLETE);
+    put(source.stage);
+    for (const ShaderDefine & define : source.defines) {
+        putText(define.name);
+        putText(define.value);
+    }
+    putText(text);
+    return vkobjects::fnv1a64(key.data(), key.size());
+}
+
+std::string GlslCompiler::path(uint64_t key) const {
+    if (dir_.empty()) return {};
+    char name[32];
+    std::snprintf(name, sizeof(name), "spv_%016llx.bin", (unsigned long long)key);
+    return (std::filesystem::path(dir_) / name).string();
+}
+
+std::vector<uint8_t> GlslCompiler::compile(const GlslSource & source) {
+    if (dir_.empty()) {
+        ++misses_;
+        return shaderc->compile(source, includeDirs_);
+    }
+    uint64_t key = cacheKey(source);
+    std::string file = path(key);
+    std::vector<uint8_t> spirv = readSpirvCacheEntry(file, key);
+    if (!spirv.empty()) {
+        ++hits_;
+        return spirv;
+    }
+    ++misses_;
+    spirv = shaderc->compile(source, includeDirs_);
+    bool written = writeSpirvCacheEntry(file, key, spirv, verbose_);
+    if (verbose_) std::cerr << "[glslcache] " << (written ? "wrote " : "write failed: ") << file << " (" << source.name << ")\n";
+    return spirv;
+}
+
+std::vector<std::vector<uint8_t>> GlslCompiler::compileAll(std::span<const GlslSource> sources, JobSystem & jobs) {
+    std::vector<std::vector<uint8_t>> out(sources.size());
+    jobs.parallelFor(uint32_t(sources.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) out[i] = compile(sources[i]);
+    });
+    return out;
+}
+
+GlslCompiler & glslCompiler() {
+    if (VulkanContext * context = g_context.current()) return context->glsl();
+    static GlslCompiler uncached;
+    return uncached;
+}
@@ -0,0 +1,362 @@
+#include "vkinternal.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// --- HostAllocator ---
+//
+// Block layout: [padding][BlockHeader][user bytes]. The header sits directly before the user
+// pointer; `offset` leads back to the start of the block for free(). Pooled blocks are
+// kPoolAlignment-aligned and exactly one size class long, so a block freed on another thread
+// can join that thread's list unchanged.
+
+namespace {
+
+struct alignas(16) BlockHeader {
+    size_t size;          // bytes the driver asked for
+    uint32_t offset;      // user pointer - block start
+    uint16_t category;
+    uint8_t scope;
+    uint8_t sizeClass;    // kUnpooled for malloc'd blocks
+};
+static_assert(sizeof(BlockHeader) == 16);
+
+constexpr uint8_t kUnpooled = 0xFF;
+constexpr size_t kPoolAlignment = 64;
+constexpr size_t kMinClassBytes = 64;
+constexpr uint32_t kSizeClasses = 11;   // 64 B .. 64 KiB
+
+constexpr VkObjectType kTrackedTypes[] = {
+    VK_OBJECT_TYPE_INSTANCE,
+    VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT,
+    VK_OBJECT_TYPE_SURFACE_KHR,
+    VK_OBJECT_TYPE_DEVICE,
+    VK_OBJECT_TYPE_DEVICE_MEMORY,
+    VK_OBJECT_TYPE_SWAPCHAIN_KHR,
+    VK_OBJECT_TYPE_COMMAND_POOL,
+    VK_OBJECT_TYPE_FENCE,
+    VK_OBJECT_TYPE_SEMAPHORE,
+    VK_OBJECT_TYPE_IMAGE_VIEW,
+    VK_OBJECT_TYPE_SAMPLER,
+    VK_OBJECT_TYPE_SHADER_MODULE,
+    VK_OBJECT_TYPE_PIPELINE_CACHE,
+    VK_OBJECT_TYPE_PIPELINE_LAYOUT,
+    VK_OBJECT_TYPE_PIPELINE,
+    VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT,
+    VK_OBJECT_TYPE_DESCRIPTOR_POOL,
+    VK_OBJECT_TYPE_QUERY_POOL,
+    VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR,
+    VK_OBJECT_TYPE_UNKNOWN,   // anything else; must stay last
+};
+
+void * alignedAlloc(size_t alignment, size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    return std::aligned_alloc(alignment, size);
+#endif
+}
+
+void alignedFree(void * block) {
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
+
+size_t roundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+BlockHeader * headerOf(void * memory) {
+    return reinterpret_cast<BlockHeader *>(static_cast<uint8_t *>(memory) - sizeof(BlockHeader));
+}
+
+size_t classBytes(uint32_t sizeClass) {
+    return kMinClassBytes << sizeClass;
+}
+
+// Per-thread free lists of pooled blocks; the first word of a free block links to the next.
+struct PoolCache {
+    std::array<void *, kSizeClasses> lists{};
+
+    ~PoolCache() {
+        for (void * block : lists) {
+            while (block) {
+                void * next = *static_cast<void **>(block);
+                alignedFree(block);
+                block = next;
+            }
+        }
+    }
+
+    void * pop(uint32_t sizeClass) {
+        void * block = lists[sizeClass];
+        if (block) lists[sizeClass] = *static_cast<void **>(block);
+        return block;
+    }
+
+    void push(uint32_t sizeClass, void * block) {
+        *static_cast<void **>(block) = lists[sizeClass];
+        lists[sizeClass] = block;
+    }
+};
+
+thread_local PoolCache tlsPool;
+
+void raiseMax(std::atomic<int64_t> & peak, int64_t value) {
+    int64_t seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void addLive(HostAllocator::Counters & counters, int64_t delta) {
+    int64_t live = counters.liveBytes.fetch_add(delta, std::memory_order_relaxed) + delta;
+    raiseMax(counters.peakLiveBytes, live);
+}
+
+HostAllocationStats snapshot(const HostAllocator::Counters & c) {
+    HostAllocationStats s;
+    s.allocations = c.allocations.load(std::memory_order_relaxed);
+    s.reallocations = c.reallocations.load(std::memory_order_relaxed);
+    s.frees = c.frees.load(std::memory_order_relaxed);
+    s.bytes = c.bytes.load(std::memory_order_relaxed);
+    s.liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+    s.peakLiveBytes = c.peakLiveBytes.load(std::memory_order_relaxed);
+    s.internalAllocations = c.internalAllocations.load(std::memory_order_relaxed);
+    s.internalLiveBytes = c.internalLiveBytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace
+
+const VkAllocationCallbacks * hostCallbacks(VkObjectType type) {
+    VulkanContext * context = g_context.current();
+    return context ? context->allocationCallbacks(type) : nullptr;
+}
+
+HostAllocator::HostAllocator(bool poolCommandScope) : poolCommandScope(poolCommandScope) {
+    for (VkObjectType type : kTrackedTypes) {
+        auto category = std::make_unique<Category>();
+        category->owner = this;
+        category->index = uint16_t(categories.size());
+        category->type = type;
+        category->callbacks.pUserData = category.get();
+        category->callbacks.pfnAllocation = &HostAllocator::allocate;
+        category->callbacks.pfnReallocation = &HostAllocator::reallocate;
+        category->callbacks.pfnFree = &HostAllocator::free;
+        category->callbacks.pfnInternalAllocation = &HostAllocator::internalAllocate;
+        category->callbacks.pfnInternalFree = &HostAllocator::internalFree;
+        categories.push_back(std::move(category));
+    }
+}
+
+HostAllocator::~HostAllocator() = default;
+
+const VkAllocationCallbacks * HostAllocator::callbacks(VkObjectType type) {
+    for (auto & category : categories) {
+        if (category->type == type) return &category->callbacks;
+    }
+    return &categories.back()->callbacks;
+}
+
+void * HostAllocator::allocateBlock(Category & category, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    alignment = std::max<size_t>(alignment, alignof(BlockHeader));
+    size_t offset = roundUp(sizeof(BlockHeader), alignment);
+    size_t total = offset + size;
+    uint8_t sizeClass = kUnpooled;
+    void * block = nullptr;
+
+    if (poolCommandScope && scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && alignment <= kPoolAlignment) {
+        for (uint32_t c = 0; c < kSizeClasses; ++c) {
+            if (total <= classBytes(c)) {
+                sizeClass = uint8_t(c);
+                break;
+            }
+        }
+        if (sizeClass != kUnpooled) {
+            block = tlsPool.pop(sizeClass);
+            if (!block) block = alignedAlloc(kPoolAlignment, classBytes(sizeClass));
+            if (!block) return nullptr;
+            pooled.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!block) {
+        block = alignedAlloc(alignment, roundUp(total, alignment));
+        if (!block) return nullptr;
+    }
+
+    uint8_t * user = static_cast<uint8_t *>(block) + offset;
+    BlockHeader * header = headerOf(user);
+    header->size = size;
+    header->offset = uint32_t(offset);
+    header->category = category.index;
+    header->scope = uint8_t(scope);
+    header->sizeClass = sizeClass;
+    if (category.firstUse.load(std::memory_order_relaxed) == 0) {
+        uint64_t expected = 0;
+        category.firstUse.compare_exchange_strong(expected, firstUseCounter.fetch_add(1) + 1);
+    }
+    return user;
+}
+
+void HostAllocator::freeBlock(void * memory) {
+    BlockHeader * header = headerOf(memory);
+    void * block = static_cast<uint8_t *>(memory) - header->offset;
+    if (header->sizeClass != kUnpooled) {
+        tlsPool.push(header->sizeClass, block);
+    } else {
+        alignedFree(block);
+    }
+}
+
+void * VKAPI_PTR HostAllocator::allocate(void * user, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    Category & category = *static_cast<Category *>(user);
+    void * memory = category.owner->allocateBlock(category, size, alignment, scope);
+    if (memory) {
+        Counters & counters = category.scopes[scope];
+        counters.allocations.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes.fetch_add(size, std::memory_order_relaxed);
+        addLive(counters, int64_t(size));
+    }
+    return memory;
+}
+
+void * VKAPI_PTR HostAllocator::reallocate(void * user, void * original, size_t size, size_t alignment,
+                                           VkSystemAllocationScope scope) {
+    if (!original) return allocate(user, size, alignment, scope);
+    if (size == 0) {
+        free(user, original);
+        return nullptr;
+    }
+    Category & category = *static_cast<Category *>(user);
+    HostAllocator & self = *category.owner;
+    // On failure the original stays valid, as the spec requires.
+    void * memory = self.allocateBlock(category, size, alignment, scope);
+    if (!memory) return nullptr;
+
+    BlockHeader * old = headerOf(original);
+    std::memcpy(memory, original, std::min(old->size, size));
+    Counters & was = self.categories[old->category]->scopes[old->scope];
+    addLive(was, -int64_t(old->size));
+    Counters & now = category.scopes[scope];
+    now.reallocations.fetch_add(1, std::memory_order_relaxed);
+    now.bytes.fetch_add(size, std::memory_order_relaxed);
+    addLive(now, int64_t(size));
+    self.freeBlock(original);
+    return memory;
+}
+
+void VKAPI_PTR HostAllocator::free(void * user, void * memory) {
+    if (!memory) return;
+    HostAllocator & self = *static_cast<Category *>(user)->owner;
+    BlockHeader * header = headerOf(memory);
+    Counters & counters = self.categories[header->category]->scopes[header->scope];
+    counters.frees.fetch_add(1, std::memory_order_relaxed);
+    addLive(counters, -int64_t(header->size));
+    self.freeBlock(memory);
+}
+
+void VKAPI_PTR HostAllocator::internalAllocate(void * user, size_t size, VkInternalAllocationType,
+                                               VkSystemAllocationScope scope) {
+    Counters & counters = static_cast<Category *>(user)->scopes[scope];
+    counters.internalAllocations.fetch_add(1, std::memory_order_relaxed);
+    counters.internalLiveBytes.fetch_add(int64_t(size), std::memory_order_relaxed);
+}
+
+void VKAPI_PTR HostAllocator::internalFree(void * user, size_t size, VkInternalAllocationType,
+                                           VkSystemAllocationScope scope) {
+    static_cast<Category *>(user)->scopes[scope].internalLiveBytes.fetch_sub(int64_t(size), std::memory_order_relaxed);
+}
+
+HostAllocationReport HostAllocator::report() const {
+    HostAllocationReport report;
+    std::vector<std::pair<uint64_t, std::pair<VkObjectType, HostAllocationStats>>> used;
+    for (const auto & category : categories) {
+        HostAllocationStats total;
+        for (size_t scope = 0; scope < category->scopes.size(); ++scope) {
+            HostAllocationStats s = snapshot(category->scopes[scope]);
+            report.byScope[scope] += s;
+            total += s;
+        }
+        uint64_t order = category->firstUse.load(std::memory_order_relaxed);
+        if (order != 0 || total.internalAllocations != 0) {
+            used.push_back({ order ? order : UINT64_MAX, { category->type, total } });
+        }
+    }
+    std::stable_sort(used.begin(), used.end(), [](auto & a, auto & b) { return a.first < b.first; });
+    for (auto & entry : used) report.byObjectType.push_back(entry.second);
+    report.pooledAllocations = pooled.load(std::memory_order_relaxed);
+    return report;
+}
+
+// --- HostAllocationReport ---
+
+HostAllocationStats & HostAllocationStats::operator+=(const HostAllocationStats & other) {
+    allocations += other.allocations;
+    reallocations += other.reallocations;
+    frees += other.frees;
+    bytes += other.bytes;
+    liveBytes += other.liveBytes;
+    peakLiveBytes += other.peakLiveBytes;
+    internalAllocations += other.internalAllocations;
+    internalLiveBytes += other.internalLiveBytes;
+    return *this;
+}
+
+const char * HostAllocationReport::scopeName(VkSystemAllocationScope scope) {
+    switch (scope) {
+        case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+        case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+        case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+        case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+        case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+        default: return "unknown";
+    }
+}
+
+const char * HostAllocationReport::objectTypeName(VkObjectType type) {
+    switch (type) {
+        case VK_OBJECT_TYPE_INSTANCE: return "instance";
+        case VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT: return "debug messenger";
+        case VK_OBJECT_TYPE_SURFACE_KHR: return "surface";
+        case VK_OBJECT_TYPE_DEVICE: return "device";
+        case VK_OBJECT_TYPE_DEVICE_MEMORY: return "memory (VMA)";
+        case VK_OBJECT_TYPE_SWAPCHAIN_KHR: return "swapchain";
+        case VK_OBJECT_TYPE_COMMAND_POOL: return "command pool";
+        case VK_OBJECT_TYPE_FENCE: return "fence";
+        case VK_OBJECT_TYPE_SEMAPHORE: return "semaphore";
+        case VK_OBJECT_TYPE_IMAGE_VIEW: return "image view";
+        case VK_OBJECT_TYPE_SAMPLER: return "sampler";
+        case VK_OBJECT_TYPE_SHADER_MODULE: return "shader module";
+        case VK_OBJECT_TYPE_PIPELINE_CACHE: return "pipeline cache";
+        case VK_OBJECT_TYPE_PIPELINE_LAYOUT: return "pipeline layout";
+        case VK_OBJECT_TYPE_PIPELINE: return "pipeline";
+        case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT: return "descriptor set layout";
+        case VK_OBJECT_TYPE_DESCRIPTOR_POOL: return "descriptor pool";
+        case VK_OBJECT_TYPE_QUERY_POOL: return "query pool";
+        case VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR: return "acceleration structure";
+        default: return "other";
+    }
+}
+
+void HostAllocationReport::print(std::ostream & out) const {
+    auto line = [&](const char * name, const HostAllocationStats & s) {
+        out << "  " << name << ": " << s.allocations << " allocs, " << s.reallocations << " reallocs, "
+            << s.frees << " frees, " << s.bytes << " B total, " << s.liveBytes << " B live";
+        if (s.internalAllocations) out << ", " << s.internalAllocations << " internal (" << s.internalLiveBytes << " B live)";
+        out << "\n";
+    };
+    out << "host allocations by scope:\n";
+    for (size_t scope = 0; scope < byScope.size(); ++scope) {
+        line(scopeName(VkSystemAllocationScope(scope)), byScope[scope]);
+    }
+    out << "host allocations by object type:\n";
+    for (auto & [type, stats] : byObjectType) line(objectTypeName(type), stats);
+    if (pooledAllocations) out << "  " << pooledAllocations << " command-scope allocations pooled\n";
+}
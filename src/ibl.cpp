@@ -0,0 +1,128 @@
+#include "vkinternal.h"
+
+#include <algorithm>
+
+// --- IblBaker ---
+
+namespace {
+
+// SPIR-V compiled from src/shaders at build time (glslc -mfmt=c).
+const uint32_t kPrefilterSpv[] =
+#include "ibl_prefilter.comp.inc"
+;
+const uint32_t kIrradianceShSpv[] =
+#include "ibl_irradiance_sh.comp.inc"
+;
+const uint32_t kBrdfLutSpv[] =
+#include "ibl_brdf_lut.comp.inc"
+;
+
+constexpr VkFormat kIblFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+constexpr uint32_t kPrefilterSamples = 512;
+constexpr uint32_t kIrradianceSamples = 4096;
+constexpr uint32_t kBrdfLutSamples = 1024;
+
+uint32_t groups(uint32_t size) { return (size + 7) / 8; }
+
+} // namespace
+
+IblBaker::IblBaker(Commands & cmd, uint32_t edge, uint32_t mipCount, uint32_t lutSize)
+    : prefilterShader(embeddedComputeShader(kPrefilterSpv, sizeof(kPrefilterSpv), "ibl_prefilter.comp")),
+      irradianceShader(embeddedComputeShader(kIrradianceShSpv, sizeof(kIrradianceShSpv), "ibl_irradiance_sh.comp")),
+      brdfLutShader(embeddedComputeShader(kBrdfLutSpv, sizeof(kBrdfLutSpv), "ibl_brdf_lut.comp")),
+      prefilterPipeline(createComputePipeline(*prefilterShader)),
+      irradiancePipeline(createComputePipeline(*irradianceShader)),
+      brdfLutPipeline(createComputePipeline(*brdfLutShader)),
+      timer(3) {
+    if (edge == 0 || mipCount == 0 || lutSize == 0) throw std::runtime_error("IblBaker sizes must be nonzero");
+
+    ImageBuilder cubeBuilder = ImageBuilder().withFormat(kIblFormat).cube(edge).mipLevels(mipCount);
+    prefiltered_ = std::make_unique<Image>(cubeBuilder, cmd);
+    ImageBuilder lutBuilder = ImageBuilder().withFormat(kIblFormat).size(lutSize, lutSize).sampledStorage();
+    brdfLut_ = std::make_unique<Image>(lutBuilder, cmd);
+    BufferBuilder shBuilder(9 * 4 * sizeof(float));
+    shBuilder.storage().transferSource();
+    irradianceSH_ = std::make_unique<Buffer>(shBuilder);
+
+    for (uint32_t mip = 0; mip < prefiltered_->mipLevelCount(); ++mip) {
+        mipViews.push_back(prefiltered_->createStorageArrayView(mip));
+    }
+    brdfLutView = brdfLut_->createStorageView(0, 0);
+}
+
+IblBaker::~IblBaker() {
+    // A bake may still be in flight; the views retire with the current frame's resources.
+    for (Image::StorageView view : mipViews) Image::retireStorageView(view);
+    Image::retireStorageView(brdfLutView);
+}
+
+void IblBaker::bake(Commands & cmd, const Image & environment) {
+    if (!environment.isCube()) throw std::runtime_error("IblBaker::bake requires a cube environment image");
+
+    Image & cube = *prefiltered_;
+    uint32_t mips = cube.mipLevelCount();
+
+    if (baked) {
+        // Re-bake: outputs go back from sampled to writable.
+        cmd.imageBarrier(cube, Stage::Fragment | Stage::Compute, Access::ShaderRead, Layout::ShaderReadOnly,
+                         Stage::Compute, Access::ShaderWrite, Layout::General, mips, 6);
+        cmd.bufferBarrier(*irradianceSH_, Stage::Fragment | Stage::Compute, Access::ShaderRead,
+                          Stage::Compute, Access::ShaderWrite);
+    }
+
+    timer.begin(cmd);
+
+    struct PrefilterPush {
+        uint32_t environmentRID;
+        uint32_t targetRID;
+        uint32_t size;
+        uint32_t environmentEdge;
+        float roughness;
+        uint32_t sampleCount;
+    } prefilterPush{environment.rid(), 0, 0, environment.extent().width, 0.0f, kPrefilterSamples};
+    cmd.bindCompute(prefilterPipeline);
+    for (uint32_t mip = 0; mip < mips; ++mip) {
+        prefilterPush.targetRID = mipViews[mip].rid;
+        prefilterPush.size = std::max(cube.extent().width >> mip, 1u);
+        prefilterPush.roughness = mips > 1 ? float(mip) / float(mips - 1) : 0.0f;
+        cmd.pushConstants(prefilterPush);
+        cmd.dispatch(groups(prefilterPush.size), groups(prefilterPush.size), 6);
+    }
+    timer.mark(cmd, "ibl prefilter");
+
+    struct IrradiancePush {
+        uint32_t environmentRID;
+        uint32_t outputRID;
+        uint32_t sampleCount;
+        float lod;
+    } irradiancePush{environment.rid(), irradianceSH_->rid(), kIrradianceSamples,
+                     float(std::max(environment.mipLevelCount(), 3u) - 3)};
+    cmd.bindCompute(irradiancePipeline);
+    cmd.pushConstants(irradiancePush);
+    cmd.dispatch(1, 1, 1);
+    timer.mark(cmd, "ibl irradiance sh");
+
+    if (!baked) {
+        struct BrdfLutPush {
+            uint32_t targetRID;
+            uint32_t size;
+            uint32_t sampleCount;
+        } lutPush{brdfLutView.rid, brdfLut_->extent().width, kBrdfLutSamples};
+        cmd.bindCompute(brdfLutPipeline);
+        cmd.pushConstants(lutPush);
+        cmd.dispatch(groups(lutPush.size), groups(lutPush.size), 1);
+        cmd.imageBarrier(*brdfLut_, Stage::Compute, Access::ShaderWrite, Layout::General,
+                         Stage::Fragment | Stage::Compute, Access::ShaderRead, Layout::ShaderReadOnly);
+        timer.mark(cmd, "ibl brdf lut");
+    }
+
+    cmd.imageBarrier(cube, Stage::Compute, Access::ShaderWrite, Layout::General,
+                     Stage::Fragment | Stage::Compute, Access::ShaderRead, Layout::ShaderReadOnly, mips, 6);
+    cmd.bufferBarrier(*irradianceSH_, Stage::Compute, Access::ShaderWrite,
+                      Stage::Fragment | Stage::Compute, Access::ShaderRead);
+    baked = true;
+}
+
+const std::vector<std::pair<const char *, double>> & IblBaker::timings() {
+    return timer.resolve();
+}
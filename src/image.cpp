@@ -121,19 +121,19 @@ void recordCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkI
     vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 }
 
-VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags imageAspects, size_t mipLevelCount) {
+VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags imageAspects, size_t mipLevelCount, uint32_t layerCount) {
     VkImageView textureImageView;
     VkImageViewCreateInfo viewInfo = {};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = image;
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.viewType = layerCount > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = imageAspects;
     viewInfo.subresourceRange.baseMipLevel = 0;
     viewInfo.subresourceRange.levelCount = mipLevelCount;
     viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
-    if (vkCreateImageView(device, &viewInfo, nullptr, &textureImageView) != VK_SUCCESS) {
+    viewInfo.subresourceRange.layerCount = layerCount;
+    if (vkCreateImageView(device, &viewInfo, hostCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW), &textureImageView) != VK_SUCCESS) {
         throw std::runtime_error("failed to create texture image views");
     }
     return textureImageView;
@@ -163,6 +163,12 @@ ImageBuilder & ImageBuilder::depthSampled(uint32_t width, uint32_t height) {
     isColorTarget = false;
     return *this;
 }
+ImageBuilder & ImageBuilder::depthSampledArray(uint32_t width, uint32_t height, uint32_t layers) {
+    if (layers == 0) throw std::runtime_error("depthSampledArray requires at least one layer");
+    depthSampled(width, height);
+    layerCount = layers;
+    return *this;
+}
 ImageBuilder & ImageBuilder::colorTarget(uint32_t width, uint32_t height) {
     return colorTarget(width, height, g_context().colorFormat);
 }
@@ -186,6 +192,14 @@ ImageBuilder & ImageBuilder::fromStagingBuffer(Buffer & stagingBuffer, int width
     isColorTarget = false;
     return *this;
 }
+ImageBuilder & ImageBuilder::fromCookedTexture(Buffer & stagingBuffer, const CookedTexture & texture) {
+    fromStagingBuffer(stagingBuffer, int(texture.extent.width), int(texture.extent.height), texture.format);
+    if (stagingBuffer.byteSize() < texture.byteSize) throw std::runtime_error("staging buffer smaller than cooked texture");
+    buildMipmaps = false;
+    mipLevelsOverride = texture.mipLevels;
+    copyRegions = texture.regions;
+    return *this;
+}
 ImageBuilder & ImageBuilder::color() {
     bytes = nullptr; stagingBuffer = nullptr; buildMipmaps = false;
     extent.width = g_context().windowWidth;
@@ -241,7 +255,7 @@ ImageBuilder & ImageBuilder::sampledStorage() {
     return *this;
 }
 
-Image::Image(Image && other) : image(other.image), allocation(other.allocation), sampler(other.sampler), rid_(other.rid_), isStorageImage(other.isStorageImage), isCube_(other.isCube_), mipLevels_(other.mipLevels_), format_(other.format_), imageView(other.imageView) {
+Image::Image(Image && other) : context(other.context), image(other.image), allocation(other.allocation), sampler(other.sampler), rid_(other.rid_), isStorageImage(other.isStorageImage), isCube_(other.isCube_), mipLevels_(other.mipLevels_), layers_(other.layers_), extent_(other.extent_), format_(other.format_), imageView(other.imageView) {
     other.image = VK_NULL_HANDLE;
     other.allocation = VK_NULL_HANDLE;
     other.imageView = VK_NULL_HANDLE;
@@ -249,7 +263,7 @@ Image::Image(Image && other) : image(other.image), allocation(other.allocation),
     other.rid_ = UINT32_MAX;
 }
 
-Image::Image(ImageBuilder & builder, Commands & commands) : sampler(VK_NULL_HANDLE), rid_(UINT32_MAX), isStorageImage(false), isCube_(builder.isCube), mipLevels_(1), format_(builder.format) {
+Image::Image(ImageBuilder & builder, Commands & commands) : context(commands.context), sampler(VK_NULL_HANDLE), rid_(UINT32_MAX), isStorageImage(false), isCube_(builder.isCube), mipLevels_(1), format_(builder.format) {
     VkCommandBuffer commandBuffer = commands.commandBuffer;
     VkImageFormatProperties formatProps;
 
@@ -275,7 +289,7 @@ Image::Image(ImageBuilder & builder, Commands & commands) : sampler(VK_NULL_HAND
     if (builder.isCube) createFlags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
 
     VkResult result = vkGetPhysicalDeviceImageFormatProperties(
-        g_context().physicalDevice, builder.format, VK_IMAGE_TYPE_2D,
+        context->physicalDevice, builder.format, VK_IMAGE_TYPE_2D,
         VK_IMAGE_TILING_OPTIMAL, usageFlags, createFlags, &formatProps);
     if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to get image format properties " + std::to_string(result));
@@ -291,6 +305,7 @@ Image::Image(ImageBuilder & builder, Commands & commands) : sampler(VK_NULL_HAND
         mipLevels = 1;
     }
     mipLevels_ = static_cast<uint32_t>(mipLevels);
+    if (mipLevels < builder.copyRegions.size()) throw std::runtime_error("device supports fewer mip levels than the cooked texture");
 
     VkExtent3D extent = {
         std::min(builder.extent.width, formatProps.maxExtent.width),
@@ -298,11 +313,17 @@ Image::Image(ImageBuilder & builder, Commands & commands) : sampler(VK_NULL_HAND
         1
     };
 
+    extent_ = {extent.width, extent.height};
+
     if (!(formatProps.sampleCounts & builder.sampleBits)) {
         throw std::runtime_error("requested sample count not supported");
     }
 
-    uint32_t arrayLayers = builder.isCube ? 6u : 1u;
+    uint32_t arrayLayers = builder.isCube ? 6u : builder.layerCount;
+    if (arrayLayers > formatProps.maxArrayLayers) {
+        throw std::runtime_error("requested layer count not supported");
+    }
+    layers_ = arrayLayers;
 
     VkImageCreateInfo imageInfo = {};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -321,7 +342,7 @@ Image::Image(ImageBuilder & builder, Commands & commands) : sampler(VK_NULL_HAND
     VmaAllocationCreateInfo vmaAllocInfo = {};
     vmaAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
 
-    if (vmaCreateImage(g_allocator, &imageInfo, &vmaAllocInfo, &image, &allocation, nullptr) != VK_SUCCESS) {
+    if (vmaCreateImage(context->allocator, &imageInfo, &vmaAllocInfo, &image, &allocation, nullptr) != VK_SUCCESS) {
         throw std::runtime_error("failed to create image");
     }
 
@@ -341,7 +362,7 @@ Image::Image(ImageBuilder & builder, Commands & commands) : sampler(VK_NULL_HAND
         VkImageAspectFlags depthAspect = builder.isDepthSampled
             ? VK_IMAGE_ASPECT_DEPTH_BIT
             : (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT);
-        Barrier(commandBuffer).image(image)
+        Barrier(commandBuffer).image(image, 1, arrayLayers)
             .from(Stage::None, Access::None, Layout::Undefined)
             .to(Stage::EarlyFragment, Access::DepthStencilWrite, Layout::DepthStencilAttachment)
             .aspectMask(depthAspect)
@@ -352,13 +373,16 @@ Image::Image(ImageBuilder & builder, Commands & commands) : sampler(VK_NULL_HAND
             .to(Stage::ColorOutput, Access::ColorAttachmentWrite, Layout::ColorAttachment)
             .record();
     } else {
-        Barrier(commandBuffer).image(image)
+        Barrier(commandBuffer).image(image, builder.copyRegions.empty() ? 1u : static_cast<uint32_t>(mipLevels))
             .from(Stage::None, Access::None, Layout::Undefined)
             .to(Stage::Transfer, Access::TransferWrite, Layout::TransferDst)
             .record();
     }
 
-    if (builder.stagingBuffer != nullptr) {
+    if (builder.stagingBuffer != nullptr && !builder.copyRegions.empty()) {
+        vkCmdCopyBufferToImage(commandBuffer, *(builder.stagingBuffer), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               static_cast<uint32_t>(builder.copyRegions.size()), builder.copyRegions.data());
+    } else if (builder.stagingBuffer != nullptr) {
         recordCopyBufferToImage(commandBuffer, *(builder.stagingBuffer), image, builder.extent.width, builder.extent.height);
     }
 
@@ -400,11 +424,11 @@ Image::Image(ImageBuilder & builder, Commands & commands) : sampler(VK_NULL_HAND
         vi.subresourceRange.levelCount = mipLevels;
         vi.subresourceRange.baseArrayLayer = 0;
         vi.subresourceRange.layerCount = 6;
-        if (vkCreateImageView(g_context().device, &vi, nullptr, &imageView) != VK_SUCCESS) {
+        if (vkCreateImageView(context->device, &vi, context->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW), &imageView) != VK_SUCCESS) {
             throw std::runtime_error("failed to create cube image view");
         }
     } else {
-        imageView = createImageView(g_context().device, image, builder.format, aspectFlags, mipLevels);
+        imageView = createImageView(context->device, image, builder.format, aspectFlags, mipLevels, arrayLayers);
     }
 
     // Register with bindless table. Cube and sampled-storage images
@@ -412,18 +436,18 @@ Image::Image(ImageBuilder & builder, Commands & commands) : sampler(VK_NULL_HAND
     // demand via createStorageView().
     if (builder.isCube || builder.isSampledStorage) {
         isStorageImage = false;
-        sampler = builder.useNearest ? createNearestSampler(g_context().device) : createSampler(g_context().device);
-        rid_ = g_context().bindlessTable.registerSampler(g_context().device, imageView, sampler);
+        sampler = builder.useNearest ? createNearestSampler(context->device) : createSampler(context->device);
+        rid_ = context->bindlessTable.registerSampler(context->device, imageView, sampler);
     } else {
         isStorageImage = (builder.usage & VK_IMAGE_USAGE_STORAGE_BIT) != 0;
         if (isStorageImage) {
-            rid_ = g_context().bindlessTable.registerStorageImage(g_context().device, imageView);
+            rid_ = context->bindlessTable.registerStorageImage(context->device, imageView);
         } else if (builder.isDepthSampled) {
-            sampler = createShadowSampler(g_context().device);
-            rid_ = g_context().bindlessTable.registerSampler(g_context().device, imageView, sampler);
+            sampler = createShadowSampler(context->device);
+            rid_ = context->bindlessTable.registerSampler(context->device, imageView, sampler);
         } else if (!builder.isDepthBuffer) {
-            sampler = builder.useNearest ? createNearestSampler(g_context().device) : createSampler(g_context().device);
-            rid_ = g_context().bindlessTable.registerSampler(g_context().device, imageView, sampler);
+            sampler = builder.useNearest ? createNearestSampler(context->device) : createSampler(context->device);
+            rid_ = context->bindlessTable.registerSampler(context->device, imageView, sampler);
         }
     }
 }
@@ -431,6 +455,8 @@ Image::Image(ImageBuilder & builder, Commands & commands) : sampler(VK_NULL_HAND
 uint32_t Image::rid() const { return rid_; }
 bool Image::isCube() const { return isCube_; }
 uint32_t Image::mipLevelCount() const { return mipLevels_; }
+uint32_t Image::layerCount() const { return layers_; }
+VkExtent2D Image::extent() const { return extent_; }
 Image::operator VkImage() const { return image; }
 
 Image::StorageView Image::createStorageView(uint32_t face, uint32_t mip) {
@@ -445,34 +471,65 @@ Image::StorageView Image::createStorageView(uint32_t face, uint32_t mip) {
     vi.subresourceRange.baseArrayLayer = face;
     vi.subresourceRange.layerCount = 1;
     StorageView out{UINT32_MAX, VK_NULL_HANDLE};
-    if (vkCreateImageView(g_context().device, &vi, nullptr, &out.view) != VK_SUCCESS) {
+    if (vkCreateImageView(context->device, &vi, context->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW), &out.view) != VK_SUCCESS) {
         throw std::runtime_error("failed to create storage face/mip view");
     }
-    out.rid = g_context().bindlessTable.registerStorageImage(g_context().device, out.view);
+    out.rid = context->bindlessTable.registerStorageImage(context->device, out.view);
+    return out;
+}
+
+Image::StorageView Image::createStorageArrayView(uint32_t mip) {
+    VkImageViewCreateInfo vi = {};
+    vi.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    vi.image = image;
+    vi.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    vi.format = format_;
+    vi.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    vi.subresourceRange.baseMipLevel = mip;
+    vi.subresourceRange.levelCount = 1;
+    vi.subresourceRange.baseArrayLayer = 0;
+    vi.subresourceRange.layerCount = layers_;
+    StorageView out{UINT32_MAX, VK_NULL_HANDLE};
+    if (vkCreateImageView(context->device, &vi, context->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW), &out.view) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create storage array view");
+    }
+    out.rid = context->bindlessTable.registerStorageImage(context->device, out.view);
     return out;
 }
 
 void Image::destroyStorageView(StorageView v) {
     if (v.rid != UINT32_MAX) g_context().bindlessTable.releaseStorageImage(v.rid);
-    if (v.view != VK_NULL_HANDLE) vkDestroyImageView(g_context().device, v.view, nullptr);
+    if (v.view != VK_NULL_HANDLE) vkDestroyImageView(g_context().device, v.view, hostCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW));
 }
 
-Image::~Image() {
-    if (image == VK_NULL_HANDLE) return;
+void Image::retireStorageView(StorageView v) {
     VulkanContext & context = g_context();
     if (context.options.enableImmediateDestroy) {
+        destroyStorageView(v);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(context.destroyMutex);
+    auto & gen = context.destroyGenerations[context.frameInFlightIndex];
+    if (v.rid != UINT32_MAX) gen.storageImageRIDs.push_back(v.rid);
+    if (v.view != VK_NULL_HANDLE) gen.imageViews.push_back(v.view);
+}
+
+Image::~Image() {
+    if (image == VK_NULL_HANDLE) return;
+    if (context->options.enableImmediateDestroy) {
         if (rid_ != UINT32_MAX) {
             if (isStorageImage)
-                context.bindlessTable.releaseStorageImage(rid_);
+                context->bindlessTable.releaseStorageImage(rid_);
             else
-                context.bindlessTable.releaseSampler(rid_);
+                context->bindlessTable.releaseSampler(rid_);
         }
-        if (imageView != VK_NULL_HANDLE) vkDestroyImageView(context.device, imageView, nullptr);
-        if (sampler != VK_NULL_HANDLE) vkDestroySampler(context.device, sampler, nullptr);
-        vmaDestroyImage(g_allocator, image, allocation);
+        if (imageView != VK_NULL_HANDLE) vkDestroyImageView(context->device, imageView, context->allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW));
+        if (sampler != VK_NULL_HANDLE) vkDestroySampler(context->device, sampler, context->allocationCallbacks(VK_OBJECT_TYPE_SAMPLER));
+        vmaDestroyImage(context->allocator, image, allocation);
         return;
     }
-    auto & gen = context.destroyGenerations[context.frameInFlightIndex];
+    std::lock_guard<std::mutex> lock(context->destroyMutex);
+    auto & gen = context->destroyGenerations[context->frameInFlightIndex];
 
     if (rid_ != UINT32_MAX) {
         if (isStorageImage) {
@@ -0,0 +1,227 @@
+#include "vkinternal.h"
+
+#include <algorithm>
+
+// --- JobSystem ---
+//
+// Each deque is the fixed-capacity Chase-Lev deque with the C11 orderings from Lê et al.,
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013), except that push
+// publishes with a release store of `bottom` rather than a release fence, which is the same
+// on x86/ARM and lets ThreadSanitizer follow it. A push into a full deque runs the job inline
+// instead of growing the buffer.
+//
+// Sleeping: a worker that finds nothing registers in `sleepers` under sleepMutex and waits
+// for `queued` > 0. A submitter bumps `queued` and then, only if someone is asleep, takes
+// sleepMutex before notifying, so a worker between its predicate check and its wait cannot
+// miss the wakeup.
+
+namespace {
+
+constexpr uint32_t kNoDeque = UINT32_MAX;
+constexpr uint32_t kSpinsBeforeSleep = 64;
+
+// The JobSystem whose deque this thread owns, and its index there.
+thread_local std::pair<const JobSystem *, uint32_t> tlsOwner = { nullptr, kNoDeque };
+
+} // namespace
+
+struct JobSystem::Job {
+    std::function<void()> fn;
+    JobCounter * counter;
+};
+
+struct JobSystem::WorkDeque {
+    static constexpr int64_t kCapacity = 4096;   // power of two
+
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    std::array<std::atomic<Job *>, kCapacity> items{};
+
+    // Owner only. False when full.
+    bool push(Job * job) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= kCapacity) return false;
+        items[b & (kCapacity - 1)].store(job, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);   // publishes the job to thieves
+        return true;
+    }
+
+    // Owner only: newest job, or nullptr.
+    Job * pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {   // empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Job * job = items[b & (kCapacity - 1)].load(std::memory_order_relaxed);
+        if (t == b) {   // last job: race thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // Any thread: oldest job, or nullptr when empty or when another thief won.
+    Job * steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        Job * job = items[t & (kCapacity - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return job;
+    }
+};
+
+uint32_t JobSystem::defaultWorkerCount() {
+    return std::max(1u, std::thread::hardware_concurrency()) - 1;
+}
+
+JobSystem::JobSystem(uint32_t workers) : context(g_context.current()) {
+    for (uint32_t i = 0; i <= workers; ++i) deques.push_back(std::make_unique<WorkDeque>());
+    previousOwner = tlsOwner;
+    tlsOwner = { this, 0 };
+    threads.reserve(workers);
+    for (uint32_t i = 1; i <= workers; ++i) threads.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto & t : threads) t.join();
+    // Jobs the owner queued but nobody ran (there were no workers, or they exited first).
+    for (Job * job = take(0); job; job = take(0)) execute(job);
+    if (tlsOwner.first == this) tlsOwner = previousOwner;
+}
+
+uint32_t JobSystem::selfIndex() const {
+    return tlsOwner.first == this ? tlsOwner.second : kNoDeque;
+}
+
+void JobSystem::push(Job * job) {
+    uint32_t self = selfIndex();
+    if (self != kNoDeque) {
+        if (!deques[self]->push(job)) {
+            execute(job);
+            return;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        injected.push_back(job);
+        injectedCount.fetch_add(1, std::memory_order_release);
+    }
+    queued.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_seq_cst) > 0) {
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wake.notify_one();
+    }
+}
+
+JobSystem::Job * JobSystem::take(uint32_t self) {
+    Job * job = nullptr;
+    if (self != kNoDeque) job = deques[self]->pop();
+    if (!job && injectedCount.load(std::memory_order_acquire) > 0) {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        if (!injected.empty()) {
+            job = injected.front();
+            injected.pop_front();
+            injectedCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    uint32_t n = uint32_t(deques.size());
+    uint32_t start = self == kNoDeque ? 0 : self + 1;
+    for (uint32_t i = 0; !job && i < n; ++i) {
+        uint32_t victim = (start + i) % n;
+        if (victim != self) job = deques[victim]->steal();
+    }
+    if (job) queued.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+void JobSystem::execute(Job * job) {
+    JobCounter * counter = job->counter;
+    try {
+        job->fn();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(counter->errorMutex);
+        if (!counter->error) counter->error = std::current_exception();
+    }
+    delete job;
+    // Last touch of the counter: a waiter may destroy it as soon as this lands.
+    counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+    tlsOwner = { this, index };
+    VulkanContextSingleton::threadContext = context;
+    uint32_t spins = 0;
+    for (;;) {
+        if (Job * job = take(index)) {
+            execute(job);
+            spins = 0;
+            continue;
+        }
+        if (++spins < kSpinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        wake.wait(lock, [&] { return stopping || queued.load(std::memory_order_seq_cst) > 0; });
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+        if (stopping && queued.load(std::memory_order_seq_cst) == 0) return;
+        spins = 0;
+    }
+}
+
+void JobSystem::run(JobCounter & counter, std::function<void()> job) {
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    push(new Job{ std::move(job), &counter });
+}
+
+void JobSystem::wait(JobCounter & counter) {
+    uint32_t self = selfIndex();
+    while (!counter.done()) {
+        if (Job * job = take(self)) execute(job);
+        else std::this_thread::yield();
+    }
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(counter.errorMutex);
+        error = std::exchange(counter.error, nullptr);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grain,
+                            const std::function<void(uint32_t begin, uint32_t end)> & body) {
+    grain = std::max(1u, grain);
+    if (count <= grain || threads.empty()) {
+        if (count > 0) body(0, count);
+        return;
+    }
+    JobCounter counter;
+    for (uint32_t begin = grain; begin < count; begin += grain) {
+        uint32_t end = std::min(count, begin + grain);
+        run(counter, [&body, begin, end] { body(begin, end); });
+    }
+    // The first chunk runs here, then the caller helps with the rest.
+    try {
+        body(0, grain);
+    } catch (...) {
+        wait(counter);
+        throw;
+    }
+    wait(counter);
+}
@@ -0,0 +1,127 @@
+#include "vkinternal.h"
+
+#include <cmath>
+#include <cstring>
+
+// --- LightClusterer ---
+
+namespace {
+
+const uint32_t kCullSpv[] =
+#include "light_cluster_cull.comp.inc"
+;
+
+// Word offsets of the light buffer header; must match include/glsl/light_clusters.glsl.
+enum HeaderWord : uint32_t {
+    kGridX = 0, kGridY = 1, kGridZ = 2, kMaxPerCluster = 3,
+    kLightCount = 4, kLightCapacity = 5, kClustersRid = 6,
+    kZNear = 8, kZFar = 9, kSliceScale = 10, kSliceBias = 11,
+    kViewportWidth = 12, kViewportHeight = 13, kTanHalfFovX = 14, kTanHalfFovY = 15,
+    kView = 16, kHeaderWords = 32,
+};
+constexpr uint32_t kWorkgroupSize = 128;   // local_size_x in light_cluster_cull.comp
+
+uint32_t floatWord(float value) {
+    uint32_t word;
+    memcpy(&word, &value, sizeof(word));
+    return word;
+}
+
+} // namespace
+
+LightClusterer::LightClusterer(uint32_t maxLights, uint32_t gridX, uint32_t gridY, uint32_t gridZ,
+                               uint32_t maxLightsPerCluster)
+    : maxLights_(maxLights), gridX(gridX), gridY(gridY), gridZ(gridZ), maxPerCluster(maxLightsPerCluster) {
+    if (maxLights == 0) throw std::runtime_error("LightClusterer needs room for at least one light");
+    if (gridX == 0 || gridY == 0 || gridZ == 0 || maxLightsPerCluster == 0) {
+        throw std::runtime_error("LightClusterer grid dimensions and per-cluster capacity must be nonzero");
+    }
+
+    shader = embeddedComputeShader(kCullSpv, sizeof(kCullSpv), "light_cluster_cull.comp");
+    pipeline = createComputePipeline(*shader);
+
+    size_t lightBytes = (kHeaderWords + size_t(maxLights) * 12) * sizeof(uint32_t);
+    for (size_t i = 0; i < g_context().swapchainImageCount; ++i) {
+        BufferBuilder builder(lightBytes);
+        builder.storage().persistentlyMapped();
+        lightBuffers.push_back(std::make_unique<Buffer>(builder));
+    }
+    uploadedVersion.assign(lightBuffers.size(), 0);
+
+    BufferBuilder clusterBuilder(size_t(clusterCount()) * (1 + maxLightsPerCluster) * sizeof(uint32_t));
+    clusterBuilder.storage().deviceLocal().transferSource();
+    clusters = std::make_unique<Buffer>(clusterBuilder);
+
+    staged.assign(size_t(maxLights) * 12, 0);
+}
+
+void LightClusterer::setLights(std::span<const ClusterLight> lights) {
+    if (lights.size() > maxLights_) throw std::runtime_error("LightClusterer: more lights than maxLights");
+    lightCount_ = (uint32_t)lights.size();
+    // Three vec4 arrays of maxLights entries: position + range, color + intensity, direction + cos.
+    uint32_t * positionRange = staged.data();
+    uint32_t * colorIntensity = positionRange + size_t(maxLights_) * 4;
+    uint32_t * directionCos = colorIntensity + size_t(maxLights_) * 4;
+    for (size_t i = 0; i < lights.size(); ++i) {
+        const ClusterLight & light = lights[i];
+        for (int c = 0; c < 3; ++c) {
+            positionRange[i * 4 + c] = floatWord(light.position[c]);
+            colorIntensity[i * 4 + c] = floatWord(light.color[c]);
+            directionCos[i * 4 + c] = floatWord(light.direction[c]);
+        }
+        positionRange[i * 4 + 3] = floatWord(light.range);
+        colorIntensity[i * 4 + 3] = floatWord(light.intensity);
+        directionCos[i * 4 + 3] = floatWord(light.spotCos);
+    }
+    ++version;
+}
+
+void LightClusterer::cull(Commands & cmd, const ClusterView & view, VkExtent2D viewport) {
+    if (view.zNear <= 0.0f || view.zFar <= view.zNear) {
+        throw std::runtime_error("LightClusterer: view needs 0 < zNear < zFar");
+    }
+    if (viewport.width == 0 || viewport.height == 0) throw std::runtime_error("LightClusterer: viewport must be nonzero");
+
+    // The slot's previous contents were last read by the frame that used it, which Frame has
+    // already waited for.
+    Frame * frame = Frame::current();
+    slot = frame ? (uint32_t)(frame->inFlight() % lightBuffers.size()) : 0;
+    Buffer & lights = *lightBuffers[slot];
+    uint32_t * words = static_cast<uint32_t *>(lights.mappedData());
+
+    if (uploadedVersion[slot] != version) {
+        memcpy(words + kHeaderWords, staged.data(), staged.size() * sizeof(uint32_t));
+        uploadedVersion[slot] = version;
+    }
+
+    float logDepthRange = std::log(view.zFar / view.zNear);
+    uint32_t header[kHeaderWords] = {};
+    header[kGridX] = gridX;
+    header[kGridY] = gridY;
+    header[kGridZ] = gridZ;
+    header[kMaxPerCluster] = maxPerCluster;
+    header[kLightCount] = lightCount_;
+    header[kLightCapacity] = maxLights_;
+    header[kClustersRid] = clusters->rid();
+    header[kZNear] = floatWord(view.zNear);
+    header[kZFar] = floatWord(view.zFar);
+    header[kSliceScale] = floatWord(float(gridZ) / logDepthRange);
+    header[kSliceBias] = floatWord(-float(gridZ) * std::log(view.zNear) / logDepthRange);
+    header[kViewportWidth] = floatWord(float(viewport.width));
+    header[kViewportHeight] = floatWord(float(viewport.height));
+    header[kTanHalfFovX] = floatWord(view.tanHalfFovX);
+    header[kTanHalfFovY] = floatWord(view.tanHalfFovY);
+    memcpy(header + kView, view.view, sizeof(view.view));
+    memcpy(words, header, sizeof(header));
+    lights.flush();
+
+    // The previous frame's lit pass may still be reading the cluster lists.
+    cmd.bufferBarrier(*clusters, Stage::Fragment | Stage::Compute, Access::ShaderRead,
+                      Stage::Compute, Access::ShaderWrite);
+    struct CullPush { uint32_t lightsRID; } push{lights.rid()};
+    cmd.bindCompute(pipeline);
+    cmd.pushConstants(push);
+    cmd.dispatch((clusterCount() + kWorkgroupSize - 1) / kWorkgroupSize, 1, 1);
+    cmd.bufferBarrier(*clusters, Stage::Compute, Access::ShaderWrite,
+                      Stage::Fragment | Stage::Compute, Access::ShaderRead);
+}
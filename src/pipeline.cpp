@@ -1,5 +1,7 @@
 #include "vkinternal.h"
 
+#include <bit>
+
 // --- Pipelines ---
 
 GraphicsPipelineBuilder::GraphicsPipelineBuilder() : sampleCountBit(VK_SAMPLE_COUNT_1_BIT), isDepthOnly(false), enableAlphaBlend(false), disableDepthTest(false), depthOnlyFormat(VK_FORMAT_D32_SFLOAT) {}
@@ -67,17 +69,38 @@ GraphicsPipelineBuilder & GraphicsPipelineBuilder::noColor() {
     return *this;
 }
 
+GraphicsPipelineBuilder & GraphicsPipelineBuilder::viewMask(uint32_t mask) {
+    multiviewMask = mask;
+    return *this;
+}
+
 static void validateShaderBindings(const ShaderReflection & r, const std::string & name) {
+    static const char * kBindingNames[] = { "storage buffers", "samplers", "storage images", "TLAS", "uniform buffers" };
+    static const VkDescriptorType kBindingTypes[] = {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    };
     for (auto & [set, binding] : r.descriptorBindings) {
         if (set != 0) {
             throw std::runtime_error("pipeline build error: shader '" + name +
                 "' references descriptor set " + std::to_string(set) + " (only set 0 allowed in bindless)");
         }
-        uint32_t maxBinding = g_context().rayTracingEnabled() ? 3u : 2u;
-        if (binding > maxBinding) {
+        bool enabled = binding <= 2 ||
+            (binding == 3 && g_context().rayTracingEnabled()) ||
+            (binding == BindlessTable::UNIFORM_BUFFER_BINDING && g_context().uniformBuffersEnabled());
+        if (!enabled) {
             throw std::runtime_error("pipeline build error: shader '" + name +
                 "' references binding " + std::to_string(binding) +
-                " (valid: 0=storage, 1=samplers, 2=storage images, 3=TLAS when rayTracing() is enabled)");
+                " (valid: 0=storage, 1=samplers, 2=storage images, 3=TLAS when rayTracing() is enabled,"
+                " 4=uniform buffers when uniformBuffers() is enabled)");
+        }
+        auto declared = r.descriptorTypes.find({set, binding});
+        if (declared != r.descriptorTypes.end() && declared->second != kBindingTypes[binding]) {
+            bool uniformBlock = declared->second == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            throw std::runtime_error("pipeline build error: shader '" + name +
+                "' declares binding " + std::to_string(binding) + " as a different descriptor type than the bindless " +
+                kBindingNames[binding] + " array" +
+                (uniformBlock ? " (uniform blocks belong at binding 4; use `buffer` for binding 0)" : ""));
         }
     }
 }
@@ -91,17 +114,19 @@ static void validatePushConstantLimit(const ShaderReflection & r, const std::str
 }
 
 Pipeline::~Pipeline() {
-    if (pipeline != VK_NULL_HANDLE) destroyPipeline(pipeline);
+    if (pipeline != VK_NULL_HANDLE) destroyPipeline(*context, pipeline);
 }
 
-void Pipeline::destroyPipeline(VkPipeline pipeline) {
-    VulkanContext & context = g_context();
-    context.pipelines.erase(pipeline);
-    if (context.options.enableImmediateDestroy) {
-        vkDestroyPipeline(context.device, pipeline, nullptr);
-        return;
+void Pipeline::destroyPipeline(VulkanContext & context, VkPipeline pipeline) {
+    {
+        std::lock_guard<std::mutex> lock(context.destroyMutex);
+        context.pipelines.erase(pipeline);
+        if (!context.options.enableImmediateDestroy) {
+            context.destroyGenerations[context.frameInFlightIndex].pipelines.push_back(pipeline);
+            return;
+        }
     }
-    context.destroyGenerations[context.frameInFlightIndex].pipelines.push_back(pipeline);
+    vkDestroyPipeline(context.device, pipeline, context.allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
 }
 
 Pipeline GraphicsPipelineBuilder::build() {
@@ -248,6 +273,7 @@ Pipeline GraphicsPipelineBuilder::build() {
 
     VkPipelineRenderingCreateInfo renderingInfo = {};
     renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.viewMask = multiviewMask;
     renderingInfo.colorAttachmentCount = colorCount;
     renderingInfo.pColorAttachmentFormats = colorCount > 0 ? formats.data() : nullptr;
     renderingInfo.depthAttachmentFormat = isDepthOnly ? depthOnlyFormat : (noColorAttachments && disableDepthTest ? VK_FORMAT_UNDEFINED : depthFormat);
@@ -271,14 +297,55 @@ Pipeline GraphicsPipelineBuilder::build() {
     pipelineCreateInfo.pNext = &renderingInfo;
 
     VkPipeline pipeline;
-    if (vkCreateGraphicsPipelines(g_context().device, g_context().pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(g_context().device, g_context().pipelineCache, 1, &pipelineCreateInfo, hostCallbacks(VK_OBJECT_TYPE_PIPELINE), &pipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline");
     }
-    g_context().pipelines.emplace(pipeline);
+    {
+        std::lock_guard<std::mutex> lock(g_context().destroyMutex);
+        g_context().pipelines.emplace(pipeline);
+    }
     return Pipeline(pipeline);
 }
 
+SpecConstants & SpecConstants::set(uint32_t constantId, uint32_t value) {
+    for (auto & entry : entries) {
+        if (entry.constantID == constantId) {
+            data[entry.offset / sizeof(uint32_t)] = value;
+            return *this;
+        }
+    }
+    entries.push_back({constantId, uint32_t(data.size() * sizeof(uint32_t)), sizeof(uint32_t)});
+    data.push_back(value);
+    return *this;
+}
+
+SpecConstants & SpecConstants::set(uint32_t constantId, int32_t value) {
+    return set(constantId, std::bit_cast<uint32_t>(value));
+}
+
+SpecConstants & SpecConstants::set(uint32_t constantId, float value) {
+    return set(constantId, std::bit_cast<uint32_t>(value));
+}
+
+SpecConstants & SpecConstants::localSize(const ShaderReflection & reflection, uint32_t x, uint32_t y, uint32_t z) {
+    uint32_t size[3] = {x, y, z};
+    for (int i = 0; i < 3; ++i) {
+        if (reflection.localSizeSpecIds[i] != ~0u) {
+            set(reflection.localSizeSpecIds[i], size[i]);
+        } else if (size[i] != reflection.localSize[i]) {
+            throw std::runtime_error("SpecConstants::localSize: dimension " + std::to_string(i) +
+                " is fixed at " + std::to_string(reflection.localSize[i]) + " (declare it with local_size_" +
+                char('x' + i) + "_id)");
+        }
+    }
+    return *this;
+}
+
 Pipeline createComputePipeline(ShaderModule & computeShaderModule, const char * entryPoint) {
+    return createComputePipeline(computeShaderModule, SpecConstants(), entryPoint);
+}
+
+Pipeline createComputePipeline(ShaderModule & computeShaderModule, const SpecConstants & constants, const char * entryPoint) {
     if (computeShaderModule.reflection.executionModel != VK_SHADER_STAGE_COMPUTE_BIT) {
         throw std::runtime_error("pipeline build error: shader '" + computeShaderModule.fileName +
             "' is not a compute shader (wrong execution model)");
@@ -287,6 +354,24 @@ Pipeline createComputePipeline(ShaderModule & computeShaderModule, const char *
     validatePushConstantLimit(computeShaderModule.reflection, computeShaderModule.fileName,
         g_context().limits.maxPushConstantsSize);
 
+    // The workgroup size after specialization, for Commands::dispatchThreads.
+    const ShaderReflection & reflection = computeShaderModule.reflection;
+    std::array<uint32_t, 3> localSize = reflection.localSize;
+    for (int i = 0; i < 3; ++i) {
+        for (const VkSpecializationMapEntry & entry : constants.entries) {
+            if (entry.constantID == reflection.localSizeSpecIds[i]) localSize[i] = constants.data[entry.offset / sizeof(uint32_t)];
+        }
+    }
+    const VkPhysicalDeviceLimits & limits = g_context().limits;
+    uint64_t invocations = uint64_t(localSize[0]) * localSize[1] * localSize[2];
+    for (int i = 0; i < 3; ++i) {
+        if (localSize[i] > limits.maxComputeWorkGroupSize[i] || invocations > limits.maxComputeWorkGroupInvocations) {
+            throw std::runtime_error("pipeline build error: shader '" + computeShaderModule.fileName + "' local size " +
+                std::to_string(localSize[0]) + "x" + std::to_string(localSize[1]) + "x" + std::to_string(localSize[2]) +
+                " exceeds the device's workgroup limits");
+        }
+    }
+
 #ifndef NDEBUG
     if (g_context().options.enableVerbose) {
         std::cerr << "[pipeline] compute validation passed: " << computeShaderModule.fileName
@@ -304,10 +389,24 @@ Pipeline createComputePipeline(ShaderModule & computeShaderModule, const char *
     pipelineInfo.stage.pName = entryPoint;
     pipelineInfo.layout = pipelineLayout;
 
+    VkSpecializationInfo specialization = {};
+    if (!constants.entries.empty()) {
+        specialization.mapEntryCount = (uint32_t)constants.entries.size();
+        specialization.pMapEntries = constants.entries.data();
+        specialization.dataSize = constants.data.size() * sizeof(uint32_t);
+        specialization.pData = constants.data.data();
+        pipelineInfo.stage.pSpecializationInfo = &specialization;
+    }
+
     VkPipeline computePipeline;
-    if (VK_SUCCESS != vkCreateComputePipelines(g_context().device, g_context().pipelineCache, 1, &pipelineInfo, nullptr, &computePipeline)) {
+    if (VK_SUCCESS != vkCreateComputePipelines(g_context().device, g_context().pipelineCache, 1, &pipelineInfo, hostCallbacks(VK_OBJECT_TYPE_PIPELINE), &computePipeline)) {
         throw std::runtime_error("failed to create compute pipeline");
     }
-    g_context().pipelines.emplace(computePipeline);
-    return Pipeline(computePipeline);
+    {
+        std::lock_guard<std::mutex> lock(g_context().destroyMutex);
+        g_context().pipelines.emplace(computePipeline);
+    }
+    Pipeline result(computePipeline);
+    result.localSize_ = localSize;
+    return result;
 }
@@ -19,24 +19,6 @@ namespace vkobjects {
 
 namespace {
 
-void put32(std::vector<uint8_t> & b, size_t off, uint32_t v) {
-    b[off + 0] = uint8_t(v);
-    b[off + 1] = uint8_t(v >> 8);
-    b[off + 2] = uint8_t(v >> 16);
-    b[off + 3] = uint8_t(v >> 24);
-}
-void put64(std::vector<uint8_t> & b, size_t off, uint64_t v) {
-    for (int i = 0; i < 8; ++i) b[off + i] = uint8_t(v >> (8 * i));
-}
-uint32_t get32(const uint8_t * b) {
-    return uint32_t(b[0]) | (uint32_t(b[1]) << 8) | (uint32_t(b[2]) << 16) | (uint32_t(b[3]) << 24);
-}
-uint64_t get64(const uint8_t * b) {
-    uint64_t v = 0;
-    for (int i = 0; i < 8; ++i) v |= uint64_t(b[i]) << (8 * i);
-    return v;
-}
-
 // Offsets into the trailing VkPipelineCacheHeaderVersionOne (little-endian per spec).
 constexpr size_t kDriverHeaderSize = 32;
 
@@ -54,14 +36,14 @@ uint64_t fnv1a64(const uint8_t * data, size_t n) {
 std::vector<uint8_t> serializeCacheFile(const DeviceCacheId & id,
                                         const uint8_t * blob, size_t blobSize) {
     std::vector<uint8_t> file(kPrefixSize + blobSize);
-    put32(file, 0, kCacheMagic);
-    put32(file, 4, kCacheVersion);
-    put64(file, 8, uint64_t(blobSize));
-    put64(file, 16, fnv1a64(blob, blobSize));
-    put32(file, 24, id.vendorID);
-    put32(file, 28, id.deviceID);
-    put32(file, 32, id.driverVersion);
-    put32(file, 36, id.abiBits);
+    put32(file.data() + 0, kCacheMagic);
+    put32(file.data() + 4, kCacheVersion);
+    put64(file.data() + 8, uint64_t(blobSize));
+    put64(file.data() + 16, fnv1a64(blob, blobSize));
+    put32(file.data() + 24, id.vendorID);
+    put32(file.data() + 28, id.deviceID);
+    put32(file.data() + 32, id.driverVersion);
+    put32(file.data() + 36, id.abiBits);
     std::memcpy(file.data() + 40, id.uuid, VK_UUID_SIZE);
     if (blobSize) std::memcpy(file.data() + kPrefixSize, blob, blobSize);
     return file;
@@ -122,21 +104,24 @@ DeviceCacheId deviceCacheId(const VkPhysicalDeviceProperties & props) {
 
 namespace {
 
-VkPipelineCache createCache(VkDevice device, const void * data, size_t size) {
+VkPipelineCache createCache(VkDevice device, const void * data, size_t size,
+                            const VkAllocationCallbacks * allocator) {
     VkPipelineCacheCreateInfo ci{};
     ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
     ci.initialDataSize = size;
     ci.pInitialData = size ? data : nullptr;
     VkPipelineCache cache = VK_NULL_HANDLE;
-    if (vkCreatePipelineCache(device, &ci, nullptr, &cache) == VK_SUCCESS) return cache;
+    if (vkCreatePipelineCache(device, &ci, allocator, &cache) == VK_SUCCESS) return cache;
     // Driver rejected validated data — fall back to an empty cache.
     ci.initialDataSize = 0;
     ci.pInitialData = nullptr;
     cache = VK_NULL_HANDLE;
-    vkCreatePipelineCache(device, &ci, nullptr, &cache);
+    vkCreatePipelineCache(device, &ci, allocator, &cache);
     return cache;
 }
 
+} // namespace
+
 std::vector<uint8_t> readFile(const std::filesystem::path & path) {
     std::ifstream f(path, std::ios::binary);
     if (!f) return {};
@@ -200,31 +185,39 @@ bool atomicWrite(const std::filesystem::path & finalPath,
 #endif
 }
 
-} // namespace
-
-VkPipelineCache loadPipelineCache(VkDevice device, const DeviceCacheId & id,
-                                  const std::string & dir, bool verbose) {
-    if (dir.empty()) return createCache(device, nullptr, 0);
+std::vector<uint8_t> readPipelineCacheBlob(const DeviceCacheId & id, const std::string & dir, bool verbose) {
+    if (dir.empty()) return {};
     try {
         std::filesystem::path path = std::filesystem::path(dir) / cacheFileName(id);
         std::vector<uint8_t> file = readFile(path);
         if (file.empty()) {
             if (verbose) std::cerr << "[pipelinecache] no cache at " << path << " (cold)\n";
-            return createCache(device, nullptr, 0);
+            return {};
         }
         std::vector<uint8_t> blob = validateCacheFile(file, id);
         if (blob.empty()) {
             if (verbose) std::cerr << "[pipelinecache] discarding incompatible/corrupt " << path << "\n";
-            return createCache(device, nullptr, 0);
+            return {};
         }
         if (verbose) std::cerr << "[pipelinecache] seeded from " << path << " (" << blob.size() << " B)\n";
-        return createCache(device, blob.data(), blob.size());
+        return blob;
     } catch (const std::exception & e) {
         if (verbose) std::cerr << "[pipelinecache] load error (" << e.what() << "); cold start\n";
-        return createCache(device, nullptr, 0);
+        return {};
     }
 }
 
+VkPipelineCache createPipelineCache(VkDevice device, const std::vector<uint8_t> & blob,
+                                    const VkAllocationCallbacks * allocator) {
+    return createCache(device, blob.data(), blob.size(), allocator);
+}
+
+VkPipelineCache loadPipelineCache(VkDevice device, const DeviceCacheId & id,
+                                  const std::string & dir, bool verbose,
+                                  const VkAllocationCallbacks * allocator) {
+    return createPipelineCache(device, readPipelineCacheBlob(id, dir, verbose), allocator);
+}
+
 void savePipelineCache(VkDevice device, VkPipelineCache cache,
                        const DeviceCacheId & id, const std::string & dir, bool verbose) {
     if (dir.empty() || cache == VK_NULL_HANDLE) return;
@@ -12,6 +12,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
 #include <string>
 #include <vector>
 
@@ -55,16 +56,59 @@ std::vector<uint8_t> validateCacheFile(const std::vector<uint8_t> & file,
 //   vkpc_<vendorID:08x>_<deviceID:08x>_<abiBits>.bin
 std::string cacheFileName(const DeviceCacheId & id);
 
+// --- Byte helpers, shared by every on-disk format (pipeline, BLAS and SPIR-V caches, asset
+// archives, cooked textures); all of them are little-endian ---
+
+inline void put32(uint8_t * b, uint32_t v) { for (int i = 0; i < 4; ++i) b[i] = uint8_t(v >> (8 * i)); }
+inline void put64(uint8_t * b, uint64_t v) { for (int i = 0; i < 8; ++i) b[i] = uint8_t(v >> (8 * i)); }
+inline uint32_t get32(const uint8_t * b) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= uint32_t(b[i]) << (8 * i);
+    return v;
+}
+inline uint64_t get64(const uint8_t * b) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= uint64_t(b[i]) << (8 * i);
+    return v;
+}
+// `v` rounded up to a multiple of `a`.
+inline size_t alignUp(size_t v, size_t a) { return (v + a - 1) / a * a; }
+
+// --- File helpers, shared with the BLAS cache (src/blascache.cpp) ---
+
+// Whole file, or empty when it cannot be opened.
+std::vector<uint8_t> readFile(const std::filesystem::path & path);
+
+// Write to a unique temp file beside finalPath, fsync, then rename over finalPath (and fsync
+// the directory on POSIX), so readers see the old file or the new one, never a torn write.
+bool atomicWrite(const std::filesystem::path & finalPath,
+                 const std::vector<uint8_t> & bytes, bool verbose);
+
 // --- Device-touching glue (declared here, defined in pipelinecache.cpp) ---
 
 DeviceCacheId deviceCacheId(const VkPhysicalDeviceProperties & props);
 
+// Read and validate <dir>/<cacheFileName> without touching the device, so it
+// can run on a worker thread while the device is being created. Returns the
+// inner Vulkan blob, or empty on a missing/incompatible/corrupt file or when
+// dir is empty.
+std::vector<uint8_t> readPipelineCacheBlob(const DeviceCacheId & id,
+                                           const std::string & dir, bool verbose);
+
+// Create a VkPipelineCache from a blob returned by readPipelineCacheBlob
+// (empty => empty cache). Never fails on bad data; see loadPipelineCache.
+// allocator is passed through to vkCreatePipelineCache; the caller destroys
+// the cache with the same callbacks.
+VkPipelineCache createPipelineCache(VkDevice device, const std::vector<uint8_t> & blob,
+                                    const VkAllocationCallbacks * allocator = nullptr);
+
 // Create a VkPipelineCache, seeding it from <dir>/<cacheFileName> when that
 // file exists and validates. Always returns a usable cache (empty on any
 // problem, with a final empty-retry if the driver rejects validated data).
 // dir empty => in-process-only cache (no file read).
 VkPipelineCache loadPipelineCache(VkDevice device, const DeviceCacheId & id,
-                                  const std::string & dir, bool verbose);
+                                  const std::string & dir, bool verbose,
+                                  const VkAllocationCallbacks * allocator = nullptr);
 
 // Serialize the cache and atomically replace <dir>/<cacheFileName>. No-op when
 // dir is empty or the cache yields no data. Best-effort: never throws.
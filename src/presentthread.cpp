@@ -0,0 +1,76 @@
+#include "vkinternal.h"
+
+#include <chrono>
+
+// --- PresentThread ---
+
+PresentThread::PresentThread(VulkanContext & context) : context(context) {
+    thread = std::thread(&PresentThread::run, this);
+}
+
+PresentThread::~PresentThread() {
+    // A stop request behind any pending presents, so they are all issued first.
+    push(kStop, VK_NULL_HANDLE);
+    thread.join();
+}
+
+void PresentThread::push(uint32_t imageIndex, VkSemaphore waitSemaphore) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    for (uint32_t h = head.load(std::memory_order_acquire); t - h == kCapacity; h = head.load(std::memory_order_acquire)) {
+        head.wait(h, std::memory_order_acquire);
+    }
+    ring[t % kCapacity] = { imageIndex, waitSemaphore };
+    tail.store(t + 1, std::memory_order_release);
+    tail.notify_one();
+}
+
+void PresentThread::drain() {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    for (uint32_t h = head.load(std::memory_order_acquire); h != t; h = head.load(std::memory_order_acquire)) {
+        head.wait(h, std::memory_order_acquire);
+    }
+    if (failure.load(std::memory_order_relaxed) != VK_SUCCESS) {
+        throw std::runtime_error("failed to present queue");
+    }
+}
+
+void PresentThread::run() {
+    for (uint32_t h = 0;; ++h) {
+        for (uint32_t t = tail.load(std::memory_order_acquire); t == h; t = tail.load(std::memory_order_acquire)) {
+            tail.wait(t, std::memory_order_acquire);
+        }
+        Request request = ring[h % kCapacity];
+        if (request.imageIndex == kStop) {
+            head.store(h + 1, std::memory_order_release);
+            head.notify_all();
+            return;
+        }
+
+        VkSwapchainKHR swapchains[] = {context.swapchain};
+        VkPresentInfoKHR presentInfo = {};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &request.waitSemaphore;
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = swapchains;
+        presentInfo.pImageIndices = &request.imageIndex;
+
+        VkResult result;
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(context.queueMutex);
+            result = vkQueuePresentKHR(context.presentationQueue, &presentInfo);
+        }
+        context.presentNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        context.presentCount++;
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+            stale.store(true, std::memory_order_release);
+        } else if (result != VK_SUCCESS) {
+            failure.store(result, std::memory_order_relaxed);
+        }
+        // Publishes `stale`/`failure` along with the slot.
+        head.store(h + 1, std::memory_order_release);
+        head.notify_all();
+    }
+}
@@ -0,0 +1,287 @@
+#include "vkinternal.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+
+// --- GpuPrimitives ---
+
+namespace {
+
+// SPIR-V compiled from src/shaders at build time, with and without -DUSE_SUBGROUPS.
+const uint32_t kScanSpv[] =
+#include "prims_scan.comp.inc"
+;
+const uint32_t kScanSubgroupSpv[] =
+#include "prims_scan.comp.subgroup.inc"
+;
+const uint32_t kScanAddSpv[] =
+#include "prims_scan_add.comp.inc"
+;
+const uint32_t kScanAddSubgroupSpv[] =
+#include "prims_scan_add.comp.subgroup.inc"
+;
+const uint32_t kCompactSpv[] =
+#include "prims_compact.comp.inc"
+;
+const uint32_t kCompactSubgroupSpv[] =
+#include "prims_compact.comp.subgroup.inc"
+;
+const uint32_t kReduceSpv[] =
+#include "prims_segmented_reduce.comp.inc"
+;
+const uint32_t kReduceSubgroupSpv[] =
+#include "prims_segmented_reduce.comp.subgroup.inc"
+;
+const uint32_t kRadixCountSpv[] =
+#include "prims_radix_count.comp.inc"
+;
+const uint32_t kRadixCountSubgroupSpv[] =
+#include "prims_radix_count.comp.subgroup.inc"
+;
+const uint32_t kRadixScatterSpv[] =
+#include "prims_radix_scatter.comp.inc"
+;
+const uint32_t kRadixScatterSubgroupSpv[] =
+#include "prims_radix_scatter.comp.subgroup.inc"
+;
+
+constexpr uint32_t kItems = 4;        // ITEMS in prims_common.glsl
+constexpr uint32_t kRadixBits = 4;
+constexpr uint32_t kRadixDigits = 1u << kRadixBits;
+
+uint32_t divideRoundUp(uint32_t n, uint32_t d) { return (n + d - 1) / d; }
+
+bool subgroupArithmeticSupported(uint32_t workgroupSize) {
+    const VkPhysicalDeviceSubgroupProperties & subgroup = g_context().subgroupProperties();
+    VkSubgroupFeatureFlags needed = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+    return (subgroup.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+           (subgroup.supportedOperations & needed) == needed &&
+           subgroup.subgroupSize > 0 && workgroupSize % subgroup.subgroupSize == 0;
+}
+
+// Compute write -> compute read/write on every buffer a following dispatch touches.
+void computeBarrier(Commands & cmd, std::initializer_list<VkBuffer> buffers) {
+    BufferBarrierDesc barriers[3];
+    if (buffers.size() > std::size(barriers)) throw std::runtime_error("GpuPrimitives: too many buffers for one barrier");
+    size_t count = 0;
+    for (VkBuffer buffer : buffers) {
+        barriers[count++] = {buffer, Stage::Compute, Access::ShaderWrite,
+                             Stage::Compute, Access::ShaderRead | Access::ShaderWrite};
+    }
+    cmd.bufferBarriers(std::span<const BufferBarrierDesc>(barriers, count));
+}
+
+void requireBytes(const Buffer & buffer, size_t byteCount, const char * what) {
+    if (buffer.byteSize() < byteCount) {
+        throw std::runtime_error(std::string("GpuPrimitives: ") + what + " buffer is smaller than count requires");
+    }
+}
+
+} // namespace
+
+// Reuses `slot` when it is large enough; otherwise replaces it. The old buffer always goes to
+// the current frame's destroy generation, even with immediateDestroy: commands recorded
+// against it earlier in this command buffer have not been submitted yet.
+Buffer & GpuPrimitives::scratch(std::unique_ptr<Buffer> & slot, size_t byteCount) {
+    byteCount = std::max<size_t>(byteCount, sizeof(uint32_t));
+    if (slot && slot->byteSize() >= byteCount) return *slot;
+    if (slot) slot->retire();
+    BufferBuilder builder(byteCount);
+    builder.storage().deviceLocal();
+    slot = std::make_unique<Buffer>(builder);
+    return *slot;
+}
+
+GpuPrimitives::Kernel GpuPrimitives::makeKernel(const uint32_t * words, size_t byteCount, const char * name) {
+    Kernel kernel;
+    kernel.shader = embeddedComputeShader(words, byteCount, name);
+    kernel.pipeline = createComputePipeline(*kernel.shader, SpecConstants().set(0, workgroupSize_));
+    return kernel;
+}
+
+GpuPrimitives::GpuPrimitives(uint32_t workgroupSize, bool useSubgroups)
+    : workgroupSize_(workgroupSize) {
+    const VkPhysicalDeviceLimits & limits = g_context().limits;
+    if (workgroupSize < 32 || workgroupSize > 512 || (workgroupSize & (workgroupSize - 1)) != 0 ||
+        workgroupSize > limits.maxComputeWorkGroupSize[0] || workgroupSize > limits.maxComputeWorkGroupInvocations) {
+        throw std::runtime_error("GpuPrimitives workgroup size must be a power of two in [32, 512] within device limits");
+    }
+    subgroups_ = useSubgroups && subgroupArithmeticSupported(workgroupSize);
+
+    auto variant = [&](const auto & plain, const auto & subgroup, const char * name) {
+        return subgroups_ ? makeKernel(subgroup, sizeof(subgroup), name) : makeKernel(plain, sizeof(plain), name);
+    };
+    scanKernel = variant(kScanSpv, kScanSubgroupSpv, "prims_scan.comp");
+    scanAddKernel = variant(kScanAddSpv, kScanAddSubgroupSpv, "prims_scan_add.comp");
+    compactKernel = variant(kCompactSpv, kCompactSubgroupSpv, "prims_compact.comp");
+    reduceKernel = variant(kReduceSpv, kReduceSubgroupSpv, "prims_segmented_reduce.comp");
+    radixCountKernel = variant(kRadixCountSpv, kRadixCountSubgroupSpv, "prims_radix_count.comp");
+    radixScatterKernel = variant(kRadixScatterSpv, kRadixScatterSubgroupSpv, "prims_radix_scatter.comp");
+}
+
+// Splits more than maxComputeWorkGroupCount[0] groups across y; shaders linearize with groupIndex().
+void GpuPrimitives::dispatchGroups(Commands & cmd, uint32_t groups) {
+    const VkPhysicalDeviceLimits & limits = g_context().limits;
+    uint32_t x = std::min(groups, limits.maxComputeWorkGroupCount[0]);
+    uint32_t y = divideRoundUp(groups, x);
+    if (y > limits.maxComputeWorkGroupCount[1]) throw std::runtime_error("GpuPrimitives: element count exceeds dispatch limits");
+    cmd.dispatch(x, y, 1);
+}
+
+void GpuPrimitives::scan(Commands & cmd, Buffer & input, Buffer & output, uint32_t count,
+                         bool inclusive, bool predicate, uint32_t level) {
+    uint32_t blocks = divideRoundUp(count, workgroupSize_ * kItems);
+    if (scanPartials.size() <= level) scanPartials.resize(level + 1);
+    Buffer * partials = blocks > 1 ? &scratch(scanPartials[level], size_t(blocks) * sizeof(uint32_t)) : nullptr;
+    // Scratch may still be in use by previously recorded primitives.
+    if (partials) computeBarrier(cmd, {*partials});
+
+    struct ScanPush {
+        uint32_t inputRID;
+        uint32_t outputRID;
+        uint32_t partialsRID;
+        uint32_t count;
+        uint32_t inclusive;
+        uint32_t predicate;
+    } push{input.rid(), output.rid(), partials ? partials->rid() : kNullRid, count,
+           inclusive ? 1u : 0u, predicate ? 1u : 0u};
+    cmd.bindCompute(scanKernel.pipeline);
+    cmd.pushConstants(push);
+    dispatchGroups(cmd, blocks);
+    if (!partials) return;
+
+    // Scan the block totals in place, then add each block's offset back in.
+    computeBarrier(cmd, {*partials});
+    scan(cmd, *partials, *partials, blocks, false, false, level + 1);
+    computeBarrier(cmd, {output, *partials});
+
+    struct ScanAddPush {
+        uint32_t dataRID;
+        uint32_t partialsRID;
+        uint32_t count;
+    } addPush{output.rid(), partials->rid(), count};
+    cmd.bindCompute(scanAddKernel.pipeline);
+    cmd.pushConstants(addPush);
+    dispatchGroups(cmd, blocks);
+}
+
+void GpuPrimitives::exclusiveScan(Commands & cmd, Buffer & input, Buffer & output, uint32_t count) {
+    if (count == 0) return;
+    requireBytes(input, size_t(count) * 4, "scan input");
+    requireBytes(output, size_t(count) * 4, "scan output");
+    scan(cmd, input, output, count, false, false, 0);
+}
+
+void GpuPrimitives::inclusiveScan(Commands & cmd, Buffer & input, Buffer & output, uint32_t count) {
+    if (count == 0) return;
+    requireBytes(input, size_t(count) * 4, "scan input");
+    requireBytes(output, size_t(count) * 4, "scan output");
+    scan(cmd, input, output, count, true, false, 0);
+}
+
+void GpuPrimitives::compact(Commands & cmd, Buffer & values, Buffer & flags, Buffer & output,
+                            Buffer & countOut, uint32_t count) {
+    if (count == 0) return;
+    requireBytes(values, size_t(count) * 4, "compact values");
+    requireBytes(flags, size_t(count) * 4, "compact flags");
+    requireBytes(output, size_t(count) * 4, "compact output");
+
+    Buffer & indices = scratch(compactIndices, size_t(count) * sizeof(uint32_t));
+    computeBarrier(cmd, {indices});
+    scan(cmd, flags, indices, count, false, true, 0);
+    computeBarrier(cmd, {indices});
+
+    struct CompactPush {
+        uint32_t valuesRID;
+        uint32_t flagsRID;
+        uint32_t indicesRID;
+        uint32_t outputRID;
+        uint32_t countRID;
+        uint32_t count;
+    } push{values.rid(), flags.rid(), indices.rid(), output.rid(), countOut.rid(), count};
+    cmd.bindCompute(compactKernel.pipeline);
+    cmd.pushConstants(push);
+    dispatchGroups(cmd, divideRoundUp(count, workgroupSize_));
+}
+
+void GpuPrimitives::segmentedReduce(Commands & cmd, Buffer & values, Buffer & offsets, Buffer & output,
+                                    uint32_t segmentCount, uint32_t valueCount, ReduceOp op) {
+    if (segmentCount == 0) return;
+    requireBytes(values, size_t(valueCount) * 4, "reduce values");
+    requireBytes(offsets, (size_t(segmentCount) + 1) * 4, "segment offsets");
+    requireBytes(output, size_t(segmentCount) * 4, "reduce output");
+
+    struct ReducePush {
+        uint32_t valuesRID;
+        uint32_t offsetsRID;
+        uint32_t outputRID;
+        uint32_t segmentCount;
+        uint32_t valueCount;
+        uint32_t op;
+    } push{values.rid(), offsets.rid(), output.rid(), segmentCount, valueCount, uint32_t(op)};
+    cmd.bindCompute(reduceKernel.pipeline);
+    cmd.pushConstants(push);
+    dispatchGroups(cmd, segmentCount);
+}
+
+void GpuPrimitives::radixSort(Commands & cmd, Buffer & keys, Buffer * values, uint32_t count, uint32_t keyBits) {
+    if (keyBits != 32 && keyBits != 64) throw std::runtime_error("GpuPrimitives::radixSort supports 32- or 64-bit keys");
+    if (count < 2) return;
+    uint32_t keyWords = keyBits / 32;
+    requireBytes(keys, size_t(count) * keyWords * 4, "sort keys");
+    if (values) requireBytes(*values, size_t(count) * 4, "sort values");
+
+    uint32_t blocks = divideRoundUp(count, workgroupSize_ * kItems);
+    Buffer & histogram = scratch(radixHistogram, size_t(blocks) * kRadixDigits * sizeof(uint32_t));
+    Buffer & keysAlt = scratch(radixKeys, size_t(count) * keyWords * sizeof(uint32_t));
+    Buffer * valuesAlt = values ? &scratch(radixValues, size_t(count) * sizeof(uint32_t)) : nullptr;
+    if (valuesAlt) computeBarrier(cmd, {histogram, keysAlt, *valuesAlt});
+    else computeBarrier(cmd, {histogram, keysAlt});
+
+    // keyBits / kRadixBits passes is even, so the result ping-pongs back into keys/values.
+    Buffer * keySrc = &keys;
+    Buffer * keyDst = &keysAlt;
+    Buffer * valueSrc = values;
+    Buffer * valueDst = valuesAlt;
+    for (uint32_t shift = 0; shift < keyBits; shift += kRadixBits) {
+        struct CountPush {
+            uint32_t keysRID;
+            uint32_t histogramRID;
+            uint32_t count;
+            uint32_t blockCount;
+            uint32_t keyWords;
+            uint32_t shift;
+        } countPush{keySrc->rid(), histogram.rid(), count, blocks, keyWords, shift};
+        cmd.bindCompute(radixCountKernel.pipeline);
+        cmd.pushConstants(countPush);
+        dispatchGroups(cmd, blocks);
+        computeBarrier(cmd, {histogram});
+
+        scan(cmd, histogram, histogram, blocks * kRadixDigits, false, false, 0);
+        computeBarrier(cmd, {histogram});
+
+        struct ScatterPush {
+            uint32_t keysInRID;
+            uint32_t keysOutRID;
+            uint32_t valuesInRID;
+            uint32_t valuesOutRID;
+            uint32_t histogramRID;
+            uint32_t count;
+            uint32_t blockCount;
+            uint32_t keyWords;
+            uint32_t shift;
+        } scatterPush{keySrc->rid(), keyDst->rid(),
+                      valueSrc ? valueSrc->rid() : kNullRid, valueDst ? valueDst->rid() : kNullRid,
+                      histogram.rid(), count, blocks, keyWords, shift};
+        cmd.bindCompute(radixScatterKernel.pipeline);
+        cmd.pushConstants(scatterPush);
+        dispatchGroups(cmd, blocks);
+        if (valueDst) computeBarrier(cmd, {*keyDst, *valueDst});
+        else computeBarrier(cmd, {*keyDst});
+
+        std::swap(keySrc, keyDst);
+        std::swap(valueSrc, valueDst);
+    }
+}
@@ -0,0 +1,139 @@
+#include "vkinternal.h"
+
+#include <chrono>
+
+// --- FramePacket ---
+
+FramePacket::FramePacket(size_t arenaBytes, uint32_t drawBuckets)
+    : arena(new uint8_t[arenaBytes]), capacity(arenaBytes), draws(drawBuckets) {}
+
+void * FramePacket::allocate(size_t size, size_t alignment) {
+    // The arena comes from operator new[], so it is aligned for any fundamental type; offsets
+    // only need rounding up.
+    size_t offset = (used + alignment - 1) & ~(alignment - 1);
+    if (offset > capacity || size > capacity - offset) {
+        throw std::runtime_error("FramePacket arena exhausted (" + std::to_string(capacity) + " bytes)");
+    }
+    used = offset + size;
+    return arena.get() + offset;
+}
+
+void FramePacket::reset() {
+    used = 0;
+    state_ = nullptr;
+    stateSize = 0;
+    draws.clear();
+}
+
+// --- RenderThread ---
+//
+// submitted/rendered count packets; packet s (1-based) lives in packets[(s - 1) % 2]. The game
+// thread may start packet s once packet s - 2 has been rendered, i.e. rendered + 1 >= submitted,
+// which keeps it at most one frame ahead of the render thread.
+
+RenderThread::RenderThread(std::function<void(FramePacket &)> render, RenderThreadOptions options)
+    : render(std::move(render)), threaded(options.threaded), context(g_context.current()) {
+    for (auto & packet : packets) packet = std::make_unique<FramePacket>(options.arenaBytes, options.drawBuckets);
+    if (threaded) worker = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+// The thread has exited once `error` is set, so every later call reports it again.
+void RenderThread::rethrowLocked() {
+    if (error) std::rethrow_exception(error);
+}
+
+FramePacket & RenderThread::beginPacket() {
+    if (building) throw std::runtime_error("RenderThread::beginPacket() called twice without submitPacket()");
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return rendered + 1 >= submitted || error; });
+    rethrowLocked();
+    waitMillis_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    FramePacket & packet = *packets[submitted % 2];
+    lock.unlock();
+
+    packet.reset();
+    packet.serial_ = submitted + 1;   // only this thread writes `submitted`
+    building = true;
+    return packet;
+}
+
+void RenderThread::submitPacket() {
+    if (!building) throw std::runtime_error("RenderThread::submitPacket() without beginPacket()");
+    building = false;
+    if (!threaded) {
+        FramePacket & packet = *packets[submitted % 2];
+        auto start = std::chrono::steady_clock::now();
+        ++submitted;
+        render(packet);
+        ++rendered;
+        renderMillis_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rethrowLocked();
+        ++submitted;
+    }
+    wake.notify_one();
+}
+
+void RenderThread::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return rendered == submitted || error; });
+    rethrowLocked();
+}
+
+double RenderThread::renderMillis() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return renderMillis_;
+}
+
+double RenderThread::waitMillis() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return waitMillis_;
+}
+
+void RenderThread::run() {
+    VulkanContextSingleton::threadContext = context;
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stopping || rendered < submitted; });
+        if (rendered == submitted) break;   // stopping, and everything submitted is rendered
+        FramePacket & packet = *packets[rendered % 2];
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        std::exception_ptr failure;
+        try {
+            render(packet);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        renderMillis_ = millis;
+        if (failure) {
+            error = failure;
+            // Drop what is queued: the game thread sees the error instead of waiting on it.
+            rendered = submitted;
+        } else {
+            ++rendered;
+        }
+        lock.unlock();
+        done.notify_all();
+        if (failure) break;
+    }
+    // submitAndWait (e.g. in a swapchain resize callback) keeps a fence per thread.
+    if (context) destroyThreadLocalSubmitFence(context->deviceHandle());
+}
@@ -10,6 +10,8 @@ ShaderBuilder& ShaderBuilder::mesh() { stage = VK_SHADER_STAGE_MESH_BIT_EXT; ret
 
 ShaderBuilder& ShaderBuilder::fromFile(const char * name) {
     fileName = name;
+    view = {};
+    if (g_context.current() && g_context().takePrefetchedFile(fileName, code)) return *this;
     std::ifstream file(name, std::ios::ate|std::ios::binary);
     if (!file.is_open()) throw std::runtime_error("failed to open shader file");
     size_t fileSize = (size_t)file.tellg();
@@ -21,11 +23,51 @@ ShaderBuilder& ShaderBuilder::fromFile(const char * name) {
 }
 
 ShaderBuilder& ShaderBuilder::fromBuffer(const uint8_t * data, size_t size) {
+    view = {};
     code.clear();
     code.insert(code.end(), data, data + size);
     return *this;
 }
 
+ShaderBuilder& ShaderBuilder::fromBuffer(std::span<const uint8_t> bytes) {
+    if (reinterpret_cast<uintptr_t>(bytes.data()) % alignof(uint32_t) != 0) {
+        return fromBuffer(bytes.data(), bytes.size());   // vkCreateShaderModule needs word alignment
+    }
+    code.clear();
+    view = bytes;
+    return *this;
+}
+
+ShaderBuilder& ShaderBuilder::fromGlsl(std::string_view source, const std::vector<ShaderDefine> & defines) {
+    GlslSource glsl;
+    glsl.stage = stage;
+    glsl.source = source;
+    if (!fileName.empty()) glsl.name = fileName;
+    glsl.defines = defines;
+    view = {};
+    code = glslCompiler().compile(glsl);
+    return *this;
+}
+
+ShaderBuilder& ShaderBuilder::fromGlslFile(const char * name, const std::vector<ShaderDefine> & defines) {
+    std::ifstream file(name, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error(std::string("failed to open shader source ") + name);
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    fileName = name;
+    return fromGlsl(source, defines);
+}
+
+std::span<const uint8_t> ShaderBuilder::bytes() const {
+    return view.empty() ? std::span<const uint8_t>(code) : view;
+}
+
+std::unique_ptr<ShaderModule> embeddedComputeShader(const uint32_t * words, size_t byteCount, const char * name) {
+    ShaderBuilder builder;
+    builder.compute().fromBuffer(reinterpret_cast<const uint8_t *>(words), byteCount);
+    builder.fileName = name;
+    return std::make_unique<ShaderModule>(builder);
+}
+
 // --- SPIR-V reflection ---
 
 static uint32_t spirvTypeSize(uint32_t typeId,
@@ -57,7 +99,7 @@ static VkShaderStageFlagBits executionModelToStage(uint32_t model) {
     }
 }
 
-static ShaderReflection parseSpirv(const std::vector<uint8_t> & code) {
+static ShaderReflection parseSpirv(std::span<const uint8_t> code) {
     ShaderReflection r;
     if (code.size() < 20) return r;
 
@@ -72,6 +114,8 @@ static ShaderReflection parseSpirv(const std::vector<uint8_t> & code) {
     std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> matrixTypes; // id -> (colId, count)
     std::unordered_map<uint32_t, std::vector<uint32_t>> structMembers;       // id -> member type ids
     std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> pointerTypes; // id -> (storageClass, typeId)
+    std::unordered_map<uint32_t, uint32_t> arrayElements;      // array / runtime array id -> element type
+    std::unordered_map<uint32_t, VkDescriptorType> opaqueTypes; // image / sampler / AS id -> descriptor type
 
     // variable info
     struct VarInfo { uint32_t typeId; uint32_t storageClass; };
@@ -82,6 +126,14 @@ static ShaderReflection parseSpirv(const std::vector<uint8_t> & code) {
     std::unordered_map<uint32_t, uint32_t> bindingDecos;      // id -> binding
     std::unordered_map<uint32_t, uint32_t> descriptorSetDecos; // id -> set
     std::set<uint32_t> builtinIds;
+    std::set<uint32_t> bufferBlockIds;                         // pre-1.3 SPIR-V storage buffer structs
+
+    // workgroup size from (spec) constants: local_size_*_id, which overrides LocalSize
+    std::unordered_map<uint32_t, uint32_t> scalarConstants;    // OpConstant / OpSpecConstant id -> value
+    std::unordered_map<uint32_t, std::vector<uint32_t>> compositeConstants; // id -> constituent ids
+    std::unordered_map<uint32_t, uint32_t> specIds;            // id -> SpecId
+    uint32_t workgroupSizeId = 0;                              // BuiltIn WorkgroupSize constant
+    std::array<uint32_t, 3> localSizeIds = {0, 0, 0};          // OpExecutionModeId LocalSizeId
 
     // member offsets: structId -> (member -> offset)
     std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> memberOffsets;
@@ -109,6 +161,23 @@ static ShaderReflection parseSpirv(const std::vector<uint8_t> & code) {
             }
             break;
         }
+        case 331: { // OpExecutionModeId
+            if (words[pos + 2] == 38 && wc >= 6) { // LocalSizeId
+                localSizeIds = { words[pos + 3], words[pos + 4], words[pos + 5] };
+            }
+            break;
+        }
+        case 43: // OpConstant
+        case 50: // OpSpecConstant
+            if (wc >= 4) scalarConstants[words[pos + 2]] = words[pos + 3];
+            break;
+        case 44: // OpConstantComposite
+        case 51: { // OpSpecConstantComposite
+            std::vector<uint32_t> constituents;
+            for (uint32_t i = 3; i < wc; ++i) constituents.push_back(words[pos + i]);
+            compositeConstants[words[pos + 2]] = constituents;
+            break;
+        }
         case 21: // OpTypeInt
         case 22: // OpTypeFloat
             scalarWidths[words[pos + 1]] = words[pos + 2];
@@ -119,6 +188,23 @@ static ShaderReflection parseSpirv(const std::vector<uint8_t> & code) {
         case 24: // OpTypeMatrix
             matrixTypes[words[pos + 1]] = { words[pos + 2], words[pos + 3] };
             break;
+        case 25: // OpTypeImage: Sampled operand is 1 (sampled) or 2 (storage)
+            opaqueTypes[words[pos + 1]] = words[pos + 7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+                                                               : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            break;
+        case 26: // OpTypeSampler
+            opaqueTypes[words[pos + 1]] = VK_DESCRIPTOR_TYPE_SAMPLER;
+            break;
+        case 27: // OpTypeSampledImage
+            opaqueTypes[words[pos + 1]] = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            break;
+        case 5341: // OpTypeAccelerationStructureKHR
+            opaqueTypes[words[pos + 1]] = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+            break;
+        case 28: // OpTypeArray
+        case 29: // OpTypeRuntimeArray
+            arrayElements[words[pos + 1]] = words[pos + 2];
+            break;
         case 30: { // OpTypeStruct
             std::vector<uint32_t> members;
             for (uint32_t i = 2; i < wc; ++i) members.push_back(words[pos + i]);
@@ -135,9 +221,12 @@ static ShaderReflection parseSpirv(const std::vector<uint8_t> & code) {
             uint32_t target = words[pos + 1];
             uint32_t deco = words[pos + 2];
             if (deco == 11) builtinIds.insert(target);          // BuiltIn
+            else if (deco == 3) bufferBlockIds.insert(target);  // BufferBlock
             else if (deco == 30 && wc >= 4) locationDecos[target] = words[pos + 3]; // Location
             else if (deco == 33 && wc >= 4) bindingDecos[target] = words[pos + 3];  // Binding
             else if (deco == 34 && wc >= 4) descriptorSetDecos[target] = words[pos + 3]; // DescriptorSet
+            else if (deco == 1 && wc >= 4) specIds[target] = words[pos + 3];   // SpecId
+            if (deco == 11 && wc >= 4 && words[pos + 3] == 25) workgroupSizeId = target; // BuiltIn WorkgroupSize
             break;
         }
         case 72: { // OpMemberDecorate
@@ -153,6 +242,17 @@ static ShaderReflection parseSpirv(const std::vector<uint8_t> & code) {
         pos += wc;
     }
 
+    // local_size_*_id: the LocalSizeId operands, or the WorkgroupSize composite in SPIR-V < 1.6
+    if (compositeConstants.count(workgroupSizeId) && compositeConstants[workgroupSizeId].size() == 3) {
+        const std::vector<uint32_t> & ids = compositeConstants[workgroupSizeId];
+        localSizeIds = { ids[0], ids[1], ids[2] };
+    }
+    for (uint32_t i = 0; i < 3; ++i) {
+        if (!scalarConstants.count(localSizeIds[i])) continue;
+        r.localSize[i] = scalarConstants[localSizeIds[i]];
+        if (specIds.count(localSizeIds[i])) r.localSizeSpecIds[i] = specIds[localSizeIds[i]];
+    }
+
     // find push constant struct and compute size
     for (auto & [varId, var] : variables) {
         if (var.storageClass != 9) continue; // PushConstant = 9
@@ -176,7 +276,20 @@ static ShaderReflection parseSpirv(const std::vector<uint8_t> & code) {
     for (auto & [varId, var] : variables) {
         if (builtinIds.count(varId)) continue;
         if (descriptorSetDecos.count(varId) && bindingDecos.count(varId)) {
-            r.descriptorBindings.insert({ descriptorSetDecos[varId], bindingDecos[varId] });
+            std::pair<uint32_t, uint32_t> key = { descriptorSetDecos[varId], bindingDecos[varId] };
+            r.descriptorBindings.insert(key);
+
+            // Descriptor type from the storage class and the (array element) pointee type.
+            uint32_t typeId = pointerTypes.count(var.typeId) ? pointerTypes[var.typeId].second : 0;
+            while (arrayElements.count(typeId)) typeId = arrayElements[typeId];
+            if (var.storageClass == 12) { // StorageBuffer
+                r.descriptorTypes[key] = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            } else if (var.storageClass == 2) { // Uniform: Block = uniform buffer, BufferBlock = storage
+                r.descriptorTypes[key] = bufferBlockIds.count(typeId) ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                                                                      : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            } else if (var.storageClass == 0 && opaqueTypes.count(typeId)) { // UniformConstant
+                r.descriptorTypes[key] = opaqueTypes[typeId];
+            }
         }
         if (locationDecos.count(varId)) {
             if (var.storageClass == 1) r.inputLocations.insert(locationDecos[varId]);   // Input
@@ -190,13 +303,21 @@ static ShaderReflection parseSpirv(const std::vector<uint8_t> & code) {
 ShaderModule::ShaderModule(ShaderBuilder & builder) {
     VkShaderModuleCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = builder.code.size();
-    createInfo.pCode = (uint32_t*)builder.code.data();
-    if (VK_SUCCESS != vkCreateShaderModule(g_context().device, &createInfo, nullptr, &module)) {
+    std::span<const uint8_t> code = builder.bytes();
+    // Reflect the module as written: optimization may drop bindings the shader never uses.
+    reflection = parseSpirv(code);
+    std::vector<uint8_t> optimized;
+    SpirvOptimizer & optimizer = g_context().shaderOptimizer();
+    if (optimizer.level() != SpirvOptimization::None) {
+        optimized = optimizer.optimize(code);
+        code = optimized;
+    }
+    createInfo.codeSize = code.size();
+    createInfo.pCode = (const uint32_t*)code.data();
+    if (VK_SUCCESS != vkCreateShaderModule(g_context().device, &createInfo, hostCallbacks(VK_OBJECT_TYPE_SHADER_MODULE), &module)) {
         throw std::runtime_error("failed to create shader module");
     }
     fileName = builder.fileName;
-    reflection = parseSpirv(builder.code);
 }
-ShaderModule::~ShaderModule() { vkDestroyShaderModule(g_context().device, module, nullptr); }
+ShaderModule::~ShaderModule() { vkDestroyShaderModule(g_context().device, module, hostCallbacks(VK_OBJECT_TYPE_SHADER_MODULE)); }
 ShaderModule::operator VkShaderModule() const { return module; }
@@ -0,0 +1,39 @@
+// Shared helpers for the IBL bake shaders (included by ibl_*.comp).
+
+const float PI = 3.14159265359;
+
+// Direction through texel `uv` (in [-1, 1]) of cube face `face` (+X, -X, +Y, -Y, +Z, -Z).
+vec3 cubeDirection(uint face, vec2 uv) {
+    switch (face) {
+    case 0u: return normalize(vec3( 1.0, -uv.y, -uv.x));
+    case 1u: return normalize(vec3(-1.0, -uv.y,  uv.x));
+    case 2u: return normalize(vec3( uv.x,  1.0,  uv.y));
+    case 3u: return normalize(vec3( uv.x, -1.0, -uv.y));
+    case 4u: return normalize(vec3( uv.x, -uv.y,  1.0));
+    default: return normalize(vec3(-uv.x, -uv.y, -1.0));
+    }
+}
+
+vec2 hammersley(uint i, uint count) {
+    uint bits = bitfieldReverse(i);
+    return vec2(float(i) / float(count), float(bits) * 2.3283064365386963e-10);
+}
+
+// GGX importance sample around N; returns the half vector.
+vec3 importanceSampleGGX(vec2 xi, vec3 N, float roughness) {
+    float a = roughness * roughness;
+    float phi = 2.0 * PI * xi.x;
+    float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (a * a - 1.0) * xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    vec3 H = vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+    vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
+    return normalize(tangent * H.x + bitangent * H.y + N * H.z);
+}
+
+float distributionGGX(float NdotH, float roughness) {
+    float a2 = roughness * roughness * roughness * roughness;
+    float d = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    return a2 / (PI * d * d);
+}
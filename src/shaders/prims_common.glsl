@@ -0,0 +1,90 @@
+// Shared helpers for the GpuPrimitives shaders (included by prims_*.comp, first thing after
+// #version). Every kernel is embedded twice: as-is, and with USE_SUBGROUPS defined for devices
+// whose compute stage supports subgroup arithmetic. The workgroup size is specialization
+// constant 0 and must be a power of two and a multiple of the subgroup size.
+
+#ifdef USE_SUBGROUPS
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#endif
+
+layout(constant_id = 0) const uint WG_SIZE = 256;
+layout(local_size_x_id = 0, local_size_y = 1, local_size_z = 1) in;
+
+// Elements per invocation in the block-based kernels (scan, radix sort).
+const uint ITEMS = 4u;
+const uint BLOCK = WG_SIZE * ITEMS;
+
+const uint NULL_RID = 0xFFFFFFFFu;
+
+layout(set = 0, binding = 0) buffer StorageBuffers { uint data[]; } buffers[];
+
+// Workgroup index of a possibly 2D grid (the host splits more than 65535 groups across y).
+uint groupIndex() {
+    return gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+}
+
+// Inclusive scan of one value per invocation across the workgroup; `total` receives the
+// workgroup sum. Every invocation must call it, in uniform control flow. The shared-memory
+// levels are Hillis-Steele (read, barrier, write) rather than an in-place Blelloch tree.
+shared uint scanShared[WG_SIZE];
+
+uint workgroupInclusiveScan(uint value, out uint total) {
+    uint t = gl_LocalInvocationIndex;
+#ifdef USE_SUBGROUPS
+    uint inclusive = subgroupInclusiveAdd(value);
+    if (gl_SubgroupInvocationID == gl_SubgroupSize - 1u) scanShared[gl_SubgroupID] = inclusive;
+    uint count = gl_NumSubgroups;
+#else
+    scanShared[t] = value;
+    uint count = WG_SIZE;
+#endif
+    barrier();
+    for (uint offset = 1u; offset < count; offset <<= 1) {
+        uint add = (t >= offset && t < count) ? scanShared[t - offset] : 0u;
+        barrier();
+        if (t < count) scanShared[t] += add;
+        barrier();
+    }
+#ifdef USE_SUBGROUPS
+    uint result = inclusive + (gl_SubgroupID > 0u ? scanShared[gl_SubgroupID - 1u] : 0u);
+#else
+    uint result = scanShared[t];
+#endif
+    total = scanShared[count - 1u];
+    barrier();
+    return result;
+}
+
+#ifdef PRIMS_SCAN4
+// uvec4 flavour, used by the radix sort to rank four packed digit counters at once. Opt-in
+// (define PRIMS_SCAN4 before the include) so other kernels do not reserve its shared memory.
+shared uvec4 scanShared4[WG_SIZE];
+
+uvec4 workgroupInclusiveScan4(uvec4 value, out uvec4 total) {
+    uint t = gl_LocalInvocationIndex;
+#ifdef USE_SUBGROUPS
+    uvec4 inclusive = subgroupInclusiveAdd(value);
+    if (gl_SubgroupInvocationID == gl_SubgroupSize - 1u) scanShared4[gl_SubgroupID] = inclusive;
+    uint count = gl_NumSubgroups;
+#else
+    scanShared4[t] = value;
+    uint count = WG_SIZE;
+#endif
+    barrier();
+    for (uint offset = 1u; offset < count; offset <<= 1) {
+        uvec4 add = (t >= offset && t < count) ? scanShared4[t - offset] : uvec4(0u);
+        barrier();
+        if (t < count) scanShared4[t] += add;
+        barrier();
+    }
+#ifdef USE_SUBGROUPS
+    uvec4 result = inclusive + (gl_SubgroupID > 0u ? scanShared4[gl_SubgroupID - 1u] : uvec4(0u));
+#else
+    uvec4 result = scanShared4[t];
+#endif
+    total = scanShared4[count - 1u];
+    barrier();
+    return result;
+}
+#endif
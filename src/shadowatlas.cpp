@@ -0,0 +1,159 @@
+#include "vkinternal.h"
+
+#include <algorithm>
+#include <bit>
+#include <numbers>
+#include <numeric>
+
+// --- ShadowAtlas ---
+
+namespace {
+
+constexpr uint32_t kTileFloats = 8;   // two vec4 per tile, see include/glsl/shadow_atlas.glsl
+
+bool powerOfTwo(uint32_t v) { return v != 0 && (v & (v - 1)) == 0; }
+
+// Every other bit of a Morton index, packed down.
+uint32_t compactBits(uint32_t v) {
+    v &= 0x55555555u;
+    v = (v | (v >> 1)) & 0x33333333u;
+    v = (v | (v >> 2)) & 0x0F0F0F0Fu;
+    v = (v | (v >> 4)) & 0x00FF00FFu;
+    v = (v | (v >> 8)) & 0x0000FFFFu;
+    return v;
+}
+
+} // namespace
+
+std::vector<ShadowTile> ShadowAtlas::layout(std::span<const float> importance, uint32_t atlasSize,
+                                            uint32_t maxTileSize, uint32_t minTileSize) {
+    size_t count = importance.size();
+    std::vector<ShadowTile> result(count);
+    if (count == 0) return result;
+
+    // Most important first; ties keep input order.
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return importance[a] > importance[b]; });
+
+    // Desired size: importance * maxTileSize rounded to the nearest power of two in log2.
+    uint64_t atlasArea = uint64_t(atlasSize) * atlasSize;
+    uint64_t area = 0;
+    std::vector<uint32_t> sizes(count);
+    for (size_t i = 0; i < count; ++i) {
+        float target = std::clamp(importance[i], 0.0f, 1.0f) * float(maxTileSize);
+        uint32_t size = target >= 1.0f ? std::bit_floor(uint32_t(target * std::numbers::sqrt2_v<float>)) : 1u;
+        sizes[i] = std::clamp(size, minTileSize, maxTileSize);
+        area += uint64_t(sizes[i]) * sizes[i];
+    }
+    // Over budget: halve tiles from the least important up, one step per pass, then drop lights.
+    while (area > atlasArea) {
+        bool shrunk = false;
+        for (size_t k = count; k-- > 0 && area > atlasArea;) {
+            uint32_t & size = sizes[order[k]];
+            if (size <= minTileSize) continue;
+            area -= uint64_t(size) * size * 3 / 4;
+            size /= 2;
+            shrunk = true;
+        }
+        if (!shrunk) break;
+    }
+    for (size_t k = count; k-- > 0 && area > atlasArea;) {
+        uint32_t & size = sizes[order[k]];
+        area -= uint64_t(size) * size;
+        size = 0;
+    }
+
+    // Power-of-two squares placed largest first along a Z-order curve of minTileSize cells
+    // never overlap and leave no gaps: each starts at a multiple of its own cell count.
+    std::vector<uint32_t> bySize = order;
+    std::stable_sort(bySize.begin(), bySize.end(), [&](uint32_t a, uint32_t b) { return sizes[a] > sizes[b]; });
+    uint32_t cursor = 0;
+    for (uint32_t light : bySize) {
+        uint32_t size = sizes[light];
+        if (size == 0) break;
+        result[light] = { compactBits(cursor) * minTileSize, compactBits(cursor >> 1) * minTileSize, size };
+        uint32_t cellsPerSide = size / minTileSize;
+        cursor += cellsPerSide * cellsPerSide;
+    }
+    return result;
+}
+
+ShadowAtlas::ShadowAtlas(Commands & cmd, uint32_t size, uint32_t maxTileSize, uint32_t minTileSize, uint32_t maxTiles)
+    : size_(size), maxTileSize(maxTileSize), minTileSize(minTileSize), maxTiles_(maxTiles) {
+    if (!powerOfTwo(size) || !powerOfTwo(maxTileSize) || !powerOfTwo(minTileSize) ||
+        minTileSize > maxTileSize || maxTileSize > size) {
+        throw std::runtime_error("ShadowAtlas sizes must be powers of two with minTileSize <= maxTileSize <= size");
+    }
+    if (maxTiles == 0) throw std::runtime_error("ShadowAtlas needs room for at least one tile");
+
+    size_t frames = g_context().swapchainImageCount;
+    atlases.reserve(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        ImageBuilder builder;
+        builder.depthSampled(size, size);
+        atlases.emplace_back(builder, cmd);
+
+        BufferBuilder tileBuilder(size_t(maxTiles) * kTileFloats * sizeof(float));
+        tileBuilder.storage().persistentlyMapped();
+        tileBuffers.push_back(std::make_unique<Buffer>(tileBuilder));
+    }
+    sampled.assign(frames, false);
+}
+
+std::span<const ShadowTile> ShadowAtlas::allocate(std::span<const float> importance) {
+    if (importance.size() > maxTiles_) throw std::runtime_error("ShadowAtlas: more lights than maxTiles");
+    Frame * frame = Frame::current();
+    slot = frame ? (uint32_t)(frame->inFlight() % atlases.size()) : 0;
+    tiles = layout(importance, size_, maxTileSize, minTileSize);
+
+    Buffer & buffer = *tileBuffers[slot];
+    float * out = static_cast<float *>(buffer.mappedData());
+    float texel = 1.0f / float(size_);
+    for (size_t i = 0; i < tiles.size(); ++i, out += kTileFloats) {
+        const ShadowTile & tile = tiles[i];
+        if (!tile.valid()) {
+            std::fill(out, out + kTileFloats, 0.0f);
+            continue;
+        }
+        float scale = float(tile.size) * texel;
+        float u = float(tile.x) * texel, v = float(tile.y) * texel;
+        float transformAndBounds[kTileFloats] = {
+            scale, scale, u, v,
+            u + 0.5f * texel, v + 0.5f * texel, u + scale - 0.5f * texel, v + scale - 0.5f * texel,
+        };
+        std::copy(transformAndBounds, transformAndBounds + kTileFloats, out);
+    }
+    buffer.flush(0, tiles.size() * kTileFloats * sizeof(float));
+    return tiles;
+}
+
+void ShadowAtlas::begin(Commands & cmd) {
+    Image & atlas = atlases[slot];
+    if (sampled[slot]) {
+        Barrier(cmd).image(atlas, 1)
+            .from(Stage::Fragment, Access::ShaderRead, Layout::DepthReadOnly)
+            .to(Stage::EarlyFragment | Stage::LateFragment, Access::DepthStencilWrite, Layout::DepthStencilAttachment)
+            .aspectMask(VK_IMAGE_ASPECT_DEPTH_BIT)
+            .record();
+        sampled[slot] = false;
+    }
+    cmd.beginRendering(atlas.imageView, {size_, size_});
+}
+
+void ShadowAtlas::setTile(Commands & cmd, uint32_t tile) {
+    if (tile >= tiles.size() || !tiles[tile].valid()) throw std::runtime_error("ShadowAtlas::setTile: tile has no space this frame");
+    const ShadowTile & t = tiles[tile];
+    cmd.setViewport(float(t.x), float(t.y), float(t.size), float(t.size));
+    cmd.setScissor(int32_t(t.x), int32_t(t.y), t.size, t.size);
+}
+
+void ShadowAtlas::end(Commands & cmd) {
+    cmd.endRendering();
+    Barrier(cmd).image(atlases[slot], 1)
+        .from(Stage::LateFragment, Access::DepthStencilWrite, Layout::DepthStencilAttachment)
+        .to(Stage::Fragment, Access::ShaderRead, Layout::DepthReadOnly)
+        .aspectMask(VK_IMAGE_ASPECT_DEPTH_BIT)
+        .record();
+    sampled[slot] = true;
+}
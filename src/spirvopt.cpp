@@ -0,0 +1,317 @@
+#include "vkinternal.h"
+#include "pipelinecache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#if VKOBJECTS_SPIRV_TOOLS
+#include <spirv-tools/libspirv.h>
+#include <spirv-tools/optimizer.hpp>
+#endif
+
+// --- SPIR-V strip pass ---
+
+namespace {
+
+constexpr uint32_t kSpirvMagic = 0x07230203u;
+constexpr uint32_t kSpirvHeaderWords = 5;
+// Bumped when the strip pass or the recipes change, so cached results are rebuilt.
+constexpr uint32_t kOptimizerVersion = 2;
+
+enum : uint32_t {
+    OpSourceContinued = 2,
+    OpSource = 3,
+    OpSourceExtension = 4,
+    OpName = 5,
+    OpMemberName = 6,
+    OpString = 7,
+    OpLine = 8,
+    OpExtension = 10,
+    OpExtInstImport = 11,
+    OpExtInst = 12,
+    OpEntryPoint = 15,
+    OpTypeVoid = 19,
+    OpTypeForwardPointer = 39,
+    OpFunction = 54,
+    OpFunctionEnd = 56,
+    OpFunctionCall = 57,
+    OpDecorate = 71,
+    OpMemberDecorate = 72,
+    OpDecorationGroup = 73,
+    OpGroupDecorate = 74,
+    OpLabel = 248,
+    OpNoLine = 317,
+    OpModuleProcessed = 330,
+    OpDecorateId = 332,
+    OpDecorateString = 5632,
+    OpMemberDecorateString = 5633,
+};
+
+// A literal string operand starting at word `first` of an instruction `count` words long.
+std::string literalString(const uint32_t * inst, uint32_t first, uint32_t count) {
+    std::string out;
+    for (uint32_t w = first; w < count; ++w) {
+        for (int b = 0; b < 4; ++b) {
+            char c = char((inst[w] >> (8 * b)) & 0xFF);
+            if (c == 0) return out;
+            out += c;
+        }
+    }
+    return out;
+}
+
+// Words a literal string operand starting at word `first` occupies, terminator included.
+uint32_t literalWords(const uint32_t * inst, uint32_t first, uint32_t count) {
+    for (uint32_t w = first; w < count; ++w) {
+        for (int b = 0; b < 4; ++b) {
+            if (((inst[w] >> (8 * b)) & 0xFF) == 0) return w - first + 1;
+        }
+    }
+    return count - first;
+}
+
+// Word of the result id `op` defines, or 0 for none: 1 for types, labels and the like, 2 after
+// a result type. Covers what appears in function bodies and among types, constants and globals.
+uint32_t resultWord(uint32_t op) {
+    switch (op) {
+        case OpLabel: case OpString: case OpExtInstImport: case OpDecorationGroup:
+        case 322: case 327: case 4456: case 4472: case 5281: case 5341: case 5358:   // OpType* outside 19-39
+            return 1;
+        case 0: case OpSourceContinued: case OpSource: case OpSourceExtension: case OpName: case OpMemberName:
+        case OpLine: case OpExtension: case 14: case OpEntryPoint: case 16: case 17: case OpFunctionEnd:
+        case 62: case 63: case 64: case OpDecorate: case OpMemberDecorate: case OpGroupDecorate: case 75:
+        case 99: case 218: case 219: case 220: case 221: case 224: case 225: case 228: case 246: case 247:
+        case 249: case 250: case 251: case 252: case 253: case 254: case 255: case 256: case 257:
+        case 280: case 281: case 287: case 288: case 294: case 297: case 298: case 301: case 302:
+        case OpNoLine: case 319: case 329: case OpModuleProcessed: case 331: case OpDecorateId:
+        case 4416: case 4445: case 4446: case 4448: case 4449: case 4458: case 4473: case 4474: case 4475:
+        case 4476: case 5294: case 5295: case 5299: case 5337: case 5344: case 5360: case 5364: case 5365:
+        case 5380: case 5630: case OpDecorateString: case OpMemberDecorateString:
+            return 0;
+    }
+    return op >= OpTypeVoid && op <= OpTypeForwardPointer ? 1 : 2;
+}
+
+std::vector<uint8_t> toBytes(const std::vector<uint32_t> & words) {
+    std::vector<uint8_t> out(words.size() * sizeof(uint32_t));
+    std::memcpy(out.data(), words.data(), out.size());
+    return out;
+}
+
+} // namespace
+
+std::vector<uint8_t> stripSpirv(std::span<const uint8_t> spirv) {
+    std::vector<uint8_t> unchanged(spirv.begin(), spirv.end());
+    if (spirv.size() < kSpirvHeaderWords * 4 || spirv.size() % 4 != 0) return unchanged;
+    std::vector<uint32_t> words(spirv.size() / 4);
+    std::memcpy(words.data(), spirv.data(), spirv.size());
+    if (words[0] != kSpirvMagic) return unchanged;
+
+    // First pass: instruction boundaries, NonSemantic sets, entry points, the call graph, and
+    // the result ids each function defines.
+    std::vector<size_t> starts;
+    std::unordered_set<uint32_t> nonSemanticSets;
+    std::vector<uint32_t> roots;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> callees;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> definedIn;
+    std::unordered_set<uint32_t> definedOutside;
+    uint32_t function = 0;
+    for (size_t pos = kSpirvHeaderWords; pos < words.size();) {
+        uint32_t count = words[pos] >> 16;
+        uint32_t op = words[pos] & 0xFFFF;
+        if (count == 0 || pos + count > words.size()) return unchanged;
+        const uint32_t * inst = &words[pos];
+        uint32_t result = resultWord(op);
+        if (result != 0 && result < count) {
+            if (function != 0 || op == OpFunction) {
+                definedIn[op == OpFunction ? inst[2] : function].push_back(inst[result]);
+            } else {
+                definedOutside.insert(inst[result]);
+            }
+        }
+        if (op == OpExtInstImport && count > 2 && literalString(inst, 2, count).starts_with("NonSemantic.")) {
+            nonSemanticSets.insert(inst[1]);
+        } else if (op == OpEntryPoint && count > 2) {
+            roots.push_back(inst[2]);
+        } else if (op == OpFunction && count > 2) {
+            function = inst[2];
+            callees[function];
+        } else if (op == OpFunctionEnd) {
+            function = 0;
+        } else if (op == OpFunctionCall && count > 3) {
+            callees[function].push_back(inst[3]);
+        }
+        starts.push_back(pos);
+        pos += count;
+    }
+
+    // Without entry points (a library module) every function counts as reachable.
+    std::unordered_set<uint32_t> reachable;
+    if (roots.empty()) {
+        for (auto & entry : callees) reachable.insert(entry.first);
+    }
+    while (!roots.empty()) {
+        uint32_t id = roots.back();
+        roots.pop_back();
+        if (!reachable.insert(id).second) continue;
+        for (uint32_t callee : callees[id]) roots.push_back(callee);
+    }
+
+    // Ids whose only definition is in a removed function: their decorations, group-decoration
+    // targets and entry-point interface entries go too, or they would name undefined ids. An id
+    // also defined outside (only possible if resultWord misreads an operand) is kept.
+    std::unordered_set<uint32_t> removedIds;
+    for (auto & [fn, ids] : definedIn) {
+        if (reachable.count(fn)) continue;
+        for (uint32_t id : ids) {
+            if (!definedOutside.count(id)) removedIds.insert(id);
+        }
+    }
+    auto removed = [&](uint32_t id) { return removedIds.count(id) != 0; };
+
+    std::vector<uint32_t> out(words.begin(), words.begin() + kSpirvHeaderWords);
+    out.reserve(words.size());
+    bool skippingFunction = false;
+    for (size_t pos : starts) {
+        uint32_t count = words[pos] >> 16;
+        uint32_t op = words[pos] & 0xFFFF;
+        const uint32_t * inst = &words[pos];
+        bool drop = false;
+        switch (op) {
+            case OpSourceContinued: case OpSource: case OpSourceExtension: case OpName: case OpMemberName:
+            case OpString: case OpLine: case OpNoLine: case OpModuleProcessed:
+                drop = true;
+                break;
+            case OpExtension:
+                drop = literalString(inst, 1, count) == "SPV_KHR_non_semantic_info";
+                break;
+            case OpExtInstImport:
+                drop = nonSemanticSets.count(inst[1]) != 0;
+                break;
+            case OpExtInst:
+                drop = count > 3 && nonSemanticSets.count(inst[3]) != 0;
+                break;
+            case OpFunction:
+                skippingFunction = count > 2 && reachable.count(inst[2]) == 0;
+                break;
+            case OpDecorate: case OpMemberDecorate: case OpDecorateId: case OpDecorateString: case OpMemberDecorateString:
+                // Decorations of removed functions (e.g. LinkageAttributes) and of their locals.
+                drop = count > 1 && removed(inst[1]);
+                break;
+            case OpGroupDecorate: case OpEntryPoint: {
+                // Keep the instruction, minus targets or interface ids that were removed.
+                uint32_t first = op == OpGroupDecorate ? 2 : 3 + literalWords(inst, 3, count);
+                std::vector<uint32_t> kept(inst, inst + std::min(first, count));
+                for (uint32_t w = first; w < count; ++w) {
+                    if (!removed(inst[w])) kept.push_back(inst[w]);
+                }
+                if (kept.size() == count) break;
+                kept[0] = (uint32_t(kept.size()) << 16) | op;
+                if (!skippingFunction) out.insert(out.end(), kept.begin(), kept.end());
+                drop = true;
+                break;
+            }
+        }
+        if (skippingFunction) {
+            if (op == OpFunctionEnd) skippingFunction = false;
+            continue;
+        }
+        if (!drop) out.insert(out.end(), inst, inst + count);
+    }
+    return toBytes(out);
+}
+
+// --- SpirvOptimizer ---
+
+#if VKOBJECTS_SPIRV_TOOLS
+
+namespace {
+
+// The SPIRV-Tools recipe for `level`, or the input when the optimizer rejects the module.
+std::vector<uint8_t> runRecipe(std::span<const uint8_t> spirv, SpirvOptimization level, bool verbose) {
+    std::vector<uint32_t> words(spirv.size() / 4);
+    std::memcpy(words.data(), spirv.data(), words.size() * 4);
+    if (words.size() < kSpirvHeaderWords || words[0] != kSpirvMagic) return std::vector<uint8_t>(spirv.begin(), spirv.end());
+    // SPIR-V 1.6 needs the Vulkan 1.3 environment; glslc --target-env=vulkan1.2 emits 1.5.
+    spvtools::Optimizer optimizer(words[1] >= 0x00010600 ? SPV_ENV_VULKAN_1_3 : SPV_ENV_VULKAN_1_2);
+    std::string messages;
+    optimizer.SetMessageConsumer([&](spv_message_level_t, const char *, const spv_position_t &, const char * message) {
+        messages += message;
+        messages += '\n';
+    });
+    if (level == SpirvOptimization::Size) {
+        optimizer.RegisterSizePasses();
+    } else {
+        optimizer.RegisterPerformancePasses();
+    }
+    std::vector<uint32_t> optimized;
+    if (!optimizer.Run(words.data(), words.size(), &optimized)) {
+        if (verbose) std::cerr << "[spirvopt] optimizer failed, using the module as given: " << messages;
+        return std::vector<uint8_t>(spirv.begin(), spirv.end());
+    }
+    return toBytes(optimized);
+}
+
+} // namespace
+
+bool SpirvOptimizer::toolsAvailable() { return true; }
+
+#else
+
+bool SpirvOptimizer::toolsAvailable() { return false; }
+
+#endif
+
+SpirvOptimizer::SpirvOptimizer(SpirvOptimization level, std::string cacheDir, bool verbose)
+    : level_(level), dir_(std::move(cacheDir)), verbose_(verbose) {}
+
+uint64_t SpirvOptimizer::cacheKey(std::span<const uint8_t> spirv) const {
+    std::vector<uint8_t> key;
+    auto put = [&](uint64_t v) { for (int i = 0; i < 8; ++i) key.push_back(uint8_t(v >> (8 * i))); };
+    put(kOptimizerVersion);
+    put(uint64_t(level_));
+#if VKOBJECTS_SPIRV_TOOLS
+    std::string tools = spvSoftwareVersionString();
+    put(vkobjects::fnv1a64(reinterpret_cast<const uint8_t *>(tools.data()), tools.size()));
+#endif
+    put(spirv.size());
+    put(vkobjects::fnv1a64(spirv.data(), spirv.size()));
+    return vkobjects::fnv1a64(key.data(), key.size());
+}
+
+std::string SpirvOptimizer::path(uint64_t key) const {
+    if (dir_.empty()) return {};
+    char name[40];
+    std::snprintf(name, sizeof(name), "spvopt_%016llx.bin", (unsigned long long)key);
+    return (std::filesystem::path(dir_) / name).string();
+}
+
+std::vector<uint8_t> SpirvOptimizer::optimize(std::span<const uint8_t> spirv) {
+    if (level_ == SpirvOptimization::None) return std::vector<uint8_t>(spirv.begin(), spirv.end());
+    uint64_t key = dir_.empty() ? 0 : cacheKey(spirv);
+    if (!dir_.empty()) {
+        std::vector<uint8_t> cached = readSpirvCacheEntry(path(key), key);
+        if (!cached.empty()) {
+            ++hits_;
+            return cached;
+        }
+    }
+    ++misses_;
+    std::vector<uint8_t> out;
+#if VKOBJECTS_SPIRV_TOOLS
+    if (level_ != SpirvOptimization::Strip) out = runRecipe(spirv, level_, verbose_);
+#endif
+    out = stripSpirv(out.empty() ? spirv : std::span<const uint8_t>(out));
+    if (!dir_.empty()) {
+        bool written = writeSpirvCacheEntry(path(key), key, out, verbose_);
+        if (verbose_) {
+            std::cerr << "[spirvopt] " << (written ? "wrote " : "write failed: ") << path(key) << " ("
+                      << spirv.size() << " -> " << out.size() << " B)\n";
+        }
+    }
+    return out;
+}
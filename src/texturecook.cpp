@@ -0,0 +1,453 @@
+#include "vkinternal.h"
+#include "pipelinecache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VKOBJECTS_COOK_SSE2 1
+#endif
+
+// --- Cooked textures ---
+//
+// File layout (little-endian):
+//   0   header: magic, version, VkFormat, width, height, mip count (u32 each), file size (u64)
+//   32  mip table: mip count x { offset u64, size u64 }
+//   ..  mips, largest first, each at a 16-byte aligned offset (a multiple of every texel block
+//       size we write, as vkCmdCopyBufferToImage requires), rows tightly packed
+// Mips are filtered from the previous level in linear float, then quantized to 8-bit BGRA
+// (sRGB-encoded for sRGB formats) and optionally BC-compressed. Every pass splits its rows
+// across JobSystem jobs; each row is written by one job, so the output does not depend on the
+// thread count.
+
+namespace {
+
+constexpr uint32_t kCookMagic = 0x58544B56u;   // 'VKTX'
+constexpr uint32_t kCookVersion = 1u;
+constexpr size_t kCookHeaderSize = 32;
+constexpr size_t kMipEntrySize = 16;
+constexpr size_t kMipAlignment = 16;
+
+uint32_t mipCount(uint32_t width, uint32_t height) {
+    return uint32_t(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+uint32_t mipDim(uint32_t base, uint32_t level) { return std::max(1u, base >> level); }
+
+VkFormat cookedFormat(TextureCompression compression, bool srgb) {
+    switch (compression) {
+    case TextureCompression::BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case TextureCompression::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    default: return srgb ? VK_FORMAT_B8G8R8A8_SRGB : VK_FORMAT_B8G8R8A8_UNORM;
+    }
+}
+
+// Bytes per 4x4 block for BC formats, 0 for B8G8R8A8; false when the format is not one we cook.
+bool blockBytes(VkFormat format, uint32_t & bytes) {
+    switch (format) {
+    case VK_FORMAT_B8G8R8A8_SRGB: case VK_FORMAT_B8G8R8A8_UNORM: bytes = 0; return true;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK: case VK_FORMAT_BC1_RGB_UNORM_BLOCK: bytes = 8; return true;
+    case VK_FORMAT_BC3_SRGB_BLOCK: case VK_FORMAT_BC3_UNORM_BLOCK: bytes = 16; return true;
+    default: return false;
+    }
+}
+
+size_t mipBytes(uint32_t blockSize, uint32_t w, uint32_t h) {
+    if (blockSize == 0) return size_t(w) * h * 4;
+    return size_t((w + 3) / 4) * ((h + 3) / 4) * blockSize;
+}
+
+// Runs fn(begin, end) over [0, rows) as jobs, a few chunks per thread so stealing can even
+// out uneven rows. Small levels are not worth splitting below 8 rows.
+template <typename Fn>
+void parallelRows(JobSystem & jobs, uint32_t rows, Fn && fn) {
+    uint32_t grain = std::max(8u, rows / (jobs.concurrency() * 4));
+    jobs.parallelFor(rows, grain, fn);
+}
+
+// One BGRA texel in linear float. The filters only add and scale texels, which SSE2 does for
+// all four channels at once.
+struct alignas(16) Texel {
+    float c[4];
+};
+
+#if VKOBJECTS_COOK_SSE2
+inline void accumulate(Texel & acc, const Texel & x, float w) {
+    _mm_store_ps(acc.c, _mm_add_ps(_mm_load_ps(acc.c), _mm_mul_ps(_mm_load_ps(x.c), _mm_set1_ps(w))));
+}
+inline Texel average4(const Texel & a, const Texel & b, const Texel & c, const Texel & d) {
+    __m128 sum = _mm_add_ps(_mm_add_ps(_mm_load_ps(a.c), _mm_load_ps(b.c)),
+                            _mm_add_ps(_mm_load_ps(c.c), _mm_load_ps(d.c)));
+    Texel t;
+    _mm_store_ps(t.c, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+    return t;
+}
+#else
+inline void accumulate(Texel & acc, const Texel & x, float w) {
+    for (int i = 0; i < 4; ++i) acc.c[i] += x.c[i] * w;
+}
+inline Texel average4(const Texel & a, const Texel & b, const Texel & c, const Texel & d) {
+    Texel t;
+    for (int i = 0; i < 4; ++i) t.c[i] = (a.c[i] + b.c[i] + c.c[i] + d.c[i]) * 0.25f;
+    return t;
+}
+#endif
+
+struct Level {
+    uint32_t width = 0, height = 0;
+    std::vector<Texel> texels;
+};
+
+float srgbToLinear(float s) {
+    return s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+}
+float linearToSrgb(float l) {
+    return l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+}
+
+void downsampleBox(const Level & src, Level & dst, JobSystem & jobs) {
+    parallelRows(jobs, dst.height, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; ++y) {
+            uint32_t y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+            const Texel * r0 = &src.texels[size_t(y0) * src.width];
+            const Texel * r1 = &src.texels[size_t(y1) * src.width];
+            for (uint32_t x = 0; x < dst.width; ++x) {
+                uint32_t x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+                dst.texels[size_t(y) * dst.width + x] = average4(r0[x0], r0[x1], r1[x0], r1[x1]);
+            }
+        }
+    });
+}
+
+// Taps for one destination texel along one axis: weights for source texels first..first+n-1,
+// clamped to the edge.
+struct Taps {
+    int first;
+    std::vector<float> weights;
+};
+
+float besselI0(float x) {
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 20; ++k) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+std::vector<Taps> kaiserTaps(uint32_t srcSize, uint32_t dstSize) {
+    constexpr float kRadius = 3.0f;   // in destination texels
+    constexpr float kBeta = 4.0f;
+    const float pi = 3.14159265358979f;
+    float scale = float(srcSize) / float(dstSize);
+    float norm = besselI0(kBeta);
+    std::vector<Taps> taps(dstSize);
+    for (uint32_t x = 0; x < dstSize; ++x) {
+        float center = (float(x) + 0.5f) * scale;
+        int first = int(std::floor(center - kRadius * scale));
+        int last = int(std::ceil(center + kRadius * scale));
+        taps[x].first = first;
+        float sum = 0.0f;
+        for (int i = first; i <= last; ++i) {
+            float t = (float(i) + 0.5f - center) / scale;
+            float r = t / kRadius;
+            float w = 0.0f;
+            if (std::fabs(r) < 1.0f) {
+                float sinc = t == 0.0f ? 1.0f : std::sin(pi * t) / (pi * t);
+                w = sinc * besselI0(kBeta * std::sqrt(1.0f - r * r)) / norm;
+            }
+            taps[x].weights.push_back(w);
+            sum += w;
+        }
+        for (float & w : taps[x].weights) w /= sum;
+    }
+    return taps;
+}
+
+void downsampleKaiser(const Level & src, Level & dst, JobSystem & jobs) {
+    std::vector<Taps> columns = kaiserTaps(src.width, dst.width);
+    std::vector<Taps> rows = kaiserTaps(src.height, dst.height);
+    auto clampIndex = [](int i, uint32_t size) { return uint32_t(std::clamp(i, 0, int(size) - 1)); };
+
+    // Horizontal pass: src.height rows of dst.width texels.
+    std::vector<Texel> wide(size_t(dst.width) * src.height);
+    parallelRows(jobs, src.height, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; ++y) {
+            const Texel * row = &src.texels[size_t(y) * src.width];
+            for (uint32_t x = 0; x < dst.width; ++x) {
+                Texel acc = {};
+                const Taps & t = columns[x];
+                for (size_t k = 0; k < t.weights.size(); ++k) {
+                    accumulate(acc, row[clampIndex(t.first + int(k), src.width)], t.weights[k]);
+                }
+                wide[size_t(y) * dst.width + x] = acc;
+            }
+        }
+    });
+    // Vertical pass. Negative lobes can overshoot; quantization clamps.
+    parallelRows(jobs, dst.height, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; ++y) {
+            const Taps & t = rows[y];
+            Texel * out = &dst.texels[size_t(y) * dst.width];
+            for (uint32_t x = 0; x < dst.width; ++x) out[x] = Texel{};
+            for (size_t k = 0; k < t.weights.size(); ++k) {
+                const Texel * in = &wide[size_t(clampIndex(t.first + int(k), src.height)) * dst.width];
+                for (uint32_t x = 0; x < dst.width; ++x) accumulate(out[x], in[x], t.weights[k]);
+            }
+        }
+    });
+}
+
+void quantize(const Level & level, bool srgb, std::vector<uint8_t> & bgra, JobSystem & jobs) {
+    bgra.resize(level.texels.size() * 4);
+    parallelRows(jobs, level.height, [&](uint32_t begin, uint32_t end) {
+        for (size_t i = size_t(begin) * level.width; i < size_t(end) * level.width; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                float v = std::clamp(level.texels[i].c[c], 0.0f, 1.0f);
+                if (srgb && c < 3) v = linearToSrgb(v);
+                bgra[i * 4 + c] = uint8_t(std::lround(v * 255.0f));
+            }
+        }
+    });
+}
+
+// --- BC1 / BC3 block encoders ---
+
+uint16_t to565(const int bgr[3]) {
+    return uint16_t(((bgr[2] * 31 + 127) / 255) << 11 | ((bgr[1] * 63 + 127) / 255) << 5 | ((bgr[0] * 31 + 127) / 255));
+}
+void from565(uint16_t c, int bgr[3]) {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    bgr[0] = (b << 3) | (b >> 2);
+    bgr[1] = (g << 2) | (g >> 4);
+    bgr[2] = (r << 3) | (r >> 2);
+}
+
+// 16 texels, row-major BGRA8. Bounding-box endpoints inset by 1/16, with the box diagonal
+// flipped to follow the sign of the red/green and red/blue covariance.
+void encodeColorBlock(const uint8_t block[64], uint8_t out[8]) {
+    int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0}, mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            lo[c] = std::min(lo[c], int(block[i * 4 + c]));
+            hi[c] = std::max(hi[c], int(block[i * 4 + c]));
+            mean[c] += block[i * 4 + c];
+        }
+    }
+    int covRG = 0, covRB = 0;
+    for (int i = 0; i < 16; ++i) {
+        int r = block[i * 4 + 2] * 16 - mean[2];
+        covRG += r * (block[i * 4 + 1] * 16 - mean[1]);
+        covRB += r * (block[i * 4 + 0] * 16 - mean[0]);
+    }
+    if (covRG < 0) std::swap(lo[1], hi[1]);
+    if (covRB < 0) std::swap(lo[0], hi[0]);
+    for (int c = 0; c < 3; ++c) {
+        int inset = (hi[c] - lo[c]) / 16;
+        hi[c] -= inset;
+        lo[c] += inset;
+    }
+
+    uint16_t c0 = to565(hi), c1 = to565(lo);
+    if (c0 < c1) std::swap(c0, c1);
+    int palette[4][3];
+    from565(c0, palette[0]);
+    from565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestError = INT32_MAX;
+            for (int p = 0; p < 4; ++p) {
+                int error = 0;
+                for (int c = 0; c < 3; ++c) {
+                    int d = int(block[i * 4 + c]) - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError) { bestError = error; best = p; }
+            }
+            indices |= uint32_t(best) << (2 * i);
+        }
+    }
+    out[0] = uint8_t(c0); out[1] = uint8_t(c0 >> 8);
+    out[2] = uint8_t(c1); out[3] = uint8_t(c1 >> 8);
+    vkobjects::put32(out + 4, indices);
+}
+
+// BC3 alpha: min/max endpoints in the eight-value mode.
+void encodeAlphaBlock(const uint8_t block[64], uint8_t out[8]) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        a0 = std::max(a0, int(block[i * 4 + 3]));
+        a1 = std::min(a1, int(block[i * 4 + 3]));
+    }
+    int palette[8] = {a0, a1};
+    for (int i = 2; i < 8; ++i) palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestError = INT32_MAX;
+            for (int p = 0; p < 8; ++p) {
+                int error = std::abs(int(block[i * 4 + 3]) - palette[p]);
+                if (error < bestError) { bestError = error; best = p; }
+            }
+            indices |= uint64_t(best) << (3 * i);
+        }
+    }
+    out[0] = uint8_t(a0);
+    out[1] = uint8_t(a1);
+    for (int i = 0; i < 6; ++i) out[2 + i] = uint8_t(indices >> (8 * i));
+}
+
+void compress(const std::vector<uint8_t> & bgra, uint32_t w, uint32_t h, uint32_t blockSize,
+              uint8_t * out, JobSystem & jobs) {
+    uint32_t blocksX = (w + 3) / 4, blocksY = (h + 3) / 4;
+    parallelRows(jobs, blocksY, [&](uint32_t begin, uint32_t end) {
+        uint8_t block[64];
+        for (uint32_t by = begin; by < end; ++by) {
+            for (uint32_t bx = 0; bx < blocksX; ++bx) {
+                // Edge blocks replicate the last row/column.
+                for (uint32_t i = 0; i < 16; ++i) {
+                    uint32_t x = std::min(bx * 4 + i % 4, w - 1), y = std::min(by * 4 + i / 4, h - 1);
+                    std::memcpy(block + i * 4, &bgra[(size_t(y) * w + x) * 4], 4);
+                }
+                uint8_t * dst = out + (size_t(by) * blocksX + bx) * blockSize;
+                if (blockSize == 16) {
+                    encodeAlphaBlock(block, dst);
+                    encodeColorBlock(block, dst + 8);
+                } else {
+                    encodeColorBlock(block, dst);
+                }
+            }
+        }
+    });
+}
+
+} // namespace
+
+std::vector<uint8_t> cookTexture(const uint8_t * bgra, uint32_t width, uint32_t height,
+                                 const TextureCookOptions & options) {
+    if (width == 0 || height == 0) throw std::runtime_error("cookTexture: empty image");
+    // threads = 0 borrows the context's workers when there is a context; an explicit count (or
+    // no context, as in vkobjects-cook) gets a JobSystem of its own for this call.
+    std::unique_ptr<JobSystem> ownJobs;
+    if (options.threads || !g_context.current()) {
+        uint32_t threads = options.threads ? options.threads : JobSystem::defaultWorkerCount() + 1;
+        ownJobs = std::make_unique<JobSystem>(threads - 1);
+    }
+    JobSystem & jobs = ownJobs ? *ownJobs : g_context().jobs();
+    VkFormat format = cookedFormat(options.compression, options.srgb);
+    uint32_t blockSize = 0;
+    blockBytes(format, blockSize);
+    uint32_t mips = mipCount(width, height);
+
+    std::vector<size_t> offsets(mips), sizes(mips);
+    size_t fileSize = vkobjects::alignUp(kCookHeaderSize + mips * kMipEntrySize, kMipAlignment);
+    for (uint32_t m = 0; m < mips; ++m) {
+        offsets[m] = fileSize;
+        sizes[m] = mipBytes(blockSize, mipDim(width, m), mipDim(height, m));
+        fileSize = vkobjects::alignUp(fileSize + sizes[m], kMipAlignment);
+    }
+
+    std::vector<uint8_t> out(fileSize, 0);
+    vkobjects::put32(out.data(), kCookMagic);
+    vkobjects::put32(out.data() + 4, kCookVersion);
+    vkobjects::put32(out.data() + 8, uint32_t(format));
+    vkobjects::put32(out.data() + 12, width);
+    vkobjects::put32(out.data() + 16, height);
+    vkobjects::put32(out.data() + 20, mips);
+    vkobjects::put64(out.data() + 24, fileSize);
+    for (uint32_t m = 0; m < mips; ++m) {
+        vkobjects::put64(out.data() + kCookHeaderSize + m * kMipEntrySize, offsets[m]);
+        vkobjects::put64(out.data() + kCookHeaderSize + m * kMipEntrySize + 8, sizes[m]);
+    }
+
+    std::vector<float> decode(256);
+    for (int i = 0; i < 256; ++i) decode[i] = options.srgb ? srgbToLinear(i / 255.0f) : i / 255.0f;
+
+    Level level;
+    level.width = width;
+    level.height = height;
+    level.texels.resize(size_t(width) * height);
+    parallelRows(jobs, height, [&](uint32_t begin, uint32_t end) {
+        for (size_t i = size_t(begin) * width; i < size_t(end) * width; ++i) {
+            for (int c = 0; c < 3; ++c) level.texels[i].c[c] = decode[bgra[i * 4 + c]];
+            level.texels[i].c[3] = bgra[i * 4 + 3] / 255.0f;
+        }
+    });
+
+    std::vector<uint8_t> quantized;
+    for (uint32_t m = 0; m < mips; ++m) {
+        if (m > 0) {
+            Level next;
+            next.width = mipDim(width, m);
+            next.height = mipDim(height, m);
+            next.texels.resize(size_t(next.width) * next.height);
+            if (options.filter == MipFilter::Kaiser) downsampleKaiser(level, next, jobs);
+            else downsampleBox(level, next, jobs);
+            level = std::move(next);
+        }
+        if (m == 0) {
+            // Mip 0 is the source itself; requantizing would only add rounding.
+            quantized.assign(bgra, bgra + size_t(width) * height * 4);
+        } else {
+            quantize(level, options.srgb, quantized, jobs);
+        }
+        if (blockSize == 0) {
+            std::memcpy(out.data() + offsets[m], quantized.data(), sizes[m]);
+        } else {
+            compress(quantized, level.width, level.height, blockSize, out.data() + offsets[m], jobs);
+        }
+    }
+    return out;
+}
+
+CookedTexture::CookedTexture(std::span<const uint8_t> file) {
+    auto fail = [](const char * why) { throw std::runtime_error(std::string("malformed cooked texture: ") + why); };
+    if (file.size() < kCookHeaderSize) fail("truncated header");
+    const uint8_t * p = file.data();
+    if (vkobjects::get32(p) != kCookMagic) fail("bad magic");
+    if (vkobjects::get32(p + 4) != kCookVersion) fail("unsupported version");
+    format = VkFormat(vkobjects::get32(p + 8));
+    uint32_t blockSize = 0;
+    if (!blockBytes(format, blockSize)) fail("unsupported format");
+    extent = { vkobjects::get32(p + 12), vkobjects::get32(p + 16) };
+    if (extent.width == 0 || extent.height == 0) fail("empty image");
+    mipLevels = vkobjects::get32(p + 20);
+    if (mipLevels == 0 || mipLevels > mipCount(extent.width, extent.height)) fail("bad mip count");
+    if (vkobjects::get64(p + 24) != file.size()) fail("file size does not match header");
+    if (kCookHeaderSize + size_t(mipLevels) * kMipEntrySize > file.size()) fail("mip table past end of file");
+    byteSize = file.size();
+
+    regions.resize(mipLevels);
+    for (uint32_t m = 0; m < mipLevels; ++m) {
+        uint64_t offset = vkobjects::get64(p + kCookHeaderSize + m * kMipEntrySize);
+        uint64_t size = vkobjects::get64(p + kCookHeaderSize + m * kMipEntrySize + 8);
+        uint32_t w = mipDim(extent.width, m), h = mipDim(extent.height, m);
+        if (offset % kMipAlignment != 0) fail("misaligned mip");
+        if (size != mipBytes(blockSize, w, h)) fail("mip size does not match its extent");
+        if (offset > file.size() || size > file.size() - offset) fail("mip past end of file");
+
+        VkBufferImageCopy & region = regions[m];
+        region = {};
+        region.bufferOffset = offset;
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, m, 0, 1 };
+        region.imageExtent = { w, h, 1 };
+    }
+}
+
+Image loadCookedTexture(Commands & cmd, std::span<const uint8_t> file) {
+    CookedTexture texture(file);
+    BufferBuilder builder(texture.byteSize);
+    builder.transferSource().persistentlyMapped();
+    Buffer staging(builder);
+    std::memcpy(staging.mappedData(), file.data(), file.size());
+    staging.flush();
+    return Image(ImageBuilder().fromCookedTexture(staging, texture), cmd);
+}
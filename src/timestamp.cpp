@@ -12,7 +12,7 @@ TimestampQuery::TimestampQuery(uint32_t queryCount, uint32_t frameCount)
     ci.queryType = VK_QUERY_TYPE_TIMESTAMP;
     ci.queryCount = queryCount;
     for (uint32_t i = 0; i < frameCount; ++i) {
-        if (vkCreateQueryPool(g_context().device, &ci, nullptr, &pools[i]) != VK_SUCCESS) {
+        if (vkCreateQueryPool(g_context().device, &ci, hostCallbacks(VK_OBJECT_TYPE_QUERY_POOL), &pools[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create timestamp query pool");
         }
     }
@@ -21,7 +21,7 @@ TimestampQuery::TimestampQuery(uint32_t queryCount, uint32_t frameCount)
 TimestampQuery::~TimestampQuery() {
     for (auto pool : pools) {
         if (pool != VK_NULL_HANDLE)
-            vkDestroyQueryPool(g_context().device, pool, nullptr);
+            vkDestroyQueryPool(g_context().device, pool, hostCallbacks(VK_OBJECT_TYPE_QUERY_POOL));
     }
 }
 
@@ -57,6 +57,8 @@ float TimestampQuery::nanosPerTick() const {
 GpuTimer::GpuTimer(uint32_t maxSegments, uint32_t frameCount)
     : query(maxSegments + 1, frameCount), frame(0), next(0) {
     labels.reserve(maxSegments);
+    ticks.resize(maxSegments + 1);
+    results.reserve(maxSegments);
 }
 
 void GpuTimer::begin(Commands & cmd, uint32_t frameIndex) {
@@ -72,14 +74,12 @@ void GpuTimer::mark(Commands & cmd, const char * label) {
     labels.push_back(label);
 }
 
-std::vector<std::pair<std::string, double>> GpuTimer::resolve() {
-    std::vector<std::pair<std::string, double>> out;
-    if (labels.empty()) return out;
-    uint32_t count = next;
-    std::vector<uint64_t> ticks(count);
-    if (!query.read(frame, ticks.data(), count)) return out;
+const std::vector<std::pair<const char *, double>> & GpuTimer::resolve() {
+    results.clear();
+    if (labels.empty()) return results;
+    if (!query.read(frame, ticks.data(), next)) return results;
     double npt = double(query.nanosPerTick());
     for (size_t i = 0; i < labels.size(); ++i)
-        out.emplace_back(labels[i], double(ticks[i + 1] - ticks[i]) * npt * 1e-6);
-    return out;
+        results.emplace_back(labels[i], double(ticks[i + 1] - ticks[i]) * npt * 1e-6);
+    return results;
 }
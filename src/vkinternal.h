@@ -3,31 +3,128 @@
 
 #include "vkobjects.h"
 #include "vk_mem_alloc.h"
+#include <atomic>
 #include <tuple>
 
 extern VkFormat depthFormat;
-extern VmaAllocator g_allocator;
 
 VkSampleCountFlagBits getSampleBits(uint32_t sampleCount);
 VkCommandBuffer createCommandBuffer(VkDevice device, VkCommandPool commandPool);
 VkSampler createSampler(VkDevice device);
 VkSampler createNearestSampler(VkDevice device);
 VkSampler createShadowSampler(VkDevice device);
-VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags imageAspects, size_t mipLevelCount);
+VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags imageAspects, size_t mipLevelCount, uint32_t layerCount = 1);
 void recordMipmapGeneration(VkCommandBuffer commandBuffer, VkImage image, int width, int height, size_t mipLevelCount);
 void recordCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 void createSwapChain(VulkanContext & context, VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice device, VkSwapchainKHR& outSwapChain);
 void getSwapChainImageHandles(VkDevice device, VkSwapchainKHR chain, std::vector<VkImage>& outImageHandles);
 void makeChainImageViews(VkDevice device, VkFormat colorFormat, std::vector<VkImage> & images, std::vector<VkImageView> & imageViews);
 void destroyThreadLocalSubmitFence(VkDevice device);
+// Compute module from SPIR-V embedded at build time (src/shaders, glslc -mfmt=c); `name` labels errors.
+std::unique_ptr<ShaderModule> embeddedComputeShader(const uint32_t * words, size_t byteCount, const char * name);
+// ShaderBuilder::fromGlsl's compiler: the calling thread's context's glsl(), or an uncached one.
+GlslCompiler & glslCompiler();
+// Content-addressed SPIR-V cache files shared by GlslCompiler and SpirvOptimizer. Reading
+// returns empty for a missing, corrupt or foreign entry; writing is atomic and best-effort.
+std::vector<uint8_t> readSpirvCacheEntry(const std::string & path, uint64_t key);
+bool writeSpirvCacheEntry(const std::string & path, uint64_t key, std::span<const uint8_t> spirv, bool verbose);
+
+// VkAllocationCallbacks the library passes when creating/destroying an object of `type` on the
+// calling thread's context: its HostAllocator (VulkanContextOptions::trackHostAllocations),
+// otherwise nullptr. The constructor binds the context first, so startup helpers use it too.
+// Code that holds its context passes context.allocationCallbacks(type) instead.
+const VkAllocationCallbacks * hostCallbacks(VkObjectType type);
+
+// Issues vkQueuePresentKHR for Frame::submit on a dedicated thread
+// (VulkanContextOptions::presentThread). The frame thread is the only producer and the present
+// thread the only consumer of a small single-producer/single-consumer ring; both sides block with
+// std::atomic::wait rather than a lock. Frame() drain()s before acquiring, so at most one present
+// is in flight and swapchain recreation stays on the frame thread.
+class PresentThread {
+public:
+    explicit PresentThread(VulkanContext & context);
+    PresentThread(const PresentThread &) = delete;
+    PresentThread & operator=(const PresentThread &) = delete;
+    // Drains, then joins.
+    ~PresentThread();
+
+    // Frame thread only.
+    void push(uint32_t imageIndex, VkSemaphore waitSemaphore);
+    // Blocks until every pushed present has been issued. Throws if one failed outright.
+    void drain();
+    // True once if a present reported VK_ERROR_OUT_OF_DATE_KHR or VK_SUBOPTIMAL_KHR.
+    bool takeStale() { return stale.exchange(false, std::memory_order_acq_rel); }
+
+private:
+    struct Request {
+        uint32_t imageIndex;
+        VkSemaphore waitSemaphore;
+    };
+    static constexpr uint32_t kCapacity = 4;
+    static constexpr uint32_t kStop = UINT32_MAX;
+
+    VulkanContext & context;
+    std::array<Request, kCapacity> ring;
+    std::atomic<uint32_t> head{0};   // next request to present; written by the present thread
+    std::atomic<uint32_t> tail{0};   // next free slot; written by the frame thread
+    std::atomic<bool> stale{false};
+    std::atomic<int32_t> failure{VK_SUCCESS};
+    std::thread thread;
+
+    void run();
+};
+
+// Counting VkAllocationCallbacks, one set per object type so that pUserData tells the
+// callbacks which type an allocation belongs to (the callbacks themselves only see the scope).
+// Every block carries a small header with its size, type and scope, so frees and
+// reallocations are attributed without a lookup. Command-scope blocks optionally come from
+// per-thread size-class free lists (VulkanContextOptions::poolCommandAllocations).
+class HostAllocator {
+public:
+    explicit HostAllocator(bool poolCommandScope);
+    HostAllocator(const HostAllocator &) = delete;
+    HostAllocator & operator=(const HostAllocator &) = delete;
+    ~HostAllocator();
+
+    // Stable for the allocator's lifetime; unknown types share one "other" set.
+    const VkAllocationCallbacks * callbacks(VkObjectType type);
+    HostAllocationReport report() const;
+
+    struct Counters {
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> reallocations{0};
+        std::atomic<uint64_t> frees{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<int64_t> liveBytes{0};
+        std::atomic<int64_t> peakLiveBytes{0};
+        std::atomic<uint64_t> internalAllocations{0};
+        std::atomic<int64_t> internalLiveBytes{0};
+    };
+    struct Category {
+        HostAllocator * owner;
+        uint16_t index;
+        VkObjectType type;
+        VkAllocationCallbacks callbacks;
+        std::array<Counters, 5> scopes;   // by VkSystemAllocationScope
+        std::atomic<uint64_t> firstUse{0};   // order of first allocation, 0 = unused
+    };
+
+private:
+    static void * VKAPI_PTR allocate(void * user, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static void * VKAPI_PTR reallocate(void * user, void * original, size_t size, size_t alignment,
+                                       VkSystemAllocationScope scope);
+    static void VKAPI_PTR free(void * user, void * memory);
+    static void VKAPI_PTR internalAllocate(void * user, size_t size, VkInternalAllocationType,
+                                           VkSystemAllocationScope scope);
+    static void VKAPI_PTR internalFree(void * user, size_t size, VkInternalAllocationType,
+                                       VkSystemAllocationScope scope);
+
+    void * allocateBlock(Category & category, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void freeBlock(void * memory);
+
+    const bool poolCommandScope;
+    std::vector<std::unique_ptr<Category>> categories;
+    std::atomic<uint64_t> firstUseCounter{0};
+    std::atomic<uint64_t> pooled{0};
+};
 
-// Loaded function pointers (set by VulkanContext constructor)
-extern PFN_vkCmdDrawMeshTasksEXT vkCmdDrawMeshTasks;
-extern PFN_vkCmdDrawMeshTasksIndirectEXT vkCmdDrawMeshTasksIndirect;
-extern PFN_vkCmdBeginRendering vkBeginRendering;
-extern PFN_vkCmdEndRendering vkEndRendering;
-extern PFN_vkGetAccelerationStructureBuildSizesKHR rtGetAccelerationStructureBuildSizes;
-extern PFN_vkCreateAccelerationStructureKHR rtCreateAccelerationStructure;
-extern PFN_vkDestroyAccelerationStructureKHR rtDestroyAccelerationStructure;
-extern PFN_vkCmdBuildAccelerationStructuresKHR rtCmdBuildAccelerationStructures;
-extern PFN_vkGetAccelerationStructureDeviceAddressKHR rtGetAccelerationStructureDeviceAddress;
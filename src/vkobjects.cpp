@@ -13,6 +13,8 @@
 #include <cmath>
 #include <cstring>
 #include <atomic>
+#include <chrono>
+#include <algorithm>
 
 void destroyThreadLocalSubmitFence(VkDevice device);
 
@@ -27,16 +29,6 @@ VkFormat surfaceFormat = VK_FORMAT_B8G8R8A8_SRGB;
 VkColorSpaceKHR colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
 VkFormat depthFormat = VK_FORMAT_D32_SFLOAT_S8_UINT;
 
-PFN_vkCmdDrawMeshTasksEXT vkCmdDrawMeshTasks;
-PFN_vkCmdDrawMeshTasksIndirectEXT vkCmdDrawMeshTasksIndirect;
-PFN_vkCmdBeginRendering vkBeginRendering;
-PFN_vkCmdEndRendering vkEndRendering;
-PFN_vkGetAccelerationStructureBuildSizesKHR rtGetAccelerationStructureBuildSizes;
-PFN_vkCreateAccelerationStructureKHR rtCreateAccelerationStructure;
-PFN_vkDestroyAccelerationStructureKHR rtDestroyAccelerationStructure;
-PFN_vkCmdBuildAccelerationStructuresKHR rtCmdBuildAccelerationStructures;
-PFN_vkGetAccelerationStructureDeviceAddressKHR rtGetAccelerationStructureDeviceAddress;
-
 VulkanContextOptions::VulkanContextOptions() :
     enableMultisampling(false),
     multisampleCount(1),
@@ -47,7 +39,16 @@ VulkanContextOptions::VulkanContextOptions() :
     enableVerbose(false),
     enableGpuAssistedValidation(true),
     enableImmediateDestroy(false),
-    enableRayTracing(false) {}
+    enableRayTracing(false),
+    enableUniformBuffers(false),
+    destroyBudgetItems(0),
+    destroyBudgetMillis(0.0),
+    jobWorkerCount(kAutoJobWorkers),
+    enablePresentThread(false),
+    enableHostAllocationTracking(false),
+    enableCommandScopePool(false),
+    offscreenExtent{1, 1},
+    shaderOptimization(SpirvOptimization::None) {}
 VulkanContextOptions & VulkanContextOptions::pipelineCache(const std::string & dir) {
     pipelineCacheDir = dir;
     return *this;
@@ -65,6 +66,10 @@ VulkanContextOptions & VulkanContextOptions::rayTracing() {
     enableRayTracing = true;
     return *this;
 }
+VulkanContextOptions & VulkanContextOptions::uniformBuffers() {
+    enableUniformBuffers = true;
+    return *this;
+}
 VulkanContextOptions & VulkanContextOptions::validation() {
     enableValidationLayers = true;
     return *this;
@@ -92,54 +97,161 @@ VulkanContextOptions & VulkanContextOptions::immediateDestroy(bool v) {
     enableImmediateDestroy = v;
     return *this;
 }
+VulkanContextOptions & VulkanContextOptions::prefetchFiles(std::vector<std::string> paths) {
+    prefetchPaths = std::move(paths);
+    return *this;
+}
+VulkanContextOptions & VulkanContextOptions::destroyBudget(uint32_t maxItems, double maxMillis) {
+    if (maxMillis < 0.0) {
+        throw std::runtime_error("invalid destroy budget");
+    }
+    destroyBudgetItems = maxItems;
+    destroyBudgetMillis = maxMillis;
+    return *this;
+}
+VulkanContextOptions & VulkanContextOptions::jobWorkers(uint32_t count) {
+    jobWorkerCount = count;
+    return *this;
+}
+VulkanContextOptions & VulkanContextOptions::presentThread(bool enable) {
+    enablePresentThread = enable;
+    return *this;
+}
+VulkanContextOptions & VulkanContextOptions::trackHostAllocations(bool enable) {
+    enableHostAllocationTracking = enable;
+    if (!enable) enableCommandScopePool = false;
+    return *this;
+}
+VulkanContextOptions & VulkanContextOptions::poolCommandAllocations(bool enable) {
+    enableCommandScopePool = enable;
+    if (enable) enableHostAllocationTracking = true;
+    return *this;
+}
+VulkanContextOptions & VulkanContextOptions::offscreenSize(uint32_t width, uint32_t height) {
+    if (width == 0 || height == 0) throw std::runtime_error("invalid offscreen size");
+    offscreenExtent = {width, height};
+    return *this;
+}
+VulkanContextOptions & VulkanContextOptions::glslCache(const std::string & dir) {
+    glslCacheDir = dir;
+    return *this;
+}
+VulkanContextOptions & VulkanContextOptions::optimizeShaders(SpirvOptimization level, const std::string & cacheDir) {
+    shaderOptimization = level;
+    shaderOptimizationCacheDir = cacheDir;
+    return *this;
+}
+
+thread_local VulkanContext * VulkanContextSingleton::threadContext = nullptr;
+
+VulkanContext * VulkanContextSingleton::current() const {
+    return threadContext ? threadContext : contextInstance.load(std::memory_order_acquire);
+}
 
-VulkanContext & VulkanContextSingleton::operator()() { return *contextInstance; }
+VulkanContext & VulkanContextSingleton::operator()() {
+    VulkanContext * context = current();
+    if (!context) throw std::runtime_error("no VulkanContext: none is bound to this thread and none is alive");
+    return *context;
+}
 
 VulkanContextSingleton g_context;
-VmaAllocator g_allocator = VK_NULL_HANDLE;
+
+ContextScope::ContextScope(VulkanContext & context) : previous(VulkanContextSingleton::threadContext) {
+    VulkanContextSingleton::threadContext = &context;
+}
+
+ContextScope::~ContextScope() {
+    VulkanContextSingleton::threadContext = previous;
+}
 
 // --- DestroyGeneration ---
 
 void DestroyGeneration::destroy() {
-    struct VulkanContext & context = g_context();
+    destroy(0, 0.0);
+}
+
+DestroyStats DestroyGeneration::destroy(uint32_t maxItems, double maxMillis) {
+    if (pending() == 0) return {};
+    // Generations belong to the context bound to this thread (its Frame, flushDestroys, or its
+    // destructor).
+    VulkanContext & context = g_context();
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&] {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
     for (uint32_t rid : storageBufferRIDs) context.bindlessTable.releaseStorageBuffer(rid);
     storageBufferRIDs.clear();
     for (uint32_t rid : samplerRIDs) context.bindlessTable.releaseSampler(rid);
     samplerRIDs.clear();
     for (uint32_t rid : storageImageRIDs) context.bindlessTable.releaseStorageImage(rid);
     storageImageRIDs.clear();
-    for (VkPipeline p : pipelines) {
-        context.pipelines.erase(p);
-        vkDestroyPipeline(context.device, p, nullptr);
-    }
-    pipelines.clear();
-    for (VkSampler s : samplers) {
-        vkDestroySampler(context.device, s, nullptr);
-    }
-    samplers.clear();
     for (uint32_t rid : tlasRIDs) context.bindlessTable.releaseTlas(rid);
     tlasRIDs.clear();
-    for (VkAccelerationStructureKHR as : accelStructures) {
-        rtDestroyAccelerationStructure(context.device, as, nullptr);
-    }
-    accelStructures.clear();
-    for (VkImageView v : imageViews) {
-        vkDestroyImageView(context.device, v, nullptr);
-    }
-    imageViews.clear();
-    for (auto & [img, alloc] : imageAllocations) {
-        vmaDestroyImage(g_allocator, img, alloc);
-    }
-    imageAllocations.clear();
-    for (auto & [buf, alloc] : bufferAllocations) {
-        vmaDestroyBuffer(g_allocator, buf, alloc);
-    }
-    bufferAllocations.clear();
-    if (!commandBuffers.empty()) {
-        vkFreeCommandBuffers(context.device, context.commandPool, commandBuffers.size(), commandBuffers.data());
-        commandBuffers.clear();
-    }
+    for (uint32_t rid : uniformBufferRIDs) context.bindlessTable.releaseUniformBuffer(rid);
+    uniformBufferRIDs.clear();
+
+    // Oldest first (append() adds at the back), so nothing starves under sustained load. The
+    // first handle is freed whatever the budget, so the queue always shrinks.
+    uint32_t destroyed = 0;
+    auto overBudget = [&] {
+        if (destroyed == 0) return false;
+        return (maxItems > 0 && destroyed >= maxItems) || (maxMillis > 0.0 && elapsedMs() >= maxMillis);
+    };
+    auto drain = [&](auto & items, auto && destroyOne) {
+        size_t done = 0;
+        while (done < items.size() && !overBudget()) {
+            destroyOne(items[done++]);
+            ++destroyed;
+        }
+        items.erase(items.begin(), items.begin() + done);
+    };
+    drain(pipelines, [&](VkPipeline p) {
+        {
+            std::lock_guard<std::mutex> lock(context.destroyMutex);
+            context.pipelines.erase(p);
+        }
+        vkDestroyPipeline(context.device, p, context.allocationCallbacks(VK_OBJECT_TYPE_PIPELINE));
+    });
+    drain(samplers, [&](VkSampler s) { vkDestroySampler(context.device, s, context.allocationCallbacks(VK_OBJECT_TYPE_SAMPLER)); });
+    drain(accelStructures, [&](VkAccelerationStructureKHR as) {
+        context.rtDestroyAccelerationStructure(context.device, as, context.allocationCallbacks(VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR));
+    });
+    drain(imageViews, [&](VkImageView v) { vkDestroyImageView(context.device, v, context.allocationCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW)); });
+    drain(imageAllocations, [&](auto & entry) { vmaDestroyImage(context.allocator, entry.first, entry.second); });
+    drain(bufferAllocations, [&](auto & entry) { vmaDestroyBuffer(context.allocator, entry.first, entry.second); });
+    drain(commandBuffers, [&](VkCommandBuffer cb) {
+        vkFreeCommandBuffers(context.device, context.commandPool, 1, &cb);
+    });
+
+    return {destroyed, static_cast<uint32_t>(pending()), elapsedMs()};
+}
+
+void DestroyGeneration::append(DestroyGeneration & other) {
+    auto moveAll = [](auto & dst, auto & src) {
+        dst.insert(dst.end(), src.begin(), src.end());
+        src.clear();
+    };
+    moveAll(bufferAllocations, other.bufferAllocations);
+    moveAll(imageAllocations, other.imageAllocations);
+    moveAll(commandBuffers, other.commandBuffers);
+    moveAll(imageViews, other.imageViews);
+    moveAll(samplers, other.samplers);
+    moveAll(accelStructures, other.accelStructures);
+    moveAll(storageBufferRIDs, other.storageBufferRIDs);
+    moveAll(samplerRIDs, other.samplerRIDs);
+    moveAll(storageImageRIDs, other.storageImageRIDs);
+    moveAll(tlasRIDs, other.tlasRIDs);
+    moveAll(uniformBufferRIDs, other.uniformBufferRIDs);
+    moveAll(pipelines, other.pipelines);
 }
+
+size_t DestroyGeneration::pending() const {
+    return bufferAllocations.size() + imageAllocations.size() + commandBuffers.size() +
+        imageViews.size() + samplers.size() + accelStructures.size() + storageBufferRIDs.size() +
+        samplerRIDs.size() + storageImageRIDs.size() + tlasRIDs.size() + uniformBufferRIDs.size() + pipelines.size();
+}
+
 DestroyGeneration::~DestroyGeneration() {
     destroy();
 }
@@ -175,17 +287,18 @@ VkCommandBuffer createCommandBuffer(VkDevice device, VkCommandPool commandPool)
 // --- Instance & Device Setup ---
 
 void getAvailableVulkanExtensions(SDL_Window * window, std::vector<std::string>& outExtensions) {
+    outExtensions.clear();
+    if (window == nullptr) return;   // offscreen: no surface extensions
+
     uint32_t extensionCount = 0;
     const char * const * extensionNames = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
     if (extensionNames == nullptr) {
         throw std::runtime_error("unable to query vulkan extension count");
     }
 
-    outExtensions.clear();
     for (uint32_t i = 0; i < extensionCount; i++) {
         outExtensions.emplace_back(extensionNames[i]);
     }
-    (void)window;
 }
 
 std::vector<std::string> getRequestedLayerNames(VulkanContextOptions & options) {
@@ -256,7 +369,7 @@ void createVulkanInstance(const std::vector<std::string> & layerNames, const std
     instanceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     instanceCreateInfo.ppEnabledExtensionNames = extensions.data();
 
-    VkResult result = vkCreateInstance(&instanceCreateInfo, nullptr, &outInstance);
+    VkResult result = vkCreateInstance(&instanceCreateInfo, hostCallbacks(VK_OBJECT_TYPE_INSTANCE), &outInstance);
     if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to create vulkan instance (VkResult " + std::to_string(result) + ")");
     }
@@ -328,7 +441,7 @@ void setupDebugMessenger(VkInstance instance, VulkanContextOptions* opts, VkDebu
     auto createMessenger = (PFN_vkCreateDebugUtilsMessengerEXT)
         vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
 
-    if (createMessenger == nullptr || createMessenger(instance, &createInfo, nullptr, &messenger) != VK_SUCCESS) {
+    if (createMessenger == nullptr || createMessenger(instance, &createInfo, hostCallbacks(VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT), &messenger) != VK_SUCCESS) {
         throw std::runtime_error("failed to set up debug messenger");
     }
 }
@@ -353,6 +466,28 @@ VkPhysicalDeviceMeshShaderPropertiesEXT getMeshShaderProperties(VkPhysicalDevice
     return meshShaderProperties;
 }
 
+void getSubgroupProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceSubgroupProperties & outSubgroup,
+                           VkPhysicalDeviceSubgroupSizeControlProperties & outSizeControl, bool verbose) {
+    outSizeControl = {};
+    outSizeControl.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_PROPERTIES;
+    outSubgroup = {};
+    outSubgroup.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    outSubgroup.pNext = &outSizeControl;
+
+    VkPhysicalDeviceProperties2 deviceProperties2 = {};
+    deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    deviceProperties2.pNext = &outSubgroup;
+
+    vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties2);
+    outSubgroup.pNext = nullptr;
+    outSizeControl.pNext = nullptr;
+
+    if (verbose) {
+        std::cout << "subgroup size: " << outSubgroup.subgroupSize << " (" << outSizeControl.minSubgroupSize << "-"
+                  << outSizeControl.maxSubgroupSize << ")" << std::endl;
+    }
+}
+
 void selectGPU(VkInstance instance, VkPhysicalDevice & outDevice, unsigned int & outQueueFamilyIndex, uint32_t & outMaxSamples, VkPhysicalDeviceLimits & outLimits, bool verbose) {
     uint32_t count = 0;
     if (VK_SUCCESS != vkEnumeratePhysicalDevices(instance, &count, nullptr)) {
@@ -410,7 +545,7 @@ void selectGPU(VkInstance instance, VkPhysicalDevice & outDevice, unsigned int &
     outQueueFamilyIndex = queueNodeIndex;
 }
 
-VkDevice createLogicalDevice(VulkanContextOptions & options, VkPhysicalDevice& physicalDevice, uint32_t queueFamilyIndex) {
+VkDevice createLogicalDevice(VulkanContextOptions & options, VkPhysicalDevice& physicalDevice, uint32_t queueFamilyIndex, bool presentable) {
     uint32_t devicePropertyCount(0);
     if (VK_SUCCESS != vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &devicePropertyCount, NULL)) {
         throw std::runtime_error("Unable to acquire device extension property count");
@@ -423,7 +558,10 @@ VkDevice createLogicalDevice(VulkanContextOptions & options, VkPhysicalDevice& p
     }
 
     std::vector<const char*> devicePropertyNames;
-    std::set<std::string> requiredExtensionNames{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    std::set<std::string> requiredExtensionNames;
+    if (presentable) {
+        requiredExtensionNames.emplace(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
     if (options.enableMeshShaders) {
         requiredExtensionNames.emplace(VK_EXT_MESH_SHADER_EXTENSION_NAME);
@@ -464,6 +602,12 @@ VkDevice createLogicalDevice(VulkanContextOptions & options, VkPhysicalDevice& p
 
     void* previousInChain = nullptr;
 
+    // Vulkan 1.1 features: multiview for layered (cascade / cube) single-pass rendering
+    VkPhysicalDeviceVulkan11Features device11Features = {};
+    device11Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    device11Features.multiview = VK_TRUE;
+    previousInChain = &device11Features;
+
     // Vulkan 1.2 features: descriptor indexing for bindless
     VkPhysicalDeviceVulkan12Features device12Features = {};
     device12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
@@ -478,6 +622,22 @@ VkDevice createLogicalDevice(VulkanContextOptions & options, VkPhysicalDevice& p
     device12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
     device12Features.descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
     device12Features.bufferDeviceAddress = options.enableRayTracing ? VK_TRUE : VK_FALSE;
+    if (options.enableUniformBuffers) {
+        // Bindless binding 4. Non-uniform indexing is optional: RIDs from push constants are
+        // dynamically uniform, which only needs shaderUniformBufferArrayDynamicIndexing.
+        VkPhysicalDeviceVulkan12Features supported = {};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 query = {};
+        query.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        query.pNext = &supported;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &query);
+        if (!supported.descriptorBindingUniformBufferUpdateAfterBind || !query.features.shaderUniformBufferArrayDynamicIndexing) {
+            throw std::runtime_error("uniformBuffers() requires descriptorBindingUniformBufferUpdateAfterBind and shaderUniformBufferArrayDynamicIndexing");
+        }
+        device12Features.descriptorBindingUniformBufferUpdateAfterBind = VK_TRUE;
+        device12Features.shaderUniformBufferArrayNonUniformIndexing = supported.shaderUniformBufferArrayNonUniformIndexing;
+    }
+    device12Features.pNext = previousInChain;
     previousInChain = &device12Features;
 
     // Vulkan 1.3 features: dynamic rendering and synchronization2
@@ -493,6 +653,16 @@ VkDevice createLogicalDevice(VulkanContextOptions & options, VkPhysicalDevice& p
     meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
     meshShaderFeatures.taskShader = VK_TRUE;
     meshShaderFeatures.meshShader = VK_TRUE;
+    if (options.enableMeshShaders) {
+        // multiviewMeshShader is optional; enable it only where the driver reports it.
+        VkPhysicalDeviceMeshShaderFeaturesEXT supported = {};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+        VkPhysicalDeviceFeatures2 query = {};
+        query.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        query.pNext = &supported;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &query);
+        meshShaderFeatures.multiviewMeshShader = supported.multiviewMeshShader;
+    }
     meshShaderFeatures.pNext = previousInChain;
 
     if (options.enableMeshShaders) {
@@ -527,6 +697,7 @@ VkDevice createLogicalDevice(VulkanContextOptions & options, VkPhysicalDevice& p
     deviceFeatures2.features.shaderInt64 = VK_TRUE;
     deviceFeatures2.features.shaderFloat64 = VK_TRUE;
     deviceFeatures2.features.fragmentStoresAndAtomics = VK_TRUE;
+    deviceFeatures2.features.shaderUniformBufferArrayDynamicIndexing = options.enableUniformBuffers ? VK_TRUE : VK_FALSE;
     deviceFeatures2.pNext = previousInChain;
     if (options.shaderSampleRateShading > 0.0f) {
         deviceFeatures2.features.sampleRateShading = VK_TRUE;
@@ -544,7 +715,7 @@ VkDevice createLogicalDevice(VulkanContextOptions & options, VkPhysicalDevice& p
     deviceCreateInfo.flags = 0;
 
     VkDevice device;
-    if (VK_SUCCESS != vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device)) {
+    if (VK_SUCCESS != vkCreateDevice(physicalDevice, &deviceCreateInfo, hostCallbacks(VK_OBJECT_TYPE_DEVICE), &device)) {
         throw std::runtime_error("failed to create logical device!");
     }
 
@@ -555,7 +726,7 @@ VkDevice createLogicalDevice(VulkanContextOptions & options, VkPhysicalDevice& p
 
 VkSurfaceKHR createSurface(SDL_Window* window, VkInstance instance, VkPhysicalDevice gpu, uint32_t graphicsFamilyQueueIndex) {
     VkSurfaceKHR surface;
-    if (false == SDL_Vulkan_CreateSurface(window, instance, nullptr, &surface)) {
+    if (false == SDL_Vulkan_CreateSurface(window, instance, hostCallbacks(VK_OBJECT_TYPE_SURFACE_KHR), &surface)) {
         throw std::runtime_error("Unable to create Vulkan compatible surface using SDL: " + std::string(SDL_GetError()));
     }
     VkBool32 supported = false;
@@ -620,6 +791,8 @@ bool getImageUsage(const VkSurfaceCapabilitiesKHR& capabilities, VkImageUsageFla
     if (image_usage != desiredImageUsage) {
         return false;
     }
+    // Optional: lets FrameCapture copy the swapchain image out.
+    foundUsages |= capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
     return true;
 }
 
@@ -684,6 +857,8 @@ void createSwapChain(VulkanContext & context, VkSurfaceKHR surface, VkPhysicalDe
         throw std::runtime_error("failed to get surface format");
     }
     context.colorFormat = imageFormat.format;
+    context.swapchainUsage = usageFlags;
+    context.swapchainImageExtent = swap_image_extent;
 
     VkSwapchainKHR oldSwapChain = outSwapChain;
 
@@ -703,12 +878,12 @@ void createSwapChain(VulkanContext & context, VkSurfaceKHR surface, VkPhysicalDe
     swapInfo.clipped = true;
     swapInfo.oldSwapchain = NULL;
 
-    if (VK_SUCCESS != vkCreateSwapchainKHR(device, &swapInfo, nullptr, &outSwapChain)) {
+    if (VK_SUCCESS != vkCreateSwapchainKHR(device, &swapInfo, hostCallbacks(VK_OBJECT_TYPE_SWAPCHAIN_KHR), &outSwapChain)) {
         throw std::runtime_error("unable to create swap chain");
     }
 
     if (oldSwapChain != VK_NULL_HANDLE) {
-        vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+        vkDestroySwapchainKHR(device, oldSwapChain, hostCallbacks(VK_OBJECT_TYPE_SWAPCHAIN_KHR));
     }
 }
 
@@ -737,7 +912,7 @@ void makeChainImageViews(VkDevice device, VkFormat colorFormat, std::vector<VkIm
         viewInfo.subresourceRange.levelCount = 1;
         viewInfo.subresourceRange.baseArrayLayer = 0;
         viewInfo.subresourceRange.layerCount = 1;
-        if (vkCreateImageView(device, &viewInfo, nullptr, &imageViews[i]) != VK_SUCCESS) {
+        if (vkCreateImageView(device, &viewInfo, hostCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW), &imageViews[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image views!");
         }
     }
@@ -749,7 +924,7 @@ VkCommandPool createCommandPool(VkDevice device, uint32_t queueFamilyIndex) {
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.queueFamilyIndex = queueFamilyIndex;
     poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+    if (vkCreateCommandPool(device, &poolInfo, hostCallbacks(VK_OBJECT_TYPE_COMMAND_POOL), &commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
     return commandPool;
@@ -757,9 +932,10 @@ VkCommandPool createCommandPool(VkDevice device, uint32_t queueFamilyIndex) {
 
 // --- BindlessTable ---
 
-void BindlessTable::init(VkDevice device, uint32_t maxPushConstantSize, bool enableTlas) {
+void BindlessTable::init(VkDevice device, uint32_t maxPushConstantSize, bool enableTlas, uint32_t uniformBuffers) {
     tlasEnabled = enableTlas;
-    std::array<VkDescriptorSetLayoutBinding, 4> bindings = {};
+    uniformBufferCount = uniformBuffers;
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings = {};
 
     bindings[0].binding = 0;
     bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
@@ -776,15 +952,30 @@ void BindlessTable::init(VkDevice device, uint32_t maxPushConstantSize, bool ena
     bindings[2].descriptorCount = MAX_STORAGE_IMAGES;
     bindings[2].stageFlags = VK_SHADER_STAGE_ALL;
 
-    uint32_t bindingCount = enableTlas ? 4u : 3u;
+    // Optional bindings are appended in order; binding numbers stay fixed (the uniform buffer
+    // array is binding 4 whether or not TLAS binding 3 exists).
+    uint32_t bindingCount = 3;
+    VkDescriptorPoolSize poolSizes[5] = {};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_STORAGE_BUFFERS};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_SAMPLERS};
+    poolSizes[2] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_STORAGE_IMAGES};
     if (enableTlas) {
-        bindings[3].binding = 3;
-        bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
-        bindings[3].descriptorCount = MAX_TLAS;
-        bindings[3].stageFlags = VK_SHADER_STAGE_ALL;
+        bindings[bindingCount].binding = 3;
+        bindings[bindingCount].descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+        bindings[bindingCount].descriptorCount = MAX_TLAS;
+        bindings[bindingCount].stageFlags = VK_SHADER_STAGE_ALL;
+        poolSizes[bindingCount++] = {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, MAX_TLAS};
+    }
+    if (uniformBuffers > 0) {
+        bindings[bindingCount].binding = UNIFORM_BUFFER_BINDING;
+        bindings[bindingCount].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[bindingCount].descriptorCount = uniformBuffers;
+        bindings[bindingCount].stageFlags = VK_SHADER_STAGE_ALL;
+        poolSizes[bindingCount++] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBuffers};
     }
 
-    VkDescriptorBindingFlags bindingFlags[4] = {
+    VkDescriptorBindingFlags bindingFlags[5] = {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
         VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
         VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
         VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
@@ -803,16 +994,10 @@ void BindlessTable::init(VkDevice device, uint32_t maxPushConstantSize, bool ena
     layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
     layoutInfo.pNext = &bindingFlagsInfo;
 
-    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, hostCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT), &layout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create bindless descriptor set layout");
     }
 
-    VkDescriptorPoolSize poolSizes[4] = {};
-    poolSizes[0] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_STORAGE_BUFFERS};
-    poolSizes[1] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_SAMPLERS};
-    poolSizes[2] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_STORAGE_IMAGES};
-    if (enableTlas) poolSizes[3] = {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, MAX_TLAS};
-
     VkDescriptorPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.maxSets = 1;
@@ -820,7 +1005,7 @@ void BindlessTable::init(VkDevice device, uint32_t maxPushConstantSize, bool ena
     poolInfo.pPoolSizes = poolSizes;
     poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
 
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+    if (vkCreateDescriptorPool(device, &poolInfo, hostCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL), &pool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create bindless descriptor pool");
     }
 
@@ -846,15 +1031,15 @@ void BindlessTable::init(VkDevice device, uint32_t maxPushConstantSize, bool ena
     pipelineLayoutInfo.pushConstantRangeCount = 1;
     pipelineLayoutInfo.pPushConstantRanges = &pushRange;
 
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, hostCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT), &pipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create bindless pipeline layout");
     }
 }
 
 void BindlessTable::destroy(VkDevice device) {
-    if (pipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-    if (pool != VK_NULL_HANDLE) vkDestroyDescriptorPool(device, pool, nullptr);
-    if (layout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    if (pipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(device, pipelineLayout, hostCallbacks(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+    if (pool != VK_NULL_HANDLE) vkDestroyDescriptorPool(device, pool, hostCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+    if (layout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(device, layout, hostCallbacks(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
 }
 
 uint32_t BindlessTable::registerStorageBuffer(VkDevice device, VkBuffer buffer, VkDeviceSize size) {
@@ -966,10 +1151,40 @@ uint32_t BindlessTable::registerTlas(VkDevice device, VkAccelerationStructureKHR
     return index;
 }
 
+uint32_t BindlessTable::registerUniformBuffer(VkDevice device, VkBuffer buffer, VkDeviceSize size) {
+    if (uniformBufferCount == 0) throw std::runtime_error("uniform buffer bindless table is not enabled");
+    uint32_t index;
+    if (!freeUniformBufferIndices.empty()) {
+        index = freeUniformBufferIndices.back();
+        freeUniformBufferIndices.pop_back();
+    } else {
+        index = nextUniformBufferIndex++;
+    }
+    if (index >= uniformBufferCount) throw std::runtime_error("too many uniform buffer bindless descriptors");
+
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = size;
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = UNIFORM_BUFFER_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    return index;
+}
+
 void BindlessTable::releaseStorageBuffer(uint32_t index) { freeStorageBufferIndices.push_back(index); }
 void BindlessTable::releaseSampler(uint32_t index) { freeSamplerIndices.push_back(index); }
 void BindlessTable::releaseStorageImage(uint32_t index) { freeStorageImageIndices.push_back(index); }
 void BindlessTable::releaseTlas(uint32_t index) { if (index != kNullRid) freeTlasIndices.push_back(index); }
+void BindlessTable::releaseUniformBuffer(uint32_t index) { if (index != kNullRid) freeUniformBufferIndices.push_back(index); }
 
 VkSampler createSampler(VkDevice device) {
     VkSampler textureSampler;
@@ -989,7 +1204,7 @@ VkSampler createSampler(VkDevice device) {
     samplerInfo.minLod = 0.0f;
     samplerInfo.maxLod = 13.0f;
 
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
+    if (vkCreateSampler(device, &samplerInfo, hostCallbacks(VK_OBJECT_TYPE_SAMPLER), &textureSampler) != VK_SUCCESS) {
         throw std::runtime_error("failed to create texture sampler");
     }
     return textureSampler;
@@ -1010,7 +1225,7 @@ VkSampler createNearestSampler(VkDevice device) {
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
     samplerInfo.minLod = 0.0f;
     samplerInfo.maxLod = 0.0f;
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+    if (vkCreateSampler(device, &samplerInfo, hostCallbacks(VK_OBJECT_TYPE_SAMPLER), &sampler) != VK_SUCCESS) {
         throw std::runtime_error("failed to create nearest sampler");
     }
     return sampler;
@@ -1034,7 +1249,7 @@ VkSampler createShadowSampler(VkDevice device) {
     samplerInfo.minLod = 0.0f;
     samplerInfo.maxLod = 0.0f;
 
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+    if (vkCreateSampler(device, &samplerInfo, hostCallbacks(VK_OBJECT_TYPE_SAMPLER), &sampler) != VK_SUCCESS) {
         throw std::runtime_error("failed to create shadow sampler");
     }
     return sampler;
@@ -1045,7 +1260,7 @@ VkFence createFence() {
     createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     createInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
     VkFence fence;
-    if (VK_SUCCESS != vkCreateFence(g_context().device, &createInfo, nullptr, &fence)) {
+    if (VK_SUCCESS != vkCreateFence(g_context().device, &createInfo, hostCallbacks(VK_OBJECT_TYPE_FENCE), &fence)) {
         throw std::runtime_error("failed to create fence");
     }
     g_context().fences.push_back(fence);
@@ -1056,7 +1271,7 @@ VkSemaphore createSemaphore() {
     VkSemaphoreCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
     VkSemaphore semaphore;
-    if (vkCreateSemaphore(g_context().device, &createInfo, NULL, &semaphore) != VK_SUCCESS) {
+    if (vkCreateSemaphore(g_context().device, &createInfo, hostCallbacks(VK_OBJECT_TYPE_SEMAPHORE), &semaphore) != VK_SUCCESS) {
         throw std::runtime_error("failed to create semaphore");
     }
     g_context().semaphores.push_back(semaphore);
@@ -1070,16 +1285,116 @@ void destroyDebugMessenger(VkInstance instance, VkDebugUtilsMessengerEXT messeng
     if (func != nullptr && messenger != VK_NULL_HANDLE) func(instance, messenger, pAllocator);
 }
 
+static std::vector<uint8_t> readWholeFile(const std::string & path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return {};
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+struct VulkanContext::PrefetchedFiles {
+    struct Read {
+        JobCounter done;
+        std::vector<uint8_t> bytes;
+    };
+    std::mutex mutex;
+    std::unordered_map<std::string, std::unique_ptr<Read>> reads;
+};
+
+bool VulkanContext::takePrefetchedFile(const std::string & path, std::vector<uint8_t> & out) {
+    if (!prefetched) return false;
+    std::unique_ptr<PrefetchedFiles::Read> read;
+    {
+        std::lock_guard<std::mutex> lock(prefetched->mutex);
+        auto it = prefetched->reads.find(path);
+        if (it == prefetched->reads.end()) return false;
+        read = std::move(it->second);
+        prefetched->reads.erase(it);
+    }
+    // A failed read leaves the caller to open the file itself and report the error.
+    try {
+        jobSystem->wait(read->done);
+    } catch (...) {
+        return false;
+    }
+    out = std::move(read->bytes);
+    return !out.empty();
+}
+
 VulkanContext::VulkanContext(SDL_Window * window, VulkanContextOptions options)
     : window(window), options(options), frameInFlightIndex(0) {
-    if (g_context.contextInstance != nullptr) {
-        throw std::runtime_error("VulkanContext already exists");
+    // Bound to the constructing thread for the duration, so hostCallbacks() and the objects
+    // created below resolve here. The binding stays afterwards only if the thread had none.
+    struct Binding {
+        VulkanContext * previous;
+        bool keep = false;
+        ~Binding() { if (!keep || previous) VulkanContextSingleton::threadContext = previous; }
+    } binding{VulkanContextSingleton::threadContext};
+    VulkanContextSingleton::threadContext = this;
+
+    // Startup is serial on the Vulkan side; disk I/O runs on worker threads and is joined
+    // at first use. Each phase() closes one labeled segment of the verbose timing breakdown.
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::pair<const char *, double>> startupPhases;
+    Clock::time_point phaseStart = Clock::now();
+    auto phase = [&](const char * name) {
+        Clock::time_point now = Clock::now();
+        startupPhases.emplace_back(name, std::chrono::duration<double, std::milli>(now - phaseStart).count());
+        phaseStart = now;
+    };
+
+    // Before the instance: every object the context creates goes through these callbacks.
+    if (options.enableHostAllocationTracking) {
+        hostAllocator = std::make_unique<HostAllocator>(options.enableCommandScopePool);
+    }
+    glslCompiler = std::make_unique<GlslCompiler>(options.glslCacheDir, options.enableVerbose);
+    spirvOptimizer = std::make_unique<SpirvOptimizer>(options.shaderOptimization, options.shaderOptimizationCacheDir,
+                                                      options.enableVerbose);
+
+    // The job system comes first so startup I/O runs on its workers. Sized under the live-list
+    // lock, so contexts created concurrently split the default worker budget instead of each
+    // taking all of it; the share goes back if construction fails.
+    struct WorkerShare {
+        uint32_t workers = 0;
+        bool keep = false;
+        ~WorkerShare() {
+            if (keep) return;
+            std::lock_guard<std::mutex> lock(g_context.liveMutex);
+            g_context.liveJobWorkers -= std::min(workers, g_context.liveJobWorkers);
+        }
+    } workerShare;
+    {
+        std::lock_guard<std::mutex> lock(g_context.liveMutex);
+        uint32_t workers = options.jobWorkerCount;
+        if (workers == kAutoJobWorkers) {
+            uint32_t budget = JobSystem::defaultWorkerCount();
+            workers = budget > g_context.liveJobWorkers ? budget - g_context.liveJobWorkers : 0;
+        }
+        jobSystem = std::make_unique<JobSystem>(workers);
+        g_context.liveJobWorkers += workers;
+        workerShare.workers = workers;
+    }
+
+    if (!options.prefetchPaths.empty()) {
+        // One job per file: the workers bound how many reads hit the disk at once. With no
+        // workers, a read runs when takePrefetchedFile waits for it.
+        prefetched = std::make_unique<PrefetchedFiles>();
+        for (const std::string & path : options.prefetchPaths) {
+            auto & read = prefetched->reads[path];
+            if (read) continue;
+            read = std::make_unique<PrefetchedFiles::Read>();
+            jobSystem->run(read->done, [r = read.get(), path] { r->bytes = readWholeFile(path); });
+        }
     }
 
-    int windowWidth, windowHeight;
-    SDL_GetWindowSize(window, &windowWidth, &windowHeight);
-    this->windowWidth = windowWidth;
-    this->windowHeight = windowHeight;
+    if (window) {
+        int windowWidth, windowHeight;
+        SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+        this->windowWidth = windowWidth;
+        this->windowHeight = windowHeight;
+    } else {
+        this->windowWidth = options.offscreenExtent.width;
+        this->windowHeight = options.offscreenExtent.height;
+    }
 
     std::vector<std::string> foundExtensions;
     getAvailableVulkanExtensions(window, foundExtensions);
@@ -1101,6 +1416,10 @@ VulkanContext::VulkanContext(SDL_Window * window, VulkanContextOptions options)
         }
     }
 
+    // The layer settings are read from the environment while the instance is created, and
+    // contexts may be created on several threads at once.
+    static std::mutex instanceMutex;
+    std::unique_lock<std::mutex> instanceLock(instanceMutex);
     if (options.enableValidationLayers && options.enableGpuAssistedValidation) {
         SDL_setenv_unsafe("VK_LAYER_GPUAV_ENABLE", "1", 1);
         // Suppress the "both GPU-AV and Core Check enabled" meta-warning.
@@ -1111,15 +1430,35 @@ VulkanContext::VulkanContext(SDL_Window * window, VulkanContextOptions options)
     }
 
     createVulkanInstance(enabledLayers, foundExtensions, this->instance);
+    instanceLock.unlock();
 
     if (options.enableValidationLayers) {
         setupDebugMessenger(this->instance, &this->options, this->debugMessenger);
     }
+    phase("instance");
 
     this->graphicsQueueIndex = -1;
     selectGPU(this->instance, this->physicalDevice, this->graphicsQueueIndex, this->maxSamples, this->limits, options.enableVerbose);
 
-    this->device = createLogicalDevice(options, this->physicalDevice, this->graphicsQueueIndex);
+    // The cache file is keyed by the selected GPU; read and validate it while the device is created.
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(this->physicalDevice, &deviceProperties);
+    // Joined on the way out too, so the job never outlives what it writes if a later step throws.
+    struct PipelineCacheRead {
+        JobSystem & jobs;
+        JobCounter done;
+        std::vector<uint8_t> blob;
+        ~PipelineCacheRead() {
+            try { jobs.wait(done); } catch (...) {}
+        }
+    } pipelineCacheRead{*jobSystem};
+    jobSystem->run(pipelineCacheRead.done, [&read = pipelineCacheRead, cacheId = vkobjects::deviceCacheId(deviceProperties),
+                                            dir = options.pipelineCacheDir, verbose = options.enableVerbose] {
+        read.blob = vkobjects::readPipelineCacheBlob(cacheId, dir, verbose);
+    });
+    phase("select gpu");
+
+    this->device = createLogicalDevice(options, this->physicalDevice, this->graphicsQueueIndex, window != nullptr);
     if (options.enableRayTracing) {
         auto g = [&](const char* n) { return vkGetDeviceProcAddr(this->device, n); };
         rtGetAccelerationStructureBuildSizes =
@@ -1132,9 +1471,19 @@ VulkanContext::VulkanContext(SDL_Window * window, VulkanContextOptions options)
             (PFN_vkCmdBuildAccelerationStructuresKHR)g("vkCmdBuildAccelerationStructuresKHR");
         rtGetAccelerationStructureDeviceAddress =
             (PFN_vkGetAccelerationStructureDeviceAddressKHR)g("vkGetAccelerationStructureDeviceAddressKHR");
+        rtCmdCopyAccelerationStructureToMemory =
+            (PFN_vkCmdCopyAccelerationStructureToMemoryKHR)g("vkCmdCopyAccelerationStructureToMemoryKHR");
+        rtCmdCopyMemoryToAccelerationStructure =
+            (PFN_vkCmdCopyMemoryToAccelerationStructureKHR)g("vkCmdCopyMemoryToAccelerationStructureKHR");
+        rtCmdWriteAccelerationStructuresProperties =
+            (PFN_vkCmdWriteAccelerationStructuresPropertiesKHR)g("vkCmdWriteAccelerationStructuresPropertiesKHR");
+        rtGetDeviceAccelerationStructureCompatibility =
+            (PFN_vkGetDeviceAccelerationStructureCompatibilityKHR)g("vkGetDeviceAccelerationStructureCompatibilityKHR");
         if (!rtGetAccelerationStructureBuildSizes || !rtCreateAccelerationStructure ||
             !rtDestroyAccelerationStructure || !rtCmdBuildAccelerationStructures ||
-            !rtGetAccelerationStructureDeviceAddress) {
+            !rtGetAccelerationStructureDeviceAddress || !rtCmdCopyAccelerationStructureToMemory ||
+            !rtCmdCopyMemoryToAccelerationStructure || !rtCmdWriteAccelerationStructuresProperties ||
+            !rtGetDeviceAccelerationStructureCompatibility) {
             throw std::runtime_error("failed to load acceleration-structure entrypoints");
         }
 
@@ -1151,42 +1500,68 @@ VulkanContext::VulkanContext(SDL_Window * window, VulkanContextOptions options)
         }
     }
 
+    phase("device");
+
     // Initialize VMA
     VmaAllocatorCreateInfo allocatorInfo = {};
     allocatorInfo.instance = this->instance;
     allocatorInfo.physicalDevice = this->physicalDevice;
     allocatorInfo.device = this->device;
     allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_3;
+    // VMA passes these on to vkAllocateMemory/vkCreateBuffer/vkCreateImage as well.
+    allocatorInfo.pAllocationCallbacks = hostCallbacks(VK_OBJECT_TYPE_DEVICE_MEMORY);
     if (options.enableRayTracing) {
         allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
     }
-    if (vmaCreateAllocator(&allocatorInfo, &g_allocator) != VK_SUCCESS) {
+    if (vmaCreateAllocator(&allocatorInfo, &this->allocator) != VK_SUCCESS) {
         throw std::runtime_error("failed to create VMA allocator");
     }
 
     this->meshShaderProperties = getMeshShaderProperties(this->physicalDevice, options.enableVerbose);
-
-    this->presentationSurface = createSurface(window, this->instance, this->physicalDevice, this->graphicsQueueIndex);
-    this->presentationQueue = getPresentationQueue(this->physicalDevice, this->device, this->graphicsQueueIndex, this->presentationSurface);
+    getSubgroupProperties(this->physicalDevice, this->subgroup, this->subgroupSizeControl, options.enableVerbose);
+    phase("allocator");
 
     this->swapchain = VK_NULL_HANDLE;
-    createSwapChain(*this, this->presentationSurface, this->physicalDevice, this->device, this->swapchain);
-    getSwapChainImageHandles(this->device, this->swapchain, this->swapchainImages);
+    if (window) {
+        this->presentationSurface = createSurface(window, this->instance, this->physicalDevice, this->graphicsQueueIndex);
+        this->presentationQueue = getPresentationQueue(this->physicalDevice, this->device, this->graphicsQueueIndex, this->presentationSurface);
 
-    this->swapchainImageCount = this->swapchainImages.size();
-    makeChainImageViews(this->device, this->colorFormat, this->swapchainImages, this->swapchainImageViews);
+        createSwapChain(*this, this->presentationSurface, this->physicalDevice, this->device, this->swapchain);
+        getSwapChainImageHandles(this->device, this->swapchain, this->swapchainImages);
+
+        this->swapchainImageCount = this->swapchainImages.size();
+        makeChainImageViews(this->device, this->colorFormat, this->swapchainImages, this->swapchainImageViews);
+    } else {
+        // Offscreen: no surface or swapchain; the count still sizes the deferred-destroy ring.
+        this->swapchainImageCount = 2;
+    }
+
+    phase("swapchain");
 
     this->commandPool = createCommandPool(this->device, this->graphicsQueueIndex);
 
     // Init bindless descriptor table
-    this->bindlessTable.init(this->device, this->limits.maxPushConstantsSize, options.enableRayTracing);
-
-    {
-        VkPhysicalDeviceProperties props;
-        vkGetPhysicalDeviceProperties(this->physicalDevice, &props);
-        this->pipelineCache = vkobjects::loadPipelineCache(this->device, vkobjects::deviceCacheId(props),
-                                                options.pipelineCacheDir, options.enableVerbose);
+    uint32_t uniformBufferCount = 0;
+    if (options.enableUniformBuffers) {
+        VkPhysicalDeviceVulkan12Properties props12 = {};
+        props12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+        VkPhysicalDeviceProperties2 props = {};
+        props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        props.pNext = &props12;
+        vkGetPhysicalDeviceProperties2(this->physicalDevice, &props);
+        uniformBufferCount = std::min({BindlessTable::MAX_UNIFORM_BUFFERS,
+            props12.maxPerStageDescriptorUpdateAfterBindUniformBuffers,
+            props12.maxDescriptorSetUpdateAfterBindUniformBuffers});
+        if (uniformBufferCount == 0) throw std::runtime_error("device reports no update-after-bind uniform buffer descriptors");
+        if (options.enableVerbose) std::cout << "bindless uniform buffers: " << uniformBufferCount << std::endl;
     }
+    this->bindlessTable.init(this->device, this->limits.maxPushConstantsSize, options.enableRayTracing, uniformBufferCount);
+    phase("bindless");
+
+    jobSystem->wait(pipelineCacheRead.done);
+    this->pipelineCache = vkobjects::createPipelineCache(this->device, pipelineCacheRead.blob,
+                                                         hostCallbacks(VK_OBJECT_TYPE_PIPELINE_CACHE));
+    phase("pipeline cache");
 
     // Pre-allocate frame command buffers
     for (size_t i = 0; i < swapchainImageCount; i++) {
@@ -1194,11 +1569,10 @@ VulkanContext::VulkanContext(SDL_Window * window, VulkanContextOptions options)
     }
 
     this->destroyGenerations.resize(this->swapchainImageCount);
+    this->frameArenas.resize(this->swapchainImageCount);
 
     vkGetDeviceQueue(this->device, this->graphicsQueueIndex, 0, &this->graphicsQueue);
 
-    g_context.contextInstance = this;
-
     // No initial swapchain-image layout transition: each frame begins by transitioning the image
     // from Layout::Undefined (frame.cpp), which discards prior contents and is valid as a first use.
     // Pre-transitioning presentable images here is both unnecessary and a validation error, since
@@ -1210,15 +1584,59 @@ VulkanContext::VulkanContext(SDL_Window * window, VulkanContextOptions options)
         submittedBuffersFinishedFences.push_back(createFence());
     }
 
-    vkCmdDrawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(g_context().device, "vkCmdDrawMeshTasksEXT");
-    vkCmdDrawMeshTasksIndirect = (PFN_vkCmdDrawMeshTasksIndirectEXT)vkGetDeviceProcAddr(g_context().device, "vkCmdDrawMeshTasksIndirectEXT");
-    vkBeginRendering = (PFN_vkCmdBeginRendering)vkGetDeviceProcAddr(g_context().device, "vkCmdBeginRendering");
-    vkEndRendering = (PFN_vkCmdEndRendering)vkGetDeviceProcAddr(g_context().device, "vkCmdEndRendering");
+    vkCmdDrawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(this->device, "vkCmdDrawMeshTasksEXT");
+    vkCmdDrawMeshTasksIndirect = (PFN_vkCmdDrawMeshTasksIndirectEXT)vkGetDeviceProcAddr(this->device, "vkCmdDrawMeshTasksIndirectEXT");
+    vkBeginRendering = (PFN_vkCmdBeginRendering)vkGetDeviceProcAddr(this->device, "vkCmdBeginRendering");
+    vkEndRendering = (PFN_vkCmdEndRendering)vkGetDeviceProcAddr(this->device, "vkCmdEndRendering");
 
-    Frame::currentGuard = nullptr;
+    phase("frame resources");
+
+    {
+        std::lock_guard<std::mutex> lock(g_context.liveMutex);
+        g_context.live.push_back(this);
+        workerShare.keep = true;   // the destructor returns it from here on
+        // With no other context alive, this one becomes the process default.
+        VulkanContext * expected = nullptr;
+        g_context.contextInstance.compare_exchange_strong(expected, this, std::memory_order_acq_rel);
+    }
+    if (options.enablePresentThread) presenter = std::make_unique<PresentThread>(*this);
+    phase("worker threads");
+
+    if (options.enableVerbose) {
+        double total = 0.0;
+        std::cerr << "[startup]";
+        for (auto & [name, ms] : startupPhases) {
+            std::cerr << " " << name << "=" << ms << "ms";
+            total += ms;
+        }
+        std::cerr << " total=" << total << "ms" << std::endl;
+    }
+    binding.keep = true;
 }
 
+VulkanContext::VulkanContext(VulkanContextOptions options) : VulkanContext(nullptr, options) {}
+
 VulkanContext::~VulkanContext() {
+    // Bound for the duration, like the constructor: deferred destroys and the callbacks below
+    // resolve to this context whichever thread it is destroyed on.
+    VulkanContext * previous = VulkanContextSingleton::threadContext == this ? nullptr : VulkanContextSingleton::threadContext;
+    VulkanContextSingleton::threadContext = this;
+
+    // Jobs may still reference resources, so the workers finish before anything is destroyed.
+    uint32_t workers = jobSystem ? jobSystem->workerCount() : 0;
+    jobSystem.reset();
+    {
+        // Leave the live list first, so no other thread resolves the default to a context being
+        // torn down. The oldest survivor becomes the default.
+        std::lock_guard<std::mutex> lock(g_context.liveMutex);
+        auto & live = g_context.live;
+        live.erase(std::remove(live.begin(), live.end(), this), live.end());
+        g_context.liveJobWorkers -= std::min(workers, g_context.liveJobWorkers);
+        VulkanContext * expected = this;
+        g_context.contextInstance.compare_exchange_strong(expected, live.empty() ? nullptr : live.front(),
+                                                         std::memory_order_acq_rel);
+    }
+    presenter.reset();   // issues any queued present
     vkQueueWaitIdle(graphicsQueue);
     destroyThreadLocalSubmitFence(device);
 
@@ -1226,32 +1644,33 @@ VulkanContext::~VulkanContext() {
     preDestroyCallbacks.clear();
 
     destroyGenerations.clear();
+    destroyBacklog.destroy();
 
-    for (auto semaphore : semaphores) vkDestroySemaphore(device, semaphore, nullptr);
-    for (auto fence : fences) vkDestroyFence(device, fence, nullptr);
-    for (VkPipeline pipeline : pipelines) vkDestroyPipeline(device, pipeline, nullptr);
+    for (auto semaphore : semaphores) vkDestroySemaphore(device, semaphore, hostCallbacks(VK_OBJECT_TYPE_SEMAPHORE));
+    for (auto fence : fences) vkDestroyFence(device, fence, hostCallbacks(VK_OBJECT_TYPE_FENCE));
+    for (VkPipeline pipeline : pipelines) vkDestroyPipeline(device, pipeline, hostCallbacks(VK_OBJECT_TYPE_PIPELINE));
 
     if (pipelineCache != VK_NULL_HANDLE) {
         VkPhysicalDeviceProperties props;
         vkGetPhysicalDeviceProperties(physicalDevice, &props);
         vkobjects::savePipelineCache(device, pipelineCache, vkobjects::deviceCacheId(props),
                           options.pipelineCacheDir, options.enableVerbose);
-        vkDestroyPipelineCache(device, pipelineCache, nullptr);
+        vkDestroyPipelineCache(device, pipelineCache, hostCallbacks(VK_OBJECT_TYPE_PIPELINE_CACHE));
     }
 
     bindlessTable.destroy(device);
 
-    vkDestroyCommandPool(device, commandPool, nullptr);
-    for (VkImageView view : swapchainImageViews) vkDestroyImageView(device, view, nullptr);
-    vkDestroySwapchainKHR(device, swapchain, nullptr);
-    vkDestroySurfaceKHR(instance, presentationSurface, nullptr);
-    vmaDestroyAllocator(g_allocator);
-    g_allocator = VK_NULL_HANDLE;
-    vkDestroyDevice(device, nullptr);
-    destroyDebugMessenger(instance, debugMessenger, nullptr);
-    vkDestroyInstance(instance, nullptr);
-
-    g_context.contextInstance = nullptr;
+    vkDestroyCommandPool(device, commandPool, hostCallbacks(VK_OBJECT_TYPE_COMMAND_POOL));
+    for (VkImageView view : swapchainImageViews) vkDestroyImageView(device, view, hostCallbacks(VK_OBJECT_TYPE_IMAGE_VIEW));
+    if (swapchain != VK_NULL_HANDLE) vkDestroySwapchainKHR(device, swapchain, hostCallbacks(VK_OBJECT_TYPE_SWAPCHAIN_KHR));
+    if (presentationSurface != VK_NULL_HANDLE) vkDestroySurfaceKHR(instance, presentationSurface, hostCallbacks(VK_OBJECT_TYPE_SURFACE_KHR));
+    vmaDestroyAllocator(allocator);
+    allocator = VK_NULL_HANDLE;
+    vkDestroyDevice(device, hostCallbacks(VK_OBJECT_TYPE_DEVICE));
+    destroyDebugMessenger(instance, debugMessenger, hostCallbacks(VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT));
+    vkDestroyInstance(instance, hostCallbacks(VK_OBJECT_TYPE_INSTANCE));
+
+    VulkanContextSingleton::threadContext = previous;
 }
 
 void VulkanContext::onPreDestroy(std::function<void()> callback) {
@@ -1263,9 +1682,51 @@ void VulkanContext::onSwapchainResize(std::function<void(Commands &, VkExtent2D)
 }
 
 void VulkanContext::waitIdle() {
+    if (presenter) presenter->drain();
+    std::lock_guard<std::mutex> lock(queueMutex);
     vkQueueWaitIdle(graphicsQueue);
 }
 
+uint32_t VulkanContext::subgroupLocalSize(uint32_t threads) const {
+    // Subgroup sizes are powers of two, so a multiple of the largest is a multiple of any the
+    // device picks for the dispatch.
+    uint32_t width = std::max({subgroup.subgroupSize, subgroupSizeControl.maxSubgroupSize, 1u});
+    uint32_t limit = std::min(limits.maxComputeWorkGroupSize[0], limits.maxComputeWorkGroupInvocations);
+    uint32_t size = std::max(1u, (threads + width - 1) / width) * width;
+    return std::max(1u, std::min(size, limit / width * width));
+}
+
+PresentStats VulkanContext::presentStats() const {
+    PresentStats stats;
+    stats.presents = presentCount.load();
+    stats.presentMillis = presentNanos.load() / 1e6;
+    stats.callerMillis = presentCallerNanos.load() / 1e6;
+    return stats;
+}
+
+HostAllocationReport VulkanContext::hostAllocations() const {
+    return hostAllocator ? hostAllocator->report() : HostAllocationReport{};
+}
+
+const VkAllocationCallbacks * VulkanContext::allocationCallbacks(VkObjectType type) const {
+    return hostAllocator ? hostAllocator->callbacks(type) : nullptr;
+}
+
 void VulkanContext::flushDestroys() {
-    for (auto& dg : destroyGenerations) dg.destroy();
+    ContextScope scope(*this);
+    {
+        std::lock_guard<std::mutex> lock(destroyMutex);
+        for (auto& dg : destroyGenerations) destroyBacklog.append(dg);
+    }
+    destroyBacklog.destroy();
+}
+
+void VulkanContext::drainDestroys() {
+    DestroyGeneration done;
+    {
+        std::lock_guard<std::mutex> lock(destroyMutex);
+        for (auto& dg : destroyGenerations) done.append(dg);
+    }
+    ContextScope scope(*this);
+    done.destroy();
 }
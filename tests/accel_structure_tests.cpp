@@ -46,7 +46,7 @@ struct Hit {
 
 uint64_t allocatedBytes() {
     VmaBudget budgets[VK_MAX_MEMORY_HEAPS] = {};
-    vmaGetHeapBudgets(g_allocator, budgets);
+    vmaGetHeapBudgets(g_context().allocatorHandle(), budgets);
     VkPhysicalDeviceMemoryProperties props = {};
     vkGetPhysicalDeviceMemoryProperties(g_context().physicalDeviceHandle(), &props);
     uint64_t total = 0;
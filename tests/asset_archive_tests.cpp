@@ -0,0 +1,206 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// AssetArchive: a packed directory maps back byte-for-byte with 64-byte aligned blobs, damaged
+// archives are rejected on open, and a shader module and staging buffer come straight from
+// the mapping. `--bench` instead compares loading many small files loose and from an archive.
+
+namespace {
+
+struct TempDir {
+    std::filesystem::path path;
+    TempDir() {
+        path = std::filesystem::temp_directory_path() / ("vkobjects-asset-archive-" + std::to_string(getpid()));
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+std::vector<uint8_t> readAll(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("failed to open " + path.string());
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void writeAll(const std::filesystem::path& path, const std::vector<uint8_t>& bytes) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+}
+
+// `count` files of random size in [0, maxBytes] spread over a few subdirectories.
+std::vector<std::pair<std::string, std::vector<uint8_t>>> writeTree(const std::filesystem::path& root,
+                                                                    uint32_t count, uint32_t maxBytes) {
+    std::mt19937 rng(90);
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> files;
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string name = (i % 4 == 0 ? "" : "dir" + std::to_string(i % 4) + "/") + "file" + std::to_string(i) + ".bin";
+        std::vector<uint8_t> bytes(i == 0 ? 0 : rng() % (maxBytes + 1));
+        for (auto& b : bytes) b = uint8_t(rng());
+        writeAll(root / name, bytes);
+        files.emplace_back(name, std::move(bytes));
+    }
+    return files;
+}
+
+void testRoundTrip() {
+    TempDir dir;
+    auto files = writeTree(dir.path / "src", 97, 5000);
+    std::string archivePath = (dir.path / "test.vkpak").string();
+    if (AssetArchive::pack((dir.path / "src").string(), archivePath) != files.size()) {
+        throw std::runtime_error("pack() entry count mismatch");
+    }
+
+    AssetArchive archive(archivePath);
+    if (archive.size() != files.size()) throw std::runtime_error("archive entry count mismatch");
+    for (auto& [name, bytes] : files) {
+        std::span<const uint8_t> blob = archive.get(name);
+        if (blob.size() != bytes.size() || !std::equal(blob.begin(), blob.end(), bytes.begin())) {
+            throw std::runtime_error("blob mismatch for " + name);
+        }
+        if (reinterpret_cast<uintptr_t>(blob.data()) % 64 != 0) throw std::runtime_error("unaligned blob " + name);
+    }
+    for (size_t i = 0; i < archive.size(); ++i) {
+        if (!archive.contains(archive.name(i))) throw std::runtime_error("name() does not round-trip");
+    }
+    if (archive.contains("file1.bin") || archive.contains("dir1") || !archive.find("missing").empty()) {
+        throw std::runtime_error("lookup matched a missing entry");
+    }
+    try {
+        archive.get("missing");
+        throw std::runtime_error("get() of a missing entry did not throw");
+    } catch (const std::runtime_error& e) {
+        if (std::string(e.what()).find("has no entry") == std::string::npos) throw;
+    }
+
+    // An in-memory build() is byte-identical to the packed file.
+    if (AssetArchive::build(files) != readAll(archivePath)) throw std::runtime_error("build() differs from pack()");
+}
+
+void expectRejected(const std::filesystem::path& path, const std::string& fragment) {
+    try {
+        AssetArchive archive(path.string());
+    } catch (const std::runtime_error& e) {
+        if (std::string(e.what()).find(fragment) == std::string::npos) {
+            throw std::runtime_error(std::string("unexpected archive error: ") + e.what());
+        }
+        return;
+    }
+    throw std::runtime_error(path.string() + " opened without the expected '" + fragment + "' error");
+}
+
+void testRejects() {
+    TempDir dir;
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> files = {
+        { "a.spv", std::vector<uint8_t>(100, 1) },
+        { "b/c.tga", std::vector<uint8_t>(300, 2) },
+    };
+    std::vector<uint8_t> good = AssetArchive::build(files);
+
+    expectRejected(dir.path / "missing.vkpak", "failed to map");
+
+    auto damaged = [&](const char* name, auto edit) {
+        std::vector<uint8_t> bytes = good;
+        edit(bytes);
+        writeAll(dir.path / name, bytes);
+        return dir.path / name;
+    };
+    expectRejected(damaged("magic.vkpak", [](auto& b) { b[0] ^= 0xFF; }), "bad magic");
+    expectRejected(damaged("truncated.vkpak", [](auto& b) { b.resize(b.size() - 1); }), "file size");
+    expectRejected(damaged("header.vkpak", [](auto& b) { b.resize(16); }), "truncated header");
+    expectRejected(damaged("toc.vkpak", [](auto& b) { b[32 + 8] ^= 0x40; }), "checksum");
+
+    bool threw = false;
+    try {
+        files.push_back(files[0]);
+        AssetArchive::build(files);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::runtime_error("build() accepted duplicate names");
+}
+
+void testGpuLoads() {
+    TempDir dir;
+    std::string archivePath = (dir.path / "shaders.vkpak").string();
+    AssetArchive::pack("tests/shaders", archivePath);
+    AssetArchive archive(archivePath);
+
+    ShaderBuilder fromArchive;
+    fromArchive.compute().fromBuffer(archive.get("constant_fetch.comp.spv"));
+    if (!fromArchive.code.empty() || fromArchive.bytes().data() != archive.get("constant_fetch.comp.spv").data()) {
+        throw std::runtime_error("fromBuffer(span) copied the SPIR-V");
+    }
+    ShaderModule mapped(fromArchive);
+    ShaderModule loose(ShaderBuilder().compute().fromFile("tests/shaders/constant_fetch.comp.spv"));
+    if (mapped.reflection.localSize != loose.reflection.localSize ||
+        mapped.reflection.pushConstantSize != loose.reflection.pushConstantSize) {
+        throw std::runtime_error("archive shader reflects differently from the loose file");
+    }
+
+    std::span<const uint8_t> blob = archive.get("as_oracle.comp.spv");
+    Buffer staging = archive.stagingBuffer("as_oracle.comp.spv");
+    if (staging.byteSize() < blob.size() || std::memcmp(staging.mappedData(), blob.data(), blob.size()) != 0) {
+        throw std::runtime_error("staging buffer does not hold the blob");
+    }
+}
+
+void bench() {
+    using Clock = std::chrono::steady_clock;
+    TempDir dir;
+    const uint32_t fileCount = 2000;
+    auto files = writeTree(dir.path / "src", fileCount, 16 * 1024);
+    std::string archivePath = (dir.path / "bench.vkpak").string();
+    AssetArchive::pack((dir.path / "src").string(), archivePath);
+
+    // Both paths touch every byte so the mapping is actually paged in. The page cache is warm
+    // for both; a cold-cache comparison needs `echo 3 > /proc/sys/vm/drop_caches` between runs.
+    for (int run = 0; run < 3; ++run) {
+        auto t0 = Clock::now();
+        uint64_t looseSum = 0;
+        for (auto& f : files) {
+            for (uint8_t b : readAll(dir.path / "src" / f.first)) looseSum += b;
+        }
+        auto t1 = Clock::now();
+        uint64_t archiveSum = 0;
+        {
+            AssetArchive archive(archivePath);
+            for (auto& f : files) {
+                for (uint8_t b : archive.get(f.first)) archiveSum += b;
+            }
+        }
+        auto t2 = Clock::now();
+        if (looseSum != archiveSum) throw std::runtime_error("bench checksum mismatch");
+        std::cout << "load " << fileCount << " files: loose "
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, archive "
+                  << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("asset archive", argc, argv, [] {
+        testRoundTrip();
+        testRejects();
+        TestContext ctx;
+        testGpuLoads();
+    }, bench);
+}
@@ -0,0 +1,232 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// Blas serialize/deserialize and BlasCache: a deserialized triangle traces like the original,
+// incompatible or corrupt data is rejected, and the cache misses once then hits. `--bench`
+// instead compares cache load time against a rebuild for a large grid mesh.
+
+namespace {
+
+struct TempDir {
+    std::filesystem::path path;
+    TempDir() {
+        path = std::filesystem::temp_directory_path() / ("vkobjects-blas-cache-" + std::to_string(getpid()));
+        std::filesystem::remove_all(path);
+    }
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+// A gridSize x gridSize quad grid in the z = 0 plane covering [0, 1]^2, two triangles per quad.
+struct Grid {
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    std::unique_ptr<Buffer> vertexBuffer, indexBuffer;
+
+    explicit Grid(uint32_t gridSize) {
+        for (uint32_t y = 0; y <= gridSize; ++y) {
+            for (uint32_t x = 0; x <= gridSize; ++x) {
+                vertices.insert(vertices.end(), { float(x) / gridSize, float(y) / gridSize, 0.0f });
+            }
+        }
+        for (uint32_t y = 0; y < gridSize; ++y) {
+            for (uint32_t x = 0; x < gridSize; ++x) {
+                uint32_t i = y * (gridSize + 1) + x;
+                indices.insert(indices.end(), { i, i + 1, i + gridSize + 1, i + 1, i + gridSize + 2, i + gridSize + 1 });
+            }
+        }
+        vertexBuffer = upload(vertices.data(), vertices.size() * sizeof(float));
+        indexBuffer = upload(indices.data(), indices.size() * sizeof(uint32_t));
+    }
+
+    static std::unique_ptr<Buffer> upload(void* data, size_t bytes) {
+        BufferBuilder builder(bytes);
+        builder.hostVisible().accelerationStructureInput();
+        auto buffer = std::make_unique<Buffer>(builder);
+        buffer->upload(data, bytes);
+        return buffer;
+    }
+
+    BlasBuilder builder() {
+        BlasBuilder b;
+        b.addGeometry(BlasGeometry(*vertexBuffer)
+                          .vertexCount(uint32_t(vertices.size() / 3))
+                          .indexBuffer(*indexBuffer)
+                          .triangleCount(uint32_t(indices.size() / 3)));
+        return b;
+    }
+
+    uint64_t key(const BlasBuilder& b) const {
+        std::vector<uint8_t> bytes(vertices.size() * sizeof(float) + indices.size() * sizeof(uint32_t));
+        std::memcpy(bytes.data(), vertices.data(), vertices.size() * sizeof(float));
+        std::memcpy(bytes.data() + vertices.size() * sizeof(float), indices.data(), indices.size() * sizeof(uint32_t));
+        return b.contentHash(bytes);
+    }
+};
+
+Blas buildNow(BlasBuilder& builder) {
+    Blas blas(builder);
+    auto cmd = Commands::oneShot();
+    cmd.buildBlas(blas, false);
+    cmd.submitAndWait();
+    return blas;
+}
+
+// Ray from (0.25, 0.25, 1) down -Z through tests/shaders/as_oracle.comp; returns hit t or -1.
+float traceDown(Blas& blas) {
+    Tlas tlas(1);
+    TlasInstances instances;
+    instances.add(blas, 3);
+    {
+        auto cmd = Commands::oneShot();
+        VkBuffer backing = blas.backing();
+        cmd.blasToTlasBarrier(std::span<const VkBuffer>(&backing, 1));
+        cmd.buildTlas(tlas, instances);
+        cmd.tlasToShaderReadBarrier(tlas.backing());
+        cmd.submitAndWait();
+    }
+    ShaderModule shader(ShaderBuilder().compute().fromFile("tests/shaders/as_oracle.comp.spv"));
+    Pipeline pipeline = createComputePipeline(shader);
+    BufferBuilder outBuilder(4 * sizeof(uint32_t));
+    outBuilder.hostVisible();
+    Buffer out(outBuilder);
+    uint32_t zero[4] = {};
+    out.upload(zero, sizeof(zero));
+
+    struct Push { uint32_t tlasRID; uint32_t outRID; } push{tlas.rid(), out.rid()};
+    auto cmd = Commands::oneShot();
+    cmd.bindCompute(pipeline);
+    cmd.pushConstants(push);
+    cmd.dispatch(1, 1, 1);
+    cmd.bufferBarrier(out, Stage::Compute, Access::ShaderWrite, Stage::Host, Access::HostRead);
+    cmd.submitAndWait();
+
+    uint32_t hit[4];
+    out.download(hit, sizeof(hit));
+    if (hit[3] == 0) return -1.0f;
+    if (hit[0] != 3) throw std::runtime_error("traced hit has the wrong custom index");
+    float t;
+    std::memcpy(&t, &hit[2], sizeof(t));
+    return t;
+}
+
+void testRoundTrip() {
+    Grid grid(4);
+    BlasBuilder builder = grid.builder();
+    Blas original = buildNow(builder);
+    std::vector<uint8_t> data = original.serialize();
+    if (!Blas::compatible(data)) throw std::runtime_error("own serialized BLAS reported incompatible");
+
+    std::optional<Blas> copy = Blas::deserialize(builder, data);
+    if (!copy) throw std::runtime_error("deserialize rejected its own serialized BLAS");
+    float t = traceDown(*copy);
+    if (std::fabs(t - 1.0f) > 0.001f) throw std::runtime_error("deserialized BLAS traced t = " + std::to_string(t));
+
+    std::vector<uint8_t> foreign = data;
+    foreign[16] ^= 0xFF;   // compatibility UUID
+    if (Blas::compatible(foreign) || Blas::deserialize(builder, foreign)) {
+        throw std::runtime_error("BLAS with a foreign compatibility UUID was accepted");
+    }
+    std::vector<uint8_t> truncated(data.begin(), data.end() - 1);
+    if (Blas::deserialize(builder, truncated)) throw std::runtime_error("truncated BLAS was accepted");
+}
+
+void testCache() {
+    TempDir dir;
+    Grid grid(8);
+    BlasBuilder builder = grid.builder();
+    uint64_t key = grid.key(builder);
+
+    Grid other(9);
+    if (other.key(other.builder()) == key) throw std::runtime_error("different geometry hashed to the same key");
+
+    BlasCache cache(dir.path.string());
+    {
+        Blas cold = cache.getOrBuild(builder, key);
+        Blas warm = cache.getOrBuild(builder, key);
+        if (cache.misses() != 1 || cache.hits() != 1) throw std::runtime_error("expected one miss then one hit");
+        if (std::fabs(traceDown(warm) - 1.0f) > 0.001f) throw std::runtime_error("cached BLAS does not trace");
+    }
+
+    // Flip one payload byte: the prefix hash rejects the file and the next getOrBuild rewrites it.
+    {
+        std::fstream f(cache.path(key), std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(100);
+        char c = 0x5A;
+        f.write(&c, 1);
+    }
+    if (cache.load(builder, key)) throw std::runtime_error("corrupt cache file was accepted");
+    Blas rebuilt = cache.getOrBuild(builder, key);
+    if (!cache.load(builder, key)) throw std::runtime_error("cache entry was not rewritten after corruption");
+
+    // Entries are per device: the tag is in the file name, and a prefix naming another device
+    // is a miss even when its payload is intact.
+    char tag[17];
+    std::snprintf(tag, sizeof(tag), "%016llx", (unsigned long long)cache.deviceTag());
+    if (cache.path(key).find(tag) == std::string::npos) throw std::runtime_error("cache file name lacks the device tag");
+    {
+        std::fstream f(cache.path(key), std::ios::in | std::ios::out | std::ios::binary);
+        f.seekg(8);   // device tag
+        char c = 0;
+        f.read(&c, 1);
+        c ^= 0xFF;
+        f.seekp(8);
+        f.write(&c, 1);
+    }
+    if (cache.load(builder, key)) throw std::runtime_error("cache entry from another device was accepted");
+
+    BlasCache disabled("");
+    Blas uncached = disabled.getOrBuild(builder, key);
+    if (disabled.misses() != 1 || !disabled.path(key).empty()) throw std::runtime_error("empty-dir cache touched disk");
+}
+
+void bench() {
+    TestContext ctx(VulkanContextOptions().rayTracing(), false);
+    TempDir dir;
+    BlasCache cache(dir.path.string());
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    std::cout << "BLAS cache benchmark (wall clock, one-shot submits)\n";
+    for (uint32_t gridSize : { 256u, 512u, 1024u }) {
+        Grid grid(gridSize);
+        BlasBuilder builder = grid.builder();
+        uint64_t key = grid.key(builder);
+        auto t0 = Clock::now();
+        Blas built = buildNow(builder);
+        auto t1 = Clock::now();
+        cache.store(built, key);
+        auto t2 = Clock::now();
+        std::optional<Blas> loaded = cache.load(builder, key);
+        auto t3 = Clock::now();
+        if (!loaded) throw std::runtime_error("bench: cache load failed");
+        std::cout << "  " << grid.indices.size() / 3 << " triangles: rebuild " << ms(t1 - t0)
+                  << " ms, cache load " << ms(t3 - t2) << " ms (" << std::filesystem::file_size(cache.path(key)) / 1024
+                  << " KiB on disk)\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("BLAS cache", argc, argv, [] {
+        TestContext ctx(VulkanContextOptions().rayTracing());
+        testRoundTrip();
+        testCache();
+    }, bench);
+}
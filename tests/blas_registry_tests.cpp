@@ -0,0 +1,126 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// BlasRegistry sharing and refcount expiry. `--bench` builds a scene of many props drawn
+// from a few meshes with and without the registry and prints BLAS memory and build time.
+
+namespace {
+
+// A rows x rows triangle strip patch at height `z`; each z value is a distinct mesh.
+struct Mesh {
+    std::vector<float> vertices;
+    std::unique_ptr<Buffer> buffer;
+
+    Mesh(uint32_t rows, float z) {
+        for (uint32_t y = 0; y < rows; ++y) {
+            for (uint32_t x = 0; x < rows; ++x) {
+                float x0 = float(x) / rows, y0 = float(y) / rows, d = 1.0f / rows;
+                vertices.insert(vertices.end(), { x0, y0, z, x0 + d, y0, z, x0, y0 + d, z });
+            }
+        }
+        BufferBuilder builder(vertices.size() * sizeof(float));
+        builder.hostVisible().accelerationStructureInput();
+        buffer = std::make_unique<Buffer>(builder);
+        buffer->upload(vertices.data(), vertices.size() * sizeof(float));
+    }
+
+    uint32_t triangles() const { return uint32_t(vertices.size() / 9); }
+
+    BlasBuilder builder() const {
+        BlasBuilder b;
+        b.addGeometry(BlasGeometry(*buffer).vertexCount(triangles() * 3).triangleCount(triangles()));
+        return b;
+    }
+
+    std::span<const uint8_t> bytes() const {
+        return { reinterpret_cast<const uint8_t*>(vertices.data()), vertices.size() * sizeof(float) };
+    }
+};
+
+void testSharing() {
+    Mesh rock(4, 0.0f), tree(4, 1.0f);
+    BlasRegistry registry;
+    std::shared_ptr<Blas> a, b, c;
+    {
+        auto cmd = Commands::oneShot();
+        BlasBuilder rockBuilder = rock.builder(), treeBuilder = tree.builder();
+        a = registry.acquire(cmd, rockBuilder, rock.bytes());
+        b = registry.acquire(cmd, rockBuilder, rock.bytes());
+        c = registry.acquire(cmd, treeBuilder, tree.bytes());
+        if (registry.pendingBackings().size() != 2) throw std::runtime_error("expected two pending builds");
+        cmd.submitAndWait();
+    }
+    if (a != b) throw std::runtime_error("identical geometry was not shared");
+    if (a == c) throw std::runtime_error("different geometry was shared");
+    const auto& stats = registry.stats();
+    if (stats.requests != 3 || stats.builds != 2) throw std::runtime_error("unexpected request/build counts");
+    if (stats.bytesSaved != a->memoryBytes()) throw std::runtime_error("bytesSaved does not match the shared Blas");
+    if (registry.liveCount() != 2) throw std::runtime_error("expected two live entries");
+
+    // Dropping every user releases the entry; the next request builds again.
+    a.reset();
+    b.reset();
+    if (registry.liveCount() != 1) throw std::runtime_error("released Blas is still live");
+    {
+        auto cmd = Commands::oneShot();
+        BlasBuilder rockBuilder = rock.builder();
+        a = registry.acquire(cmd, rockBuilder, 42);   // caller key
+        cmd.submitAndWait();
+    }
+    if (registry.stats().builds != 3 || registry.liveCount() != 2) throw std::runtime_error("re-acquire did not rebuild");
+}
+
+void bench() {
+    TestContext ctx(VulkanContextOptions().rayTracing(), false);
+    const uint32_t meshCount = 8, propCount = 1024, rows = 32;
+    std::vector<std::unique_ptr<Mesh>> meshes;
+    for (uint32_t i = 0; i < meshCount; ++i) meshes.push_back(std::make_unique<Mesh>(rows, float(i)));
+
+    GpuTimer timer(2);
+    auto cmd = Commands::oneShot();
+    timer.begin(cmd);
+
+    std::vector<Blas> unshared;
+    unshared.reserve(propCount);
+    VkDeviceSize unsharedBytes = 0;
+    for (uint32_t p = 0; p < propCount; ++p) {
+        BlasBuilder builder = meshes[p % meshCount]->builder();
+        unshared.emplace_back(builder);
+        cmd.buildBlas(unshared.back(), false);
+        unsharedBytes += unshared.back().memoryBytes();
+    }
+    timer.mark(cmd, "one Blas per prop");
+
+    BlasRegistry registry;
+    std::vector<std::shared_ptr<Blas>> shared;
+    for (uint32_t p = 0; p < propCount; ++p) {
+        const Mesh& mesh = *meshes[p % meshCount];
+        BlasBuilder builder = mesh.builder();
+        shared.push_back(registry.acquire(cmd, builder, mesh.bytes()));
+    }
+    timer.mark(cmd, "BlasRegistry");
+    cmd.submitAndWait();
+
+    const auto& stats = registry.stats();
+    std::cout << "BLAS dedup benchmark (" << propCount << " props, " << meshCount << " meshes of "
+              << meshes[0]->triangles() << " triangles)\n";
+    std::cout << "  one Blas per prop: " << propCount << " builds, " << unsharedBytes / 1024 << " KiB\n";
+    std::cout << "  BlasRegistry: " << stats.builds << " builds, " << stats.bytesAllocated / 1024 << " KiB ("
+              << stats.bytesSaved / 1024 << " KiB saved)\n";
+    for (auto& [label, ms] : timer.resolve()) std::cout << "  " << label << " build time: " << ms << " ms\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("BLAS registry", argc, argv, [] {
+        TestContext ctx(VulkanContextOptions().rayTracing());
+        testSharing();
+    }, bench);
+}
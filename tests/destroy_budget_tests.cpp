@@ -0,0 +1,118 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Budgeted deferred destruction: DestroyGeneration::destroy frees oldest-first across appended
+// generations, stops at the item budget, and always frees at least one handle even when the
+// time budget is already spent, so a backlog cannot grow without bound. `--bench` replays a
+// steady trickle of releases with one level-unload burst and reports the worst per-frame destroy
+// pass with and without a budget.
+
+namespace {
+
+std::vector<VkSampler> makeSamplers(uint32_t count) {
+    VkSamplerCreateInfo info = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+    info.magFilter = VK_FILTER_LINEAR;
+    info.minFilter = VK_FILTER_LINEAR;
+    std::vector<VkSampler> samplers(count);
+    for (VkSampler& s : samplers) {
+        if (vkCreateSampler(g_context().deviceHandle(), &info, nullptr, &s) != VK_SUCCESS) {
+            throw std::runtime_error("vkCreateSampler failed");
+        }
+    }
+    return samplers;
+}
+
+void testOldestFirst() {
+    DestroyGeneration backlog;
+    DestroyGeneration older, newer;
+    older.samplers = makeSamplers(5);
+    newer.samplers = makeSamplers(5);
+    std::vector<VkSampler> queued = older.samplers;
+    queued.insert(queued.end(), newer.samplers.begin(), newer.samplers.end());
+    backlog.append(older);
+    backlog.append(newer);
+
+    DestroyStats stats = backlog.destroy(3, 0.0);
+    if (stats.destroyed != 3 || stats.pending != 7) throw std::runtime_error("item budget not honored");
+    if (backlog.samplers != std::vector<VkSampler>(queued.begin() + 3, queued.end())) {
+        throw std::runtime_error("destroy did not free the oldest handles first");
+    }
+    backlog.destroy(4, 0.0);
+    if (backlog.samplers != std::vector<VkSampler>(queued.begin() + 7, queued.end())) {
+        throw std::runtime_error("second pass did not continue from the oldest handle");
+    }
+    backlog.destroy();
+    if (backlog.pending() != 0) throw std::runtime_error("unbudgeted destroy left handles queued");
+}
+
+void testSpentBudget() {
+    DestroyGeneration backlog;
+    backlog.samplers = makeSamplers(8);
+    size_t before = backlog.pending();
+    int passes = 0;
+    while (backlog.pending() != 0) {
+        // A budget far below the cost of any vkDestroy* call: spent before the first handle.
+        DestroyStats stats = backlog.destroy(0, 1e-9);
+        if (stats.destroyed == 0 || backlog.pending() >= before) throw std::runtime_error("spent budget freed nothing");
+        before = backlog.pending();
+        if (++passes > 8) throw std::runtime_error("backlog did not drain");
+    }
+}
+
+// Per-frame destroy passes for `frames` frames: a trickle of `steady` releases per frame and a
+// burst of `burst` at frame `burstFrame`. Returns the worst pass and the frames taken to drain.
+struct SpikeResult {
+    double worstMs = 0.0;
+    double totalMs = 0.0;
+    int framesToDrain = 0;
+};
+
+SpikeResult replay(uint32_t maxItems, double maxMillis, uint32_t steady, uint32_t burst) {
+    const int frames = 120, burstFrame = 10;
+    SpikeResult result;
+    DestroyGeneration backlog;
+    for (int frame = 0; frame < frames || backlog.pending() != 0; ++frame) {
+        DestroyGeneration released;
+        if (frame < frames) released.samplers = makeSamplers(steady + (frame == burstFrame ? burst : 0));
+        backlog.append(released);
+        DestroyStats stats = backlog.destroy(maxItems, maxMillis);
+        result.worstMs = std::max(result.worstMs, stats.millis);
+        result.totalMs += stats.millis;
+        if (frame >= burstFrame && stats.pending <= steady && result.framesToDrain == 0) {
+            result.framesToDrain = frame - burstFrame + 1;
+        }
+    }
+    return result;
+}
+
+void bench() {
+    VulkanContext context(VulkanContextOptions().offscreenSize(64, 64).jobWorkers(0));
+    const uint32_t steady = 16, burst = 2048;
+    struct Config {
+        const char* name;
+        uint32_t maxItems;
+        double maxMillis;
+    };
+    for (Config config : {Config{"no budget", 0, 0.0}, Config{"64 items", 64, 0.0}, Config{"0.25 ms", 0, 0.25}}) {
+        SpikeResult r = replay(config.maxItems, config.maxMillis, steady, burst);
+        std::cout << config.name << ": worst frame " << r.worstMs << " ms, total " << r.totalMs << " ms, burst drained in "
+                  << r.framesToDrain << " frames (" << burst << " samplers + " << steady << " per frame)\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("destroy budget", argc, argv, [] {
+        VulkanContext context(VulkanContextOptions().offscreenSize(64, 64).jobWorkers(0).validation().throwOnValidationError());
+        testOldestFirst();
+        testSpentBudget();
+    }, bench);
+}
@@ -0,0 +1,187 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Subgroup-aware dispatch: reflection of local_size_*_id (specialized and fixed dimensions),
+// SpecConstants::localSize, the context's subgroup properties and subgroupLocalSize, pipelines
+// carrying their specialized local size, and dispatchThreads covering exactly the requested
+// invocations. `--bench` runs the demo's cubes.comp at local size 1 (as the demo used to) and at
+// subgroupLocalSize() and reports GPU time for both.
+
+namespace {
+
+struct DispatchPush {
+    uint32_t outRID;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Matches cubes.comp; only vertexBufferRID and rotationAngle are read.
+struct CubesPush {
+    uint32_t drawDataRID;
+    uint32_t globalsSlot;
+    uint32_t vertexBufferRID;
+    uint32_t textureRID;
+    uint32_t shadowMapRID;
+    uint32_t lightBufferRID;
+    float rotationAngle;
+    uint32_t tlasRID;
+    uint32_t useRT;
+};
+
+bool isPowerOfTwo(uint32_t v) { return v != 0 && (v & (v - 1)) == 0; }
+
+void testReflection() {
+    ShaderModule specialized(ShaderBuilder().compute().fromFile("tests/shaders/dispatch_threads.comp.spv"));
+    const ShaderReflection& r = specialized.reflection;
+    if (r.localSizeSpecIds[0] != 0 || r.localSizeSpecIds[1] != ~0u || r.localSizeSpecIds[2] != ~0u) {
+        throw std::runtime_error("local_size_x_id not reflected");
+    }
+    if (r.localSize[0] != 1 || r.localSize[1] != 2 || r.localSize[2] != 1) throw std::runtime_error("default local size");
+
+    ShaderModule fixed(ShaderBuilder().compute().fromFile("tests/shaders/constant_fetch.comp.spv"));
+    if (fixed.reflection.localSizeSpecIds[0] != ~0u || fixed.reflection.localSize[0] != 64) {
+        throw std::runtime_error("fixed local size reflected as specializable");
+    }
+
+    SpecConstants constants = SpecConstants().localSize(r, 96, 2);
+    if (constants.entries.size() != 1 || constants.entries[0].constantID != 0 || constants.data[0] != 96) {
+        throw std::runtime_error("localSize() did not set constant 0");
+    }
+    bool threw = false;
+    try {
+        SpecConstants().localSize(r, 96, 4);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::runtime_error("localSize() changed a fixed dimension");
+    SpecConstants().localSize(fixed.reflection, 64);   // the fixed size itself is fine
+}
+
+void testSubgroupProperties() {
+    VulkanContext& context = g_context();
+    const VkPhysicalDeviceSubgroupProperties& subgroup = context.subgroupProperties();
+    if (!isPowerOfTwo(subgroup.subgroupSize)) throw std::runtime_error("subgroup size not queried");
+    if (!(subgroup.supportedOperations & VK_SUBGROUP_FEATURE_BASIC_BIT)) throw std::runtime_error("basic subgroup operations missing");
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(context.physicalDeviceHandle(), &properties);
+    uint32_t limit = std::min(properties.limits.maxComputeWorkGroupSize[0], properties.limits.maxComputeWorkGroupInvocations);
+    uint32_t widest = std::max(subgroup.subgroupSize, context.subgroupSizeControlProperties().maxSubgroupSize);
+    for (uint32_t threads : {1u, 12u, 64u, 100u, 1000u, 1u << 20}) {
+        uint32_t size = context.subgroupLocalSize(threads);
+        if (size % widest != 0) throw std::runtime_error("subgroupLocalSize not a multiple of the subgroup size");
+        if (size < std::min(threads, 128u)) throw std::runtime_error("subgroupLocalSize smaller than asked for");
+        if (size > limit) throw std::runtime_error("subgroupLocalSize beyond the workgroup limits");
+    }
+}
+
+void testDispatchThreads() {
+    ShaderModule shader(ShaderBuilder().compute().fromFile("tests/shaders/dispatch_threads.comp.spv"));
+    uint32_t width = g_context().subgroupLocalSize(32);
+    Pipeline pipeline = createComputePipeline(shader, SpecConstants().localSize(shader.reflection, width, 2));
+    if (pipeline.localSize()[0] != width || pipeline.localSize()[1] != 2 || pipeline.localSize()[2] != 1) {
+        throw std::runtime_error("pipeline local size not specialized");
+    }
+
+    // Neither dimension a multiple of the local size: the partial groups must still run.
+    const uint32_t w = width * 3 + 5, h = 7;
+    const uint32_t slack = width * 4 * 8;
+    Buffer out(BufferBuilder((w * h + slack) * sizeof(uint32_t)).storage().readback().transferDestination());
+    DispatchPush push = { out.rid(), w, h };
+    auto cmd = Commands::oneShot();
+    cmd.fillBuffer(out, 0);
+    cmd.bufferBarrier(out, Stage::Transfer, Access::TransferWrite, Stage::Compute, Access::ShaderWrite);
+    cmd.bindCompute(pipeline);
+    cmd.pushConstants(push);
+    cmd.dispatchThreads(w, h);
+    cmd.bufferBarrier(out, Stage::Compute, Access::ShaderWrite, Stage::Host, Access::HostRead);
+    cmd.submitAndWait();
+
+    std::vector<uint32_t> got(w * h + slack);
+    out.invalidate();
+    out.download(got.data(), got.size() * sizeof(uint32_t));
+    for (uint32_t i = 0; i < got.size(); ++i) {
+        uint32_t want = i < w * h ? i + 1 : 0;
+        if (got[i] != want) {
+            throw std::runtime_error("dispatchThreads index " + std::to_string(i) + ": got " + std::to_string(got[i]) +
+                                     ", want " + std::to_string(want));
+        }
+    }
+
+    // A raw VkPipeline carries no local size.
+    auto raw = Commands::oneShot();
+    raw.bindCompute(VkPipeline(pipeline));
+    bool threw = false;
+    try {
+        raw.dispatchThreads(w, h);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::runtime_error("dispatchThreads accepted a pipeline bound without its local size");
+}
+
+void testLocalSizeLimits() {
+    ShaderModule shader(ShaderBuilder().compute().fromFile("tests/shaders/dispatch_threads.comp.spv"));
+    uint32_t tooWide = 1u << 20;
+    bool threw = false;
+    try {
+        Pipeline pipeline = createComputePipeline(shader, SpecConstants().localSize(shader.reflection, tooWide, 2));
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()).find("workgroup limits") != std::string::npos;
+    }
+    if (!threw) throw std::runtime_error("oversized local size reached vkCreateComputePipelines");
+}
+
+void bench() {
+    VulkanContext context(VulkanContextOptions().offscreenSize(64, 64).jobWorkers(0));
+    ShaderModule shader(ShaderBuilder().compute().fromFile(CUBES_SPV));
+    std::cout << "subgroup size " << context.subgroupProperties().subgroupSize << " ("
+              << context.subgroupSizeControlProperties().minSubgroupSize << "-"
+              << context.subgroupSizeControlProperties().maxSubgroupSize << ")\n";
+    const uint32_t floatsPerCube = 36 * 8;
+    for (uint32_t cubes : {12u, 1024u, 32768u}) {
+        Buffer vertices(BufferBuilder(size_t(cubes) * floatsPerCube * sizeof(float)).storage().deviceLocal());
+        CubesPush push = {};
+        push.vertexBufferRID = vertices.rid();
+        push.rotationAngle = 0.5f;
+        uint32_t tuned = context.subgroupLocalSize();
+        Pipeline single = createComputePipeline(shader, SpecConstants().localSize(shader.reflection, 1).set(1, cubes));
+        Pipeline wide = createComputePipeline(shader, SpecConstants().localSize(shader.reflection, tuned).set(1, cubes));
+
+        const int repeats = 32;
+        GpuTimer timer(2);
+        for (int run = 0; run < 3; ++run) {   // first runs warm clocks and caches
+            auto cmd = Commands::oneShot();
+            cmd.pushConstants(push);
+            timer.begin(cmd);
+            cmd.bindCompute(single);
+            for (int i = 0; i < repeats; ++i) cmd.dispatchThreads(cubes);
+            timer.mark(cmd, "local size 1");
+            cmd.bindCompute(wide);
+            for (int i = 0; i < repeats; ++i) cmd.dispatchThreads(cubes);
+            timer.mark(cmd, "subgroup-sized");
+            cmd.submitAndWait();
+        }
+        std::cout << cubes << " cubes (local size " << tuned << ", " << repeats << " dispatches each):\n";
+        for (auto& [label, ms] : timer.resolve()) {
+            std::cout << "  " << label << ": " << ms / repeats << " ms per dispatch\n";
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("dispatch", argc, argv, [] {
+        VulkanContext context(VulkanContextOptions().offscreenSize(64, 64).jobWorkers(0).validation().throwOnValidationError());
+        testReflection();
+        testSubgroupProperties();
+        testDispatchThreads();
+        testLocalSizeLimits();
+    }, bench);
+}
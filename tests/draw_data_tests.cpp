@@ -0,0 +1,104 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// DrawDataRing: argument and Frame checks, slots aligned to the written type's size within the
+// current frame's region, exhaustion, and a shader reading items[slot] from the ring across
+// more frames than the swapchain has images, so every region is reused while each frame's
+// dispatch still sees its own data.
+
+namespace {
+
+struct Item {
+    uint32_t v[4];
+};
+
+struct Globals {   // 12 bytes, so the Items after it need realigning
+    uint32_t a, b, c;
+};
+
+struct FetchPush {
+    uint32_t ringRID;
+    uint32_t firstSlot;
+    uint32_t count;
+    uint32_t outRID;
+    uint32_t outOffset;
+};
+
+void testSlots() {
+    expectThrow([] { DrawDataRing ring(0); }, "zero-byte region");
+    DrawDataRing ring(480);   // a multiple of 12 and 16, so every region starts on a slot of either
+    expectThrow([&] { ring.beginFrame(); }, "beginFrame outside a Frame");
+
+    Frame frame;
+    Commands cmd = frame.beginCommands();
+    ring.beginFrame();
+    size_t regionStart = frame.inFlight() * ring.bytesPerFrame();
+    uint32_t globals = ring.write(Globals{1, 2, 3});
+    if (size_t(globals) * sizeof(Globals) != regionStart) throw std::runtime_error("first slot not at the region start");
+    uint32_t first = ring.write(Item{});
+    size_t offset = size_t(first) * sizeof(Item);
+    if (offset < regionStart + sizeof(Globals) || offset >= regionStart + sizeof(Globals) + sizeof(Item)) {
+        throw std::runtime_error("Item slot not the next 16-byte boundary");
+    }
+    if (ring.write(Item{}) != first + 1) throw std::runtime_error("consecutive Items not in consecutive slots");
+    if (ring.bytesUsed() != offset + 2 * sizeof(Item) - regionStart) throw std::runtime_error("bytesUsed");
+    expectThrow([&] { ring.write(&globals, 4, 6); }, "stride not a multiple of 4");
+    expectThrow([&] { for (int i = 0; i < 32; ++i) ring.write(Item{}); }, "region exhaustion");
+    ring.flush();
+    frame.submit(cmd);
+    g_context().waitIdle();
+}
+
+void testShaderReads() {
+    const uint32_t kItems = 32;
+    const uint32_t frames = 3 * (uint32_t)g_context().swapchainImageCount + 1;
+    ShaderModule shader(ShaderBuilder().compute().fromFile("tests/shaders/draw_data_fetch.comp.spv"));
+    Pipeline pipeline = createComputePipeline(shader);
+    DrawDataRing ring(sizeof(Globals) + (kItems + 1) * sizeof(Item));
+    Buffer out(BufferBuilder(frames * kItems * sizeof(uint32_t)).storage().readback());
+
+    for (uint32_t f = 0; f < frames; ++f) {
+        Frame frame;
+        Commands cmd = frame.beginCommands();
+        ring.beginFrame();
+        ring.write(Globals{f, f, f});
+        uint32_t firstSlot = ring.write(Item{{f, 0, 1000, 0}});
+        for (uint32_t i = 1; i < kItems; ++i) ring.write(Item{{f, i, 1000, 0}});
+        ring.flush();
+
+        FetchPush push = {ring.rid(), firstSlot, kItems, out.rid(), f * kItems};
+        cmd.bindCompute(pipeline);
+        cmd.pushConstants(push);
+        cmd.dispatch(1, 1, 1);
+        cmd.bufferBarrier(out, Stage::Compute, Access::ShaderWrite, Stage::Host, Access::HostRead);
+        frame.submit(cmd);
+    }
+    g_context().waitIdle();
+
+    std::vector<uint32_t> got(frames * kItems);
+    out.invalidate();
+    out.download(got.data(), got.size() * sizeof(uint32_t));
+    for (uint32_t f = 0; f < frames; ++f) {
+        for (uint32_t i = 0; i < kItems; ++i) {
+            uint32_t want = f + i + 1000;
+            if (got[f * kItems + i] != want) {
+                throw std::runtime_error("frame " + std::to_string(f) + " item " + std::to_string(i) + ": got " +
+                                         std::to_string(got[f * kItems + i]) + ", want " + std::to_string(want));
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("draw data", argc, argv, [] {
+        TestContext ctx;
+        testSlots();
+        testShaderReads();
+    });
+}
@@ -0,0 +1,154 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// DrawList without a device: key fields order pass > pipeline > material > depth, equal keys
+// replay in bucket then submission order on both the std::stable_sort and the radix path,
+// redundant binds and identical push constants are elided, and a list cleared and refilled
+// with the same number of packets is re-sorted before replay.
+
+namespace {
+
+// Handles are never dereferenced here, only compared and hashed.
+template<typename Handle>
+Handle fakeHandle(uintptr_t id) { return reinterpret_cast<Handle>(id * 0x1000); }
+
+VkPipeline fakePipeline(uintptr_t id) { return fakeHandle<VkPipeline>(id); }
+
+// Stands in for Commands: logs what replay() records.
+struct Recorder {
+    struct Call {
+        char kind;   // 'b' bind, 'p' push, 'd' draw, 'i' indirect draw
+        uint64_t value;
+    };
+    std::vector<Call> calls;
+
+    void bindGraphics(VkPipeline pipeline) { calls.push_back({'b', (uint64_t)pipeline}); }
+    void pushConstants(const void* data, uint32_t size) {
+        uint32_t first = 0;
+        std::memcpy(&first, data, std::min<uint32_t>(size, 4));
+        calls.push_back({'p', first});
+    }
+    void drawMeshTasks(uint32_t x, uint32_t, uint32_t) { calls.push_back({'d', x}); }
+    void drawMeshTasksIndirect(VkBuffer, uint32_t drawCount, VkDeviceSize, uint32_t) { calls.push_back({'i', drawCount}); }
+
+    // The x group counts (draw ids) in replay order.
+    std::vector<uint64_t> draws() const {
+        std::vector<uint64_t> out;
+        for (const Call& c : calls) {
+            if (c.kind == 'd' || c.kind == 'i') out.push_back(c.value);
+        }
+        return out;
+    }
+};
+
+void testKeyOrder() {
+    VkPipeline a = fakePipeline(1), b = fakePipeline(2);
+    if (!(DrawList::key(0, b, 999, 1.0f) < DrawList::key(1, a, 0, 0.0f))) throw std::runtime_error("pass is not the top field");
+    if (!(DrawList::key(0, a, 5, 0.5f) < DrawList::key(0, a, 6, 0.0f))) throw std::runtime_error("material does not beat depth");
+    if (!(DrawList::key(0, a, 5, 0.25f) < DrawList::key(0, a, 5, 0.75f))) throw std::runtime_error("depth not front to back");
+    if (!(DrawList::key(0, a, 5, 0.75f, true) < DrawList::key(0, a, 5, 0.25f, true))) throw std::runtime_error("backToFront");
+    if (DrawList::key(0, a, 5, -3.0f) != DrawList::key(0, a, 5, 0.0f) || DrawList::key(0, a, 5, 7.0f) != DrawList::key(0, a, 5, 1.0f)) {
+        throw std::runtime_error("depth not clamped to [0, 1]");
+    }
+    // Pipelines group together whatever their material or depth.
+    uint64_t pa = DrawList::key(0, a, 0, 0.0f) >> 48, pb = DrawList::key(0, b, 0, 0.0f) >> 48;
+    if (pa == pb) throw std::runtime_error("pipeline hash collided for adjacent handles");
+    VkPipeline low = pa < pb ? a : b, high = pa < pb ? b : a;
+    if (!(DrawList::key(0, low, (1u << 24) - 1, 1.0f) < DrawList::key(0, high, 0, 0.0f))) {
+        throw std::runtime_error("pipeline is not above material and depth");
+    }
+
+    DrawList list;
+    uint32_t push = 0;
+    list.bucket(0).draw(DrawList::key(2, a, 0, 0.0f), a, push, 3);
+    list.bucket(0).draw(DrawList::key(0, a, 0, 0.9f), a, push, 2);
+    list.bucket(0).draw(DrawList::key(0, a, 0, 0.1f), a, push, 1);
+    Recorder out;
+    list.replay(out);
+    if (out.draws() != std::vector<uint64_t>{1, 2, 3}) throw std::runtime_error("replay not in key order");
+}
+
+// `count` packets, all with one of two keys, spread over three buckets; equal keys must come
+// back in bucket order, then submission order.
+void testStability(uint32_t count) {
+    VkPipeline pipeline = fakePipeline(7);
+    uint64_t keys[2] = {DrawList::key(0, pipeline, 3, 0.5f), DrawList::key(0, pipeline, 1, 0.5f)};
+    DrawList list(3);
+    std::vector<uint64_t> expected[2];
+    uint32_t id = 0;
+    for (uint32_t bucket = 0; bucket < 3; ++bucket) {
+        for (uint32_t i = 0; i < count / 3; ++i, ++id) {
+            uint32_t which = (id * 7) % 3 == 0;
+            list.bucket(bucket).draw(keys[which], pipeline, id, id);
+            expected[which].push_back(id);
+        }
+    }
+    std::vector<uint64_t> want = expected[1];   // keys[1] sorts first
+    want.insert(want.end(), expected[0].begin(), expected[0].end());
+    Recorder out;
+    list.replay(out);
+    if (out.draws() != want) throw std::runtime_error("equal keys reordered with " + std::to_string(count) + " packets");
+}
+
+void testElision() {
+    VkPipeline a = fakePipeline(1), b = fakePipeline(2);
+    uint32_t same = 42, other = 43;
+    DrawList list;
+    DrawList::Bucket& bucket = list.bucket(0);
+    uint64_t key = DrawList::key(0, a, 0, 0.5f);
+    bucket.draw(key, a, same, 1);
+    bucket.draw(key, a, same, 2);                        // same pipeline, same bytes: draw only
+    bucket.draw(key, a, other, 3);                       // new bytes: push
+    bucket.drawIndirect(key, a, other, fakeHandle<VkBuffer>(9), 4);   // indirect, nothing new
+    bucket.draw(DrawList::key(1, b, 0, 0.5f), b, other, 5);   // new pipeline, push survives it
+    Recorder out;
+    DrawReplayStats stats = list.replay(out);
+    if (stats.draws != 5 || stats.pipelineBinds != 2 || stats.pushConstantUploads != 2) {
+        throw std::runtime_error("elision stats " + std::to_string(stats.pipelineBinds) + " binds, " +
+                                 std::to_string(stats.pushConstantUploads) + " uploads");
+    }
+    std::string kinds;
+    for (auto& call : out.calls) kinds += call.kind;
+    if (kinds != "bpddpdibd") throw std::runtime_error("recorded sequence " + kinds);
+}
+
+void testRefillSameCount() {
+    VkPipeline pipeline = fakePipeline(3);
+    uint32_t push = 0;
+    DrawList list;
+    for (uint32_t i = 0; i < 4; ++i) list.bucket(0).draw(DrawList::key(0, pipeline, i, 0.0f), pipeline, push, 10 + i);
+    Recorder first;
+    list.replay(first);
+    if (first.draws() != std::vector<uint64_t>{10, 11, 12, 13}) throw std::runtime_error("first frame order");
+
+    // Same packet count, opposite key order: a size comparison alone would replay stale indices.
+    list.clear();
+    for (uint32_t i = 0; i < 4; ++i) list.bucket(0).draw(DrawList::key(0, pipeline, 3 - i, 0.0f), pipeline, push, 20 + i);
+    Recorder second;
+    list.replay(second);
+    if (second.draws() != std::vector<uint64_t>{23, 22, 21, 20}) throw std::runtime_error("refilled list replayed stale order");
+
+    // Nothing changed: replaying again records the same thing without re-sorting.
+    Recorder third;
+    list.replay(third);
+    if (third.draws() != second.draws()) throw std::runtime_error("repeat replay");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("draw list", argc, argv, [] {
+        testKeyOrder();
+        testStability(30);     // std::stable_sort
+        testStability(3000);   // radix sort
+        testElision();
+        testRefillSameCount();
+    });
+}
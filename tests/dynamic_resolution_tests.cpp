@@ -0,0 +1,169 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// DynamicResolution: argument checks, an over-budget pass dropping straight to minScale, an
+// under-budget pass recovering by at most 2% per frame up to maxScale, resize() keeping the
+// scale, resize() re-fitting the per-slot queries after the swapchain image count grows, and a pass rendered with beginRenderingOffscreen(view, extent()) touching only the
+// top-left extent() sub-rect of a max-size target, as the demo's upscale relies on.
+
+namespace {
+
+constexpr VkExtent2D kMaxExtent = {200, 100};
+
+// One Frame whose measured pass is `pass`.
+template<typename F>
+void runFrame(DynamicResolution& dynres, F&& pass) {
+    Frame frame;
+    Commands cmd = frame.beginCommands();
+    dynres.begin(cmd);
+    pass(cmd);
+    dynres.end(cmd);
+    frame.submit(cmd);
+}
+
+void runFrame(DynamicResolution& dynres) {
+    runFrame(dynres, [](Commands&) {});
+}
+
+void testArguments() {
+    expectThrow([] { DynamicResolution(kMaxExtent, 0.0f); }, "zero budget");
+    expectThrow([] { DynamicResolution(kMaxExtent, 1.0f, 0.8f, 0.5f); }, "minScale above maxScale");
+    expectThrow([] { DynamicResolution(kMaxExtent, 1.0f, 0.5f, 1.5f); }, "maxScale above 1");
+    expectThrow([] { DynamicResolution(kMaxExtent, 1.0f, 0.0f); }, "zero minScale");
+    DynamicResolution dynres(kMaxExtent, 1.0f);
+    expectThrow([&] { dynres.resize({0, 100}); }, "zero-width resize");
+    auto cmd = Commands::oneShot();
+    expectThrow([&] { dynres.begin(cmd); }, "begin outside a Frame");
+    if (dynres.extent().width != kMaxExtent.width || dynres.scale() != 1.0f) throw std::runtime_error("initial extent");
+}
+
+void testController() {
+    const int settle = 3 * (int)g_context().swapchainImageCount + 2;
+
+    // No pass fits a nanosecond budget: the first sample drops straight to minScale.
+    DynamicResolution dynres(kMaxExtent, 1e-6f, 0.5f, 1.0f);
+    for (int i = 0; i < settle; ++i) runFrame(dynres);
+    if (dynres.scale() != 0.5f || dynres.extent().width != 100 || dynres.extent().height != 50) {
+        throw std::runtime_error("over budget did not drop to minScale, scale " + std::to_string(dynres.scale()));
+    }
+    if (dynres.uvScale()[0] != 0.5f || dynres.uvScale()[1] != 0.5f) throw std::runtime_error("uvScale at minScale");
+
+    // Everything fits a second: growth is gradual and ends at maxScale.
+    dynres.budget(1000.0f);
+    float previous = dynres.scale();
+    for (int i = 0; i < 60; ++i) {
+        runFrame(dynres);
+        float step = dynres.scale() - previous;
+        if (step < 0.0f || step > 0.02f + 1e-5f) throw std::runtime_error("recovery step " + std::to_string(step));
+        previous = dynres.scale();
+    }
+    if (dynres.scale() != 1.0f || dynres.extent().width != kMaxExtent.width) throw std::runtime_error("did not recover to maxScale");
+
+    dynres.budget(1e-6f);
+    for (int i = 0; i < settle; ++i) runFrame(dynres);
+    dynres.resize({300, 150});
+    if (dynres.extent().width != 150 || dynres.extent().height != 75) throw std::runtime_error("resize lost the scale");
+    g_context().waitIdle();
+}
+
+void testSlotCountChange() {
+    VulkanContext& context = g_context();
+    const size_t count = context.swapchainImageCount;
+
+    // Line the ring up so the next Frame is slot 0, then build against one slot fewer.
+    for (bool last = false; !last;) {
+        Frame frame;
+        Commands cmd = frame.beginCommands();
+        last = frame.inFlight() == count - 1;
+        frame.submit(cmd);
+    }
+    context.swapchainImageCount = count - 1;
+    DynamicResolution dynres(kMaxExtent, 1000.0f, 0.5f, 1.0f);
+    for (size_t i = 0; i < 2 * count; ++i) runFrame(dynres);
+    context.waitIdle();
+    context.swapchainImageCount = count;
+
+    // The ring is back at slot 0; slot count - 1 has no query until resize() re-fits.
+    for (size_t i = 0; i + 1 < count; ++i) runFrame(dynres);
+    {
+        Frame frame;
+        Commands cmd = frame.beginCommands();
+        expectThrow([&] { dynres.begin(cmd); }, "begin in a slot past the old image count");
+        frame.submit(cmd);
+    }
+    context.waitIdle();
+
+    dynres.resize(kMaxExtent);
+    for (size_t i = 0; i < 3 * count + 2; ++i) runFrame(dynres);
+    context.waitIdle();
+    if (dynres.gpuMillis() <= 0.0) throw std::runtime_error("no samples after the slot count grew");
+    if (dynres.extent().width != kMaxExtent.width) throw std::runtime_error("re-fit lost the extent");
+}
+
+void testSubRect() {
+    DynamicResolution dynres(kMaxExtent, 1e-6f, 0.5f, 1.0f);
+    for (int i = 0; i < 3 * (int)g_context().swapchainImageCount + 2; ++i) runFrame(dynres);
+
+    ImageBuilder builder = ImageBuilder().colorTarget(kMaxExtent.width, kMaxExtent.height, VK_FORMAT_R8G8B8A8_UNORM);
+    auto setup = Commands::oneShot();
+    Image target(builder, setup);
+    setup.submitAndWait();
+    Buffer readback(BufferBuilder(kMaxExtent.width * kMaxExtent.height * 4).readback().transferDestination());
+
+    // Fill the whole target white, then clear the pass's render area (transparent black).
+    VkExtent2D rendered = {};
+    runFrame(dynres, [&](Commands& cmd) {
+        rendered = dynres.extent();
+        cmd.imageBarrier(target, Stage::None, Access::None, Layout::Undefined, Stage::Transfer, Access::TransferWrite, Layout::TransferDst);
+        VkClearColorValue white = {{1.0f, 1.0f, 1.0f, 1.0f}};
+        VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdClearColorImage(cmd, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1, &range);
+        cmd.imageBarrier(target, Stage::Transfer, Access::TransferWrite, Layout::TransferDst,
+                         Stage::ColorOutput, Access::ColorAttachmentWrite, Layout::ColorAttachment);
+        cmd.beginRenderingOffscreen(target.imageView, rendered);
+        cmd.endRendering();
+        cmd.imageBarrier(target, Stage::ColorOutput, Access::ColorAttachmentWrite, Layout::ColorAttachment,
+                         Stage::Transfer, Access::TransferRead, Layout::TransferSrc);
+        VkBufferImageCopy region = {};
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent = {kMaxExtent.width, kMaxExtent.height, 1};
+        vkCmdCopyImageToBuffer(cmd, target, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback, 1, &region);
+        cmd.bufferBarrier(readback, Stage::Transfer, Access::TransferWrite, Stage::Host, Access::HostRead);
+    });
+    g_context().waitIdle();
+    if (rendered.width != 100 || rendered.height != 50) throw std::runtime_error("pass did not run at minScale");
+
+    std::vector<uint8_t> pixels(kMaxExtent.width * kMaxExtent.height * 4);
+    readback.invalidate();
+    readback.download(pixels.data(), pixels.size());
+    for (uint32_t y = 0; y < kMaxExtent.height; ++y) {
+        for (uint32_t x = 0; x < kMaxExtent.width; ++x) {
+            bool inside = x < rendered.width && y < rendered.height;
+            uint8_t want = inside ? 0 : 255;
+            const uint8_t* p = &pixels[(y * kMaxExtent.width + x) * 4];
+            if (p[0] != want || p[3] != want) {
+                throw std::runtime_error("pixel " + std::to_string(x) + "," + std::to_string(y) +
+                                         (inside ? " inside the render area kept its fill" : " outside the render area was cleared"));
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("dynamic resolution", argc, argv, [] {
+        TestContext ctx;
+        testArguments();
+        testController();
+        testSlotCountChange();
+        testSubRect();
+    });
+}
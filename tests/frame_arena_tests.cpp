@@ -0,0 +1,180 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// FrameArena and allocation-free recording: the arena aligns, reuses its blocks after reset()
+// and takes oversized requests, and once warmed up, recording the demo's per-frame command
+// sequence (geometry barrier, BLAS/TLAS rebuild, multi-target rendering, batched and image
+// barriers, GPU timer marks and resolve) makes zero operator new calls.
+
+namespace {
+
+// Counts global operator new calls while `counting` is set, on any thread.
+std::atomic<bool> counting{false};
+std::atomic<uint64_t> allocations{0};
+int * volatile sink;   // keeps the sanity-check allocation from being elided
+
+void * countedAlloc(std::size_t size) {
+    if (counting.load(std::memory_order_relaxed)) allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void * p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void * countedAlignedAlloc(std::size_t size, std::align_val_t alignment) {
+    if (counting.load(std::memory_order_relaxed)) allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    size = (std::max<size_t>(size, 1) + align - 1) & ~(align - 1);
+    if (void * p = std::aligned_alloc(align, size)) return p;
+    throw std::bad_alloc();
+}
+
+// Allocations made by `fn`.
+template<typename F>
+uint64_t countAllocations(F && fn) {
+    allocations = 0;
+    counting = true;
+    fn();
+    counting = false;
+    return allocations.load();
+}
+
+} // namespace
+
+void * operator new(std::size_t size) { return countedAlloc(size); }
+void * operator new[](std::size_t size) { return countedAlloc(size); }
+void * operator new(std::size_t size, std::align_val_t alignment) { return countedAlignedAlloc(size, alignment); }
+void * operator new[](std::size_t size, std::align_val_t alignment) { return countedAlignedAlloc(size, alignment); }
+void operator delete(void * p) noexcept { std::free(p); }
+void operator delete[](void * p) noexcept { std::free(p); }
+void operator delete(void * p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void * p, std::size_t) noexcept { std::free(p); }
+void operator delete(void * p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void * p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void * p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void * p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+void testArena() {
+    FrameArena arena(256);
+    arena.allocate<uint8_t>(3);
+    double* d = arena.allocate<double>(2);
+    if (reinterpret_cast<uintptr_t>(d) % alignof(double) != 0) throw std::runtime_error("unaligned arena allocation");
+    if (arena.bytesUsed() != 24) throw std::runtime_error("bytesUsed() bookkeeping");
+
+    // Larger than a block: gets a block of its own.
+    uint8_t* big = arena.allocate<uint8_t>(1000);
+    big[999] = 1;
+    size_t reserved = arena.bytesReserved();
+    if (reserved < 1000 + 256) throw std::runtime_error("oversized request not given its own block");
+
+    // After reset() the same sequence lands in the same memory, with no new blocks.
+    arena.reset();
+    if (arena.bytesUsed() != 0) throw std::runtime_error("reset() kept bytesUsed");
+    uint64_t count = countAllocations([&] {
+        for (int frame = 0; frame < 10; ++frame) {
+            arena.reset();
+            arena.allocate<uint8_t>(3);
+            if (arena.allocate<double>(2) != d) throw std::runtime_error("reset() did not rewind to the first block");
+            arena.allocate<uint8_t>(1000);
+        }
+    });
+    if (count != 0 || arena.bytesReserved() != reserved) throw std::runtime_error("a warmed-up arena allocated");
+
+    if (countAllocations([] { sink = new int(1); }) != 1) throw std::runtime_error("operator new is not being counted");
+    delete sink;
+}
+
+void testSteadyStateRecording() {
+    // The demo's per-frame resources, at test size.
+    const uint32_t vertexCount = 36 * 4;
+    Buffer vertices(BufferBuilder(sizeof(float) * 8 * vertexCount).storage().accelerationStructureInput().transferDestination());
+    Buffer lights(BufferBuilder(256).storage().transferDestination());
+    BlasBuilder blasBuilder;
+    blasBuilder.addGeometry(BlasGeometry(vertices).vertexCount(vertexCount / 2).vertexStrideBytes(sizeof(float) * 8)
+                                .triangleCount(vertexCount / 6));
+    blasBuilder.addGeometry(BlasGeometry(vertices).vertexCount(vertexCount).vertexStrideBytes(sizeof(float) * 8)
+                                .triangleCount(vertexCount / 3));
+    Blas blas(blasBuilder);
+    Tlas tlas(1);
+    TlasInstances instances;
+
+    Commands setup = Commands::oneShot();
+    Image depth(ImageBuilder().depth(), setup);
+    std::vector<Image> colors;
+    for (int i = 0; i < 2; ++i) colors.emplace_back(ImageBuilder().colorTarget(64, 64), setup);
+    setup.submitAndWait();
+    VkImageView colorViews[] = { colors[0].imageView, colors[1].imageView };
+    GpuTimer timer(3);
+
+    auto recordFrame = [&](Commands & cmd) {
+        timer.resolve();   // the previous frame's timings, as a frame loop reads them
+        timer.begin(cmd);
+        cmd.fillBuffer(vertices, 0);   // stands in for the demo's compute pass
+        cmd.bufferBarrier(vertices, Stage::Transfer, Access::TransferWrite,
+                          Stage::AccelStructureBuild, Access::AccelStructureRead);
+        timer.mark(cmd, "geometry");
+
+        cmd.buildBlas(blas, false);
+        VkBuffer backing = blas.backing();
+        cmd.blasToTlasBarrier(std::span<const VkBuffer>(&backing, 1));
+        instances.clear();
+        instances.add(blas, 0);
+        cmd.buildTlas(tlas, instances);
+        cmd.tlasToShaderReadBarrier(tlas.backing());
+        timer.mark(cmd, "acceleration structures");
+
+        cmd.beginRendering(std::span<const VkImageView>(colorViews), depth.imageView, {64, 64});
+        cmd.endRendering();
+        for (Image & color : colors) {
+            Barrier(cmd).image(color, 1)
+                .from(Stage::ColorOutput, Access::ColorAttachmentWrite, Layout::ColorAttachment)
+                .to(Stage::Fragment, Access::ShaderRead, Layout::ShaderReadOnly)
+                .record();
+            Barrier(cmd).image(color, 1)
+                .from(Stage::Fragment, Access::ShaderRead, Layout::ShaderReadOnly)
+                .to(Stage::ColorOutput, Access::ColorAttachmentWrite, Layout::ColorAttachment)
+                .record();
+        }
+        BufferBarrierDesc barriers[] = {
+            {vertices, Stage::AccelStructureBuild, Access::AccelStructureRead, Stage::Transfer, Access::TransferWrite},
+            {lights, Stage::Transfer, Access::TransferWrite, Stage::Fragment, Access::ShaderRead},
+        };
+        cmd.bufferBarriers(barriers);
+        timer.mark(cmd, "main pass");
+    };
+
+    // Warm-up frames size the setup arena and the reused vectors.
+    uint64_t steadyAllocations = 0;
+    for (int frame = 0; frame < 8; ++frame) {
+        Commands cmd = Commands::oneShot();
+        uint64_t count = countAllocations([&] { recordFrame(cmd); });
+        cmd.submitAndWait();
+        if (frame >= 3) steadyAllocations += count;
+    }
+    if (steadyAllocations != 0) {
+        throw std::runtime_error("steady-state recording made " + std::to_string(steadyAllocations) +
+                                 " operator new calls");
+    }
+    if (timer.resolve().size() != 3) throw std::runtime_error("GpuTimer did not resolve its marks");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("frame arena", argc, argv, [] {
+        testArena();
+        // Counting runs without validation: the layers allocate inside vkCmd* calls.
+        TestContext ctx(VulkanContextOptions().rayTracing(), false);
+        testSteadyStateRecording();
+    });
+}
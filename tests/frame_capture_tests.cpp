@@ -0,0 +1,186 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// FrameCapture of an offscreen image through both encoders: the TGA and QOI files written by
+// the worker decode back to the uploaded pixels, including two captures recorded into one
+// Commands before it was submitted, and a swapchain capture at the swapchain's own extent.
+
+namespace {
+
+constexpr uint32_t kWidth = 61, kHeight = 37;
+
+// Flat regions, gradients and noise, so every QOI op is exercised.
+std::vector<uint8_t> testPixels() {
+    std::mt19937 rng(89);
+    std::vector<uint8_t> rgba(kWidth * kHeight * 4);
+    for (uint32_t y = 0; y < kHeight; ++y) {
+        for (uint32_t x = 0; x < kWidth; ++x) {
+            uint8_t* p = &rgba[(y * kWidth + x) * 4];
+            if (y < 8) { p[0] = 20; p[1] = 40; p[2] = 60; }
+            else if (y < 20) { p[0] = uint8_t(x * 4); p[1] = uint8_t(y * 3); p[2] = uint8_t(x + y); }
+            else { p[0] = uint8_t(rng()); p[1] = uint8_t(rng()); p[2] = uint8_t(rng()); }
+            p[3] = 255;
+        }
+    }
+    return rgba;
+}
+
+std::vector<uint8_t> readAll(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) throw std::runtime_error("capture not written: " + path);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+// RGB rows, top first.
+std::vector<uint8_t> decodeTga(const std::vector<uint8_t>& file, uint32_t& w, uint32_t& h) {
+    if (file.size() < 18 || file[2] != 2 || file[16] != 24 || !(file[17] & 0x20)) throw std::runtime_error("bad TGA header");
+    w = file[12] | (file[13] << 8);
+    h = file[14] | (file[15] << 8);
+    std::vector<uint8_t> rgb(size_t(w) * h * 3);
+    for (size_t i = 0; i < size_t(w) * h; ++i) {
+        rgb[i * 3 + 0] = file[18 + i * 3 + 2];
+        rgb[i * 3 + 1] = file[18 + i * 3 + 1];
+        rgb[i * 3 + 2] = file[18 + i * 3 + 0];
+    }
+    return rgb;
+}
+
+std::vector<uint8_t> decodeQoi(const std::vector<uint8_t>& file, uint32_t& w, uint32_t& h) {
+    if (file.size() < 22 || std::string(file.begin(), file.begin() + 4) != "qoif") throw std::runtime_error("bad QOI header");
+    w = (file[4] << 24) | (file[5] << 16) | (file[6] << 8) | file[7];
+    h = (file[8] << 24) | (file[9] << 16) | (file[10] << 8) | file[11];
+    struct Px { uint8_t r, g, b, a; };
+    Px index[64] = {};
+    Px px = { 0, 0, 0, 255 };
+    size_t p = 14;
+    uint32_t run = 0;
+    std::vector<uint8_t> rgb;
+    for (size_t i = 0; i < size_t(w) * h; ++i) {
+        if (run > 0) {
+            --run;
+        } else {
+            uint8_t b1 = file.at(p++);
+            if (b1 == 0xFE) { px.r = file.at(p++); px.g = file.at(p++); px.b = file.at(p++); }
+            else if (b1 == 0xFF) { px.r = file.at(p++); px.g = file.at(p++); px.b = file.at(p++); px.a = file.at(p++); }
+            else if ((b1 & 0xC0) == 0x00) px = index[b1];
+            else if ((b1 & 0xC0) == 0x40) { px.r += ((b1 >> 4) & 3) - 2; px.g += ((b1 >> 2) & 3) - 2; px.b += (b1 & 3) - 2; }
+            else if ((b1 & 0xC0) == 0x80) {
+                uint8_t b2 = file.at(p++);
+                int dg = (b1 & 0x3F) - 32;
+                px.r += dg - 8 + ((b2 >> 4) & 0xF);
+                px.g += dg;
+                px.b += dg - 8 + (b2 & 0xF);
+            }
+            else run = b1 & 0x3F;
+            index[(px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64] = px;
+        }
+        rgb.insert(rgb.end(), { px.r, px.g, px.b });
+    }
+    return rgb;
+}
+
+void testCapture(CaptureFormat format, const char* extension) {
+    std::vector<uint8_t> rgba = testPixels();
+    BufferBuilder stagingBuilder(rgba.size());
+    stagingBuilder.transferSource().hostVisible();
+    Buffer staging(stagingBuilder);
+    staging.upload(rgba.data(), rgba.size());
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / ("vkobjects-capture-" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+    std::string pattern = (dir / (std::string("shot_%02u") + extension)).string();
+    {
+        FrameCapture capture(pattern, format);
+        auto setup = Commands::oneShot();
+        ImageBuilder imageBuilder;
+        imageBuilder.fromStagingBuffer(staging, kWidth, kHeight, VK_FORMAT_R8G8B8A8_UNORM).createMipmaps(false);
+        Image image(imageBuilder, setup);
+        setup.submitAndWait();
+
+        // Two captures in one Commands: the second must not hand the first's still unsubmitted
+        // copy to the worker. Then a third after the submit is reported.
+        auto shoot = [&](Commands& cmd) {
+            if (!capture.capture(cmd, image, Layout::ShaderReadOnly, Stage::Fragment, Access::ShaderRead)) {
+                throw std::runtime_error("capture dropped with free slots");
+            }
+        };
+        auto cmd = Commands::oneShot();
+        shoot(cmd);
+        shoot(cmd);
+        cmd.submitAndWait();
+        capture.submitted();
+        auto last = Commands::oneShot();
+        shoot(last);
+        last.submitAndWait();
+        capture.flush();
+        if (capture.written() != 3 || capture.failed() != 0 || capture.dropped() != 0) {
+            throw std::runtime_error("expected three written captures");
+        }
+    }
+
+    for (const char* name : { "shot_00", "shot_01", "shot_02" }) {
+        std::vector<uint8_t> file = readAll((dir / (std::string(name) + extension)).string());
+        uint32_t w = 0, h = 0;
+        std::vector<uint8_t> rgb = format == CaptureFormat::Qoi ? decodeQoi(file, w, h) : decodeTga(file, w, h);
+        if (w != kWidth || h != kHeight) throw std::runtime_error(std::string(extension) + " capture has the wrong size");
+        for (size_t i = 0; i < size_t(w) * h; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                if (rgb[i * 3 + c] != rgba[i * 4 + c]) {
+                    throw std::runtime_error(std::string(extension) + " capture differs at pixel " + std::to_string(i));
+                }
+            }
+        }
+    }
+    std::filesystem::remove_all(dir);
+}
+
+// The swapchain capture has the size the swapchain images were created with.
+void testSwapchain() {
+    VulkanContext& context = g_context();
+    if (!context.swapchainCapturable()) {
+        std::cout << "frame capture: swapchain lacks transfer source usage, skipping\n";
+        return;
+    }
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / ("vkobjects-capture-swap-" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+    {
+        FrameCapture capture((dir / "swap_%02u.tga").string());
+        Frame frame;
+        Commands cmd = frame.beginCommands();
+        if (!capture.captureSwapchain(cmd)) throw std::runtime_error("swapchain capture dropped");
+        frame.submit(cmd);
+        capture.flush();
+        if (capture.written() != 1) throw std::runtime_error("swapchain capture not written");
+    }
+    std::vector<uint8_t> file = readAll((dir / "swap_00.tga").string());
+    uint32_t w = 0, h = 0;
+    decodeTga(file, w, h);
+    VkExtent2D extent = context.swapchainExtent();
+    if (w != extent.width || h != extent.height) {
+        throw std::runtime_error("swapchain capture is " + std::to_string(w) + "x" + std::to_string(h) + ", swapchain is " +
+                                 std::to_string(extent.width) + "x" + std::to_string(extent.height));
+    }
+    std::filesystem::remove_all(dir);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("frame capture", argc, argv, [] {
+        TestContext ctx;
+        testCapture(CaptureFormat::Tga, ".tga");
+        testCapture(CaptureFormat::Qoi, ".qoi");
+        testSwapchain();
+    });
+}
@@ -0,0 +1,186 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Runtime GLSL: defines reach the compiled module (checked through reflection), the SPIR-V
+// cache hits on a repeat, misses when a define or an #included file changes and recompiles a
+// corrupt entry, compile errors carry the compiler's message, and compileAll matches serial
+// compiles. `--bench` compares cold and warm compiles of a set of permutations with reading
+// the build's precompiled .spv.
+
+namespace {
+
+const char * kKernel = R"(#version 460
+#include "common.glsl"
+layout(local_size_x = LOCAL_SIZE) in;
+layout(set = 0, binding = 0) buffer StorageBuffers { uint data[]; } storageBuffers[];
+layout(push_constant) uniform Push { uint outRID; } pc;
+void main() {
+    storageBuffers[pc.outRID].data[gl_GlobalInvocationID.x] = SCALE * gl_GlobalInvocationID.x;
+}
+)";
+
+struct TempDir {
+    std::filesystem::path path;
+    TempDir() {
+        path = std::filesystem::temp_directory_path() / ("vkobjects-glsl-" + std::to_string(getpid()));
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path / "cache");
+    }
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+void writeText(const std::filesystem::path& path, const std::string& text) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+}
+
+GlslSource kernel(const TempDir& dir, uint32_t localSize) {
+    GlslSource source;
+    source.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    source.source = kKernel;
+    source.name = (dir.path / "kernel.comp").string();
+    source.defines = {{"LOCAL_SIZE", std::to_string(localSize)}};
+    return source;
+}
+
+void testCache() {
+    TempDir dir;
+    writeText(dir.path / "common.glsl", "#define SCALE 3u\n");
+    GlslCompiler compiler((dir.path / "cache").string());
+
+    std::vector<uint8_t> cold = compiler.compile(kernel(dir, 64));
+    if (cold.size() < 20 || cold[0] != 0x03 || cold[3] != 0x07) throw std::runtime_error("not SPIR-V");
+    std::vector<uint8_t> warm = compiler.compile(kernel(dir, 64));
+    if (compiler.misses() != 1 || compiler.hits() != 1 || warm != cold) throw std::runtime_error("repeat compile missed the cache");
+
+    // A different define, and an edited #include, are different shaders.
+    if (compiler.cacheKey(kernel(dir, 32)) == compiler.cacheKey(kernel(dir, 64))) throw std::runtime_error("define not in the key");
+    uint64_t before = compiler.cacheKey(kernel(dir, 64));
+    writeText(dir.path / "common.glsl", "#define SCALE 5u\n");
+    uint64_t after = compiler.cacheKey(kernel(dir, 64));
+    if (before == after) throw std::runtime_error("included file not in the key");
+    if (compiler.compile(kernel(dir, 64)) == cold || compiler.misses() != 2) throw std::runtime_error("edited include served from the cache");
+
+    // A truncated entry is recompiled and rewritten.
+    std::filesystem::resize_file(compiler.path(after), 40);
+    std::vector<uint8_t> repaired = compiler.compile(kernel(dir, 64));
+    if (compiler.misses() != 3 || std::filesystem::file_size(compiler.path(after)) != 32 + repaired.size()) {
+        throw std::runtime_error("corrupt entry not recompiled");
+    }
+    compiler.compile(kernel(dir, 64));
+    if (compiler.hits() != 2) throw std::runtime_error("repaired entry not used");
+}
+
+void testErrors() {
+    GlslCompiler compiler;
+    GlslSource broken;
+    broken.source = "#version 460\nlayout(local_size_x = 1) in;\nvoid main() { undeclared = 1; }\n";
+    broken.name = "broken.comp";
+    bool threw = false;
+    try {
+        compiler.compile(broken);
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()).find("undeclared") != std::string::npos;
+    }
+    if (!threw) throw std::runtime_error("compile error without the compiler's message");
+
+    GlslSource missing = broken;
+    missing.source = "#version 460\n#include \"nowhere.glsl\"\nvoid main() {}\n";
+    threw = false;
+    try {
+        compiler.compile(missing);
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()).find("nowhere.glsl") != std::string::npos;
+    }
+    if (!threw) throw std::runtime_error("missing include not reported");
+}
+
+void testCompileAll() {
+    TempDir dir;
+    writeText(dir.path / "common.glsl", "#define SCALE 3u\n");
+    std::vector<GlslSource> sources;
+    for (uint32_t size = 1; size <= 256; size *= 2) sources.push_back(kernel(dir, size));
+    GlslCompiler compiler((dir.path / "cache").string());
+    JobSystem jobs(3);
+    std::vector<std::vector<uint8_t>> parallel = compiler.compileAll(sources, jobs);
+    GlslCompiler serial;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (parallel[i] != serial.compile(sources[i])) throw std::runtime_error("compileAll differs from compile");
+    }
+    compiler.compileAll(sources, jobs);
+    if (compiler.hits() != sources.size()) throw std::runtime_error("compileAll did not use the cache");
+}
+
+void testShaderBuilder() {
+    TempDir dir;
+    writeText(dir.path / "common.glsl", "#define SCALE 3u\n");
+    writeText(dir.path / "kernel.comp", kKernel);
+    VulkanContext context(VulkanContextOptions().validation().throwOnValidationError()
+                              .glslCache((dir.path / "cache").string()));
+    ShaderModule module(ShaderBuilder().compute().fromGlslFile((dir.path / "kernel.comp").string().c_str(),
+                                                               {{"LOCAL_SIZE", "128"}}));
+    if (module.reflection.localSize[0] != 128) throw std::runtime_error("define did not reach the module");
+    if (module.reflection.pushConstantSize != 4) throw std::runtime_error("reflection of a runtime-compiled module");
+    if (context.glsl().misses() != 1) throw std::runtime_error("fromGlsl did not go through the context's compiler");
+    createComputePipeline(module);
+}
+
+void bench() {
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    TempDir dir;
+    writeText(dir.path / "common.glsl", "#define SCALE 3u\n");
+    std::vector<GlslSource> sources;
+    for (uint32_t size = 1; size <= 1024; ++size) {
+        if (size % 16 == 0) sources.push_back(kernel(dir, size));
+    }
+    JobSystem jobs;
+    for (bool parallel : {false, true}) {
+        std::filesystem::remove_all(dir.path / "cache");
+        GlslCompiler compiler((dir.path / "cache").string());
+        auto run = [&] {
+            if (parallel) return compiler.compileAll(sources, jobs);
+            std::vector<std::vector<uint8_t>> out;
+            for (const GlslSource& s : sources) out.push_back(compiler.compile(s));
+            return out;
+        };
+        auto t0 = Clock::now();
+        run();
+        auto t1 = Clock::now();
+        run();
+        auto t2 = Clock::now();
+        std::cout << sources.size() << " permutations, " << (parallel ? "compileAll (" + std::to_string(jobs.concurrency()) + " threads)" : "serial")
+                  << ": cold " << ms(t1 - t0) << " ms, warm " << ms(t2 - t1) << " ms\n";
+    }
+    // Precompiled .spv of comparable size, read the way ShaderBuilder::fromFile reads it.
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < sources.size(); ++i) ShaderBuilder().compute().fromFile("tests/shaders/constant_fetch.comp.spv");
+    std::cout << "precompiled .spv x" << sources.size() << ": " << ms(Clock::now() - t0) << " ms\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!GlslCompiler::available()) {
+        std::cout << "glsl tests skipped: built without libshaderc\n";
+        return 0;
+    }
+    return runTests("glsl", argc, argv, [] {
+        testCache();
+        testErrors();
+        testCompileAll();
+        testShaderBuilder();
+    }, bench);
+}
@@ -0,0 +1,307 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Correctness oracles for GpuPrimitives against CPU references, on both the subgroup and the
+// shared-memory kernels, plus scratch growth within one recording under immediateDestroy.
+// `--bench [maxMillions]` instead prints throughput at 1M..64M elements.
+
+namespace {
+
+std::unique_ptr<Buffer> hostBuffer(const std::vector<uint32_t>& words) {
+    BufferBuilder builder(std::max<size_t>(words.size(), 1) * sizeof(uint32_t));
+    builder.storage().hostVisible();
+    auto buffer = std::make_unique<Buffer>(builder);
+    if (!words.empty()) buffer->upload((void*)words.data(), words.size() * sizeof(uint32_t));
+    return buffer;
+}
+
+std::vector<uint32_t> read(Buffer& buffer, size_t count) {
+    std::vector<uint32_t> words(count);
+    buffer.download(words.data(), count * sizeof(uint32_t));
+    return words;
+}
+
+void toHost(Commands& cmd, Buffer& buffer) {
+    cmd.bufferBarrier(buffer, Stage::Compute, Access::ShaderWrite, Stage::Host, Access::HostRead);
+}
+
+std::vector<uint32_t> randomWords(size_t count, uint32_t seed, uint32_t maxValue = 0xFFFFFFFFu) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> dist(0, maxValue);
+    std::vector<uint32_t> words(count);
+    for (auto& w : words) w = dist(rng);
+    return words;
+}
+
+void expectEqual(const std::vector<uint32_t>& got, const std::vector<uint32_t>& want, const std::string& what) {
+    if (got.size() != want.size()) throw std::runtime_error(what + ": size mismatch");
+    for (size_t i = 0; i < got.size(); ++i) {
+        if (got[i] != want[i]) {
+            throw std::runtime_error(what + ": mismatch at " + std::to_string(i) + " (got " +
+                                     std::to_string(got[i]) + ", want " + std::to_string(want[i]) + ")");
+        }
+    }
+}
+
+// Counts around the block size (256 * 4) and past two and three scan levels.
+const uint32_t kCounts[] = {1, 1023, 1024, 1025, 70000, 1100000};
+
+void testScan(GpuPrimitives& prims) {
+    for (uint32_t count : kCounts) {
+        auto input = randomWords(count, count, 1000);
+        auto in = hostBuffer(input);
+        auto exclusive = hostBuffer(std::vector<uint32_t>(count));
+        auto inclusive = hostBuffer(std::vector<uint32_t>(count));
+        auto cmd = Commands::oneShot();
+        prims.exclusiveScan(cmd, *in, *exclusive, count);
+        prims.inclusiveScan(cmd, *in, *inclusive, count);
+        toHost(cmd, *exclusive);
+        toHost(cmd, *inclusive);
+        cmd.submitAndWait();
+
+        std::vector<uint32_t> want(count);
+        std::exclusive_scan(input.begin(), input.end(), want.begin(), 0u);
+        expectEqual(read(*exclusive, count), want, "exclusive scan " + std::to_string(count));
+        std::inclusive_scan(input.begin(), input.end(), want.begin());
+        expectEqual(read(*inclusive, count), want, "inclusive scan " + std::to_string(count));
+    }
+
+    // In place.
+    auto input = randomWords(5000, 7, 1000);
+    auto data = hostBuffer(input);
+    auto cmd = Commands::oneShot();
+    prims.exclusiveScan(cmd, *data, *data, 5000);
+    toHost(cmd, *data);
+    cmd.submitAndWait();
+    std::vector<uint32_t> want(5000);
+    std::exclusive_scan(input.begin(), input.end(), want.begin(), 0u);
+    expectEqual(read(*data, 5000), want, "in-place scan");
+}
+
+void testCompact(GpuPrimitives& prims) {
+    for (uint32_t count : kCounts) {
+        auto values = randomWords(count, count + 1);
+        auto flags = randomWords(count, count + 2, 3);   // ~3/4 kept, nonzero flags other than 1
+        auto valuesBuffer = hostBuffer(values);
+        auto flagsBuffer = hostBuffer(flags);
+        auto out = hostBuffer(std::vector<uint32_t>(count));
+        auto kept = hostBuffer({0xDEADBEEFu});
+        auto cmd = Commands::oneShot();
+        prims.compact(cmd, *valuesBuffer, *flagsBuffer, *out, *kept, count);
+        toHost(cmd, *out);
+        toHost(cmd, *kept);
+        cmd.submitAndWait();
+
+        std::vector<uint32_t> want;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (flags[i] != 0) want.push_back(values[i]);
+        }
+        uint32_t keptCount = read(*kept, 1)[0];
+        if (keptCount != want.size()) throw std::runtime_error("compact count " + std::to_string(count));
+        expectEqual(read(*out, keptCount), want, "compact " + std::to_string(count));
+    }
+}
+
+void testSegmentedReduce(GpuPrimitives& prims) {
+    // Mixed segment lengths, including empty ones and one longer than a workgroup.
+    std::mt19937 rng(11);
+    std::vector<uint32_t> offsets = {0};
+    for (uint32_t s = 0; s < 3000; ++s) {
+        uint32_t length = (s % 97 == 0) ? 5000 : (rng() % 40);
+        offsets.push_back(offsets.back() + length);
+    }
+    uint32_t segmentCount = (uint32_t)offsets.size() - 1;
+    auto values = randomWords(offsets.back(), 12, 100000);
+    auto valuesBuffer = hostBuffer(values);
+    auto offsetsBuffer = hostBuffer(offsets);
+
+    for (ReduceOp op : {ReduceOp::Add, ReduceOp::Min, ReduceOp::Max}) {
+        auto out = hostBuffer(std::vector<uint32_t>(segmentCount));
+        auto cmd = Commands::oneShot();
+        prims.segmentedReduce(cmd, *valuesBuffer, *offsetsBuffer, *out, segmentCount, offsets.back(), op);
+        toHost(cmd, *out);
+        cmd.submitAndWait();
+
+        std::vector<uint32_t> want(segmentCount);
+        for (uint32_t s = 0; s < segmentCount; ++s) {
+            auto first = values.begin() + offsets[s];
+            auto last = values.begin() + offsets[s + 1];
+            if (op == ReduceOp::Add) want[s] = std::accumulate(first, last, 0u);
+            else if (op == ReduceOp::Min) want[s] = first == last ? 0xFFFFFFFFu : *std::min_element(first, last);
+            else want[s] = first == last ? 0u : *std::max_element(first, last);
+        }
+        expectEqual(read(*out, segmentCount), want, "segmented reduce op " + std::to_string((uint32_t)op));
+    }
+
+    // values must cover every offset the table may name.
+    auto out = hostBuffer(std::vector<uint32_t>(segmentCount));
+    auto cmd = Commands::oneShot();
+    bool threw = false;
+    try {
+        prims.segmentedReduce(cmd, *valuesBuffer, *offsetsBuffer, *out, segmentCount, offsets.back() + 1);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::runtime_error("segmented reduce accepted values smaller than valueCount");
+}
+
+void testRadixSort(GpuPrimitives& prims, uint32_t keyBits) {
+    uint32_t words = keyBits / 32;
+    for (uint32_t count : {2u, 1025u, 200000u}) {
+        // Narrow key range so stability is exercised by many duplicates.
+        auto keys = randomWords(size_t(count) * words, count * keyBits, 4095);
+        std::vector<uint32_t> values(count);
+        std::iota(values.begin(), values.end(), 0u);
+        auto keysBuffer = hostBuffer(keys);
+        auto valuesBuffer = hostBuffer(values);
+        auto cmd = Commands::oneShot();
+        prims.radixSort(cmd, *keysBuffer, valuesBuffer.get(), count, keyBits);
+        toHost(cmd, *keysBuffer);
+        toHost(cmd, *valuesBuffer);
+        cmd.submitAndWait();
+
+        auto keyOf = [&](uint32_t i) {
+            return words == 2 ? (uint64_t(keys[2 * i + 1]) << 32) | keys[2 * i] : uint64_t(keys[i]);
+        };
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keyOf(a) < keyOf(b); });
+        std::vector<uint32_t> wantKeys;
+        for (uint32_t i : order) {
+            for (uint32_t w = 0; w < words; ++w) wantKeys.push_back(keys[i * words + w]);
+        }
+        std::string what = "radix sort " + std::to_string(keyBits) + "-bit " + std::to_string(count);
+        expectEqual(read(*keysBuffer, size_t(count) * words), wantKeys, what + " keys");
+        expectEqual(read(*valuesBuffer, count), order, what + " values");
+    }
+}
+
+// Scratch that grows between two calls on one Commands: the first call's buffers must outlive
+// the recording even with immediateDestroy.
+void testScratchGrowth() {
+    GpuPrimitives prims;
+    uint32_t counts[2] = {1025, 70000};
+    std::vector<uint32_t> values[2], flags[2];
+    std::unique_ptr<Buffer> valueBuffers[2], flagBuffers[2], outs[2], kept[2];
+    auto cmd = Commands::oneShot();
+    for (int i = 0; i < 2; ++i) {
+        values[i] = randomWords(counts[i], 20 + i);
+        flags[i] = randomWords(counts[i], 30 + i, 1);
+        valueBuffers[i] = hostBuffer(values[i]);
+        flagBuffers[i] = hostBuffer(flags[i]);
+        outs[i] = hostBuffer(std::vector<uint32_t>(counts[i]));
+        kept[i] = hostBuffer({0u});
+        prims.compact(cmd, *valueBuffers[i], *flagBuffers[i], *outs[i], *kept[i], counts[i]);
+        toHost(cmd, *outs[i]);
+        toHost(cmd, *kept[i]);
+    }
+    cmd.submitAndWait();
+    for (int i = 0; i < 2; ++i) {
+        std::vector<uint32_t> want;
+        for (uint32_t j = 0; j < counts[i]; ++j) {
+            if (flags[i][j] != 0) want.push_back(values[i][j]);
+        }
+        std::string what = "compact before and after scratch growth " + std::to_string(counts[i]);
+        if (read(*kept[i], 1)[0] != want.size()) throw std::runtime_error(what + " count");
+        expectEqual(read(*outs[i], want.size()), want, what);
+    }
+    g_context().flushDestroys();
+}
+
+void runOracles(bool useSubgroups) {
+    GpuPrimitives prims(256, useSubgroups);
+    std::cout << "gpu primitives: " << (prims.usesSubgroups() ? "subgroup" : "shared-memory") << " kernels\n";
+    testScan(prims);
+    testCompact(prims);
+    testSegmentedReduce(prims);
+    testRadixSort(prims, 32);
+    testRadixSort(prims, 64);
+}
+
+// --- Benchmarks ---
+
+std::unique_ptr<Buffer> deviceBuffer(Commands& cmd, const std::vector<uint32_t>& words,
+                                     std::vector<std::unique_ptr<Buffer>>& staging) {
+    size_t bytes = words.size() * sizeof(uint32_t);
+    BufferBuilder stagingBuilder(bytes);
+    stagingBuilder.hostVisible().transferSource();
+    staging.push_back(std::make_unique<Buffer>(stagingBuilder));
+    staging.back()->upload((void*)words.data(), bytes);
+    BufferBuilder builder(bytes);
+    builder.storage().deviceLocal().transferDestination();
+    auto buffer = std::make_unique<Buffer>(builder);
+    cmd.copyBuffer(*staging.back(), *buffer, bytes);
+    cmd.bufferBarrier(*buffer, Stage::Transfer, Access::TransferWrite, Stage::Compute, Access::ShaderRead | Access::ShaderWrite);
+    return buffer;
+}
+
+void bench(uint32_t maxMillions) {
+    TestContext ctx(VulkanContextOptions(), false);
+    GpuPrimitives prims;
+    std::cout << "gpu primitives benchmark (" << (prims.usesSubgroups() ? "subgroup" : "shared-memory")
+              << " kernels, workgroup " << prims.workgroupSize() << ")\n";
+    for (uint32_t millions = 1; millions <= maxMillions; millions *= 4) {
+        uint32_t count = millions << 20;
+        std::vector<std::unique_ptr<Buffer>> staging;
+        auto setup = Commands::oneShot();
+        auto data = deviceBuffer(setup, randomWords(count, 1, 1), staging);
+        auto keys32 = deviceBuffer(setup, randomWords(count, 2), staging);
+        auto keys64 = deviceBuffer(setup, randomWords(size_t(count) * 2, 3), staging);
+        auto values = deviceBuffer(setup, randomWords(count, 4), staging);
+        std::vector<uint32_t> offsets(count / 64 + 1);
+        for (size_t i = 0; i < offsets.size(); ++i) offsets[i] = uint32_t(i * 64);
+        auto segmentOffsets = deviceBuffer(setup, offsets, staging);
+        BufferBuilder outBuilder(size_t(count) * sizeof(uint32_t));
+        outBuilder.storage().deviceLocal();
+        Buffer out(outBuilder);
+        BufferBuilder keptBuilder(sizeof(uint32_t));
+        keptBuilder.storage();
+        Buffer kept(keptBuilder);
+        setup.submitAndWait();
+
+        GpuTimer timer(5);
+        for (int run = 0; run < 2; ++run) {   // first run warms scratch allocation and caches
+            auto cmd = Commands::oneShot();
+            timer.begin(cmd);
+            prims.exclusiveScan(cmd, *data, out, count);
+            timer.mark(cmd, "scan");
+            prims.compact(cmd, *values, *data, out, kept, count);
+            timer.mark(cmd, "compact");
+            prims.segmentedReduce(cmd, *data, *segmentOffsets, out, count / 64, count);
+            timer.mark(cmd, "segmented reduce");
+            prims.radixSort(cmd, *keys32, values.get(), count, 32);
+            timer.mark(cmd, "radix sort 32");
+            prims.radixSort(cmd, *keys64, values.get(), count, 64);
+            timer.mark(cmd, "radix sort 64");
+            cmd.submitAndWait();
+        }
+        for (auto& [label, ms] : timer.resolve()) {
+            std::cout << "  " << millions << "M " << label << ": " << ms << " ms, "
+                      << double(count) / (ms * 1e3) << " Melem/s\n";
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("gpu primitives", argc, argv, [] {
+        {
+            TestContext ctx;
+            runOracles(true);
+            runOracles(false);
+        }
+        TestContext ctx(VulkanContextOptions().immediateDestroy());
+        testScratchGrowth();
+    }, [&] { bench(argc > 2 ? (uint32_t)std::atoi(argv[2]) : 64); });
+}
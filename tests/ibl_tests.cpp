@@ -0,0 +1,107 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// IblBaker: a bake of a constant environment projects to irradiance SH with only the DC term
+// and the environment's colour ratios; the first bake times prefilter, irradiance and the BRDF
+// LUT while a re-bake reuses the LUT (no LUT segment) and keeps every output RID; and bakers
+// destroyed and recreated retire their storage views through the deferred-destroy queue.
+
+namespace {
+
+const float kEnvironment[3] = {1.0f, 0.5f, 0.25f};
+
+std::unique_ptr<Image> constantEnvironment(Commands& cmd) {
+    ImageBuilder builder = ImageBuilder().withFormat(VK_FORMAT_R16G16B16A16_SFLOAT).cube(16).mipLevels(5);
+    auto environment = std::make_unique<Image>(builder, cmd);
+    VkClearColorValue color = {{kEnvironment[0], kEnvironment[1], kEnvironment[2], 1.0f}};
+    VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, environment->mipLevelCount(), 0, 6};
+    // A cube comes out of its constructor in General for compute writes.
+    cmd.imageBarrier(*environment, Stage::Compute, Access::ShaderWrite, Layout::General,
+                     Stage::Transfer, Access::TransferWrite, Layout::TransferDst, environment->mipLevelCount(), 6);
+    vkCmdClearColorImage(cmd, *environment, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+    cmd.imageBarrier(*environment, Stage::Transfer, Access::TransferWrite, Layout::TransferDst,
+                     Stage::Compute, Access::ShaderRead, Layout::ShaderReadOnly, environment->mipLevelCount(), 6);
+    return environment;
+}
+
+bool hasLabel(const std::vector<std::pair<const char*, double>>& timings, const char* label) {
+    for (auto& [name, ms] : timings) {
+        if (std::string(name) == label) return true;
+    }
+    return false;
+}
+
+void testBakeAndReuse() {
+    auto cmd = Commands::oneShot();
+    std::unique_ptr<Image> environment = constantEnvironment(cmd);
+    IblBaker baker(cmd, 16, 3, 32);
+    baker.bake(cmd, *environment);
+    Buffer sh(BufferBuilder(9 * 4 * sizeof(float)).readback().transferDestination());
+    cmd.bufferBarrier(baker.irradianceSH(), Stage::Compute, Access::ShaderWrite, Stage::Transfer, Access::TransferRead);
+    cmd.copyBuffer(baker.irradianceSH(), sh, 9 * 4 * sizeof(float));
+    cmd.bufferBarrier(sh, Stage::Transfer, Access::TransferWrite, Stage::Host, Access::HostRead);
+    cmd.submitAndWait();
+
+    const auto& first = baker.timings();
+    if (first.size() != 3 || !hasLabel(first, "ibl prefilter") || !hasLabel(first, "ibl irradiance sh") ||
+        !hasLabel(first, "ibl brdf lut")) {
+        throw std::runtime_error("first bake did not time all three passes");
+    }
+
+    float coefficients[9 * 4];
+    sh.invalidate();
+    sh.download(coefficients, sizeof(coefficients));
+    float dc = coefficients[0];
+    if (!(dc > 0.0f)) throw std::runtime_error("SH DC term of a lit environment is not positive");
+    for (int c = 1; c < 3; ++c) {
+        float ratio = coefficients[c] / dc;
+        if (std::fabs(ratio - kEnvironment[c] / kEnvironment[0]) > 0.01f) throw std::runtime_error("SH colour ratio");
+    }
+    for (int k = 1; k < 9; ++k) {
+        for (int c = 0; c < 3; ++c) {
+            if (std::fabs(coefficients[k * 4 + c]) > 0.05f * dc) {
+                throw std::runtime_error("constant environment has SH band " + std::to_string(k));
+            }
+        }
+    }
+
+    uint32_t prefilteredRid = baker.prefiltered().rid(), lutRid = baker.brdfLut().rid();
+    uint32_t shRid = baker.irradianceSH().rid();
+    auto again = Commands::oneShot();
+    baker.bake(again, *environment);
+    again.submitAndWait();
+    const auto& second = baker.timings();
+    if (second.size() != 2 || hasLabel(second, "ibl brdf lut")) throw std::runtime_error("re-bake recomputed the BRDF LUT");
+    if (baker.prefiltered().rid() != prefilteredRid || baker.brdfLut().rid() != lutRid || baker.irradianceSH().rid() != shRid) {
+        throw std::runtime_error("re-bake replaced its outputs");
+    }
+}
+
+void testRecreate() {
+    // The views of a destroyed baker retire through the deferred-destroy queue; once flushed, a
+    // new baker gets fresh views and bakes cleanly under validation.
+    for (int i = 0; i < 2; ++i) {
+        auto cmd = Commands::oneShot();
+        std::unique_ptr<Image> environment = constantEnvironment(cmd);
+        IblBaker baker(cmd, 16, 3, 32);
+        baker.bake(cmd, *environment);
+        cmd.submitAndWait();
+    }
+    g_context().flushDestroys();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("ibl", argc, argv, [] {
+        VulkanContext context(VulkanContextOptions().offscreenSize(64, 64).jobWorkers(0).validation().throwOnValidationError());
+        testBakeAndReuse();
+        testRecreate();
+    });
+}
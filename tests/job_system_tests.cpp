@@ -0,0 +1,231 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// JobSystem: parallelFor covers every index exactly once for any grain and worker count,
+// nested and external-thread submissions complete, job exceptions reach wait(), and the
+// context's system serves library work (cookTexture). `--bench` scales a synthetic draw
+// recording workload from 1 thread up to hardware concurrency.
+
+namespace {
+
+void expectEachOnce(const std::vector<std::atomic<uint32_t>>& hits, const std::string& what) {
+    for (size_t i = 0; i < hits.size(); ++i) {
+        if (hits[i].load() != 1) {
+            throw std::runtime_error(what + ": index " + std::to_string(i) + " ran " +
+                                     std::to_string(hits[i].load()) + " times");
+        }
+    }
+}
+
+void testParallelForCoverage() {
+    for (uint32_t workers : {0u, 1u, 3u}) {
+        JobSystem jobs(workers);
+        for (uint32_t count : {0u, 1u, 7u, 1000u, 100000u}) {
+            for (uint32_t grain : {0u, 1u, 16u, 1000u}) {
+                std::vector<std::atomic<uint32_t>> hits(count);
+                jobs.parallelFor(count, grain, [&](uint32_t begin, uint32_t end) {
+                    if (begin >= end || end > count) throw std::runtime_error("bad range");
+                    for (uint32_t i = begin; i < end; ++i) hits[i]++;
+                });
+                expectEachOnce(hits, "parallelFor(" + std::to_string(count) + ", " + std::to_string(grain) +
+                                         ") with " + std::to_string(workers) + " workers");
+            }
+        }
+    }
+}
+
+void testNested() {
+    JobSystem jobs(3);
+    const uint32_t outer = 64, inner = 500;
+    std::vector<std::atomic<uint32_t>> hits(outer * inner);
+    jobs.parallelFor(outer, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t o = begin; o < end; ++o) {
+            jobs.parallelFor(inner, 32, [&, o](uint32_t b, uint32_t e) {
+                for (uint32_t i = b; i < e; ++i) hits[o * inner + i]++;
+            });
+        }
+    });
+    expectEachOnce(hits, "nested parallelFor");
+
+    // Jobs that spawn and wait on their own groups.
+    std::atomic<uint32_t> leaves{0};
+    JobCounter roots;
+    for (int r = 0; r < 16; ++r) {
+        jobs.run(roots, [&] {
+            JobCounter children;
+            for (int c = 0; c < 16; ++c) jobs.run(children, [&] { leaves++; });
+            jobs.wait(children);
+        });
+    }
+    jobs.wait(roots);
+    if (leaves != 256) throw std::runtime_error("nested run/wait lost jobs");
+}
+
+void testManyJobs() {
+    // More jobs than one deque holds: the overflow runs inline on the submitter.
+    for (uint32_t workers : {0u, 2u}) {
+        JobSystem jobs(workers);
+        std::atomic<uint32_t> ran{0};
+        JobCounter counter;
+        for (int i = 0; i < 20000; ++i) jobs.run(counter, [&] { ran++; });
+        jobs.wait(counter);
+        if (ran != 20000) throw std::runtime_error("jobs lost past deque capacity");
+    }
+}
+
+void testExceptions() {
+    JobSystem jobs(2);
+    std::atomic<uint32_t> ran{0};
+    JobCounter counter;
+    for (int i = 0; i < 100; ++i) {
+        jobs.run(counter, [&, i] {
+            ran++;
+            if (i == 37) throw std::runtime_error("job 37 failed");
+        });
+    }
+    bool threw = false;
+    try {
+        jobs.wait(counter);
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()) == "job 37 failed";
+    }
+    if (!threw) throw std::runtime_error("wait() did not rethrow the job's exception");
+    if (ran != 100) throw std::runtime_error("a failing job stopped the rest of its group");
+
+    // parallelFor rethrows too, after every chunk has finished.
+    threw = false;
+    std::atomic<uint32_t> chunks{0};
+    try {
+        jobs.parallelFor(1000, 10, [&](uint32_t begin, uint32_t) {
+            chunks++;
+            if (begin == 0 || begin == 500) throw std::runtime_error("chunk failed");
+        });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw || chunks != 100) throw std::runtime_error("parallelFor exception handling");
+
+    // The system is still usable afterwards.
+    std::vector<std::atomic<uint32_t>> hits(5000);
+    jobs.parallelFor(5000, 64, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) hits[i]++;
+    });
+    expectEachOnce(hits, "parallelFor after an exception");
+}
+
+void testExternalThreads() {
+    JobSystem jobs(2);
+    std::vector<std::atomic<uint32_t>> hits(4 * 3000);
+    std::atomic<bool> lost{false};
+    std::vector<std::thread> submitters;
+    for (uint32_t t = 0; t < 4; ++t) {
+        submitters.emplace_back([&, t] {
+            jobs.parallelFor(3000, 50, [&, t](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) hits[t * 3000 + i]++;
+            });
+            JobCounter counter;
+            std::atomic<uint32_t> ran{0};
+            for (int i = 0; i < 200; ++i) jobs.run(counter, [&] { ran++; });
+            jobs.wait(counter);
+            if (ran != 200) lost = true;
+        });
+    }
+    for (auto& s : submitters) s.join();
+    if (lost) throw std::runtime_error("jobs submitted from an external thread were lost");
+    expectEachOnce(hits, "parallelFor from external threads");
+}
+
+void testContextJobs() {
+    if (g_context().jobs().workerCount() != 2) throw std::runtime_error("jobWorkers() not applied");
+
+    // cookTexture with threads = 0 runs on the context's system; output does not depend on it.
+    const uint32_t w = 300, h = 200;
+    std::vector<uint8_t> bgra(size_t(w) * h * 4);
+    for (size_t i = 0; i < bgra.size(); ++i) bgra[i] = uint8_t((i * 2654435761u) >> 24);
+    auto shared = cookTexture(bgra.data(), w, h, TextureCookOptions().kaiser().bc3());
+    auto serial = cookTexture(bgra.data(), w, h, TextureCookOptions().kaiser().bc3().threadCount(1));
+    if (shared != serial) throw std::runtime_error("cookTexture on the context's jobs differs from serial");
+}
+
+// Per-draw CPU work typical of scene recording: a model-view-projection product, a view
+// depth and a sort key, then a packet appended to the chunk's DrawList bucket.
+struct DrawPush {
+    float mvp[16];
+    uint32_t material;
+};
+
+void recordChunk(DrawList& list, uint32_t bucket, uint32_t begin, uint32_t end) {
+    DrawList::Bucket& out = list.bucket(bucket);
+    for (uint32_t i = begin; i < end; ++i) {
+        float model[16] = {}, viewProj[16] = {};
+        for (int k = 0; k < 16; ++k) {
+            model[k] = std::sin(float(i + k));
+            viewProj[k] = std::cos(float(k) * 0.5f);
+        }
+        DrawPush push{};
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                float sum = 0.0f;
+                for (int k = 0; k < 4; ++k) sum += viewProj[r * 4 + k] * model[k * 4 + c];
+                push.mvp[r * 4 + c] = sum;
+            }
+        }
+        push.material = i % 512;
+        VkPipeline pipeline = reinterpret_cast<VkPipeline>(uintptr_t(0x1000 + (i % 8) * 0x100));
+        float depth = std::fabs(push.mvp[14]) / (1.0f + std::fabs(push.mvp[14]));
+        out.draw(DrawList::key(0, pipeline, push.material, depth), pipeline, push, 1 + i % 64);
+    }
+}
+
+void bench() {
+    using Clock = std::chrono::steady_clock;
+    const uint32_t draws = 200000, grain = 1024;
+    const uint32_t chunks = (draws + grain - 1) / grain;
+    const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+    double baseline = 0.0;
+    for (uint32_t threads : threadCounts) {
+        JobSystem jobs(threads - 1);
+        DrawList list(chunks);
+        double best = 1e30;
+        for (int run = 0; run < 5; ++run) {
+            list.clear();
+            auto t0 = Clock::now();
+            jobs.parallelFor(draws, grain, [&](uint32_t begin, uint32_t end) {
+                recordChunk(list, begin / grain, begin, end);
+            });
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+        }
+        if (list.size() != draws) throw std::runtime_error("bench recorded the wrong number of draws");
+        if (threads == 1) baseline = best;
+        std::cout << "record " << draws << " draws, " << threads << " threads: " << best << " ms, "
+                  << draws / best << " draws/ms, speedup " << baseline / best << "x\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("job system", argc, argv, [] {
+        testParallelForCoverage();
+        testNested();
+        testManyJobs();
+        testExceptions();
+        testExternalThreads();
+        TestContext ctx(VulkanContextOptions().jobWorkers(2));
+        testContextJobs();
+    }, bench);
+}
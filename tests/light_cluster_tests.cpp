@@ -0,0 +1,176 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// LightClusterer against a CPU binning of the same froxel grid. Boundary cases are judged with
+// a slightly shrunk and a slightly grown light: every light that touches a cluster even when
+// shrunk must be listed, and every listed light must touch it when grown. `--bench` instead
+// times the culling pass at 256, 1024 and 4096 lights.
+
+namespace {
+
+// Camera at the origin looking down -Z, so world space is view space.
+ClusterView identityView() {
+    ClusterView view = {};
+    view.view[0] = view.view[5] = view.view[10] = view.view[15] = 1.0f;
+    view.tanHalfFovX = 1.0f;
+    view.tanHalfFovY = 0.75f;
+    view.zNear = 0.5f;
+    view.zFar = 100.0f;
+    return view;
+}
+
+struct Box { float min[3], max[3]; };
+
+// Same bounds as light_cluster_cull.comp.
+Box clusterBox(const ClusterView& view, uint32_t gx, uint32_t gy, uint32_t gz, uint32_t cluster) {
+    uint32_t cx = cluster % gx, cy = (cluster / gx) % gy, cz = cluster / (gx * gy);
+    auto slice = [&](uint32_t k) { return view.zNear * std::pow(view.zFar / view.zNear, float(k) / float(gz)); };
+    float dn = slice(cz), df = slice(cz + 1);
+    float x0 = (-1.0f + 2.0f * cx / gx) * view.tanHalfFovX, x1 = (-1.0f + 2.0f * (cx + 1) / gx) * view.tanHalfFovX;
+    float y0 = (1.0f - 2.0f * (cy + 1) / gy) * view.tanHalfFovY, y1 = (1.0f - 2.0f * cy / gy) * view.tanHalfFovY;
+    return {{std::min(x0 * dn, x0 * df), std::min(y0 * dn, y0 * df), -df},
+            {std::max(x1 * dn, x1 * df), std::max(y1 * dn, y1 * df), -dn}};
+}
+
+bool sphereTouchesBox(const float center[3], float radius, const Box& box) {
+    float distanceSq = 0.0f;
+    for (int c = 0; c < 3; ++c) {
+        float d = std::clamp(center[c], box.min[c], box.max[c]) - center[c];
+        distanceSq += d * d;
+    }
+    return distanceSq <= radius * radius;
+}
+
+std::vector<ClusterLight> randomPointLights(uint32_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> x(-40.0f, 40.0f), y(-30.0f, 30.0f), z(-95.0f, 0.0f), range(0.3f, 4.0f);
+    std::vector<ClusterLight> lights(count);
+    for (auto& light : lights) {
+        light.position[0] = x(rng);
+        light.position[1] = y(rng);
+        light.position[2] = z(rng);
+        light.range = range(rng);
+    }
+    return lights;
+}
+
+// Runs one cull and reads back the cluster buffer (counts, then index lists).
+std::vector<uint32_t> cullAndRead(LightClusterer& clusterer, const ClusterView& view) {
+    Buffer& clusters = clusterer.clusterBuffer();
+    BufferBuilder readbackBuilder(clusters.byteSize());
+    readbackBuilder.readback().transferDestination();
+    Buffer readback(readbackBuilder);
+
+    auto cmd = Commands::oneShot();
+    clusterer.cull(cmd, view, {1280, 720});
+    cmd.bufferBarrier(clusters, Stage::Compute, Access::ShaderWrite, Stage::Transfer, Access::TransferRead);
+    cmd.copyBuffer(clusters, readback, clusters.byteSize());
+    cmd.bufferBarrier(readback, Stage::Transfer, Access::TransferWrite, Stage::Host, Access::HostRead);
+    cmd.submitAndWait();
+
+    std::vector<uint32_t> words(clusters.byteSize() / sizeof(uint32_t));
+    readback.download(words.data(), clusters.byteSize());
+    return words;
+}
+
+void testPointLights() {
+    const uint32_t gx = 8, gy = 6, gz = 12, maxPer = 64;
+    LightClusterer clusterer(512, gx, gy, gz, maxPer);
+    auto lights = randomPointLights(400, 85);
+    clusterer.setLights(lights);
+    ClusterView view = identityView();
+    auto words = cullAndRead(clusterer, view);
+
+    uint32_t clusters = clusterer.clusterCount();
+    uint32_t nonEmpty = 0;
+    for (uint32_t cluster = 0; cluster < clusters; ++cluster) {
+        uint32_t count = words[cluster];
+        if (count > maxPer) throw std::runtime_error("cluster count exceeds capacity");
+        std::set<uint32_t> listed(words.begin() + clusters + cluster * maxPer,
+                                  words.begin() + clusters + cluster * maxPer + count);
+        if (listed.size() != count) throw std::runtime_error("duplicate light in cluster " + std::to_string(cluster));
+        nonEmpty += count > 0;
+
+        Box box = clusterBox(view, gx, gy, gz, cluster);
+        for (uint32_t i = 0; i < lights.size(); ++i) {
+            bool shrunk = sphereTouchesBox(lights[i].position, lights[i].range * 0.999f - 1e-3f, box);
+            bool grown = sphereTouchesBox(lights[i].position, lights[i].range * 1.001f + 1e-3f, box);
+            bool isListed = listed.count(i) > 0;
+            if (isListed && !grown) {
+                throw std::runtime_error("light " + std::to_string(i) + " listed in cluster " + std::to_string(cluster) + " it does not touch");
+            }
+            if (!isListed && shrunk && count < maxPer) {
+                throw std::runtime_error("light " + std::to_string(i) + " missing from cluster " + std::to_string(cluster));
+            }
+        }
+    }
+    if (nonEmpty == 0) throw std::runtime_error("no cluster received a light");
+}
+
+void testSpotCone() {
+    const uint32_t gx = 8, gy = 6, gz = 12, maxPer = 16;
+    LightClusterer clusterer(4, gx, gy, gz, maxPer);
+    ClusterLight away, toward;
+    // Both sit at the camera; their spheres reach into the near clusters.
+    away.range = toward.range = 5.0f;
+    away.spotCos = toward.spotCos = 0.95f;
+    away.direction[2] = 1.0f;      // behind the camera
+    toward.direction[2] = -1.0f;   // down the view axis
+    std::vector<ClusterLight> lights = {away, toward};
+    clusterer.setLights(lights);
+    ClusterView view = identityView();
+    auto words = cullAndRead(clusterer, view);
+
+    uint32_t clusters = clusterer.clusterCount();
+    bool towardSeen = false;
+    for (uint32_t cluster = 0; cluster < clusters; ++cluster) {
+        for (uint32_t i = 0; i < words[cluster]; ++i) {
+            uint32_t light = words[clusters + cluster * maxPer + i];
+            if (light == 0) throw std::runtime_error("spot light facing away from the view was not culled");
+            towardSeen |= light == 1;
+        }
+    }
+    if (!towardSeen) throw std::runtime_error("spot light facing the view reached no cluster");
+}
+
+void bench() {
+    TestContext ctx(VulkanContextOptions(), false);
+    ClusterView view = identityView();
+    std::cout << "light clustering benchmark (16x9x24 clusters, 128 lights per cluster max)\n";
+    for (uint32_t count : {256u, 1024u, 4096u}) {
+        LightClusterer clusterer(count);
+        clusterer.setLights(randomPointLights(count, count));
+        GpuTimer timer(1);
+        for (int run = 0; run < 3; ++run) {   // first runs warm clocks and caches
+            auto cmd = Commands::oneShot();
+            timer.begin(cmd);
+            clusterer.cull(cmd, view, {1920, 1080});
+            timer.mark(cmd, "cull");
+            cmd.submitAndWait();
+        }
+        for (auto& [label, ms] : timer.resolve()) {
+            std::cout << "  " << count << " lights " << label << ": " << ms << " ms\n";
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("light cluster", argc, argv, [] {
+        TestContext ctx;
+        testPointLights();
+        testSpotCone();
+    }, bench);
+}
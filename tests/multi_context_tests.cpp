@@ -0,0 +1,238 @@
+#include "test_context.h"
+#include "vkobjects.h"
+#include "vkinternal.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Multiple contexts: offscreen contexts created and used on their own threads at the same time
+// each get their own results, a thread resolves to the first context created on it (others to
+// the process default), ContextScope nests, objects are destroyed through the context they were
+// created on, Frame refuses an offscreen context, destroying the default promotes the oldest
+// survivor, and default-sized job systems share one worker budget. `--bench` bakes on 1, 2 and
+// 4 contexts in parallel and reports the aggregate throughput.
+
+namespace {
+
+VulkanContextOptions offscreenOptions(bool validation = true) {
+    VulkanContextOptions opts = VulkanContextOptions().offscreenSize(256, 256).jobWorkers(0);
+    if (validation) opts.validation().throwOnValidationError();
+    return opts;
+}
+
+uint64_t allocatedBytes(VulkanContext& context) {
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS] = {};
+    vmaGetHeapBudgets(context.allocatorHandle(), budgets);
+    VkPhysicalDeviceMemoryProperties props = {};
+    vkGetPhysicalDeviceMemoryProperties(context.physicalDeviceHandle(), &props);
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < props.memoryHeapCount; ++i) total += budgets[i].statistics.allocationBytes;
+    return total;
+}
+
+// Fills a readback buffer `rounds` times with values derived from `seed` and checks the last.
+void bake(uint32_t seed, uint32_t rounds, size_t bytes) {
+    Buffer target(BufferBuilder(bytes).readback().transferDestination());
+    for (uint32_t r = 0; r < rounds; ++r) {
+        Commands cmd = Commands::oneShot();
+        cmd.fillBuffer(target, seed * 1000 + r);
+        cmd.submitAndWait();
+    }
+    std::vector<uint32_t> values(bytes / sizeof(uint32_t));
+    target.invalidate();
+    target.download(values.data(), bytes);
+    for (uint32_t v : values) {
+        if (v != seed * 1000 + rounds - 1) throw std::runtime_error("context " + std::to_string(seed) + " read back another context's data");
+    }
+}
+
+// An offscreen context has no Frame; its deferred destroys run when a submitAndWait on it
+// returns with no other one in flight.
+void submitEmpty(VulkanContext& context) {
+    ContextScope scope(context);
+    Commands::oneShot().submitAndWait();
+}
+
+// Runs `fn(i)` on `count` threads, each with a context of its own, and rethrows the first failure.
+template<typename F>
+void onContexts(uint32_t count, F&& fn, bool validation = true) {
+    std::vector<std::thread> threads;
+    std::vector<std::string> errors(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        threads.emplace_back([&, i] {
+            try {
+                VulkanContext context(offscreenOptions(validation));
+                if (g_context.current() != &context) throw std::runtime_error("context not bound to its creating thread");
+                fn(i);
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (auto& e : errors) {
+        if (!e.empty()) throw std::runtime_error(e);
+    }
+}
+
+void testConcurrentContexts() {
+    onContexts(4, [](uint32_t i) {
+        if (!g_context().offscreen()) throw std::runtime_error("offscreen() false without a window");
+        bake(i + 1, 8, 64 * 1024);
+    });
+    if (g_context.current() != nullptr) throw std::runtime_error("contexts outlived their threads");
+}
+
+void testBindingAndScopes() {
+    VulkanContext first(offscreenOptions());
+    if (g_context.current() != &first) throw std::runtime_error("first context is not the default");
+
+    // A second context made on a bound thread does not take the thread over.
+    VulkanContext second(offscreenOptions());
+    if (g_context.current() != &first) throw std::runtime_error("second context rebound the thread");
+
+    VulkanContext* seen = nullptr;
+    std::thread([&] { seen = g_context.current(); }).join();
+    if (seen != &first) throw std::runtime_error("unbound thread did not see the default context");
+
+    {
+        ContextScope outer(second);
+        if (&g_context() != &second) throw std::runtime_error("ContextScope did not bind");
+        {
+            ContextScope inner(first);
+            if (&g_context() != &first) throw std::runtime_error("nested ContextScope did not bind");
+        }
+        if (&g_context() != &second) throw std::runtime_error("nested ContextScope did not restore");
+        std::thread([&] { seen = g_context.current(); }).join();
+        if (seen != &first) throw std::runtime_error("ContextScope leaked to another thread");
+    }
+    if (&g_context() != &first) throw std::runtime_error("ContextScope did not restore");
+}
+
+void testObjectsKeepTheirContext() {
+    VulkanContext first(offscreenOptions());
+    VulkanContext second(offscreenOptions());
+    const size_t bytes = 4 * 1024 * 1024;
+    uint64_t firstBefore = allocatedBytes(first);
+    uint64_t secondBefore = allocatedBytes(second);
+
+    std::unique_ptr<Buffer> buffer;
+    {
+        ContextScope scope(second);
+        buffer = std::make_unique<Buffer>(BufferBuilder(bytes).storage().transferDestination());
+        bake(7, 2, 1024);
+    }
+    if (allocatedBytes(second) < secondBefore + bytes) throw std::runtime_error("buffer not allocated on the scoped context");
+    if (allocatedBytes(first) != firstBefore) throw std::runtime_error("buffer allocated on the default context");
+
+    // Destroyed with `first` bound on this thread, and again on a thread bound to nothing. The
+    // memory stays until the next submitAndWait on `second` drains its destroy generations.
+    buffer.reset();
+    if (allocatedBytes(second) < secondBefore + bytes) throw std::runtime_error("deferred destroy freed the buffer at once");
+    submitEmpty(first);
+    if (allocatedBytes(second) < secondBefore + bytes) throw std::runtime_error("another context's submit drained the buffer");
+    submitEmpty(second);
+    if (allocatedBytes(second) != secondBefore) throw std::runtime_error("buffer not freed through its own context");
+    {
+        ContextScope scope(second);
+        buffer = std::make_unique<Buffer>(BufferBuilder(bytes).storage());
+    }
+    std::thread([&] { buffer.reset(); }).join();
+    submitEmpty(second);
+    if (allocatedBytes(second) != secondBefore) throw std::runtime_error("buffer not freed from another thread");
+}
+
+void testOffscreenFrame() {
+    VulkanContext context(offscreenOptions());
+    if (context.swapchainImageCount != 2) throw std::runtime_error("offscreen frames-in-flight count");
+    bool threw = false;
+    try {
+        Frame frame;
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::runtime_error("Frame accepted an offscreen context");
+}
+
+// Destroying the default context while others live makes the oldest survivor the default;
+// with none left, g_context() throws instead of dereferencing null.
+void testDefaultPromotion() {
+    auto first = std::make_unique<VulkanContext>(offscreenOptions());
+    auto second = std::make_unique<VulkanContext>(offscreenOptions());
+    auto third = std::make_unique<VulkanContext>(offscreenOptions());
+    if (g_context.contextInstance.load() != first.get()) throw std::runtime_error("first context is not the default");
+    first.reset();
+    if (g_context.contextInstance.load() != second.get() || &g_context() != second.get()) {
+        throw std::runtime_error("oldest survivor did not become the default");
+    }
+    bake(3, 2, 1024);
+    second.reset();
+    if (&g_context() != third.get()) throw std::runtime_error("last survivor did not become the default");
+    third.reset();
+    if (g_context.current() != nullptr) throw std::runtime_error("default outlived every context");
+    bool threw = false;
+    try {
+        g_context();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::runtime_error("g_context() without a context did not throw");
+}
+
+// Contexts left at the default worker count share one budget instead of each starting
+// hardware concurrency - 1 workers.
+void testJobWorkerBudget() {
+    VulkanContextOptions opts = VulkanContextOptions().offscreenSize(64, 64).validation().throwOnValidationError();
+    uint32_t budget = JobSystem::defaultWorkerCount();
+    std::vector<std::unique_ptr<VulkanContext>> contexts;
+    uint32_t total = 0;
+    for (int i = 0; i < 3; ++i) {
+        contexts.push_back(std::make_unique<VulkanContext>(opts));
+        total += contexts.back()->jobs().workerCount();
+    }
+    if (contexts[0]->jobs().workerCount() != budget) throw std::runtime_error("lone context did not get the full worker budget");
+    if (total != budget) {
+        throw std::runtime_error("contexts started " + std::to_string(total) + " workers for a budget of " + std::to_string(budget));
+    }
+    // An explicit count is honoured, and a released budget is available again.
+    contexts.push_back(std::make_unique<VulkanContext>(VulkanContextOptions(opts).jobWorkers(2)));
+    if (contexts.back()->jobs().workerCount() != 2) throw std::runtime_error("jobWorkers() not applied");
+    contexts.clear();
+    VulkanContext again(opts);
+    if (again.jobs().workerCount() != budget) throw std::runtime_error("worker budget not returned by destroyed contexts");
+}
+
+void bench() {
+    using Clock = std::chrono::steady_clock;
+    const uint32_t rounds = 64;
+    const size_t bytes = 32 * 1024 * 1024;
+    double single = 0.0;
+    // Timed from thread start, so context creation is included as a baking tool would pay it.
+    for (uint32_t count : {1u, 2u, 4u}) {
+        auto t0 = Clock::now();
+        onContexts(count, [&](uint32_t i) { bake(i + 1, rounds, bytes); }, false);
+        double millis = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        double bakesPerSecond = count * rounds * 1000.0 / millis;
+        if (count == 1) single = bakesPerSecond;
+        std::cout << count << " context(s): " << millis << " ms, " << bakesPerSecond << " bakes/s ("
+                  << bakesPerSecond / single << "x)\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("multi context", argc, argv, [] {
+        testConcurrentContexts();
+        testBindingAndScopes();
+        testObjectsKeepTheirContext();
+        testOffscreenFrame();
+        testDefaultPromotion();
+        testJobWorkerBudget();
+    }, bench);
+}
@@ -0,0 +1,193 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// RenderThread/FramePacket: packets reach `render` in order with their state, the two packets
+// alternate without reallocating, the arena aligns and refuses overflow, exceptions cross back
+// to the game thread, and Vulkan work recorded on the render thread lands. `--bench` compares
+// the serial loop against the pipelined one for a synthetic sim + render workload.
+
+namespace {
+
+struct SceneState {
+    uint64_t frame;
+    float viewProjection[16];
+    uint32_t objectCount;
+    const uint32_t* objects;   // allocated from the same packet
+};
+
+void spinFor(double millis) {
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < millis) {
+    }
+}
+
+void testArena() {
+    FramePacket packet(256, 1);
+    packet.allocate<uint8_t>(3);
+    double* d = packet.allocate<double>();
+    if (reinterpret_cast<uintptr_t>(d) % alignof(double) != 0) throw std::runtime_error("unaligned arena allocation");
+    uint32_t* value = packet.push(uint32_t(7));
+    if (*value != 7 || packet.bytesUsed() != 20) throw std::runtime_error("push() bookkeeping");
+
+    bool threw = false;
+    try {
+        packet.allocate<uint8_t>(packet.arenaBytes());
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::runtime_error("arena overflow did not throw");
+
+    SceneState& scene = packet.state<SceneState>();
+    if (&scene != &packet.state<SceneState>() || scene.frame != 0) throw std::runtime_error("state() is not one zeroed block");
+    packet.reset();
+    if (packet.bytesUsed() != 0 || packet.draws.size() != 0) throw std::runtime_error("reset() left data behind");
+}
+
+void testOrdering(bool threaded) {
+    const uint32_t frames = 300;
+    std::vector<uint64_t> rendered;
+    std::vector<const FramePacket*> addresses;
+    RenderThreadOptions options = RenderThreadOptions().arena(64 * 1024).buckets(2);
+    if (!threaded) options.sameThread();
+    {
+        RenderThread renderer([&](FramePacket& packet) {
+            const SceneState& scene = packet.state<SceneState>();
+            if (scene.frame != packet.serial()) throw std::runtime_error("packet state does not match its serial");
+            for (uint32_t i = 0; i < scene.objectCount; ++i) {
+                if (scene.objects[i] != scene.frame * 1000 + i) throw std::runtime_error("packet arena data corrupted");
+            }
+            if (packet.draws.size() != scene.objectCount) throw std::runtime_error("packet draw count");
+            rendered.push_back(scene.frame);
+            addresses.push_back(&packet);
+        }, options);
+        if (renderer.isThreaded() != threaded) throw std::runtime_error("sameThread() not applied");
+
+        for (uint32_t f = 1; f <= frames; ++f) {
+            FramePacket& packet = renderer.beginPacket();
+            SceneState& scene = packet.state<SceneState>();
+            scene.frame = f;
+            scene.objectCount = f % 50;
+            uint32_t* objects = packet.allocate<uint32_t>(scene.objectCount);
+            for (uint32_t i = 0; i < scene.objectCount; ++i) {
+                objects[i] = f * 1000 + i;
+                VkPipeline pipeline = reinterpret_cast<VkPipeline>(uintptr_t(0x100));
+                packet.draws.bucket(i % 2).draw(DrawList::key(0, pipeline, i, 0.5f), pipeline, objects[i], 1);
+            }
+            scene.objects = objects;
+            // Game-side work overlaps the render side of the previous packet.
+            spinFor(0.01);
+            renderer.submitPacket();
+        }
+        renderer.flush();
+    }
+    if (rendered.size() != frames) throw std::runtime_error("packets lost");
+    for (uint32_t f = 0; f < frames; ++f) {
+        if (rendered[f] != f + 1) throw std::runtime_error("packets rendered out of order");
+        if (addresses[f] != addresses[f % 2]) throw std::runtime_error("packets are not double-buffered");
+    }
+    if (addresses[0] == addresses[1]) throw std::runtime_error("consecutive frames share a packet");
+}
+
+void testErrors() {
+    RenderThread renderer([](FramePacket& packet) {
+        if (packet.serial() == 5) throw std::runtime_error("render failed");
+    });
+    bool threw = false;
+    try {
+        for (int f = 0; f < 20; ++f) {
+            renderer.beginPacket();
+            renderer.submitPacket();
+        }
+        renderer.flush();
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()) == "render failed";
+    }
+    if (!threw) throw std::runtime_error("render exception did not reach the game thread");
+    threw = false;
+    try {
+        renderer.flush();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::runtime_error("render error was not sticky");
+
+    RenderThread idle([](FramePacket&) {});
+    threw = false;
+    try {
+        idle.submitPacket();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::runtime_error("submitPacket() without beginPacket() accepted");
+}
+
+void testGpuWork() {
+    // Offscreen: the render thread records and submits; the game thread reads back after flush().
+    const uint32_t frames = 16;
+    Buffer target(BufferBuilder(frames * sizeof(uint32_t)).readback().transferDestination());
+    {
+        RenderThread renderer([&](FramePacket& packet) {
+            uint32_t value = packet.state<SceneState>().objectCount;
+            Commands cmd = Commands::oneShot();
+            cmd.fillBuffer(target, value, (packet.serial() - 1) * sizeof(uint32_t), sizeof(uint32_t));
+            cmd.submitAndWait();
+        });
+        for (uint32_t f = 0; f < frames; ++f) {
+            renderer.beginPacket().state<SceneState>().objectCount = 0xA000 + f;
+            renderer.submitPacket();
+        }
+        renderer.flush();
+    }
+    std::vector<uint32_t> values(frames);
+    target.invalidate();
+    target.download(values.data(), values.size() * sizeof(uint32_t));
+    for (uint32_t f = 0; f < frames; ++f) {
+        if (values[f] != 0xA000 + f) throw std::runtime_error("render-thread GPU work did not land");
+    }
+}
+
+void bench() {
+    using Clock = std::chrono::steady_clock;
+    const uint32_t frames = 200;
+    for (auto [simMillis, renderMillis] : {std::pair{2.0, 2.0}, std::pair{3.0, 1.0}, std::pair{1.0, 3.0}}) {
+        double perFrame[2] = {};
+        for (bool threaded : {false, true}) {
+            RenderThreadOptions options;
+            if (!threaded) options.sameThread();
+            RenderThread renderer([&](FramePacket&) { spinFor(renderMillis); }, options);
+            auto t0 = Clock::now();
+            for (uint32_t f = 0; f < frames; ++f) {
+                renderer.beginPacket();
+                spinFor(simMillis);
+                renderer.submitPacket();
+            }
+            renderer.flush();
+            perFrame[threaded] = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / frames;
+        }
+        std::cout << "sim " << simMillis << " ms + render " << renderMillis << " ms: serial " << perFrame[0]
+                  << " ms/frame, render thread " << perFrame[1] << " ms/frame (ideal "
+                  << std::max(simMillis, renderMillis) << ")\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("render thread", argc, argv, [] {
+        testArena();
+        testOrdering(true);
+        testOrdering(false);
+        testErrors();
+        TestContext ctx;
+        testGpuWork();
+    }, bench);
+}
@@ -0,0 +1,118 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// ShadowAtlas::layout packing invariants (in bounds, no overlap, LOD follows importance,
+// least important lights shrink then drop when the atlas is full), then a smoke test that
+// renders tiles and checks the uploaded UV transforms.
+
+namespace {
+
+bool overlaps(const ShadowTile& a, const ShadowTile& b) {
+    return a.x < b.x + b.size && b.x < a.x + a.size && a.y < b.y + b.size && b.y < a.y + a.size;
+}
+
+void checkPacking(const std::vector<ShadowTile>& tiles, uint32_t atlasSize, const std::string& name) {
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        if (!tiles[i].valid()) continue;
+        if (tiles[i].x + tiles[i].size > atlasSize || tiles[i].y + tiles[i].size > atlasSize) {
+            throw std::runtime_error(name + ": tile " + std::to_string(i) + " leaves the atlas");
+        }
+        for (size_t j = i + 1; j < tiles.size(); ++j) {
+            if (tiles[j].valid() && overlaps(tiles[i], tiles[j])) {
+                throw std::runtime_error(name + ": tiles " + std::to_string(i) + " and " + std::to_string(j) + " overlap");
+            }
+        }
+    }
+}
+
+void testLayout() {
+    // Fits: sizes follow importance directly.
+    std::vector<float> few = { 1.0f, 0.5f, 0.3f, 0.01f };
+    auto tiles = ShadowAtlas::layout(few, 4096, 1024, 128);
+    checkPacking(tiles, 4096, "few");
+    uint32_t want[] = { 1024, 512, 256, 128 };
+    for (size_t i = 0; i < few.size(); ++i) {
+        if (tiles[i].size != want[i]) {
+            throw std::runtime_error("few: tile " + std::to_string(i) + " is " + std::to_string(tiles[i].size) +
+                                     ", want " + std::to_string(want[i]));
+        }
+    }
+
+    // Over budget: 40 full-size requests cannot fit 16 slots of 1024. Everything shrinks
+    // from the least important end and more important lights never get smaller tiles.
+    std::mt19937 rng(86);
+    std::uniform_real_distribution<float> dist(0.9f, 1.0f);
+    std::vector<float> many(40);
+    for (auto& v : many) v = dist(rng);
+    tiles = ShadowAtlas::layout(many, 4096, 1024, 128);
+    checkPacking(tiles, 4096, "many");
+    for (size_t i = 0; i < many.size(); ++i) {
+        if (!tiles[i].valid()) throw std::runtime_error("many: a light was dropped although minimum tiles fit");
+        for (size_t j = 0; j < many.size(); ++j) {
+            if (many[i] > many[j] && tiles[i].size < tiles[j].size) {
+                throw std::runtime_error("many: a more important light got a smaller tile");
+            }
+        }
+    }
+
+    // Far over budget: 300 minimum tiles against 256 cells; the 44 least important drop.
+    std::vector<float> flood(300);
+    for (size_t i = 0; i < flood.size(); ++i) flood[i] = 1.0f - float(i) / float(flood.size());
+    tiles = ShadowAtlas::layout(flood, 2048, 1024, 128);
+    checkPacking(tiles, 2048, "flood");
+    for (size_t i = 0; i < flood.size(); ++i) {
+        bool wantValid = i < 256;
+        if (tiles[i].valid() != wantValid || (wantValid && tiles[i].size != 128)) {
+            throw std::runtime_error("flood: tile " + std::to_string(i) + " has unexpected size " + std::to_string(tiles[i].size));
+        }
+    }
+}
+
+void testRender() {
+    Commands init = Commands::oneShot();
+    ShadowAtlas atlas(init, 1024, 512, 64, 16);
+    init.submitAndWait();
+
+    std::vector<float> importance = { 1.0f, 0.25f, 0.6f };
+    for (int frame = 0; frame < 2; ++frame) {   // second round takes the sampled -> attachment barrier
+        auto tiles = atlas.allocate(importance);
+        auto cmd = Commands::oneShot();
+        atlas.begin(cmd);
+        for (uint32_t i = 0; i < tiles.size(); ++i) atlas.setTile(cmd, i);
+        atlas.end(cmd);
+        cmd.submitAndWait();
+    }
+
+    // Matches include/glsl/shadow_atlas.glsl: (scale.xy, offset.xy), (min.xy, max.xy).
+    auto tiles = atlas.currentTiles();
+    const float* words = static_cast<const float*>(atlas.tileBuffer().mappedData());
+    for (size_t i = 0; i < tiles.size(); ++i, words += 8) {
+        float scale = float(tiles[i].size) / 1024.0f;
+        float u = float(tiles[i].x) / 1024.0f, v = float(tiles[i].y) / 1024.0f;
+        if (std::abs(words[0] - scale) > 1e-6f || std::abs(words[2] - u) > 1e-6f || std::abs(words[3] - v) > 1e-6f) {
+            throw std::runtime_error("tile " + std::to_string(i) + " transform does not match its rect");
+        }
+        if (!(words[4] > u && words[6] < u + scale)) {
+            throw std::runtime_error("tile " + std::to_string(i) + " clamp bounds are not inside its rect");
+        }
+    }
+    if (atlas.rid() == kNullRid || atlas.tileBufferRID() == kNullRid) throw std::runtime_error("ShadowAtlas has no RIDs");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("shadow atlas", argc, argv, [] {
+        testLayout();
+        TestContext ctx;
+        testRender();
+    });
+}
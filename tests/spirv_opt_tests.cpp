@@ -0,0 +1,209 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// SPIR-V optimization: stripping the build's test shaders drops every debug instruction and
+// shrinks them, unreachable functions go with their locals' decorations while called ones
+// stay, the cache hits on a repeat and keys on the level, and a context with optimizeShaders()
+// keeps the original reflection and creates pipelines under validation. `--bench` compares module size and pipeline creation time
+// for each SpirvOptimization level.
+
+namespace {
+
+const char* kTestShaders[] = {
+    "tests/shaders/as_oracle.comp.spv",
+    "tests/shaders/constant_fetch.comp.spv",
+    "tests/shaders/uniform_at_storage_binding.comp.spv",
+};
+
+struct TempDir {
+    std::filesystem::path path;
+    TempDir() {
+        path = std::filesystem::temp_directory_path() / ("vkobjects-spirv-opt-" + std::to_string(getpid()));
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+std::vector<uint8_t> load(const char* path) {
+    ShaderBuilder builder;
+    builder.compute().fromFile(path);
+    std::span<const uint8_t> code = builder.bytes();
+    return std::vector<uint8_t>(code.begin(), code.end());
+}
+
+std::vector<uint32_t> words(const std::vector<uint8_t>& bytes) {
+    std::vector<uint32_t> out(bytes.size() / 4);
+    std::memcpy(out.data(), bytes.data(), out.size() * 4);
+    return out;
+}
+
+std::vector<uint8_t> bytes(const std::vector<uint32_t>& words) {
+    std::vector<uint8_t> out(words.size() * 4);
+    std::memcpy(out.data(), words.data(), out.size());
+    return out;
+}
+
+// Calls `fn(opcode, instruction)` for each instruction after the header.
+template<typename F>
+void forEachInstruction(const std::vector<uint32_t>& module, F&& fn) {
+    for (size_t pos = 5; pos < module.size();) {
+        uint32_t count = module[pos] >> 16;
+        if (count == 0 || pos + count > module.size()) throw std::runtime_error("malformed SPIR-V");
+        fn(module[pos] & 0xFFFF, &module[pos]);
+        pos += count;
+    }
+}
+
+uint32_t op(uint32_t count, uint32_t opcode) { return (count << 16) | opcode; }
+
+// OpEntryPoint main (%1) calls %5; %4 is never called and declares %12, a RelaxedPrecision
+// local. Hand-assembled so the dead function survives: glslc drops unused functions itself.
+const uint32_t kDeadLocal = 12;
+
+std::vector<uint8_t> moduleWithDeadFunction() {
+    const uint32_t entry = 1, voidType = 2, fnType = 3, dead = 4, helper = 5, floatType = 10, floatPtr = 11;
+    std::vector<uint32_t> w = {
+        0x07230203u, 0x00010000u, 0, 13, 0,
+        op(2, 17), 1,                                          // OpCapability Shader
+        op(3, 14), 0, 1,                                       // OpMemoryModel Logical GLSL450
+        op(5, 15), 5, entry, 0x6E69616Du, 0,                   // OpEntryPoint GLCompute "main"
+        op(6, 16), entry, 17, 1, 1, 1,                         // OpExecutionMode LocalSize 1 1 1
+        op(4, 5), dead, 0x64616564u, 0,                        // OpName "dead"
+        op(3, 71), kDeadLocal, 0,                              // OpDecorate RelaxedPrecision
+        op(2, 19), voidType,                                   // OpTypeVoid
+        op(3, 33), fnType, voidType,                           // OpTypeFunction
+        op(3, 22), floatType, 32,                              // OpTypeFloat 32
+        op(4, 32), floatPtr, 7, floatType,                     // OpTypePointer Function
+        op(5, 54), voidType, entry, 0, fnType,                 // main
+        op(2, 248), 6,
+        op(4, 57), voidType, 7, helper,                        // OpFunctionCall helper
+        op(1, 253), op(1, 56),
+        op(5, 54), voidType, dead, 0, fnType,                  // dead
+        op(2, 248), 8,
+        op(4, 59), floatPtr, kDeadLocal, 7,                    // OpVariable Function
+        op(1, 253), op(1, 56),
+        op(5, 54), voidType, helper, 0, fnType,                // helper
+        op(2, 248), 9, op(1, 253), op(1, 56),
+    };
+    return bytes(w);
+}
+
+std::vector<uint32_t> functionIds(const std::vector<uint8_t>& module) {
+    std::vector<uint32_t> ids;
+    forEachInstruction(words(module), [&](uint32_t opcode, const uint32_t* inst) {
+        if (opcode == 54) ids.push_back(inst[2]);
+    });
+    return ids;
+}
+
+void testStripTestShaders() {
+    const uint32_t debugOps[] = {2, 3, 4, 5, 6, 7, 8, 317, 330};
+    for (const char* path : kTestShaders) {
+        std::vector<uint8_t> original = load(path);
+        std::vector<uint8_t> stripped = stripSpirv(original);
+        if (stripped.size() >= original.size()) throw std::runtime_error(std::string("strip did not shrink ") + path);
+        forEachInstruction(words(stripped), [&](uint32_t opcode, const uint32_t*) {
+            for (uint32_t debug : debugOps) {
+                if (opcode == debug) throw std::runtime_error(std::string("debug instruction left in ") + path);
+            }
+        });
+        if (stripSpirv(stripped) != stripped) throw std::runtime_error("strip is not idempotent");
+    }
+    std::vector<uint8_t> garbage = {1, 2, 3, 4, 5, 6};
+    if (stripSpirv(garbage) != garbage) throw std::runtime_error("non-SPIR-V input changed");
+}
+
+void testDeadFunctions() {
+    if (functionIds(moduleWithDeadFunction()).size() != 3) throw std::runtime_error("hand-assembled module");
+    std::vector<uint8_t> stripped = stripSpirv(moduleWithDeadFunction());
+    std::vector<uint32_t> ids = functionIds(stripped);
+    if (ids != std::vector<uint32_t>{1, 5}) throw std::runtime_error("unreachable function kept, or a called one removed");
+    forEachInstruction(words(stripped), [](uint32_t opcode, const uint32_t* inst) {
+        if (opcode == 71 && inst[1] == kDeadLocal) throw std::runtime_error("decoration of a removed function's local kept");
+    });
+}
+
+void testCache() {
+    TempDir dir;
+    std::vector<uint8_t> original = load(kTestShaders[1]);
+    SpirvOptimizer optimizer(SpirvOptimization::Size, dir.path.string());
+    std::vector<uint8_t> cold = optimizer.optimize(original);
+    std::vector<uint8_t> warm = optimizer.optimize(original);
+    if (optimizer.misses() != 1 || optimizer.hits() != 1 || warm != cold) throw std::runtime_error("repeat optimize missed the cache");
+    if (cold.size() > original.size()) throw std::runtime_error("Size level grew the module");
+
+    SpirvOptimizer strip(SpirvOptimization::Strip, dir.path.string());
+    if (strip.cacheKey(original) == optimizer.cacheKey(original)) throw std::runtime_error("level not in the key");
+    if (optimizer.cacheKey(original) == optimizer.cacheKey(load(kTestShaders[0]))) throw std::runtime_error("module not in the key");
+
+    SpirvOptimizer none(SpirvOptimization::None, dir.path.string());
+    if (none.optimize(original) != original || none.misses() != 0) throw std::runtime_error("None changed the module");
+}
+
+void testContext() {
+    TempDir dir;
+    VulkanContext context(VulkanContextOptions().offscreenSize(64, 64).jobWorkers(0).validation().throwOnValidationError()
+                              .optimizeShaders(SpirvOptimization::Strip, dir.path.string()));
+    ShaderModule module(ShaderBuilder().compute().fromFile(kTestShaders[1]));
+    if (module.reflection.pushConstantSize != 16 || module.reflection.localSize[0] != 64) {
+        throw std::runtime_error("reflection of an optimized module");
+    }
+    createComputePipeline(module);
+    ShaderModule again(ShaderBuilder().compute().fromFile(kTestShaders[1]));
+    if (context.shaderOptimizer().misses() != 1 || context.shaderOptimizer().hits() != 1) {
+        throw std::runtime_error("ShaderModule did not go through the context's optimizer");
+    }
+    // The validation layers check the stripped hand-assembled module too: a decoration left on
+    // the dead function's local would target an undefined id.
+    std::vector<uint8_t> handMade = moduleWithDeadFunction();
+    ShaderModule stripped(ShaderBuilder().compute().fromBuffer(std::span<const uint8_t>(handMade)));
+}
+
+void bench() {
+    using Clock = std::chrono::steady_clock;
+    const int repeats = 50;
+    std::cout << "SPIRV-Tools " << (SpirvOptimizer::toolsAvailable() ? "available" : "not available (Size/Performance strip only)") << "\n";
+    const char* names[] = {"None", "Strip", "Size", "Performance"};
+    for (SpirvOptimization level : {SpirvOptimization::None, SpirvOptimization::Strip, SpirvOptimization::Size,
+                                    SpirvOptimization::Performance}) {
+        VulkanContext context(VulkanContextOptions().offscreenSize(64, 64).jobWorkers(0).optimizeShaders(level));
+        size_t moduleBytes = 0;
+        double optimizeMs = 0.0, pipelineMs = 0.0;
+        for (const char* path : kTestShaders) {
+            std::vector<uint8_t> original = load(path);
+            auto t0 = Clock::now();
+            moduleBytes += context.shaderOptimizer().optimize(original).size();
+            optimizeMs += std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+            ShaderModule module(ShaderBuilder().compute().fromBuffer(std::span<const uint8_t>(original)));
+            auto t1 = Clock::now();
+            for (int i = 0; i < repeats; ++i) createComputePipeline(module);
+            pipelineMs += std::chrono::duration<double, std::milli>(Clock::now() - t1).count() / repeats;
+        }
+        std::cout << names[int(level)] << ": " << moduleBytes << " B of SPIR-V, optimize " << optimizeMs
+                  << " ms, pipeline creation " << pipelineMs << " ms (sum over " << std::size(kTestShaders) << " shaders)\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("spirv opt", argc, argv, [] {
+        testStripTestShaders();
+        testDeadFunctions();
+        testCache();
+        testContext();
+    }, bench);
+}
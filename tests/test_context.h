@@ -0,0 +1,68 @@
+#pragma once
+
+// Shared by the test executables: a VulkanContext on a hidden SDL window, an expected-exception
+// check, and the main() body every test binary runs.
+
+#include "vkobjects.h"
+
+#include <SDL3/SDL.h>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// A context on a hidden 64x64 window, so Frame, the swapchain and presentation are available.
+// Validation is added, throwing on errors, unless `validation` is false: benchmarks, and tests
+// that count allocations the layers would add to, turn it off.
+struct TestContext {
+    SDL_Window* window = nullptr;
+    std::unique_ptr<VulkanContext> context;
+
+    explicit TestContext(VulkanContextOptions opts = VulkanContextOptions(), bool validation = true) {
+        if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS)) {
+            throw std::runtime_error("SDL_Init failed");
+        }
+        window = SDL_CreateWindow("vkobjects-tests", 64, 64, SDL_WINDOW_VULKAN | SDL_WINDOW_HIDDEN);
+        if (!window) throw std::runtime_error("SDL_CreateWindow failed");
+        if (validation) opts.validation().throwOnValidationError();
+        context = std::make_unique<VulkanContext>(window, opts);
+    }
+
+    ~TestContext() {
+        context.reset();
+        if (window) SDL_DestroyWindow(window);
+        SDL_Quit();
+    }
+};
+
+// Runs `fn` and throws unless it throws std::runtime_error; `what` names the expected failure.
+template<typename F>
+void expectThrow(F&& fn, const char* what) {
+    try {
+        fn();
+    } catch (const std::runtime_error&) {
+        return;
+    }
+    throw std::runtime_error(std::string("no exception: ") + what);
+}
+
+// The body of a test binary's main(): `--bench` runs `bench` when there is one, otherwise
+// `tests` runs. Prints "<name> tests passed" or "<name> tests failed: <what>" and returns the
+// exit code.
+inline int runTests(const char* name, int argc, char** argv, const std::function<void()>& tests,
+                    const std::function<void()>& bench = nullptr) {
+    try {
+        if (bench && argc > 1 && std::string(argv[1]) == "--bench") {
+            bench();
+            return 0;
+        }
+        tests();
+    } catch (const std::exception& e) {
+        std::cout << name << " tests failed: " << e.what() << "\n";
+        return 1;
+    }
+    std::cout << name << " tests passed\n";
+    return 0;
+}
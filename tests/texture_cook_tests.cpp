@@ -0,0 +1,285 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// cookTexture / CookedTexture / loadCookedTexture: the mip table matches the chain Image would
+// build, output does not depend on the thread count, both filters keep flat colors flat, BC
+// blocks decode close to the source, and an uploaded texture reads back mip by mip. `--bench`
+// instead times cooking a 2048x2048 texture and its upload against GPU mip generation.
+
+namespace {
+
+std::vector<uint8_t> gradient(uint32_t w, uint32_t h) {
+    std::vector<uint8_t> bgra(size_t(w) * h * 4);
+    for (uint32_t y = 0; y < h; ++y) {
+        for (uint32_t x = 0; x < w; ++x) {
+            uint8_t* p = &bgra[(size_t(y) * w + x) * 4];
+            p[0] = uint8_t(x * 255 / w);
+            p[1] = uint8_t(y * 255 / h);
+            p[2] = uint8_t((x + y) * 127 / (w + h));
+            p[3] = uint8_t(255 - x * 255 / w);
+        }
+    }
+    return bgra;
+}
+
+std::span<const uint8_t> mip(const std::vector<uint8_t>& file, const CookedTexture& texture, uint32_t level) {
+    const VkBufferImageCopy& r = texture.regions[level];
+    size_t next = level + 1 < texture.mipLevels ? texture.regions[level + 1].bufferOffset : file.size();
+    return std::span<const uint8_t>(file.data() + r.bufferOffset, next - r.bufferOffset);
+}
+
+void testLayout() {
+    const uint32_t w = 37, h = 20;
+    auto source = gradient(w, h);
+    auto file = cookTexture(source.data(), w, h, TextureCookOptions().threadCount(1));
+    CookedTexture texture(file);
+    if (texture.format != VK_FORMAT_B8G8R8A8_SRGB || texture.mipLevels != 6 || texture.byteSize != file.size()) {
+        throw std::runtime_error("unexpected cooked texture header");
+    }
+    for (uint32_t m = 0; m < texture.mipLevels; ++m) {
+        const VkBufferImageCopy& r = texture.regions[m];
+        if (r.imageExtent.width != std::max(1u, w >> m) || r.imageExtent.height != std::max(1u, h >> m) ||
+            r.imageSubresource.mipLevel != m || r.bufferOffset % 16 != 0) {
+            throw std::runtime_error("mip " + std::to_string(m) + " region does not match the chain");
+        }
+    }
+    if (std::memcmp(mip(file, texture, 0).data(), source.data(), source.size()) != 0) {
+        throw std::runtime_error("mip 0 is not the source");
+    }
+    for (auto options : { TextureCookOptions().kaiser(), TextureCookOptions().bc3() }) {
+        TextureCookOptions serial = options, parallel = options;
+        if (cookTexture(source.data(), w, h, serial.threadCount(1)) != cookTexture(source.data(), w, h, parallel.threadCount(7))) {
+            throw std::runtime_error("cooked output depends on the thread count");
+        }
+    }
+
+    bool threw = false;
+    try {
+        file.resize(file.size() - 1);
+        CookedTexture truncated(file);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) throw std::runtime_error("truncated cooked texture accepted");
+}
+
+void testFilters() {
+    // A flat color stays flat through every level of either filter.
+    const uint8_t color[4] = { 10, 200, 90, 128 };
+    std::vector<uint8_t> flat(64 * 48 * 4);
+    for (size_t i = 0; i < flat.size(); ++i) flat[i] = color[i % 4];
+    for (auto options : { TextureCookOptions().box(), TextureCookOptions().kaiser() }) {
+        auto file = cookTexture(flat.data(), 64, 48, options);
+        CookedTexture texture(file);
+        for (uint32_t m = 1; m < texture.mipLevels; ++m) {
+            auto bytes = mip(file, texture, m);
+            size_t texels = size_t(texture.regions[m].imageExtent.width) * texture.regions[m].imageExtent.height;
+            for (size_t i = 0; i < texels * 4; ++i) {
+                if (std::abs(int(bytes[i]) - int(color[i % 4])) > 1) {
+                    throw std::runtime_error("flat color drifted at mip " + std::to_string(m));
+                }
+            }
+        }
+    }
+
+    // A black/white checkerboard box-filters to 50% linear gray, which is 188 in sRGB and 128
+    // when the data is linear.
+    std::vector<uint8_t> checker(4 * 4 * 4);
+    for (uint32_t i = 0; i < 16; ++i) {
+        uint8_t v = ((i % 4 + i / 4) % 2) ? 255 : 0;
+        checker[i * 4 + 0] = checker[i * 4 + 1] = checker[i * 4 + 2] = v;
+        checker[i * 4 + 3] = 255;
+    }
+    for (auto [options, want] : { std::pair{ TextureCookOptions(), 188 }, std::pair{ TextureCookOptions().linear(), 128 } }) {
+        auto file = cookTexture(checker.data(), 4, 4, options);
+        CookedTexture texture(file);
+        if (std::abs(int(mip(file, texture, 1)[0]) - want) > 1) {
+            throw std::runtime_error("checkerboard mip 1 is " + std::to_string(mip(file, texture, 1)[0]) +
+                                     ", want " + std::to_string(want));
+        }
+    }
+}
+
+// Reference BC1/BC3 decoders, written from the format description independently of the encoder.
+void decode565(uint16_t c, int bgr[3]) {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    bgr[0] = (b << 3) | (b >> 2);
+    bgr[1] = (g << 2) | (g >> 4);
+    bgr[2] = (r << 3) | (r >> 2);
+}
+
+void decodeColorBlock(const uint8_t* block, bool bc1, uint8_t out[64]) {
+    uint16_t c0 = uint16_t(block[0] | block[1] << 8), c1 = uint16_t(block[2] | block[3] << 8);
+    int palette[4][3];
+    decode565(c0, palette[0]);
+    decode565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        if (!bc1 || c0 > c1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    uint32_t indices = uint32_t(block[4]) | uint32_t(block[5]) << 8 | uint32_t(block[6]) << 16 | uint32_t(block[7]) << 24;
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) out[i * 4 + c] = uint8_t(palette[(indices >> (2 * i)) & 3][c]);
+    }
+}
+
+void decodeAlphaBlock(const uint8_t* block, uint8_t out[64]) {
+    int a0 = block[0], a1 = block[1];
+    int palette[8] = { a0, a1 };
+    if (a0 > a1) {
+        for (int i = 2; i < 8; ++i) palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+    } else {
+        for (int i = 2; i < 6; ++i) palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i) indices |= uint64_t(block[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; ++i) out[i * 4 + 3] = uint8_t(palette[(indices >> (3 * i)) & 7]);
+}
+
+void testBlockCompression() {
+    const uint32_t w = 37, h = 20;
+    auto source = gradient(w, h);
+    for (bool bc3 : { false, true }) {
+        auto file = cookTexture(source.data(), w, h, bc3 ? TextureCookOptions().bc3() : TextureCookOptions().bc1());
+        CookedTexture texture(file);
+        if (texture.format != (bc3 ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK)) {
+            throw std::runtime_error("unexpected BC format");
+        }
+        const uint32_t blockBytes = bc3 ? 16 : 8, blocksX = (w + 3) / 4, channels = bc3 ? 4 : 3;
+        const uint8_t* blocks = mip(file, texture, 0).data();
+        double totalError = 0;
+        int maxError = 0;
+        for (uint32_t by = 0; by < (h + 3) / 4; ++by) {
+            for (uint32_t bx = 0; bx < blocksX; ++bx) {
+                const uint8_t* block = blocks + (size_t(by) * blocksX + bx) * blockBytes;
+                uint8_t decoded[64];
+                if (bc3) {
+                    decodeAlphaBlock(block, decoded);
+                    decodeColorBlock(block + 8, false, decoded);
+                } else {
+                    decodeColorBlock(block, true, decoded);
+                }
+                for (uint32_t i = 0; i < 16; ++i) {
+                    uint32_t x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                    if (x >= w || y >= h) continue;
+                    for (uint32_t c = 0; c < channels; ++c) {
+                        int error = std::abs(int(decoded[i * 4 + c]) - int(source[(size_t(y) * w + x) * 4 + c]));
+                        totalError += error;
+                        maxError = std::max(maxError, error);
+                    }
+                }
+            }
+        }
+        double meanError = totalError / (double(w) * h * channels);
+        if (meanError > 8.0 || maxError > 40) {
+            throw std::runtime_error(std::string(bc3 ? "BC3" : "BC1") + " error too large: mean " +
+                                     std::to_string(meanError) + ", max " + std::to_string(maxError));
+        }
+    }
+}
+
+void testUpload() {
+    const uint32_t w = 50, h = 33;
+    auto source = gradient(w, h);
+    auto file = cookTexture(source.data(), w, h, TextureCookOptions().kaiser());
+    CookedTexture texture(file);
+
+    auto cmd = Commands::oneShot();
+    Image image = loadCookedTexture(cmd, file);
+    if (image.mipLevelCount() != texture.mipLevels) throw std::runtime_error("image mip count mismatch");
+
+    BufferBuilder readbackBuilder(file.size());
+    readbackBuilder.readback().transferDestination();
+    Buffer readback(readbackBuilder);
+    Barrier(cmd).image(image, texture.mipLevels)
+        .from(Stage::Fragment, Access::ShaderRead, Layout::ShaderReadOnly)
+        .to(Stage::Transfer, Access::TransferRead, Layout::TransferSrc)
+        .record();
+    // The same regions in reverse land every mip at its file offset.
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback,
+                           uint32_t(texture.regions.size()), texture.regions.data());
+    cmd.bufferBarrier(readback, Stage::Transfer, Access::TransferWrite, Stage::Host, Access::HostRead);
+    cmd.submitAndWait();
+
+    std::vector<uint8_t> got(file.size());
+    readback.invalidate();
+    readback.download(got.data(), got.size());
+    for (uint32_t m = 0; m < texture.mipLevels; ++m) {
+        auto want = mip(file, texture, m);
+        size_t bytes = size_t(texture.regions[m].imageExtent.width) * texture.regions[m].imageExtent.height * 4;
+        if (std::memcmp(got.data() + texture.regions[m].bufferOffset, want.data(), bytes) != 0) {
+            throw std::runtime_error("mip " + std::to_string(m) + " read back differently");
+        }
+    }
+}
+
+void bench() {
+    using Clock = std::chrono::steady_clock;
+    const uint32_t size = 2048;
+    std::vector<uint8_t> source(size_t(size) * size * 4);
+    uint32_t state = 91;
+    for (auto& b : source) b = uint8_t((state = state * 1664525u + 1013904223u) >> 24);
+
+    uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint8_t> cooked;
+    std::cout << "cook " << size << "x" << size << "\n";
+    for (auto [label, options] : { std::pair{ "box", TextureCookOptions() },
+                                   std::pair{ "kaiser", TextureCookOptions().kaiser() },
+                                   std::pair{ "kaiser+bc3", TextureCookOptions().kaiser().bc3() } }) {
+        for (uint32_t threads : { 1u, cores }) {
+            auto t0 = Clock::now();
+            auto file = cookTexture(source.data(), size, size, options.threadCount(threads));
+            auto t1 = Clock::now();
+            std::cout << "  " << label << ", " << threads << " thread(s): "
+                      << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+            if (std::string(label) == "box") cooked = std::move(file);
+        }
+    }
+
+    TestContext ctx(VulkanContextOptions(), false);
+    BufferBuilder stagingBuilder(source.size());
+    stagingBuilder.transferSource().hostVisible();
+    Buffer staging(stagingBuilder);
+    staging.upload(source.data(), source.size());
+    GpuTimer timer(2);
+    for (int run = 0; run < 3; ++run) {   // first runs warm clocks and caches
+        auto cmd = Commands::oneShot();
+        timer.begin(cmd);
+        Image generated(ImageBuilder().fromStagingBuffer(staging, size, size, VK_FORMAT_B8G8R8A8_SRGB), cmd);
+        timer.mark(cmd, "upload + recordMipmapGeneration");
+        Image loaded = loadCookedTexture(cmd, cooked);
+        timer.mark(cmd, "cooked multi-region copy");
+        cmd.submitAndWait();
+    }
+    for (auto& [label, ms] : timer.resolve()) std::cout << "  " << label << ": " << ms << " ms\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("texture cook", argc, argv, [] {
+        testLayout();
+        testFilters();
+        testBlockCompression();
+        TestContext ctx;
+        testUpload();
+    }, bench);
+}
@@ -0,0 +1,159 @@
+#include "test_context.h"
+#include "vkobjects.h"
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Bindless uniform buffers (binding 4): RID registration, reflection-time binding checks, and
+// constant_fetch.comp read through both the uniform and storage paths against a CPU sum.
+// `--bench` instead prints constant-fetch throughput for both paths.
+
+namespace {
+
+// Matches constant_fetch.comp.
+constexpr uint32_t kTableEntries = 1024;
+constexpr uint32_t kWorkgroupSize = 64;
+struct FetchPush {
+    uint32_t tableRID;
+    uint32_t uniformTableRID;
+    uint32_t outRID;
+    uint32_t iterations;
+};
+
+std::vector<uint32_t> randomTable() {
+    std::mt19937 rng(84);
+    std::vector<uint32_t> words(kTableEntries * 4);
+    for (auto& w : words) w = rng();
+    return words;
+}
+
+std::unique_ptr<Buffer> uniformTable(const std::vector<uint32_t>& words) {
+    BufferBuilder builder(words.size() * sizeof(uint32_t));
+    builder.uniform();
+    auto buffer = std::make_unique<Buffer>(builder);
+    buffer->upload((void*)words.data(), words.size() * sizeof(uint32_t));
+    return buffer;
+}
+
+Pipeline fetchPipeline(ShaderModule& shader, bool useUniform) {
+    return createComputePipeline(shader, SpecConstants().set(0, useUniform ? 1u : 0u));
+}
+
+void testRids() {
+    auto table = uniformTable(randomTable());
+    if (table->uniformRid() == kNullRid) throw std::runtime_error("uniform() buffer has no uniform RID");
+    if (table->rid() == kNullRid) throw std::runtime_error("uniform() buffer lost its storage RID");
+
+    BufferBuilder plainBuilder(64);
+    plainBuilder.storage();
+    Buffer plain(plainBuilder);
+    if (plain.uniformRid() != kNullRid) throw std::runtime_error("storage buffer got a uniform RID");
+}
+
+void testFetchOracle() {
+    auto words = randomTable();
+    auto table = uniformTable(words);
+    ShaderModule shader(ShaderBuilder().compute().fromFile("tests/shaders/constant_fetch.comp.spv"));
+
+    const uint32_t invocations = kWorkgroupSize * 4;
+    const uint32_t iterations = kTableEntries * 2 + 37;
+    uint32_t want = 0;
+    for (uint32_t i = 0; i < iterations; ++i) {
+        for (uint32_t c = 0; c < 4; ++c) want += words[(i % kTableEntries) * 4 + c];
+    }
+
+    for (bool useUniform : {true, false}) {
+        Pipeline pipeline = fetchPipeline(shader, useUniform);
+        BufferBuilder outBuilder(invocations * sizeof(uint32_t));
+        outBuilder.storage().hostVisible();
+        Buffer out(outBuilder);
+
+        FetchPush push = { table->rid(), table->uniformRid(), out.rid(), iterations };
+        auto cmd = Commands::oneShot();
+        cmd.bindCompute(pipeline);
+        cmd.pushConstants(push);
+        cmd.dispatch(invocations / kWorkgroupSize, 1, 1);
+        cmd.bufferBarrier(out, Stage::Compute, Access::ShaderWrite, Stage::Host, Access::HostRead);
+        cmd.submitAndWait();
+
+        std::vector<uint32_t> got(invocations);
+        out.download(got.data(), got.size() * sizeof(uint32_t));
+        for (uint32_t i = 0; i < invocations; ++i) {
+            if (got[i] != want) {
+                throw std::runtime_error(std::string(useUniform ? "uniform" : "storage") + " fetch mismatch at " +
+                                         std::to_string(i) + " (got " + std::to_string(got[i]) + ", want " +
+                                         std::to_string(want) + ")");
+            }
+        }
+    }
+}
+
+void expectPipelineError(const char* spirv, const std::string& fragment) {
+    ShaderModule shader(ShaderBuilder().compute().fromFile(spirv));
+    try {
+        Pipeline pipeline = createComputePipeline(shader);
+    } catch (const std::runtime_error& e) {
+        if (std::string(e.what()).find(fragment) == std::string::npos) {
+            throw std::runtime_error(std::string("unexpected pipeline error: ") + e.what());
+        }
+        return;
+    }
+    throw std::runtime_error(std::string(spirv) + " built without the expected '" + fragment + "' error");
+}
+
+void bench() {
+    TestContext ctx(VulkanContextOptions().uniformBuffers(), false);
+    auto table = uniformTable(randomTable());
+    ShaderModule shader(ShaderBuilder().compute().fromFile("tests/shaders/constant_fetch.comp.spv"));
+    Pipeline uniformPipeline = fetchPipeline(shader, true);
+    Pipeline storagePipeline = fetchPipeline(shader, false);
+
+    const uint32_t groups = 4096;
+    const uint32_t iterations = 4096;
+    BufferBuilder outBuilder(size_t(groups) * kWorkgroupSize * sizeof(uint32_t));
+    outBuilder.storage().deviceLocal();
+    Buffer out(outBuilder);
+    FetchPush push = { table->rid(), table->uniformRid(), out.rid(), iterations };
+
+    GpuTimer timer(2);
+    for (int run = 0; run < 3; ++run) {   // first runs warm clocks and caches
+        auto cmd = Commands::oneShot();
+        cmd.pushConstants(push);
+        timer.begin(cmd);
+        cmd.bindCompute(uniformPipeline);
+        cmd.dispatch(groups, 1, 1);
+        timer.mark(cmd, "uniform buffer");
+        cmd.bufferBarrier(out, Stage::Compute, Access::ShaderWrite, Stage::Compute, Access::ShaderWrite);
+        cmd.bindCompute(storagePipeline);
+        cmd.dispatch(groups, 1, 1);
+        timer.mark(cmd, "storage buffer");
+        cmd.submitAndWait();
+    }
+    double fetches = double(groups) * kWorkgroupSize * iterations;
+    std::cout << "constant fetch benchmark (" << groups * kWorkgroupSize << " invocations x "
+              << iterations << " uvec4 fetches)\n";
+    for (auto& [label, ms] : timer.resolve()) {
+        std::cout << "  " << label << ": " << ms << " ms, " << fetches / (ms * 1e6) << " Gfetch/s\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return runTests("uniform buffer", argc, argv, [] {
+        {
+            TestContext ctx(VulkanContextOptions().uniformBuffers());
+            testRids();
+            testFetchOracle();
+            expectPipelineError("tests/shaders/uniform_at_storage_binding.comp.spv", "uniform blocks belong at binding 4");
+        }
+        {
+            TestContext ctx;
+            expectPipelineError("tests/shaders/constant_fetch.comp.spv", "references binding 4");
+        }
+    }, bench);
+}
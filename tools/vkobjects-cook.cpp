@@ -0,0 +1,84 @@
+#include "vkobjects.h"
+#include "tga.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Cooks TGA files into GPU-ready textures (cookTexture / loadCookedTexture).
+//
+//   vkobjects-cook [--kaiser] [--bc1 | --bc3] [--linear] [--threads N] <input> <output>
+//
+// <input> is a .tga file or a directory; a directory is cooked recursively into <output> as a
+// mirrored tree of .vktex files, ready for vkobjects-pack.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void cookFile(const fs::path& input, const fs::path& output, const TextureCookOptions& options) {
+    std::ifstream file(input, std::ios::binary);
+    if (!file) throw std::runtime_error("failed to open " + input.string());
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    unsigned width, height;
+    int bpp;
+    uint8_t* pixels = static_cast<uint8_t*>(read_tga(bytes, width, height, bpp));
+    std::vector<uint8_t> bgra(size_t(width) * height * 4);
+    for (size_t i = 0; i < size_t(width) * height; ++i) {
+        bgra[i * 4 + 0] = pixels[i * (bpp / 8) + 0];
+        bgra[i * 4 + 1] = pixels[i * (bpp / 8) + 1];
+        bgra[i * 4 + 2] = pixels[i * (bpp / 8) + 2];
+        bgra[i * 4 + 3] = bpp == 32 ? pixels[i * 4 + 3] : 255;
+    }
+    free(pixels);
+
+    std::vector<uint8_t> cooked = cookTexture(bgra.data(), width, height, options);
+    if (output.has_parent_path()) fs::create_directories(output.parent_path());
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(cooked.data()), std::streamsize(cooked.size()));
+    if (!out) throw std::runtime_error("failed to write " + output.string());
+    std::cout << input.string() << " -> " << output.string() << " (" << width << "x" << height << ", "
+              << cooked.size() << " bytes)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TextureCookOptions options;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--kaiser") options.kaiser();
+        else if (arg == "--bc1") options.bc1();
+        else if (arg == "--bc3") options.bc3();
+        else if (arg == "--linear") options.linear();
+        else if (arg == "--threads" && i + 1 < argc) options.threadCount(uint32_t(std::atoi(argv[++i])));
+        else paths.push_back(arg);
+    }
+    if (paths.size() != 2) {
+        std::cerr << "usage: vkobjects-cook [--kaiser] [--bc1 | --bc3] [--linear] [--threads N] <input> <output>\n";
+        return 2;
+    }
+    try {
+        fs::path input(paths[0]), output(paths[1]);
+        if (!fs::is_directory(input)) {
+            cookFile(input, output, options);
+            return 0;
+        }
+        for (auto& entry : fs::recursive_directory_iterator(input)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".tga") continue;
+            fs::path target = output / entry.path().lexically_relative(input);
+            target.replace_extension(".vktex");
+            cookFile(entry.path(), target, options);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "vkobjects-cook: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
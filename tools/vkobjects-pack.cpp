@@ -0,0 +1,34 @@
+#include "vkobjects.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Packs a directory into an AssetArchive, or lists an archive's entries.
+//
+//   vkobjects-pack <directory> <archive>
+//   vkobjects-pack --list <archive>
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "usage: vkobjects-pack <directory> <archive>\n"
+                  << "       vkobjects-pack --list <archive>\n";
+        return 2;
+    }
+    try {
+        if (std::string(argv[1]) == "--list") {
+            AssetArchive archive(argv[2]);
+            for (size_t i = 0; i < archive.size(); ++i) {
+                std::string_view name = archive.name(i);
+                std::cout << archive.find(name).size() << "\t" << name << "\n";
+            }
+            return 0;
+        }
+        size_t count = AssetArchive::pack(argv[1], argv[2]);
+        std::cout << "packed " << count << " files from " << argv[1] << " into " << argv[2] << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "vkobjects-pack: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}